@@ -1,45 +1,101 @@
 #ifndef FS_H
 #define FS_H
 
+#ifdef __SWITCH__
 #include <switch.h>
+#else
+#include <stdint.h>
+#endif
 
 /**
  * Filesystem Module
  * 
  * Provides directory listing and navigation functionality.
  * Works with the SD card via both "/" (default) and "sdmc:/" paths.
- * Uses standard POSIX directory operations (opendir, readdir, closedir).
+ * I/O goes through the VFS module: on Switch, listings are read natively
+ * with fsDirRead in large batches; host builds use POSIX directory
+ * operations so the listing engine can be benchmarked on Linux.
  */
 
+/* Maximum path length used throughout the browser */
+#define FS_MAX_PATH 512
+
+/* Number of entries requested per fsDirRead call */
+#define FS_LIST_BATCH 256
+
+/* Readable bytes guaranteed past the end of any name in the arena, so
+ * 16-byte vector loads starting inside a name never leave the buffer */
+#define FS_NAME_SLACK 16
+
+/* FsDirectory.flags bits */
+#define FS_ENTRY_DIR 0x01    // Entry is a directory
+#define FS_ENTRY_SIZED 0x02  // Directory size column holds its computed total
+#define FS_ENTRY_SPLIT 0x04  // Split file: a folder of parts listed as one file
+
 /**
- * FsEntry - Represents a single file or directory entry
+ * FsEntry - Read-only view of a single file or directory entry
+ * 'name' points into the owning FsDirectory's name arena and stays valid
+ * until that directory is modified or freed.
  */
 typedef struct {
-    char name[256];      // File/folder name
+    const char* name;    // File/folder name (NUL-terminated)
+    int name_len;        // Length of name in bytes
     int is_dir;          // 1 if directory, 0 if file
     uint64_t size;       // File size in bytes (0 for directories)
 } FsEntry;
 
 /**
- * FsDirectory - Contains directory listing with dynamic array
+ * FsDirectory - Directory listing in a compact structure-of-arrays layout
+ * All names live back to back in one arena; per-entry data is kept in
+ * parallel arrays so sorting and filtering scan small, dense columns.
+ * Access entries through the fs_dir_* functions below.
  */
 typedef struct {
-    FsEntry* entries;    // Array of directory entries (malloc'd)
-    int count;           // Number of entries in array
-    int capacity;        // Allocated capacity (grows as needed)
+    char* names;               // Packed NUL-terminated names (malloc'd)
+    uint32_t names_used;       // Bytes used in the name arena
+    uint32_t names_capacity;   // Bytes allocated for the name arena
+    uint32_t* name_offsets;    // Offset of each name in the arena
+    uint16_t* name_lengths;    // Length of each name
+    uint64_t* sizes;           // File size of each entry (0 for directories)
+    uint8_t* flags;            // FS_ENTRY_* bits for each entry
+    int count;                 // Number of entries
+    int capacity;              // Allocated entry slots (grows as needed)
+    int sort_tag;              // Order applied by the sort module (0 = listing order)
 } FsDirectory;
 
+/**
+ * FsListStats - Cost of a single directory listing
+ */
+typedef struct {
+    uint64_t entries;        // Entries returned
+    uint64_t service_calls;  // Filesystem round trips (open/read/close/stat)
+    uint64_t first_batch_ns; // Time until the first batch of entries was ready
+    uint64_t elapsed_ns;     // Wall time spent listing
+} FsListStats;
+
+/* fs_stream_pump() states */
+#define FS_STREAM_LOADING 0  // Worker still reading
+#define FS_STREAM_DONE    1  // Listing complete, all entries delivered
+#define FS_STREAM_ERROR   2  // Directory could not be opened
+
+/**
+ * FsListStream - Directory listing filled by a background worker
+ */
+typedef struct FsListStream FsListStream;
+
 /**
  * fs_init()
  * Initialize the filesystem module.
- * No special initialization needed for libnx.
+ * Starts the VFS layer: on Switch it uses the SD card session already
+ * mounted as "sdmc", or opens one of its own (never mounted).
  */
 void fs_init(void);
 
 /**
  * fs_cleanup()
  * Cleanup filesystem resources.
- * No special cleanup needed at module level.
+ * Stops the VFS layer, closing the SD card session only if it opened
+ * its own. Nothing is unmounted.
  */
 void fs_cleanup(void);
 
@@ -51,6 +107,60 @@ void fs_cleanup(void);
  */
 FsDirectory* fs_list_directory(const char* path);
 
+/**
+ * fs_list_directory_stats(path, stats)
+ * Same as fs_list_directory() but also fills 'stats' (may be NULL)
+ * with the number of entries, service calls and elapsed time.
+ */
+FsDirectory* fs_list_directory_stats(const char* path, FsListStats* stats);
+
+/**
+ * fs_stream_open(path)
+ * Start listing 'path' on a background worker and return immediately.
+ * Returns NULL if the worker cannot be started.
+ * Release with fs_stream_close().
+ */
+FsListStream* fs_stream_open(const char* path);
+
+/**
+ * fs_stream_open_background(path)
+ * Same as fs_stream_open(), but the worker runs below the UI thread's
+ * priority. Use for speculative listings nobody is waiting for yet.
+ */
+FsListStream* fs_stream_open_background(const char* path);
+
+/**
+ * fs_stream_pump(stream, dest)
+ * Append every entry the worker produced since the last call to 'dest'.
+ * Call from the thread that owns 'dest' (once per frame).
+ * Returns FS_STREAM_LOADING, FS_STREAM_DONE or FS_STREAM_ERROR.
+ */
+int fs_stream_pump(FsListStream* stream, FsDirectory* dest);
+
+/**
+ * fs_stream_get_stats(stream, out)
+ * Copy the listing statistics (including time to first batch) into 'out'.
+ * Zeroed while the stream is still loading.
+ */
+void fs_stream_get_stats(FsListStream* stream, FsListStats* out);
+
+/**
+ * fs_stream_cancel(stream)
+ * Ask the worker to stop after its current batch without waiting for it.
+ * The stream must still be released with fs_stream_close(), which
+ * returns immediately once fs_stream_pump() no longer reports
+ * FS_STREAM_LOADING.
+ */
+void fs_stream_cancel(FsListStream* stream);
+
+/**
+ * fs_stream_close(stream)
+ * Cancel the worker after its current batch, wait for it and free the
+ * stream. Entries already pumped stay in the caller's directory.
+ * Safe to call with NULL pointer.
+ */
+void fs_stream_close(FsListStream* stream);
+
 /**
  * fs_free_directory(dir)
  * Free memory allocated by fs_list_directory().
@@ -72,6 +182,14 @@ void fs_build_path(const char* current_path, const char* entry_name, char* dest)
  */
 int fs_is_valid_path(const char* path);
 
+/**
+ * fs_get_mtime(path, out)
+ * Read the modification timestamp of a file or directory into 'out'
+ * (seconds, only meaningful for comparing against an earlier value).
+ * Returns 0 on success, -1 if the path cannot be queried.
+ */
+int fs_get_mtime(const char* path, uint64_t* out);
+
 /**
  * fs_is_directory(entry)
  * Check if entry represents a directory.
@@ -79,4 +197,93 @@ int fs_is_valid_path(const char* path);
  */
 int fs_is_directory(const FsEntry* entry);
 
+/**
+ * fs_dir_create(capacity)
+ * Allocate an empty listing with room for 'capacity' entries.
+ * Returns NULL on allocation failure. Free with fs_free_directory().
+ */
+FsDirectory* fs_dir_create(int capacity);
+
+/**
+ * fs_dir_reserve(dir, capacity)
+ * Make room for at least 'capacity' entries without reallocating.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int fs_dir_reserve(FsDirectory* dir, int capacity);
+
+/**
+ * fs_dir_append(dir, name, is_dir, size)
+ * Append an entry, growing the arena and columns as needed.
+ * "." and ".." are silently skipped.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int fs_dir_append(FsDirectory* dir, const char* name, int is_dir, uint64_t size);
+
+/**
+ * fs_dir_permute(dir, order)
+ * Reorder entries so that new entry i is old entry order[i]. 'order'
+ * must be a permutation of [0, count). Only the per-entry columns are
+ * moved; the name arena stays in place.
+ * Returns 0 on success, -1 on allocation failure (listing unchanged).
+ */
+int fs_dir_permute(FsDirectory* dir, const uint32_t* order);
+
+/**
+ * fs_dir_clear(dir)
+ * Remove all entries while keeping the allocated storage.
+ */
+void fs_dir_clear(FsDirectory* dir);
+
+/**
+ * Entry accessors
+ * Index must be in [0, fs_dir_count(dir)); out-of-range indices return
+ * "" / 0 rather than crashing.
+ */
+int fs_dir_count(const FsDirectory* dir);
+const char* fs_dir_name(const FsDirectory* dir, int index);
+int fs_dir_name_length(const FsDirectory* dir, int index);
+int fs_dir_is_dir(const FsDirectory* dir, int index);
+uint64_t fs_dir_size(const FsDirectory* dir, int index);
+
+/**
+ * fs_dir_set_size(dir, index, size) / fs_dir_size_known(dir, index)
+ * Record the computed total size of a directory entry, and check whether
+ * an entry's size is known (always true for files).
+ */
+void fs_dir_set_size(FsDirectory* dir, int index, uint64_t size);
+int fs_dir_size_known(const FsDirectory* dir, int index);
+
+/**
+ * fs_dir_set_split(dir, index, size) / fs_dir_is_split(dir, index)
+ * Turn directory entry 'index' into a split file of 'size' bytes (see
+ * vfs_split_probe()), and check whether an entry is one.
+ */
+void fs_dir_set_split(FsDirectory* dir, int index, uint64_t size);
+int fs_dir_is_split(const FsDirectory* dir, int index);
+
+/**
+ * fs_dir_get_entry(dir, index, out)
+ * Fill 'out' with a view of entry 'index'.
+ * Returns 0 on success, -1 if index is out of range.
+ */
+int fs_dir_get_entry(const FsDirectory* dir, int index, FsEntry* out);
+
+/**
+ * fs_dir_find(dir, name)
+ * Return the index of the entry called 'name', or -1 if absent.
+ */
+int fs_dir_find(const FsDirectory* dir, const char* name);
+
+/**
+ * fs_dir_memory_usage(dir)
+ * Bytes allocated for the listing, including unused capacity.
+ */
+uint64_t fs_dir_memory_usage(const FsDirectory* dir);
+
+/**
+ * fs_now_ns()
+ * Monotonic timestamp in nanoseconds (system tick on Switch).
+ */
+uint64_t fs_now_ns(void);
+
 #endif
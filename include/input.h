@@ -41,6 +41,14 @@ int input_select(void);   // A button (confirm/select)
 int input_back(void);     // B button (cancel/back)
 int input_exit(void);     // Plus button (exit application)
 int input_fileops(void);  // X button (open file operations overlay)
+int input_sort(void);     // Y button (cycle listing sort order)
+int input_filter(void);   // Minus button (type-to-filter)
+int input_search(void);   // R button (search the whole card)
+int input_largest(void);  // L button (largest items on the card)
+int input_jobs(void);     // ZR button (background jobs panel)
+int input_undo(void);     // ZL button (undo the last delete)
+int input_mark(void);     // Right stick press (mark the selected entry)
+int input_marks(void);    // Left stick press (marking menu)
 
 /**
  * input_power_pressed()
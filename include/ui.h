@@ -2,10 +2,15 @@
 #define UI_H
 
 #include "fs.h"
+#include "sort.h"
+#include "filter.h"
+#include "jobs.h"
+#include "select.h"
 
 /* popup type constants (match values used internally in ui.c) */
 #define POPUP_NONE    0
 #define POPUP_MESSAGE 1
+#define POPUP_CONFIRM 3
 
 /* overlay operation codes (used in dynamic menus) */
 #define UI_OP_COPY    0
@@ -15,6 +20,14 @@
 #define UI_OP_RENAME  4
 #define UI_OP_LAUNCH  5
 #define UI_OP_INSTALL 6
+#define UI_OP_HASH    7
+#define UI_OP_VERIFY  8
+#define UI_OP_SYNC    9
+#define UI_OP_MARK_ALL     10
+#define UI_OP_MARK_INVERT  11
+#define UI_OP_MARK_PATTERN 12
+#define UI_OP_MARK_CLEAR   13
+#define UI_OP_CLIP_CLEAR   14
 
 /**
  * UI Module
@@ -32,18 +45,54 @@ typedef struct {
     int selected_index;            // Index of selected entry (0-based)
     int scroll_offset;             // First visible entry index for scrolling
     char current_path[512];        // Full path of current directory
+
+    // Progressive loading state
+    FsListStream* loading;         // Worker filling current_dir (NULL when idle)
+    uint64_t load_start_ns;        // When the current listing was started
+    uint64_t load_first_row_ns;    // Time until the first row was drawn (0 = not yet)
+    uint64_t load_total_ns;        // Time until the listing completed (0 = not yet)
+    char pending_select[256];      // Entry to select once it is listed ("" = none)
+    SortOptions sort;              // Order applied to every listing
+
+    // Type-to-filter state (selected_index stays an index into current_dir)
+    int filter_active;             // 1 while only matching entries are shown
+    char filter_query[FILTER_MAX_QUERY]; // Query as typed
+    int filter_char;               // Picker position in the filter charset
+    int filter_pos;                // Selected row among the matches
+    int filter_scroll;             // First visible match row
+    FilterState filter;            // Matches for filter_query
+
+    // Global search results replace the listing; current_path keeps the
+    // folder to return to and entry names are full paths
+    int search_active;             // 1 while search results are shown
+    char search_title[96];         // What the results are ("Search: ...")
+
+    // Entries marked for a batch operation (indices into current_dir)
+    Selection marks;
+
+    // Folder sizes computed in the background for the current listing
+    uint32_t listing_id;           // Changes whenever current_dir is replaced
+    int sizes_pending;             // Folder totals requested but not yet in
     
+    // Background jobs, refreshed every frame
+    int jobs_active;               // 1 while the jobs panel is open
+    int jobs_selected;             // Selected row of the panel
+    JobInfo jobs[JOBS_MAX];        // Queued and running jobs, oldest first
+    int job_count;
+    ProgressView job_views[JOBS_MAX];  // Rates and ETA, matched by job id
+
     // Overlay menu state
     int overlay_active;            // 1 if overlay menu is open
     int overlay_selected;          // Currently selected menu option (index into dynamic list)
     int overlay_count;             // number of items currently in overlay
     int overlay_codes[8];          // operation codes for each slot
     char overlay_labels[8][32];    // label text for each slot
+    char overlay_title[16];        // heading of the menu
 
     // Popup notification state
     int popup_active;              // 1 if a popup is currently visible
     int popup_type;                // 0=none,1=message
-    char popup_message[256];       // message text for simple popups
+    char popup_message[512];       // message text for simple popups, '\n' breaks lines
     int popup_timer;               // frames remaining before auto-dismiss (for message)
 } UIState;
 
@@ -75,11 +124,11 @@ void ui_select_next(UIState* ui_state);
 void ui_select_prev(UIState* ui_state);
 
 /**
- * ui_get_selected_entry(ui_state)
- * Get pointer to currently selected directory entry.
- * Returns NULL if no valid selection.
+ * ui_get_selected_entry(ui_state, out)
+ * Fill 'out' with a view of the currently selected directory entry.
+ * Returns 0 on success, -1 if no valid selection.
  */
-FsEntry* ui_get_selected_entry(UIState* ui_state);
+int ui_get_selected_entry(UIState* ui_state, FsEntry* out);
 
 /**
  * ui_get_selected_path(ui_state, dest)
@@ -91,7 +140,8 @@ void ui_get_selected_path(UIState* ui_state, char* dest);
 /**
  * ui_enter_directory(ui_state)
  * Change to selected directory if it's a folder.
- * Resets selection to top of new directory.
+ * Restores the folder's remembered cursor, or starts at the top.
+ * In search results a file opens its folder with the file selected.
  * Returns 0 on success, -1 if entry is not a directory or access fails.
  */
 int ui_enter_directory(UIState* ui_state);
@@ -99,11 +149,156 @@ int ui_enter_directory(UIState* ui_state);
 /**
  * ui_go_back(ui_state)
  * Navigate to parent directory.
- * Resets selection to top of parent directory.
+ * Selects the folder we came from in the parent listing.
+ * From search results, returns to the folder the search started in.
  * Returns 0 on success, -1 if already at root.
  */
 int ui_go_back(UIState* ui_state);
 
+/**
+ * ui_refresh_directory(ui_state)
+ * Re-list the current directory in the background, keeping the cursor
+ * where it was (clamped once the listing completes).
+ * Returns 0 on success, -1 if the directory is no longer accessible.
+ */
+int ui_refresh_directory(UIState* ui_state);
+
+/**
+ * ui_is_loading(ui_state)
+ * Returns 1 while the current directory is still being listed.
+ */
+int ui_is_loading(UIState* ui_state);
+
+/**
+ * ui_cancel_loading(ui_state)
+ * Stop listing the current directory, keeping the entries read so far.
+ */
+void ui_cancel_loading(UIState* ui_state);
+
+/**
+ * ui_cycle_sort(ui_state)
+ * Switch to the next sort mode and re-sort the current listing, keeping
+ * the cursor on the same entry.
+ */
+void ui_cycle_sort(UIState* ui_state);
+
+/**
+ * ui_show_search(ui_state, query)
+ * Search the whole-card index for names containing 'query' and show the
+ * results in place of the listing.
+ * Returns the number of results (the listing is unchanged when 0), or
+ * -1 on failure.
+ */
+int ui_show_search(UIState* ui_state, const char* query);
+
+/**
+ * ui_show_largest(ui_state)
+ * Show the largest files and folders on the whole card (from the index)
+ * in place of the listing.
+ * Returns the number of items shown (the listing is unchanged when 0),
+ * or -1 on failure.
+ */
+int ui_show_largest(UIState* ui_state);
+
+/**
+ * ui_is_search(ui_state)
+ * Returns 1 while search results are shown.
+ */
+int ui_is_search(UIState* ui_state);
+
+/**
+ * ui_jump_initial(ui_state, direction)
+ * Move the cursor to the next (direction > 0) or previous run of entries
+ * starting with a different letter, wrapping around.
+ */
+void ui_jump_initial(UIState* ui_state, int direction);
+
+/**
+ * Type-to-filter
+ *
+ * While the filter is open only entries matching the query are listed,
+ * best match first. Each edit refines the previous matches rather than
+ * rescanning the whole listing.
+ */
+
+/**
+ * ui_filter_open(ui_state) / ui_filter_close(ui_state)
+ * Show or hide the filter. Closing keeps the cursor on the entry that
+ * was selected among the matches.
+ */
+void ui_filter_open(UIState* ui_state);
+void ui_filter_close(UIState* ui_state);
+
+/**
+ * ui_filter_is_active(ui_state)
+ * Returns 1 while the filter is open.
+ */
+int ui_filter_is_active(UIState* ui_state);
+
+/**
+ * ui_filter_set_query(ui_state, query)
+ * Replace the filter query and re-filter the listing.
+ */
+void ui_filter_set_query(UIState* ui_state, const char* query);
+
+/**
+ * ui_filter_append(ui_state) / ui_filter_backspace(ui_state)
+ * Append the picker character to the query, or remove the last one.
+ * ui_filter_backspace returns -1 if the query was already empty.
+ */
+void ui_filter_append(UIState* ui_state);
+int ui_filter_backspace(UIState* ui_state);
+
+/**
+ * ui_filter_cycle_char(ui_state, direction)
+ * Step the character picker forwards or backwards through its charset.
+ */
+void ui_filter_cycle_char(UIState* ui_state, int direction);
+
+/**
+ * Marking entries
+ *
+ * Marked entries are what Copy, Move and Delete work on, as one batch
+ * job, in place of the entry under the cursor. Marks belong to the
+ * listing on screen: sorting keeps them, listing a folder (this one
+ * again included) clears them. While the filter is open, marking all
+ * and inverting only touch the matches.
+ */
+
+/**
+ * ui_mark_toggle(ui_state)
+ * Mark or unmark the entry under the cursor and move to the next one.
+ */
+void ui_mark_toggle(UIState* ui_state);
+
+/**
+ * ui_mark_all(ui_state) / ui_mark_invert(ui_state) / ui_mark_clear(ui_state)
+ * Mark every entry, flip every mark, or unmark everything.
+ */
+void ui_mark_all(UIState* ui_state);
+void ui_mark_invert(UIState* ui_state);
+void ui_mark_clear(UIState* ui_state);
+
+/**
+ * ui_mark_matching(ui_state, pattern)
+ * Also mark the entries whose name matches 'pattern' (see select_match()).
+ * Returns the number of entries newly marked.
+ */
+int ui_mark_matching(UIState* ui_state, const char* pattern);
+
+/**
+ * ui_marked_count(ui_state)
+ * Returns the number of marked entries.
+ */
+int ui_marked_count(UIState* ui_state);
+
+/**
+ * ui_get_marked_paths(ui_state, out)
+ * Append the full path of every marked entry to 'out', in listing order.
+ * Returns the number appended, or -1 on allocation failure.
+ */
+int ui_get_marked_paths(UIState* ui_state, FsDirectory* out);
+
 /**
  * ui_cleanup(ui_state)
  * Free UI resources. Call before application exit.
@@ -121,6 +316,13 @@ void ui_cleanup(UIState* ui_state);
  */
 void ui_open_overlay(UIState* ui_state);
 
+/**
+ * ui_open_marks(ui_state)
+ * Open the overlay menu with the marking commands (and emptying the
+ * clipboard when it holds anything).
+ */
+void ui_open_marks(UIState* ui_state);
+
 /**
  * ui_close_overlay(ui_state)
  * Close the file operations overlay menu.
@@ -145,6 +347,34 @@ void ui_overlay_select_prev(UIState* ui_state);
  */
 int ui_overlay_get_selected(UIState* ui_state);
 
+/**
+ * ui_open_jobs(ui_state) / ui_close_jobs(ui_state)
+ * Show or hide the panel listing queued and running jobs. While no panel
+ * is open, running jobs are summed up on the bottom line.
+ */
+void ui_open_jobs(UIState* ui_state);
+void ui_close_jobs(UIState* ui_state);
+
+/**
+ * ui_jobs_select_next(ui_state) / ui_jobs_select_prev(ui_state)
+ * Move the selection in the jobs panel.
+ */
+void ui_jobs_select_next(UIState* ui_state);
+void ui_jobs_select_prev(UIState* ui_state);
+
+/**
+ * ui_jobs_get_selected(ui_state)
+ * Get the selected job of the panel, or NULL if there is none.
+ */
+const JobInfo* ui_jobs_get_selected(UIState* ui_state);
+
+/**
+ * ui_show_job_result(ui_state, info)
+ * Pop up how finished job 'info' ended, with its totals, time taken and
+ * average throughput.
+ */
+void ui_show_job_result(UIState* ui_state, const JobInfo* info);
+
 /* Popup system helpers */
 
 /**
@@ -154,6 +384,13 @@ int ui_overlay_get_selected(UIState* ui_state);
  */
 void ui_show_message(UIState* ui_state, const char* msg, int duration);
 
+/**
+ * ui_show_confirm(ui_state, msg)
+ * Ask a yes/no question: 'msg' ('\n' breaks lines) stays up until A (yes)
+ * or B (no).
+ */
+void ui_show_confirm(UIState* ui_state, const char* msg);
+
 /**
 
 /**
@@ -163,6 +400,7 @@ void ui_show_message(UIState* ui_state, const char* msg, int duration);
  *   0 = popup was dismissed this frame
  *   1 = popup still active, no special event
  *   2 = rename dialog confirmed (buffer contains new name)
+ *   3 = question of ui_show_confirm() answered yes (no returns 0)
  */
 int ui_process_popup_input(UIState* ui_state);
 
@@ -0,0 +1,1319 @@
+#include "bench.h"
+#include "fs.h"
+#include "sort.h"
+#include "filter.h"
+#include "dirsize.h"
+#include "prefetch.h"
+#include "vfs.h"
+#include "copy.h"
+#include "delete.h"
+#include "walk.h"
+#include "transfer.h"
+#include "copysched.h"
+#include "sync.h"
+#include "trash.h"
+#include "move.h"
+#include "select.h"
+#include "clipboard.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+
+/**
+ * Benchmark module implementation
+ */
+
+// Listing entry layout used before the arena FsDirectory (272 bytes)
+typedef struct {
+    char name[256];
+    int is_dir;
+    uint64_t size;
+} BenchLegacyEntry;
+
+// Deterministic synthetic file name for index i
+static void bench_synth_name(int i, char* out, size_t outlen)
+{
+    static const char* stems[] = {"Super Game", "save", "IMG", "rom", "Track", "patch"};
+    static const char* exts[] = {".nsp", ".jpg", ".bin", ".sav", ".mp4", ".xci"};
+    snprintf(out, outlen, "%s %d%s", stems[i % 6], (i * 7919) % 100000, exts[(i / 6) % 6]);
+}
+
+// Count names containing 'needle' (lowercase) case-insensitively
+static int bench_ci_contains(const char* name, const char* needle)
+{
+    for (; *name; name++) {
+        const char* a = name;
+        const char* b = needle;
+        while (*a && *b && tolower((unsigned char)*a) == *b) { a++; b++; }
+        if (*b == '\0')
+            return 1;
+    }
+    return 0;
+}
+
+// Create (or reuse) 'path' holding 'size' bytes of filler
+static int bench_make_file(const char* path, uint64_t size)
+{
+    VfsStat st;
+    if (vfs_stat(path, &st) == 0 && st.size == size)
+        return 0;
+
+    VfsFile* f = vfs_open(path, VFS_OPEN_WRITE | VFS_OPEN_CREATE);
+    if (f == NULL)
+        return -1;
+
+    char pad[4096];
+    memset(pad, 'x', sizeof(pad));
+    uint64_t offset = 0;
+    int rc = 0;
+    while (offset < size && rc == 0) {
+        uint64_t chunk = size - offset < sizeof(pad) ? size - offset : sizeof(pad);
+        rc = vfs_write(f, offset, pad, chunk);
+        offset += chunk;
+    }
+    vfs_close(f);
+    return rc;
+}
+
+int bench_make_tree(const char* root, int files, int dirs)
+{
+    if (root == NULL || files < 0 || dirs < 0)
+        return -1;
+
+    vfs_mkdir(root);
+
+    char path[FS_MAX_PATH];
+    for (int i = 0; i < dirs; i++) {
+        snprintf(path, sizeof(path), "%s/dir_%05d", root, i);
+        vfs_mkdir(path);
+    }
+
+    for (int i = 0; i < files; i++) {
+        snprintf(path, sizeof(path), "%s/rom_%05d.bin", root, i);
+        // Give files distinct, non-zero sizes so size reporting is exercised
+        if (bench_make_file(path, (uint64_t)(i % 64) + 1) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int bench_listing(const char* path, int iterations, BenchListingResult* out)
+{
+    if (path == NULL || out == NULL || iterations <= 0)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < iterations; i++) {
+        FsListStats stats;
+        FsDirectory* dir = fs_list_directory_stats(path, &stats);
+        if (dir == NULL)
+            return -1;
+        fs_free_directory(dir);
+
+        out->entries = stats.entries;
+        out->service_calls += stats.service_calls;
+        out->elapsed_ns += stats.elapsed_ns;
+        out->iterations++;
+    }
+
+    if (out->elapsed_ns > 0)
+        out->entries_per_sec = (double)out->entries * out->iterations * 1e9 / (double)out->elapsed_ns;
+    out->calls_per_listing = (double)out->service_calls / out->iterations;
+    return 0;
+}
+
+int bench_stream(const char* path, FsListStats* out)
+{
+    if (path == NULL || out == NULL)
+        return -1;
+
+    FsDirectory* dir = fs_dir_create(FS_LIST_BATCH);
+    FsListStream* stream = fs_stream_open(path);
+    if (dir == NULL || stream == NULL) {
+        fs_free_directory(dir);
+        fs_stream_close(stream);
+        return -1;
+    }
+
+    int state;
+    while ((state = fs_stream_pump(stream, dir)) == FS_STREAM_LOADING) {
+        // Poll the way the UI does, once per "frame"
+        struct timespec frame = {0, 1000000};
+        nanosleep(&frame, NULL);
+    }
+    fs_stream_get_stats(stream, out);
+    out->entries = (uint64_t)fs_dir_count(dir);
+
+    fs_stream_close(stream);
+    fs_free_directory(dir);
+    return state == FS_STREAM_DONE ? 0 : -1;
+}
+
+// Time one sort of a fresh copy of 'src'
+static int bench_sort_once(const FsDirectory* src, const SortOptions* opts, uint64_t* ns)
+{
+    FsDirectory* dir = fs_dir_create(src->count);
+    if (dir == NULL)
+        return -1;
+    for (int i = 0; i < src->count; i++)
+        fs_dir_append(dir, fs_dir_name(src, i), fs_dir_is_dir(src, i), fs_dir_size(src, i));
+
+    uint64_t start = fs_now_ns();
+    int rc = sort_directory(dir, opts);
+    *ns = fs_now_ns() - start;
+
+    fs_free_directory(dir);
+    return rc;
+}
+
+int bench_sort(int entries, int mode, BenchSortResult* out)
+{
+    if (entries <= 0 || out == NULL || mode < 0 || mode >= SORT_MODE_COUNT)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->entries = entries;
+    out->mode = mode;
+
+    FsDirectory* src = fs_dir_create(entries);
+    if (src == NULL)
+        return -1;
+    char name[64];
+    for (int i = 0; i < entries; i++) {
+        bench_synth_name(i, name, sizeof(name));
+        fs_dir_append(src, name, (i % 40) == 0, (uint64_t)((i * 2654435761u) % 100000000u));
+    }
+
+    SortOptions opts;
+    opts.mode = (SortMode)mode;
+    opts.dirs_first = 1;
+    opts.max_threads = 1;
+    int rc = bench_sort_once(src, &opts, &out->serial_ns);
+    opts.max_threads = 0;
+    if (rc == 0)
+        rc = bench_sort_once(src, &opts, &out->parallel_ns);
+
+    fs_free_directory(src);
+    return rc;
+}
+
+int bench_filter(int entries, const char* query, BenchFilterResult* out)
+{
+    if (entries <= 0 || query == NULL || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->entries = entries;
+
+    FsDirectory* dir = fs_dir_create(entries);
+    if (dir == NULL)
+        return -1;
+    char name[64];
+    for (int i = 0; i < entries; i++) {
+        bench_synth_name(i, name, sizeof(name));
+        fs_dir_append(dir, name, 0, 0);
+    }
+
+    FilterState state;
+    filter_init(&state);
+    char typed[FILTER_MAX_QUERY];
+    int len = (int)strlen(query);
+    if (len > FILTER_MAX_QUERY - 1)
+        len = FILTER_MAX_QUERY - 1;
+
+    int rc = 0;
+    for (int k = 1; k <= len && rc == 0; k++) {
+        memcpy(typed, query, (size_t)k);
+        typed[k] = '\0';
+        for (int j = 0; j < k; j++)
+            typed[j] = (char)tolower((unsigned char)typed[j]);
+
+        uint64_t start = fs_now_ns();
+        rc = filter_set_query(&state, dir, typed);
+        uint64_t ns = fs_now_ns() - start;
+        out->total_ns += ns;
+        if (ns > out->worst_ns)
+            out->worst_ns = ns;
+
+        start = fs_now_ns();
+        volatile int naive = 0;
+        for (int i = 0; i < entries; i++)
+            naive += bench_ci_contains(fs_dir_name(dir, i), typed);
+        out->naive_ns += fs_now_ns() - start;
+        out->keystrokes = k;
+    }
+    out->matches = state.match_count;
+
+    filter_free(&state);
+    fs_free_directory(dir);
+    return rc;
+}
+
+// Request every subfolder of 'dir' and wait for all totals
+static uint64_t bench_dirsize_pass(const char* path, const FsDirectory* dir, uint64_t* bytes)
+{
+    uint64_t start = fs_now_ns();
+    int pending = 0;
+    char child[FS_MAX_PATH];
+    for (int i = 0; i < fs_dir_count(dir); i++) {
+        if (!fs_dir_is_dir(dir, i))
+            continue;
+        snprintf(child, sizeof(child), "%s/%s", path, fs_dir_name(dir, i));
+        if (dirsize_request(child, 1) == 0)
+            pending++;
+    }
+
+    DirSizeResult results[16];
+    *bytes = 0;
+    while (pending > 0) {
+        int n = dirsize_poll(results, 16);
+        for (int k = 0; k < n; k++)
+            *bytes += results[k].bytes;
+        pending -= n;
+        if (n == 0) {
+            struct timespec ts = {0, 100000};
+            nanosleep(&ts, NULL);
+        }
+    }
+    return fs_now_ns() - start;
+}
+
+int bench_dirsize(const char* path, int threads, BenchDirSizeResult* out)
+{
+    if (path == NULL || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    FsDirectory* dir = fs_list_directory(path);
+    if (dir == NULL)
+        return -1;
+    for (int i = 0; i < fs_dir_count(dir); i++)
+        out->folders += fs_dir_is_dir(dir, i);
+
+    dirsize_cleanup();
+    if (dirsize_init(threads) != 0) {
+        fs_free_directory(dir);
+        return -1;
+    }
+    out->threads = threads;
+
+    uint64_t bytes = 0;
+    out->cold_ns = bench_dirsize_pass(path, dir, &out->bytes);
+    out->warm_ns = bench_dirsize_pass(path, dir, &bytes);
+
+    dirsize_cleanup();
+    fs_free_directory(dir);
+    return 0;
+}
+
+static void bench_sleep_ms(int ms)
+{
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+// Stream 'dir' to completion the way the browser does after entering it
+static void bench_finish_stream(FsListStream* stream, FsDirectory* dir)
+{
+    while (stream != NULL && fs_stream_pump(stream, dir) == FS_STREAM_LOADING)
+        bench_sleep_ms(1);
+    fs_stream_close(stream);
+}
+
+int bench_prefetch(const char* path, int dwell_ms, int max_folders, BenchPrefetchResult* out)
+{
+    if (path == NULL || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    FsDirectory* dir = fs_list_directory(path);
+    if (dir == NULL)
+        return -1;
+
+    prefetch_cleanup();
+    PrefetchStats before;
+    prefetch_get_stats(&before);
+
+    char child[FS_MAX_PATH];
+    for (int i = 0; i < fs_dir_count(dir) && out->folders < max_folders; i++) {
+        if (!fs_dir_is_dir(dir, i))
+            continue;
+        snprintf(child, sizeof(child), "%s/%s", path, fs_dir_name(dir, i));
+
+        uint64_t arrived = fs_now_ns();
+        while (fs_now_ns() - arrived < (uint64_t)dwell_ms * 1000000ull) {
+            prefetch_hint(child);
+            bench_sleep_ms(16);
+        }
+
+        if ((out->folders++ & 1) != 0)
+            continue;
+
+        uint64_t start = fs_now_ns();
+        FsDirectory* listing = NULL;
+        FsListStream* stream = NULL;
+        if (!prefetch_take(child, &listing, &stream)) {
+            listing = fs_dir_create(FS_LIST_BATCH);
+            stream = fs_stream_open(child);
+        }
+        bench_finish_stream(stream, listing);
+        out->enter_ns += fs_now_ns() - start;
+        out->entered++;
+        fs_free_directory(listing);
+    }
+    prefetch_cleanup();
+
+    prefetch_get_stats(&out->stats);
+    out->stats.started -= before.started;
+    out->stats.hits -= before.hits;
+    out->stats.partial_hits -= before.partial_hits;
+    out->stats.misses -= before.misses;
+    out->stats.cancelled -= before.cancelled;
+    out->stats.wasted -= before.wasted;
+    out->stats.wasted_entries -= before.wasted_entries;
+
+    // Baseline: enter the same folders with no prefetch
+    int seen = 0;
+    for (int i = 0; i < fs_dir_count(dir) && seen < out->folders; i++) {
+        if (!fs_dir_is_dir(dir, i))
+            continue;
+        if ((seen++ & 1) != 0)
+            continue;
+        snprintf(child, sizeof(child), "%s/%s", path, fs_dir_name(dir, i));
+
+        uint64_t start = fs_now_ns();
+        FsDirectory* listing = fs_dir_create(FS_LIST_BATCH);
+        bench_finish_stream(fs_stream_open(child), listing);
+        out->cold_ns += fs_now_ns() - start;
+        fs_free_directory(listing);
+    }
+
+    fs_free_directory(dir);
+    return 0;
+}
+
+int bench_fileops(const char* root, int files, uint64_t file_size, BenchFileOpsResult* out)
+{
+    if (root == NULL || files <= 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->backend = vfs_backend()->name;
+
+    char src[FS_MAX_PATH];
+    char dest_dir[FS_MAX_PATH];
+    char path[FS_MAX_PATH + 64];
+    snprintf(src, sizeof(src), "%s/fileops_src", root);
+    snprintf(dest_dir, sizeof(dest_dir), "%s/fileops_dst", root);
+
+    // Files spread over one folder per 50, like a typical game/media tree
+    uint64_t start = fs_now_ns();
+    vfs_mkdir(root);
+    if (vfs_mkdir(src) != 0 || vfs_mkdir(dest_dir) != 0)
+        return -1;
+    for (int i = 0; i < files; i++) {
+        if (i % 50 == 0) {
+            snprintf(path, sizeof(path), "%s/set_%03d", src, i / 50);
+            if (vfs_mkdir(path) != 0)
+                return -1;
+        }
+        snprintf(path, sizeof(path), "%s/set_%03d/file_%05d.bin", src, i / 50, i);
+        if (bench_make_file(path, file_size) != 0)
+            return -1;
+    }
+    out->create_ns = fs_now_ns() - start;
+    out->files = files;
+    out->dirs = (files + 49) / 50 + 1;
+    out->bytes = (uint64_t)files * file_size;
+
+    VfsCounters before;
+    VfsCounters after;
+    vfs_get_counters(&before);
+    start = fs_now_ns();
+    int rc = copy_item(src, dest_dir, NULL);
+    out->copy_ns = fs_now_ns() - start;
+    vfs_get_counters(&after);
+    vfs_counters_diff(&before, &after, &out->copy_calls);
+
+    before = after;
+    start = fs_now_ns();
+    rc |= delete_item(dest_dir, NULL);
+    rc |= delete_item(src, NULL);
+    out->delete_ns = fs_now_ns() - start;
+    vfs_get_counters(&after);
+    vfs_counters_diff(&before, &after, &out->delete_calls);
+    return rc == 0 ? 0 : -1;
+}
+
+static int bench_tree_visit(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)path;
+    (void)entry;
+    (void)depth;
+    (void)user;
+    return WALK_CONTINUE;
+}
+
+int bench_tree(const char* root, int depth, int files_per_level, BenchTreeResult* out)
+{
+    if (root == NULL || depth <= 0 || files_per_level < 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->depth = depth;
+
+    char tree[FS_MAX_PATH];
+    char dest_dir[FS_MAX_PATH];
+    char path[FS_MAX_PATH + 32];
+    snprintf(tree, sizeof(tree), "%s/deep", root);
+    snprintf(dest_dir, sizeof(dest_dir), "%s/deep_copy", root);
+
+    // root/deep/d/d/.../d, files at every level
+    vfs_mkdir(root);
+    str_copy(path, tree, sizeof(path));
+    int len = str_len(path);
+    for (int level = 0; level <= depth; level++) {
+        if (vfs_mkdir(path) != 0)
+            return -1;
+        for (int i = 0; i < files_per_level; i++) {
+            snprintf(path + len, sizeof(path) - len, "/f%d", i);
+            if (bench_make_file(path, 256) != 0)
+                return -1;
+        }
+        if (level < depth) {
+            if (len + 2 >= FS_MAX_PATH)
+                return -1;
+            memcpy(path + len, "/d", 3);
+            len += 2;
+        }
+        path[len] = '\0';
+    }
+
+    WalkStats stats;
+    uint64_t start = fs_now_ns();
+    int rc = walk_tree(tree, bench_tree_visit, NULL, NULL, NULL, &stats);
+    out->walk_ns = fs_now_ns() - start;
+    out->dirs = stats.dirs;
+    out->files = stats.files;
+    out->max_depth = stats.max_depth;
+    out->walk_calls = stats.service_calls;
+
+    if (vfs_mkdir(dest_dir) != 0)
+        return -1;
+    start = fs_now_ns();
+    rc |= copy_item(tree, dest_dir, NULL);
+    out->copy_ns = fs_now_ns() - start;
+
+    start = fs_now_ns();
+    rc |= delete_item(dest_dir, NULL);
+    rc |= delete_item(tree, NULL);
+    out->delete_ns = fs_now_ns() - start;
+    return rc == 0 ? 0 : -1;
+}
+
+// The copy loop used before the transfer module: 4 KiB, read then write
+static int bench_copy_legacy(const char* src, const char* dest)
+{
+    VfsFile* in = vfs_open(src, VFS_OPEN_READ);
+    if (in == NULL)
+        return -1;
+    VfsFile* out = vfs_open(dest, VFS_OPEN_WRITE | VFS_OPEN_CREATE);
+    if (out == NULL) {
+        vfs_close(in);
+        return -1;
+    }
+
+    char buf[4096];
+    uint64_t offset = 0;
+    int rc = 0;
+    while (1) {
+        int64_t n = vfs_read(in, offset, buf, sizeof(buf));
+        if (n <= 0) {
+            rc = n < 0 ? -1 : 0;
+            break;
+        }
+        if (vfs_write(out, offset, buf, (uint64_t)n) != 0) {
+            rc = -1;
+            break;
+        }
+        offset += (uint64_t)n;
+    }
+    vfs_close(out);
+    vfs_close(in);
+    return rc;
+}
+
+// Compare two files chunk by chunk
+static int bench_files_equal(const char* a, const char* b)
+{
+    VfsFile* fa = vfs_open(a, VFS_OPEN_READ);
+    VfsFile* fb = vfs_open(b, VFS_OPEN_READ);
+    uint8_t* ba = (uint8_t*)malloc(TRANSFER_CHUNK_MIN);
+    uint8_t* bb = (uint8_t*)malloc(TRANSFER_CHUNK_MIN);
+    int equal = (fa != NULL && fb != NULL && ba != NULL && bb != NULL);
+
+    uint64_t offset = 0;
+    while (equal) {
+        int64_t na = vfs_read(fa, offset, ba, TRANSFER_CHUNK_MIN);
+        int64_t nb = vfs_read(fb, offset, bb, TRANSFER_CHUNK_MIN);
+        if (na != nb || na < 0 || memcmp(ba, bb, (size_t)na) != 0)
+            equal = 0;
+        if (na <= 0)
+            break;
+        offset += (uint64_t)na;
+    }
+
+    free(bb);
+    free(ba);
+    if (fb != NULL)
+        vfs_close(fb);
+    if (fa != NULL)
+        vfs_close(fa);
+    return equal;
+}
+
+int bench_transfer(const char* root, uint64_t size, BenchTransferResult* out)
+{
+    if (root == NULL || size == 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->bytes = size;
+
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    snprintf(src, sizeof(src), "%s/transfer_src.bin", root);
+    snprintf(dest, sizeof(dest), "%s/transfer_dst.bin", root);
+
+    // Source: a byte pattern that changes every chunk so a misplaced
+    // chunk cannot compare equal
+    vfs_mkdir(root);
+    uint64_t start = fs_now_ns();
+    VfsFile* f = vfs_open(src, VFS_OPEN_WRITE | VFS_OPEN_CREATE);
+    uint8_t* buf = (uint8_t*)malloc(TRANSFER_CHUNK_MIN);
+    int rc = (f != NULL && buf != NULL) ? 0 : -1;
+    for (uint64_t offset = 0; rc == 0 && offset < size; offset += TRANSFER_CHUNK_MIN) {
+        uint64_t chunk = size - offset < TRANSFER_CHUNK_MIN ? size - offset : TRANSFER_CHUNK_MIN;
+        for (uint64_t i = 0; i < chunk; i++)
+            buf[i] = (uint8_t)((offset + i) * 31 + offset / TRANSFER_CHUNK_MIN);
+        rc = vfs_write(f, offset, buf, chunk);
+    }
+    free(buf);
+    if (f != NULL)
+        vfs_close(f);
+    out->create_ns = fs_now_ns() - start;
+    if (rc != 0) {
+        vfs_remove(src);
+        return -1;
+    }
+
+    static const char* labels[BENCH_TRANSFER_RUNS] = {
+        "4 KiB loop", "fixed 1 MiB", "fixed 2 MiB", "fixed 4 MiB", "fixed 8 MiB", "adaptive",
+    };
+    for (int i = 0; i < BENCH_TRANSFER_RUNS && rc == 0; i++) {
+        BenchTransferRun* run = &out->run[i];
+        run->label = labels[i];
+
+        start = fs_now_ns();
+        if (i == 0) {
+            rc = bench_copy_legacy(src, dest);
+        } else if (i < BENCH_TRANSFER_RUNS - 1) {
+            TransferOptions opt = {0};
+            opt.chunk_min = opt.chunk_max = TRANSFER_CHUNK_MIN << (i - 1);
+            opt.fixed = 1;
+            rc = transfer_file(src, dest, &opt, NULL, NULL, &run->stats);
+        } else {
+            rc = transfer_file(src, dest, NULL, NULL, NULL, &run->stats);
+        }
+        run->elapsed_ns = fs_now_ns() - start;
+
+        if (rc == 0 && !bench_files_equal(src, dest))
+            rc = -1;
+        vfs_remove(dest);
+        out->runs = i + 1;
+    }
+
+    vfs_remove(src);
+    return rc == 0 ? 0 : -1;
+}
+
+int bench_copysched(const char* root, int files, uint64_t file_size, int large_files,
+                    int max_workers, BenchCopySchedResult* out)
+{
+    if (root == NULL || files < 0 || large_files < 0 || out == NULL)
+        return -1;
+    if (max_workers < 1 || max_workers > COPYSCHED_MAX_WORKERS)
+        max_workers = COPYSCHED_MAX_WORKERS;
+
+    memset(out, 0, sizeof(*out));
+    out->files = files;
+    out->large_files = large_files;
+
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    char path[FS_MAX_PATH + 64];
+    snprintf(src, sizeof(src), "%s/sched_src", root);
+    snprintf(dest, sizeof(dest), "%s/sched_dst", root);
+
+    vfs_mkdir(root);
+    if (vfs_mkdir(src) != 0)
+        return -1;
+    for (int i = 0; i < files; i++) {
+        if (i % 50 == 0) {
+            snprintf(path, sizeof(path), "%s/set_%03d", src, i / 50);
+            if (vfs_mkdir(path) != 0)
+                return -1;
+        }
+        snprintf(path, sizeof(path), "%s/set_%03d/file_%05d.bin", src, i / 50, i);
+        if (bench_make_file(path, file_size) != 0)
+            return -1;
+    }
+    for (int i = 0; i < large_files; i++) {
+        snprintf(path, sizeof(path), "%s/large_%02d.bin", src, i);
+        if (bench_make_file(path, 2 * COPYSCHED_LARGE_FILE) != 0)
+            return -1;
+    }
+    out->bytes = (uint64_t)files * file_size + (uint64_t)large_files * 2 * COPYSCHED_LARGE_FILE;
+
+    int rc = 0;
+    for (int workers = 1; workers <= max_workers && rc == 0; workers++) {
+        CopySchedOptions opt = {0};
+        opt.workers = workers;
+        rc = copysched_copy_tree(src, dest, &opt, NULL, NULL, &out->run[workers - 1]);
+        if (rc == 0 && out->run[workers - 1].files != (uint64_t)(files + large_files))
+            rc = -1;
+        rc |= delete_item(dest, NULL);
+        out->runs = workers;
+    }
+
+    rc |= delete_item(src, NULL);
+    return rc == 0 ? 0 : -1;
+}
+
+// Known answers, so a fast but wrong hasher cannot pass
+static int bench_hash_check(void)
+{
+    static const struct {
+        HashAlgo algo;
+        const char* input;
+        const char* hex;
+    } vectors[] = {
+        { HASH_CRC32, "123456789", "cbf43926" },
+        { HASH_SHA1, "abc", "a9993e364706816aba3e25717850c26c9cd0d89d" },
+        { HASH_SHA256, "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { HASH_SHA256, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    };
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        HashContext ctx;
+        HashDigest digest;
+        char hex[2 * HASH_MAX_DIGEST + 1];
+        hash_init(&ctx, vectors[i].algo);
+        hash_update(&ctx, vectors[i].input, strlen(vectors[i].input));
+        hash_final(&ctx, &digest);
+        hash_to_hex(&digest, hex, sizeof(hex));
+        if (strcmp(hex, vectors[i].hex) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int bench_hash(uint64_t size, BenchHashResult* out)
+{
+    if (size == 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    if (bench_hash_check() != 0)
+        return -1;
+    uint8_t* buf = (uint8_t*)malloc(size);
+    if (buf == NULL)
+        return -1;
+    for (uint64_t i = 0; i < size; i++)
+        buf[i] = (uint8_t)(i * 2654435761u >> 13);
+    out->bytes = size;
+
+    const uint64_t piece = 1u << 20;
+    for (int a = HASH_CRC32; a < HASH_ALGO_COUNT; a++) {
+        HashContext ctx;
+        HashDigest digest;
+        // First pass warms the caches and, on hosts, builds the CRC tables
+        for (int pass = 0; pass < 2; pass++) {
+            uint64_t start = fs_now_ns();
+            hash_init(&ctx, (HashAlgo)a);
+            for (uint64_t offset = 0; offset < size; offset += piece)
+                hash_update(&ctx, buf + offset, size - offset < piece ? size - offset : piece);
+            hash_final(&ctx, &digest);
+            out->elapsed_ns[a] = fs_now_ns() - start;
+        }
+        if (out->elapsed_ns[a] > 0)
+            out->gb_per_sec[a] = (double)size / out->elapsed_ns[a];
+    }
+    free(buf);
+    return 0;
+}
+
+static int bench_sync_visit(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)path;
+    (void)entry;
+    (void)depth;
+    (void)user;
+    return WALK_CONTINUE;
+}
+
+// Build a plan and check it finds 'expected' items (all SYNC_IDENTICAL if 0)
+static SyncPlan* bench_sync_plan(const char* src, const char* dest, SyncCompare compare,
+                                 int files, int expected, uint64_t* elapsed_ns)
+{
+    uint64_t start = fs_now_ns();
+    SyncPlan* plan = sync_plan_build(src, dest, compare, NULL);
+    *elapsed_ns = fs_now_ns() - start;
+
+    SyncSummary summary;
+    sync_plan_summary(plan, &summary);
+    if (plan != NULL && sync_plan_count(plan) == expected &&
+        (expected > 0 || summary.count[SYNC_IDENTICAL] == (uint64_t)files))
+        return plan;
+    sync_plan_free(plan);
+    return NULL;
+}
+
+int bench_sync(const char* root, int files, uint64_t file_size, BenchSyncResult* out)
+{
+    if (root == NULL || files < 2 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->files = files;
+
+    char src[FS_MAX_PATH];
+    char mirror[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    char path[FS_MAX_PATH + 64];
+    if (walk_join(root, "sync_src", src, sizeof(src)) != 0 ||
+        walk_join(root, "sync_dst", mirror, sizeof(mirror)) != 0 ||
+        walk_join(mirror, "sync_src", dest, sizeof(dest)) != 0)
+        return -1;
+
+    vfs_mkdir(root);
+    if (vfs_mkdir(src) != 0 || vfs_mkdir(mirror) != 0)
+        return -1;
+    for (int i = 0; i < files; i++) {
+        if (i % 50 == 0) {
+            snprintf(path, sizeof(path), "%s/set_%03d", src, i / 50);
+            if (vfs_mkdir(path) != 0)
+                return -1;
+        }
+        snprintf(path, sizeof(path), "%s/set_%03d/file_%05d.bin", src, i / 50, i);
+        if (bench_make_file(path, file_size) != 0)
+            return -1;
+    }
+    int rc = copy_item(src, mirror, NULL);
+
+    // What a sync of an unchanged tree should come close to
+    uint64_t start = fs_now_ns();
+    rc |= walk_tree(src, bench_sync_visit, NULL, NULL, NULL, NULL);
+    rc |= walk_tree(dest, bench_sync_visit, NULL, NULL, NULL, NULL);
+    out->walk_ns = fs_now_ns() - start;
+
+    SyncPlan* plan = NULL;
+    if (rc == 0)
+        plan = bench_sync_plan(src, dest, SYNC_COMPARE_METADATA, files, 0, &out->plan_ns);
+    if (plan != NULL) {
+        sync_plan_free(plan);
+        plan = bench_sync_plan(src, dest, SYNC_COMPARE_CONTENT, files, 0, &out->content_ns);
+    }
+    if (plan != NULL) {
+        SyncSummary summary;
+        sync_plan_summary(plan, &summary);
+        out->probed = summary.probed;
+        sync_plan_free(plan);
+
+        // One file grows, one is added, one goes missing from the mirror and
+        // the mirror gains one the source does not have
+        snprintf(path, sizeof(path), "%s/set_000/file_00000.bin", src);
+        rc |= bench_make_file(path, file_size + 1);
+        snprintf(path, sizeof(path), "%s/added.bin", src);
+        rc |= bench_make_file(path, file_size);
+        snprintf(path, sizeof(path), "%s/set_000/file_00001.bin", dest);
+        rc |= vfs_remove(path);
+        snprintf(path, sizeof(path), "%s/set_000/extra.bin", dest);
+        rc |= bench_make_file(path, file_size);
+
+        uint64_t elapsed;
+        plan = rc == 0 ? bench_sync_plan(src, dest, SYNC_COMPARE_METADATA, files, 4, &elapsed) : NULL;
+    }
+    int ok = plan != NULL;
+    if (ok) {
+        SyncSummary summary;
+        sync_plan_summary(plan, &summary);
+        memcpy(out->changes, summary.count, sizeof(out->changes));
+        start = fs_now_ns();
+        rc |= sync_plan_execute(plan, NULL);
+        out->execute_ns = fs_now_ns() - start;
+        sync_plan_free(plan);
+
+        // Everything was carried over: nothing left to do
+        uint64_t elapsed;
+        plan = rc == 0 ? bench_sync_plan(src, dest, SYNC_COMPARE_CONTENT, files + 1, 0, &elapsed) : NULL;
+        ok = plan != NULL;
+        sync_plan_free(plan);
+    }
+
+    rc |= delete_item(mirror, NULL);
+    rc |= delete_item(src, NULL);
+    return rc == 0 && ok ? 0 : -1;
+}
+
+static int bench_delete_make(const char* tree, int files)
+{
+    char path[FS_MAX_PATH + 64];
+    if (vfs_mkdir(tree) != 0)
+        return -1;
+    for (int i = 0; i < files; i++) {
+        if (i % 50 == 0) {
+            snprintf(path, sizeof(path), "%s/set_%03d", tree, i / 50);
+            if (vfs_mkdir(path) != 0)
+                return -1;
+        }
+        snprintf(path, sizeof(path), "%s/set_%03d/file_%05d.bin", tree, i / 50, i);
+        if (bench_make_file(path, 256) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int bench_delete_file(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)depth;
+    if (!entry->is_dir && vfs_remove(path) != 0)
+        *(int*)user = -1;
+    return WALK_CONTINUE;
+}
+
+static int bench_delete_dir(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)entry;
+    (void)depth;
+    if (vfs_rmdir(path) != 0)
+        *(int*)user = -1;
+    return WALK_CONTINUE;
+}
+
+// The delete used before the trash: every file in turn, then each folder
+static int bench_delete_legacy(const char* tree)
+{
+    int rc = 0;
+    if (walk_tree(tree, bench_delete_file, bench_delete_dir, &rc, NULL, NULL) != 0)
+        return -1;
+    return rc == 0 ? vfs_rmdir(tree) : -1;
+}
+
+int bench_delete(const char* root, int files, BenchDeleteResult* out)
+{
+    if (root == NULL || files < 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->files = files;
+
+    char tree[FS_MAX_PATH];
+    char trash[FS_MAX_PATH];
+    snprintf(tree, sizeof(tree), "%s/delete_tree", root);
+    snprintf(trash, sizeof(trash), "%s/delete_trash", root);
+    vfs_mkdir(root);
+
+    int rc = bench_delete_make(tree, files);
+    uint64_t start = fs_now_ns();
+    rc |= bench_delete_legacy(tree);
+    out->legacy_ns = fs_now_ns() - start;
+
+    rc |= bench_delete_make(tree, files);
+    start = fs_now_ns();
+    rc |= delete_item(tree, NULL);
+    out->batched_ns = fs_now_ns() - start;
+
+    rc |= bench_delete_make(tree, files);
+    trash_init(trash);
+    start = fs_now_ns();
+    rc |= trash_move(tree);
+    out->trash_ns = fs_now_ns() - start;
+
+    // Its undo window is not over yet: nothing to hand out
+    TrashItem item;
+    rc |= trash_expired(&item, 1) == 0 ? 0 : -1;
+    trash_cleanup();
+    trash_init(trash);
+    start = fs_now_ns();
+    while (trash_expired(&item, 1) == 1)
+        rc |= delete_item(item.entry, NULL);
+    out->purge_ns = fs_now_ns() - start;
+    trash_cleanup();
+
+    VfsStat st;
+    rc |= vfs_stat(tree, &st) == 0 ? -1 : 0;
+    rc |= delete_item(trash, NULL);
+    return rc == 0 ? 0 : -1;
+}
+
+int bench_move(const char* root, int files, BenchMoveResult* out)
+{
+    if (root == NULL || files < 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->files = files;
+
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    char tree[FS_MAX_PATH];
+    char moved[FS_MAX_PATH];
+    if (walk_join(root, "move_src", src, sizeof(src)) != 0 ||
+        walk_join(root, "move_dest", dest, sizeof(dest)) != 0 ||
+        walk_join(src, "tree", tree, sizeof(tree)) != 0 ||
+        walk_join(dest, "tree", moved, sizeof(moved)) != 0)
+        return -1;
+    vfs_mkdir(root);
+    int rc = vfs_mkdir(src) | vfs_mkdir(dest);
+
+    rc |= bench_delete_make(tree, files);
+    uint64_t start = fs_now_ns();
+    rc |= move_file(tree, dest, NULL);
+    out->rename_ns = fs_now_ns() - start;
+
+    VfsStat st;
+    rc |= vfs_stat(tree, &st) == 0 || vfs_stat(moved, &st) != 0 ? -1 : 0;
+    start = fs_now_ns();
+    rc |= copy_item(moved, src, NULL);
+    rc |= delete_item(moved, NULL);
+    out->copy_ns = fs_now_ns() - start;
+
+    // Every folder of the tree, into 'dest'
+    FsDirectory* sets = fs_dir_create(64);
+    char** paths = NULL;
+    int count = 0;
+    if (sets != NULL && vfs_list(tree, sets, NULL, NULL, NULL) == 0) {
+        count = fs_dir_count(sets);
+        paths = calloc(count > 0 ? count : 1, sizeof(*paths));
+    }
+    for (int i = 0; paths != NULL && i < count; i++) {
+        paths[i] = malloc(FS_MAX_PATH);
+        if (paths[i] == NULL || walk_join(tree, fs_dir_name(sets, i), paths[i], FS_MAX_PATH) != 0)
+            rc = -1;
+    }
+    if (paths == NULL)
+        rc = -1;
+    out->folders = count;
+
+    if (rc == 0 && count >= 2) {
+        char path[FS_MAX_PATH + 64];
+        // A file where the second folder would go: nothing may move
+        snprintf(path, sizeof(path), "%s/%s", dest, fs_dir_name(sets, 1));
+        rc |= bench_make_file(path, 16);
+        out->conflict_ok = move_batch((const char* const*)paths, count, dest, NULL) != 0 &&
+                           vfs_stat(paths[0], &st) == 0 && vfs_stat(paths[count - 1], &st) == 0;
+        rc |= vfs_remove(path);
+
+        // A folder where the first one goes is merged into
+        snprintf(path, sizeof(path), "%s/%s", dest, fs_dir_name(sets, 0));
+        rc |= vfs_mkdir(path);
+        snprintf(path, sizeof(path), "%s/%s/extra.bin", dest, fs_dir_name(sets, 0));
+        rc |= bench_make_file(path, 16);
+        start = fs_now_ns();
+        rc |= move_batch((const char* const*)paths, count, dest, NULL);
+        out->batch_ns = fs_now_ns() - start;
+
+        fs_dir_clear(sets);
+        rc |= vfs_list(tree, sets, NULL, NULL, NULL) == 0 && fs_dir_count(sets) == 0 ? 0 : -1;
+        rc |= out->conflict_ok ? 0 : -1;
+    }
+    for (int i = 0; paths != NULL && i < count; i++)
+        free(paths[i]);
+    free(paths);
+    fs_free_directory(sets);
+
+    rc |= delete_item(src, NULL);
+    rc |= delete_item(dest, NULL);
+    return rc == 0 ? 0 : -1;
+}
+
+int bench_batch(const char* root, int files, int entries, BenchBatchResult* out)
+{
+    if (root == NULL || files < 0 || entries < 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->entries = entries;
+    out->files = files;
+
+    // One name in four is a package, for the pattern to pick out
+    static const char* exts[] = {"nsp", "xci", "txt", "jpg"};
+    FsDirectory* dir = fs_dir_create(entries);
+    if (dir == NULL)
+        return -1;
+    char name[64];
+    int rc = 0;
+    for (int i = 0; i < entries && rc == 0; i++) {
+        snprintf(name, sizeof(name), "item_%06d.%s", i, exts[i % 4]);
+        rc = fs_dir_append(dir, name, 0, (uint64_t)i);
+    }
+
+    Selection sel;
+    select_init(&sel);
+    rc |= select_resize(&sel, entries);
+    if (rc == 0) {
+        uint64_t start = fs_now_ns();
+        select_all(&sel, dir);
+        out->all_ns = fs_now_ns() - start;
+        rc |= sel.marked == entries ? 0 : -1;
+
+        start = fs_now_ns();
+        select_invert(&sel, dir);
+        out->invert_ns = fs_now_ns() - start;
+        rc |= sel.marked == 0 ? 0 : -1;
+
+        start = fs_now_ns();
+        out->matched = select_match(&sel, dir, "*.NSP");
+        out->match_ns = fs_now_ns() - start;
+        rc |= out->matched == (entries + 3) / 4 ? 0 : -1;
+
+        int walked = 0;
+        start = fs_now_ns();
+        for (int i = select_next(&sel, 0); i >= 0; i = select_next(&sel, i + 1))
+            walked++;
+        out->walk_ns = fs_now_ns() - start;
+        rc |= walked == out->matched ? 0 : -1;
+    }
+    select_free(&sel);
+    fs_free_directory(dir);
+
+    char src[FS_MAX_PATH];
+    char single[FS_MAX_PATH];
+    char batch[FS_MAX_PATH];
+    if (walk_join(root, "batch_src", src, sizeof(src)) != 0 ||
+        walk_join(root, "batch_single", single, sizeof(single)) != 0 ||
+        walk_join(root, "batch_dest", batch, sizeof(batch)) != 0)
+        return -1;
+    vfs_mkdir(root);
+    rc |= vfs_mkdir(src) | vfs_mkdir(single) | vfs_mkdir(batch);
+
+    char** paths = calloc(files > 0 ? files : 1, sizeof(*paths));
+    if (paths == NULL)
+        rc = -1;
+    for (int i = 0; paths != NULL && i < files; i++) {
+        paths[i] = malloc(FS_MAX_PATH);
+        if (paths[i] == NULL) {
+            rc = -1;
+            break;
+        }
+        snprintf(name, sizeof(name), "file_%05d.bin", i);
+        if (walk_join(src, name, paths[i], FS_MAX_PATH) != 0) {
+            rc = -1;
+            break;
+        }
+        rc |= bench_make_file(paths[i], 4096);
+    }
+
+    if (rc == 0) {
+        uint64_t start = fs_now_ns();
+        for (int i = 0; i < files; i++)
+            rc |= copy_item(paths[i], single, NULL);
+        out->single_ns = fs_now_ns() - start;
+
+        start = fs_now_ns();
+        rc |= copy_batch((const char* const*)paths, files, batch, NULL);
+        out->batch_ns = fs_now_ns() - start;
+
+        FsDirectory* copied = fs_dir_create(files > 0 ? files : 1);
+        rc |= copied != NULL && vfs_list(batch, copied, NULL, NULL, NULL) == 0 &&
+              fs_dir_count(copied) == files ? 0 : -1;
+        fs_free_directory(copied);
+    }
+    for (int i = 0; paths != NULL && i < files; i++)
+        free(paths[i]);
+    free(paths);
+
+    rc |= delete_item(src, NULL);
+    rc |= delete_item(single, NULL);
+    rc |= delete_item(batch, NULL);
+    return rc == 0 ? 0 : -1;
+}
+
+int bench_clipboard(const char* root, int items, int folders, BenchClipboardResult* out)
+{
+    if (root == NULL || items < 0 || folders <= 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->items = items;
+    out->folders = folders;
+
+    char file[FS_MAX_PATH];
+    snprintf(file, sizeof(file), "%s/clipboard.log", root);
+    vfs_mkdir(root);
+    clipboard_init(file);
+    clipboard_clear();
+
+    // The paths of one folder at a time, as marking and copying would add them
+    int per_folder = (items + folders - 1) / folders;
+    FsDirectory* list = fs_dir_create(per_folder > 0 ? per_folder : 1);
+    if (list == NULL)
+        return -1;
+    char path[FS_MAX_PATH];
+    int rc = 0;
+    uint64_t start = fs_now_ns();
+    for (int f = 0; f < folders && rc == 0; f++) {
+        for (ClipboardOp op = CLIPBOARD_COPY; op <= CLIPBOARD_MOVE && rc == 0; op++) {
+            fs_dir_clear(list);
+            for (int i = f * per_folder + (op == CLIPBOARD_MOVE); i < (f + 1) * per_folder && i < items; i += 2) {
+                snprintf(path, sizeof(path), "/switch/bench/collection_%04d/games/item_%06d.nsp", f, i);
+                rc |= fs_dir_append(list, path, 0, 0);
+            }
+            rc |= clipboard_add_list(list, op);
+        }
+    }
+    out->add_ns = fs_now_ns() - start;
+    fs_free_directory(list);
+
+    ClipboardStats stats;
+    clipboard_get_stats(&stats);
+    out->name_bytes = stats.name_bytes;
+    out->path_bytes = stats.path_bytes;
+    out->file_bytes = stats.file_bytes;
+    rc |= stats.items == items ? 0 : -1;
+
+    // A restart: the file is read when the clipboard is first asked
+    clipboard_cleanup();
+    clipboard_init(file);
+    start = fs_now_ns();
+    int count = clipboard_count(CLIPBOARD_NONE);
+    out->load_ns = fs_now_ns() - start;
+    rc |= count == items && clipboard_count(CLIPBOARD_MOVE) == items / 2 ? 0 : -1;
+    out->reloaded = count;
+
+    start = fs_now_ns();
+    clipboard_remove_op(CLIPBOARD_MOVE);
+    out->remove_ns = fs_now_ns() - start;
+    clipboard_get_stats(&stats);
+    out->compact_bytes = stats.file_bytes;
+
+    clipboard_cleanup();
+    clipboard_init(file);
+    count = clipboard_count(CLIPBOARD_NONE);
+    rc |= count == items - items / 2 && clipboard_count(CLIPBOARD_MOVE) == 0 ? 0 : -1;
+    if (count < out->reloaded)
+        out->reloaded = count;
+
+    clipboard_clear();
+    VfsStat st;
+    rc |= vfs_stat(file, &st) == 0 ? -1 : 0;
+    clipboard_cleanup();
+    clipboard_init("");
+    return rc == 0 ? 0 : -1;
+}
+
+void bench_print_listing(const BenchListingResult* result)
+{
+    if (result == NULL)
+        return;
+
+    printf("listing: %llu entries x %d runs, %.0f entries/s, %.1f calls/listing, %.3f ms/listing\n",
+           (unsigned long long)result->entries, result->iterations,
+           result->entries_per_sec, result->calls_per_listing,
+           (double)result->elapsed_ns / result->iterations / 1e6);
+}
+
+int bench_layout(int entries, BenchLayoutResult* out)
+{
+    if (entries <= 0 || out == NULL)
+        return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->entries = entries;
+    char name[64];
+
+    // Legacy layout: fixed-size structs grown by doubling
+    uint64_t start = fs_now_ns();
+    int capacity = 32;
+    int count = 0;
+    BenchLegacyEntry* legacy = (BenchLegacyEntry*)malloc(sizeof(BenchLegacyEntry) * capacity);
+    if (legacy == NULL)
+        return -1;
+    for (int i = 0; i < entries; i++) {
+        if (count >= capacity) {
+            capacity *= 2;
+            BenchLegacyEntry* grown = (BenchLegacyEntry*)realloc(legacy, sizeof(BenchLegacyEntry) * capacity);
+            if (grown == NULL) {
+                free(legacy);
+                return -1;
+            }
+            legacy = grown;
+        }
+        bench_synth_name(i, name, sizeof(name));
+        strncpy(legacy[count].name, name, sizeof(legacy[count].name) - 1);
+        legacy[count].name[sizeof(legacy[count].name) - 1] = '\0';
+        legacy[count].is_dir = 0;
+        legacy[count].size = (uint64_t)i * 4096;
+        count++;
+    }
+    out->legacy_build_ns = fs_now_ns() - start;
+    out->legacy_bytes = (uint64_t)capacity * sizeof(BenchLegacyEntry);
+
+    // Arena layout
+    start = fs_now_ns();
+    FsDirectory* dir = fs_dir_create(32);
+    if (dir == NULL) {
+        free(legacy);
+        return -1;
+    }
+    for (int i = 0; i < entries; i++) {
+        bench_synth_name(i, name, sizeof(name));
+        if (fs_dir_append(dir, name, 0, (uint64_t)i * 4096) != 0) {
+            free(legacy);
+            fs_free_directory(dir);
+            return -1;
+        }
+    }
+    out->arena_build_ns = fs_now_ns() - start;
+    out->arena_bytes = fs_dir_memory_usage(dir);
+
+    // Filter-style scan: substring match plus a size total
+    volatile uint64_t sink = 0;
+    start = fs_now_ns();
+    for (int i = 0; i < count; i++) {
+        if (bench_ci_contains(legacy[i].name, "game"))
+            sink += legacy[i].size;
+    }
+    out->legacy_scan_ns = fs_now_ns() - start;
+
+    start = fs_now_ns();
+    for (int i = 0; i < fs_dir_count(dir); i++) {
+        if (bench_ci_contains(fs_dir_name(dir, i), "game"))
+            sink += fs_dir_size(dir, i);
+    }
+    out->arena_scan_ns = fs_now_ns() - start;
+    (void)sink;
+
+    free(legacy);
+    fs_free_directory(dir);
+    return 0;
+}
+
+void bench_print_layout(const BenchLayoutResult* result)
+{
+    if (result == NULL)
+        return;
+
+    printf("layout: %d entries\n", result->entries);
+    printf("  legacy: %8.1f KiB, build %.3f ms, scan %.3f ms\n",
+           result->legacy_bytes / 1024.0, result->legacy_build_ns / 1e6, result->legacy_scan_ns / 1e6);
+    printf("  arena:  %8.1f KiB, build %.3f ms, scan %.3f ms\n",
+           result->arena_bytes / 1024.0, result->arena_build_ns / 1e6, result->arena_scan_ns / 1e6);
+    if (result->arena_bytes > 0)
+        printf("  memory ratio %.1fx\n", (double)result->legacy_bytes / result->arena_bytes);
+}
@@ -0,0 +1,408 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include "fs.h"
+#include "prefetch.h"
+#include "vfs.h"
+#include "transfer.h"
+#include "copysched.h"
+#include "hash.h"
+#include "sync.h"
+#include "trash.h"
+
+/**
+ * Benchmark module
+ *
+ * Self-contained micro benchmarks for the browser's hot paths. Every
+ * benchmark builds its own synthetic input where it needs one, so the
+ * same code runs on Switch and, through tools/hostbench.c, on a Linux host.
+ */
+
+/**
+ * BenchListingResult - Aggregate cost of repeated directory listings
+ */
+typedef struct {
+    int iterations;              // Listings performed
+    uint64_t entries;            // Entries per listing
+    uint64_t service_calls;      // Total filesystem calls over all iterations
+    uint64_t elapsed_ns;         // Total time over all iterations
+    double entries_per_sec;      // Listing throughput
+    double calls_per_listing;    // Average filesystem calls per listing
+} BenchListingResult;
+
+/**
+ * BenchLayoutResult - Legacy fixed-size entries vs the arena listing
+ */
+typedef struct {
+    int entries;                 // Synthetic entries per listing
+    uint64_t legacy_bytes;       // Bytes held by 272-byte FsEntry array
+    uint64_t arena_bytes;        // Bytes held by the arena FsDirectory
+    uint64_t legacy_build_ns;    // Time to fill the legacy array
+    uint64_t arena_build_ns;     // Time to fill the arena listing
+    uint64_t legacy_scan_ns;     // Time for a filter-style scan (legacy)
+    uint64_t arena_scan_ns;      // Time for the same scan (arena)
+} BenchLayoutResult;
+
+/**
+ * bench_make_tree(root, files, dirs)
+ * Create a synthetic flat folder under 'root' holding 'files' small
+ * files and 'dirs' empty subdirectories on the active VFS backend.
+ * Existing entries are reused.
+ * Returns 0 on success, -1 on error.
+ */
+int bench_make_tree(const char* root, int files, int dirs);
+
+/**
+ * bench_listing(path, iterations, out)
+ * List 'path' 'iterations' times through fs_list_directory_stats().
+ * Returns 0 on success, -1 if the directory cannot be listed.
+ */
+int bench_listing(const char* path, int iterations, BenchListingResult* out);
+
+/**
+ * bench_stream(path, out)
+ * List 'path' through the progressive fs_stream_* API, pumping like the
+ * UI does. Fills 'out' with time to first batch and total listing time.
+ * Returns 0 on success, -1 on error.
+ */
+int bench_stream(const char* path, FsListStats* out);
+
+/**
+ * BenchSortResult - Sort timings for one mode on synthetic names
+ */
+typedef struct {
+    int entries;             // Synthetic entries sorted
+    int mode;                // SortMode
+    uint64_t serial_ns;      // Single-threaded sort time
+    uint64_t parallel_ns;    // Sort time with automatic thread count
+} BenchSortResult;
+
+/**
+ * bench_sort(entries, mode, out)
+ * Sort 'entries' synthetic names (mixed case, embedded numbers, a few
+ * directories) with 'mode', serially and in parallel.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int bench_sort(int entries, int mode, BenchSortResult* out);
+
+/**
+ * BenchFilterResult - Type-to-filter latency, one query typed key by key
+ */
+typedef struct {
+    int entries;             // Synthetic entries filtered
+    int keystrokes;          // Characters typed
+    int matches;             // Matches for the full query
+    uint64_t total_ns;       // Incremental filtering, all keystrokes
+    uint64_t worst_ns;       // Slowest single keystroke
+    uint64_t naive_ns;       // Full scalar rescan per keystroke, all keystrokes
+} BenchFilterResult;
+
+/**
+ * bench_filter(entries, query, out)
+ * Type 'query' one character at a time over 'entries' synthetic names,
+ * timing the incremental filter against a naive rescan per keystroke.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int bench_filter(int entries, const char* query, BenchFilterResult* out);
+
+/**
+ * BenchDirSizeResult - Folder size aggregation over one listing
+ */
+typedef struct {
+    int folders;             // Subfolders measured
+    int threads;             // Worker threads used
+    uint64_t bytes;          // Sum of all folder totals
+    uint64_t cold_ns;        // All totals walked
+    uint64_t warm_ns;        // All totals answered from the cache
+} BenchDirSizeResult;
+
+/**
+ * bench_dirsize(path, threads, out)
+ * Measure every subfolder of 'path' with 'threads' dirsize workers, then
+ * again with the cache warm. Restarts the dirsize module.
+ * Returns 0 on success, -1 if 'path' cannot be listed.
+ */
+int bench_dirsize(const char* path, int threads, BenchDirSizeResult* out);
+
+/**
+ * BenchPrefetchResult - Simulated browsing with the prefetch slot
+ */
+typedef struct {
+    int folders;             // Folders the cursor rested on
+    int entered;             // Folders entered (every second one)
+    uint64_t enter_ns;       // Enter to complete listing, with prefetch
+    uint64_t cold_ns;        // The same folders streamed without prefetch
+    PrefetchStats stats;     // Prefetch counters for the run
+} BenchPrefetchResult;
+
+/**
+ * bench_prefetch(path, dwell_ms, max_folders, out)
+ * Rest the cursor on up to 'max_folders' subfolders of 'path' for
+ * 'dwell_ms' each, hinting the prefetcher every 16 ms frame, and enter
+ * every second one. Then list the entered folders again without
+ * prefetch for comparison. Resets the prefetch module.
+ * Returns 0 on success, -1 if 'path' cannot be listed.
+ */
+int bench_prefetch(const char* path, int dwell_ms, int max_folders, BenchPrefetchResult* out);
+
+/**
+ * BenchFileOpsResult - Copy and delete of a synthetic tree through the VFS
+ */
+typedef struct {
+    const char* backend;     // Name of the active VFS backend
+    int files;               // Files in the tree
+    int dirs;                // Folders in the tree, including its root
+    uint64_t bytes;          // Total file bytes
+    uint64_t create_ns;      // Building the source tree
+    uint64_t copy_ns;        // copy_item() of the whole tree
+    uint64_t delete_ns;      // delete_item() of both trees
+    VfsCounters copy_calls;  // Backend calls made by the copy
+    VfsCounters delete_calls;// Backend calls made by the deletes
+} BenchFileOpsResult;
+
+/**
+ * bench_fileops(root, files, file_size, out)
+ * Build a tree of 'files' files of 'file_size' bytes below 'root' on the
+ * active VFS backend, copy it with copy_item() and delete both copies
+ * with delete_item().
+ * Returns 0 on success, -1 if any step failed.
+ */
+int bench_fileops(const char* root, int files, uint64_t file_size, BenchFileOpsResult* out);
+
+/**
+ * BenchTreeResult - Walk, copy and delete of a deep synthetic tree
+ */
+typedef struct {
+    int depth;               // Folder levels below the tree root
+    uint64_t dirs;           // Folders walked (including the root)
+    uint64_t files;          // Files walked
+    int max_depth;           // Deepest level the walker entered
+    uint64_t walk_ns;        // walk_tree() over the tree
+    uint64_t walk_calls;     // Filesystem calls made by the walk
+    uint64_t copy_ns;        // copy_item() of the tree
+    uint64_t delete_ns;      // delete_item() of both copies
+} BenchTreeResult;
+
+/**
+ * bench_tree(root, depth, files_per_level, out)
+ * Build a chain of 'depth' nested folders below 'root', each holding
+ * 'files_per_level' small files, on the active VFS backend. Then walk,
+ * copy and delete it.
+ * Returns 0 on success, -1 if any step failed.
+ */
+int bench_tree(const char* root, int depth, int files_per_level, BenchTreeResult* out);
+
+/**
+ * BenchTransferRun - One way of copying the benchmark file
+ */
+typedef struct {
+    const char* label;       // "4 KiB loop", "fixed 1 MiB", ..., "adaptive"
+    uint64_t elapsed_ns;     // Wall time of the copy
+    TransferStats stats;     // Calls, chunk and wait times (transfer runs)
+} BenchTransferRun;
+
+#define BENCH_TRANSFER_RUNS 6
+
+/**
+ * BenchTransferResult - Large file copy throughput, old loop vs pipeline
+ */
+typedef struct {
+    uint64_t bytes;          // Size of the benchmark file
+    uint64_t create_ns;      // Writing the source file
+    int runs;                // Entries used in 'run'
+    BenchTransferRun run[BENCH_TRANSFER_RUNS];
+} BenchTransferResult;
+
+/**
+ * bench_transfer(root, size, out)
+ * Write a 'size' byte file below 'root' on the active VFS backend and
+ * copy it with the old serial 4 KiB loop, with transfer_file() at fixed
+ * 1, 2, 4 and 8 MiB chunks, and with adaptive chunks. Every copy is
+ * compared against the source. Both files are removed afterwards.
+ * Returns 0 on success, -1 if any copy failed or differed.
+ */
+int bench_transfer(const char* root, uint64_t size, BenchTransferResult* out);
+
+/**
+ * BenchCopySchedResult - Tree copy throughput by worker count
+ */
+typedef struct {
+    int files;               // Small files in the tree
+    int large_files;         // Files on the streaming lane
+    uint64_t bytes;          // Total file bytes
+    int runs;                // Entries used in 'run' (workers = index + 1)
+    CopySchedStats run[COPYSCHED_MAX_WORKERS];
+} BenchCopySchedResult;
+
+/**
+ * bench_copysched(root, files, file_size, large_files, max_workers, out)
+ * Build a tree of 'files' files of 'file_size' bytes (50 per folder) plus
+ * 'large_files' files of twice COPYSCHED_LARGE_FILE below 'root' on the
+ * active VFS backend, then copy it with 1 to 'max_workers' workers,
+ * deleting each copy. The source is deleted at the end.
+ * Returns 0 on success, -1 if any step failed.
+ */
+int bench_copysched(const char* root, int files, uint64_t file_size, int large_files,
+                    int max_workers, BenchCopySchedResult* out);
+
+/**
+ * BenchHashResult - Hashing throughput per algorithm, in memory
+ */
+typedef struct {
+    uint64_t bytes;                      // Bytes hashed per algorithm
+    uint64_t elapsed_ns[HASH_ALGO_COUNT];
+    double gb_per_sec[HASH_ALGO_COUNT];  // 1e9 bytes per second
+} BenchHashResult;
+
+/**
+ * bench_hash(size, out)
+ * Hash a 'size' byte buffer with every algorithm (in 1 MiB pieces, as the
+ * copy engine feeds them) after a warm-up pass, so the figures show the
+ * CPU cost without any I/O. Known test vectors are checked first.
+ * Returns 0 on success, -1 on a wrong digest or allocation failure.
+ */
+int bench_hash(uint64_t size, BenchHashResult* out);
+
+/**
+ * BenchSyncResult - Comparing an unchanged mirror against a plain walk
+ */
+typedef struct {
+    int files;               // Files in the tree
+    uint64_t walk_ns;        // Walking source and mirror (metadata only)
+    uint64_t plan_ns;        // Comparing them by size and timestamp
+    uint64_t content_ns;     // Comparing them by contents
+    uint64_t probed;         // Files probed by the content compare
+    uint64_t changes[SYNC_ACTION_COUNT];  // Found after the edits
+    uint64_t execute_ns;     // Applying that plan
+} BenchSyncResult;
+
+/**
+ * bench_sync(root, files, file_size, out)
+ * Build a tree of 'files' files of 'file_size' bytes (50 per folder)
+ * below 'root' on the active VFS backend and mirror it. Time a walk of
+ * both trees, then sync plans of the unchanged mirror by metadata and by
+ * contents, which must find nothing to do. Then change, add and remove
+ * a few files on both sides, plan and execute the sync, and check that
+ * a second plan comes back empty. Both trees are deleted at the end.
+ * Returns 0 on success, -1 if any step failed or a plan was wrong.
+ */
+int bench_sync(const char* root, int files, uint64_t file_size, BenchSyncResult* out);
+
+/**
+ * BenchDeleteResult - Time until a deleted folder is out of the way
+ */
+typedef struct {
+    int files;               // Files in the tree
+    uint64_t legacy_ns;      // One file at a time, as before the trash
+    uint64_t batched_ns;     // delete_item(): one call, or parallel batches
+    uint64_t trash_ns;       // trash_move(): what the user waits for now
+    uint64_t purge_ns;       // Purging the trashed tree afterwards
+} BenchDeleteResult;
+
+/**
+ * bench_delete(root, files, out)
+ * Build a tree of 'files' small files (50 per folder) below 'root' on the
+ * active VFS backend three times, and delete it file by file, with
+ * delete_item(), and by moving it to a trash folder below 'root' and
+ * purging that.
+ * Returns 0 on success, -1 if any step failed or left something behind.
+ */
+int bench_delete(const char* root, int files, BenchDeleteResult* out);
+
+/**
+ * BenchMoveResult - Moving a folder within one volume
+ */
+typedef struct {
+    int files;               // Files in the tree
+    int folders;             // Folders moved by the batch
+    uint64_t rename_ns;      // move_file() of the whole tree
+    uint64_t copy_ns;        // Copy and delete of the tree, as before
+    uint64_t batch_ns;       // move_batch() of its folders, one merging
+    int conflict_ok;         // A batch with a conflict moved nothing
+} BenchMoveResult;
+
+/**
+ * bench_move(root, files, out)
+ * Build a tree of 'files' small files (50 per folder) below 'root' on the
+ * active VFS backend, move it to another folder with move_file() and back
+ * by copying and deleting, then move its folders with one move_batch():
+ * first with a file in the way of one of them, which must move nothing,
+ * then with only a folder to merge into.
+ * Returns 0 on success, -1 if any step failed or left something behind.
+ */
+int bench_move(const char* root, int files, BenchMoveResult* out);
+
+/**
+ * BenchBatchResult - Marking entries and copying them as one batch
+ */
+typedef struct {
+    int entries;             // Entries of the synthetic listing
+    uint64_t all_ns;         // select_all()
+    uint64_t invert_ns;      // select_invert() of everything marked
+    uint64_t match_ns;       // select_match() of one name in four
+    uint64_t walk_ns;        // select_next() over the matches
+    int matched;             // Entries select_match() marked
+    int files;               // Files copied
+    uint64_t single_ns;      // copy_item() of each file in turn
+    uint64_t batch_ns;       // One copy_batch() of all of them
+} BenchBatchResult;
+
+/**
+ * bench_batch(root, files, entries, out)
+ * Time the selection operations over a synthetic listing of 'entries'
+ * names, then build 'files' small files in one folder below 'root' on the
+ * active VFS backend and copy them to two other folders, one copy_item()
+ * at a time and with one copy_batch().
+ * Returns 0 on success, -1 if any step failed or left something behind.
+ */
+int bench_batch(const char* root, int files, int entries, BenchBatchResult* out);
+
+/**
+ * BenchClipboardResult - Collecting paths on the persistent clipboard
+ */
+typedef struct {
+    int items;               // Paths added
+    int folders;             // Folders they are spread over
+    uint64_t add_ns;         // Adding them, one folder at a time
+    uint64_t load_ns;        // First use after a restart (reading the file)
+    uint64_t remove_ns;      // Dropping the half marked to move
+    uint64_t name_bytes;     // Folder paths and names as stored
+    uint64_t path_bytes;     // The same items as full paths
+    uint64_t file_bytes;     // Clipboard file once all were added
+    uint64_t compact_bytes;  // Clipboard file after the removal
+    int reloaded;            // Items found again after each restart
+} BenchClipboardResult;
+
+/**
+ * bench_clipboard(root, items, folders, out)
+ * Add 'items' paths spread over 'folders' folders to a clipboard kept in
+ * a file below 'root' (every other one to move), restart it and use it
+ * again, drop the items to move and restart once more. Uses the real
+ * clipboard, so whatever it held is replaced.
+ * Returns 0 on success, -1 if an item went missing or a step failed.
+ */
+int bench_clipboard(const char* root, int items, int folders, BenchClipboardResult* out);
+
+/**
+ * bench_print_listing(result)
+ * Print a one-line summary of a listing benchmark to stdout.
+ */
+void bench_print_listing(const BenchListingResult* result);
+
+/**
+ * bench_layout(entries, out)
+ * Build 'entries' synthetic names in both the old 272-byte FsEntry layout
+ * (capacity-doubling realloc) and the arena FsDirectory, then compare
+ * memory footprint, build time and a case-insensitive scan.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int bench_layout(int entries, BenchLayoutResult* out);
+
+/**
+ * bench_print_layout(result)
+ * Print a summary of a layout comparison to stdout.
+ */
+void bench_print_layout(const BenchLayoutResult* result);
+
+#endif
@@ -1,42 +1,684 @@
 #include "clipboard.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include "../utils/utils.h"
+#include "../walk/walk.h"
 
-static char g_clipboard_path[512];
-static ClipboardOp g_clipboard_op = CLIPBOARD_NONE;
+/**
+ * Clipboard implementation
+ *
+ * Folder paths and item names live in two FsDirectory arenas. Beside
+ * each name go the index of its folder and its intent (CLIPBOARD_NONE
+ * once removed). Two open-addressing hash tables find a folder by path
+ * and an item by folder and name. A removed item keeps its slot until the
+ * next rebuild, so adding it again simply revives it.
+ *
+ * File layout (integers unsigned LEB128 varints):
+ *   "DBFMCLP1" version
+ *   then one record per change, appended:
+ *     'F' path_len path             the next folder index
+ *     'A' op folder name_len name   add an item, or change its intent
+ *     'R' item                      remove an item
+ * Replaying the records in order gives back the same indices. A record
+ * cut short (the app stopped mid-write) ends the replay, and the file is
+ * then rewritten from what was read.
+ */
 
-void clipboard_init(void)
+#define CLIPBOARD_MAGIC "DBFMCLP1"
+#define CLIPBOARD_VERSION 1
+
+/* Records allowed beyond two per item before the file is rewritten */
+#define CLIPBOARD_SLACK_RECORDS 256
+
+#define CLIPBOARD_HASH_SEED 2166136261u
+
+typedef struct {
+    uint32_t* slots;             // Entry index + 1, 0 while free
+    uint32_t mask;               // Slot count - 1 (a power of two)
+} ClipTable;
+
+typedef struct {
+    FsDirectory* folders;        // Folder paths, each once
+    FsDirectory* names;          // Item names
+    uint32_t* item_folder;       // Folder of each item
+    uint8_t* item_op;            // Intent of each item
+    int capacity;                // Room in the two columns
+    ClipTable folder_table;
+    ClipTable item_table;
+    int live;                    // Items not removed
+} ClipSet;
+
+static char g_file[FS_MAX_PATH];
+static int g_loaded = 0;         // The file has been read
+static int g_dirty = 0;          // The file no longer matches the items
+static uint64_t g_records = 0;   // Records in the file
+static ClipSet g_set;
+
+// FNV-1a of 'str', carrying on from 'h'
+static uint32_t clipboard_hash(uint32_t h, const char* str)
 {
-    g_clipboard_path[0] = '\0';
-    g_clipboard_op = CLIPBOARD_NONE;
+    for (; *str != '\0'; str++) {
+        h ^= (uint8_t)*str;
+        h *= 16777619u;
+    }
+    return h;
 }
 
-int clipboard_set(const char* path, ClipboardOp op)
+static uint32_t clipboard_item_key(uint32_t folder, const char* name)
 {
-    if (path == NULL) return -1;
-    strncpy(g_clipboard_path, path, sizeof(g_clipboard_path)-1);
-    g_clipboard_path[sizeof(g_clipboard_path)-1] = '\0';
-    g_clipboard_op = op;
+    return clipboard_hash((CLIPBOARD_HASH_SEED ^ folder) * 16777619u, name);
+}
+
+static uint32_t clipboard_folder_hash(const ClipSet* set, int index)
+{
+    return clipboard_hash(CLIPBOARD_HASH_SEED, fs_dir_name(set->folders, index));
+}
+
+static uint32_t clipboard_item_hash(const ClipSet* set, int index)
+{
+    return clipboard_item_key(set->item_folder[index], fs_dir_name(set->names, index));
+}
+
+// Make room in 't' for 'count' entries at most half full
+static int clipboard_table_fit(const ClipSet* set, ClipTable* t, int count,
+                               uint32_t (*hash_of)(const ClipSet*, int))
+{
+    if (t->slots != NULL && (uint64_t)count * 2 <= (uint64_t)t->mask + 1)
+        return 0;
+
+    uint32_t size = t->slots != NULL ? (t->mask + 1) * 2 : 64;
+    while ((uint64_t)size < (uint64_t)count * 2)
+        size *= 2;
+    uint32_t* slots = (uint32_t*)calloc(size, sizeof(uint32_t));
+    if (slots == NULL)
+        return -1;
+
+    for (uint32_t s = 0; t->slots != NULL && s <= t->mask; s++) {
+        uint32_t entry = t->slots[s];
+        if (entry == 0)
+            continue;
+        uint32_t i = hash_of(set, (int)entry - 1) & (size - 1);
+        while (slots[i] != 0)
+            i = (i + 1) & (size - 1);
+        slots[i] = entry;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->mask = size - 1;
     return 0;
 }
 
-const char* clipboard_get_path(void)
+static void clipboard_set_free(ClipSet* set)
 {
-    if (g_clipboard_op == CLIPBOARD_NONE) return NULL;
-    return g_clipboard_path;
+    fs_free_directory(set->folders);
+    fs_free_directory(set->names);
+    free(set->item_folder);
+    free(set->item_op);
+    free(set->folder_table.slots);
+    free(set->item_table.slots);
+    memset(set, 0, sizeof(*set));
 }
 
-ClipboardOp clipboard_get_operation(void)
+// Index of folder 'path', added if new ('*added' then set).
+// Returns -1 on allocation failure.
+static int clipboard_intern(ClipSet* set, const char* path, int* added)
 {
-    return g_clipboard_op;
+    *added = 0;
+    if (set->folders == NULL && (set->folders = fs_dir_create(16)) == NULL)
+        return -1;
+    int count = fs_dir_count(set->folders);
+    if (clipboard_table_fit(set, &set->folder_table, count + 1, clipboard_folder_hash) != 0)
+        return -1;
+
+    uint32_t i = clipboard_hash(CLIPBOARD_HASH_SEED, path) & set->folder_table.mask;
+    while (set->folder_table.slots[i] != 0) {
+        int index = (int)set->folder_table.slots[i] - 1;
+        if (strcmp(fs_dir_name(set->folders, index), path) == 0)
+            return index;
+        i = (i + 1) & set->folder_table.mask;
+    }
+
+    if (fs_dir_append(set->folders, path, 1, 0) != 0)
+        return -1;
+    set->folder_table.slots[i] = (uint32_t)count + 1;
+    *added = 1;
+    return count;
 }
 
-void clipboard_clear(void)
+// Give item 'name' of folder 'folder' intent 'op', adding it if new
+// ('*changed' set unless it already had that intent).
+// Returns its index, or -1 on allocation failure.
+static int clipboard_put(ClipSet* set, int folder, const char* name, ClipboardOp op, int* changed)
+{
+    *changed = 1;
+    if (set->names == NULL && (set->names = fs_dir_create(64)) == NULL)
+        return -1;
+    int count = fs_dir_count(set->names);
+    if (clipboard_table_fit(set, &set->item_table, count + 1, clipboard_item_hash) != 0)
+        return -1;
+
+    uint32_t i = clipboard_item_key((uint32_t)folder, name) & set->item_table.mask;
+    while (set->item_table.slots[i] != 0) {
+        int index = (int)set->item_table.slots[i] - 1;
+        if (set->item_folder[index] == (uint32_t)folder &&
+            strcmp(fs_dir_name(set->names, index), name) == 0) {
+            if (set->item_op[index] == CLIPBOARD_NONE)
+                set->live++;
+            *changed = set->item_op[index] != op;
+            set->item_op[index] = (uint8_t)op;
+            return index;
+        }
+        i = (i + 1) & set->item_table.mask;
+    }
+
+    if (count >= set->capacity) {
+        int capacity = set->capacity > 0 ? set->capacity * 2 : 64;
+        uint32_t* folders = (uint32_t*)realloc(set->item_folder, sizeof(uint32_t) * capacity);
+        if (folders == NULL)
+            return -1;
+        set->item_folder = folders;
+        uint8_t* ops = (uint8_t*)realloc(set->item_op, capacity);
+        if (ops == NULL)
+            return -1;
+        set->item_op = ops;
+        set->capacity = capacity;
+    }
+    if (fs_dir_append(set->names, name, 0, 0) != 0)
+        return -1;
+    set->item_folder[count] = (uint32_t)folder;
+    set->item_op[count] = (uint8_t)op;
+    set->item_table.slots[i] = (uint32_t)count + 1;
+    set->live++;
+    return count;
+}
+
+static void clipboard_put_varint(FILE* f, uint64_t v)
+{
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, f);
+        v >>= 7;
+    }
+    fputc((int)v, f);
+}
+
+static void clipboard_put_string(FILE* f, const char* str)
 {
-    g_clipboard_path[0] = '\0';
-    g_clipboard_op = CLIPBOARD_NONE;
+    size_t len = strlen(str);
+    clipboard_put_varint(f, len);
+    fwrite(str, 1, len, f);
+}
+
+static uint64_t clipboard_get_varint(FILE* f, int* failed)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF)
+            break;
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+            return v;
+    }
+    *failed = 1;
+    return 0;
+}
+
+static void clipboard_get_string(FILE* f, char* str, size_t max, int* failed)
+{
+    uint64_t len = clipboard_get_varint(f, failed);
+    if (*failed || len >= max || fread(str, 1, (size_t)len, f) != (size_t)len) {
+        *failed = 1;
+        str[0] = '\0';
+        return;
+    }
+    str[len] = '\0';
+}
+
+// Append the record for folder 'index' ('f' may be NULL: counted only)
+static void clipboard_log_folder(FILE* f, int index)
+{
+    if (f != NULL) {
+        fputc('F', f);
+        clipboard_put_string(f, fs_dir_name(g_set.folders, index));
+    }
+    g_records++;
+}
+
+static void clipboard_log_item(FILE* f, int index)
+{
+    if (f != NULL) {
+        fputc('A', f);
+        clipboard_put_varint(f, g_set.item_op[index]);
+        clipboard_put_varint(f, g_set.item_folder[index]);
+        clipboard_put_string(f, fs_dir_name(g_set.names, index));
+    }
+    g_records++;
+}
+
+static void clipboard_log_remove(FILE* f, int index)
+{
+    if (f != NULL) {
+        fputc('R', f);
+        clipboard_put_varint(f, (uint64_t)index);
+    }
+    g_records++;
+}
+
+// Open the file to append records, starting it if new. NULL when there
+// is no file, or it cannot be kept up to date (the next save rewrites it).
+static FILE* clipboard_log_open(void)
+{
+    if (g_file[0] == '\0' || g_dirty)
+        return NULL;
+
+    FILE* f = fopen(g_file, "ab");
+    if (f == NULL) {
+        // First save: the folder may not exist yet
+        char dir[FS_MAX_PATH];
+        if (path_get_parent(g_file, dir) == 0)
+            mkdir(dir, 0777);
+        f = fopen(g_file, "ab");
+    }
+    if (f == NULL) {
+        g_dirty = 1;
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == 0) {
+        fwrite(CLIPBOARD_MAGIC, 1, 8, f);
+        clipboard_put_varint(f, CLIPBOARD_VERSION);
+    }
+    return f;
+}
+
+static void clipboard_log_close(FILE* f)
+{
+    if (f == NULL)
+        return;
+    int ok = !ferror(f);
+    if (fclose(f) != 0 || !ok)
+        g_dirty = 1;
+}
+
+// Rebuild the items without the removed ones and unused folders,
+// renumbered in order. On failure the items are left as they were.
+static int clipboard_rebuild(void)
+{
+    ClipSet fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    int count = fs_dir_count(g_set.names);
+    for (int i = 0; i < count; i++) {
+        if (g_set.item_op[i] == CLIPBOARD_NONE)
+            continue;
+        int added;
+        int changed;
+        int folder = clipboard_intern(&fresh, fs_dir_name(g_set.folders, (int)g_set.item_folder[i]),
+                                      &added);
+        if (folder < 0 ||
+            clipboard_put(&fresh, folder, fs_dir_name(g_set.names, i), (ClipboardOp)g_set.item_op[i],
+                          &changed) < 0) {
+            clipboard_set_free(&fresh);
+            return -1;
+        }
+    }
+    clipboard_set_free(&g_set);
+    g_set = fresh;
+    return 0;
+}
+
+// Drop the removed items and write the file afresh
+static void clipboard_save(void)
+{
+    if (g_set.live == 0) {
+        clipboard_set_free(&g_set);
+        if (g_file[0] != '\0')
+            remove(g_file);
+        g_records = 0;
+        g_dirty = 0;
+        return;
+    }
+    if (clipboard_rebuild() != 0)
+        return;
+
+    g_records = 0;
+    if (g_file[0] == '\0') {
+        g_records = (uint64_t)fs_dir_count(g_set.folders) + fs_dir_count(g_set.names);
+        return;
+    }
+
+    char dir[FS_MAX_PATH];
+    if (path_get_parent(g_file, dir) == 0)
+        mkdir(dir, 0777);
+    char tmp[FS_MAX_PATH + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_file);
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL) {
+        g_dirty = 1;
+        return;
+    }
+
+    fwrite(CLIPBOARD_MAGIC, 1, 8, f);
+    clipboard_put_varint(f, CLIPBOARD_VERSION);
+    // After a rebuild folders are numbered in the order items first use them
+    int next_folder = 0;
+    for (int i = 0; i < fs_dir_count(g_set.names); i++) {
+        if ((int)g_set.item_folder[i] == next_folder)
+            clipboard_log_folder(f, next_folder++);
+        clipboard_log_item(f, i);
+    }
+
+    int ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    if (ok) {
+        remove(g_file);
+        ok = rename(tmp, g_file) == 0;
+    }
+    if (!ok)
+        remove(tmp);
+    g_dirty = !ok;
+}
+
+// Rewrite the file once it no longer matches or is mostly removed items
+static void clipboard_settle(void)
+{
+    if (g_dirty || g_set.live == 0 ||
+        g_records > 2 * (uint64_t)g_set.live + CLIPBOARD_SLACK_RECORDS)
+        clipboard_save();
+}
+
+// Replay the file, once, before the clipboard is first used
+static void clipboard_load(void)
+{
+    if (g_loaded)
+        return;
+    g_loaded = 1;
+    if (g_file[0] == '\0')
+        return;
+
+    FILE* f = fopen(g_file, "rb");
+    if (f == NULL)
+        return;  // Nothing saved yet
+
+    char magic[8];
+    int failed = 0;
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, CLIPBOARD_MAGIC, 8) != 0 ||
+        clipboard_get_varint(f, &failed) != CLIPBOARD_VERSION) {
+        fclose(f);
+        g_dirty = 1;  // Replaced by the next change
+        return;
+    }
+
+    char text[FS_MAX_PATH];
+    int tag;
+    while (!failed && (tag = fgetc(f)) != EOF) {
+        int added;
+        int changed;
+        if (tag == 'F') {
+            int expect = fs_dir_count(g_set.folders);
+            clipboard_get_string(f, text, sizeof(text), &failed);
+            if (!failed && (clipboard_intern(&g_set, text, &added) != expect || !added))
+                failed = 1;
+        } else if (tag == 'A') {
+            uint64_t op = clipboard_get_varint(f, &failed);
+            uint64_t folder = clipboard_get_varint(f, &failed);
+            clipboard_get_string(f, text, sizeof(text), &failed);
+            if (!failed && ((op != CLIPBOARD_COPY && op != CLIPBOARD_MOVE) ||
+                            folder >= (uint64_t)fs_dir_count(g_set.folders) ||
+                            clipboard_put(&g_set, (int)folder, text, (ClipboardOp)op, &changed) < 0))
+                failed = 1;
+        } else if (tag == 'R') {
+            uint64_t item = clipboard_get_varint(f, &failed);
+            if (!failed && item >= (uint64_t)fs_dir_count(g_set.names))
+                failed = 1;
+            else if (!failed && g_set.item_op[item] != CLIPBOARD_NONE) {
+                g_set.item_op[item] = CLIPBOARD_NONE;
+                g_set.live--;
+            }
+        } else {
+            failed = 1;
+        }
+        if (!failed)
+            g_records++;
+    }
+    fclose(f);
+
+    // Keep what was read; the rewrite drops the broken tail
+    if (failed)
+        g_dirty = 1;
+    clipboard_settle();
+}
+
+void clipboard_init(const char* file)
+{
+    clipboard_set_free(&g_set);
+    str_copy(g_file, file != NULL ? file : CLIPBOARD_DEFAULT_FILE, sizeof(g_file));
+    g_loaded = 0;
+    g_dirty = 0;
+    g_records = 0;
+}
+
+void clipboard_cleanup(void)
+{
+    // A file that fell behind gets one more chance to catch up
+    if (g_loaded && g_dirty)
+        clipboard_save();
+    clipboard_set_free(&g_set);
+    g_loaded = 0;
+    g_records = 0;
+}
+
+int clipboard_add_list(const FsDirectory* paths, ClipboardOp op)
+{
+    if (paths == NULL || (op != CLIPBOARD_COPY && op != CLIPBOARD_MOVE))
+        return -1;
+    clipboard_load();
+
+    FILE* f = clipboard_log_open();
+    char folder_path[FS_MAX_PATH];
+    int rc = 0;
+    for (int i = 0; i < fs_dir_count(paths) && rc == 0; i++) {
+        const char* path = fs_dir_name(paths, i);
+        const char* name = path_get_filename(path);
+        if (name == NULL || name[0] == '\0') {
+            rc = -1;
+            break;
+        }
+        if (path_get_parent(path, folder_path) != 0)
+            str_copy(folder_path, "/", sizeof(folder_path));
+
+        int added;
+        int changed;
+        int folder = clipboard_intern(&g_set, folder_path, &added);
+        if (folder < 0) {
+            rc = -1;
+            break;
+        }
+        if (added)
+            clipboard_log_folder(f, folder);
+        int item = clipboard_put(&g_set, folder, name, op, &changed);
+        if (item < 0)
+            rc = -1;
+        else if (changed)
+            clipboard_log_item(f, item);
+    }
+    clipboard_log_close(f);
+    clipboard_settle();
+    return rc;
+}
+
+int clipboard_add(const char* path, ClipboardOp op)
+{
+    if (path == NULL) return -1;
+
+    FsDirectory* one = fs_dir_create(1);
+    int rc = (one != NULL && fs_dir_append(one, path, 0, 0) == 0) ? clipboard_add_list(one, op) : -1;
+    fs_free_directory(one);
+    return rc;
+}
+
+void clipboard_remove_op(ClipboardOp op)
+{
+    if (op == CLIPBOARD_NONE) {
+        clipboard_clear();
+        return;
+    }
+    clipboard_load();
+
+    FILE* f = clipboard_log_open();
+    for (int i = 0; i < fs_dir_count(g_set.names); i++) {
+        if (g_set.item_op[i] == op) {
+            g_set.item_op[i] = CLIPBOARD_NONE;
+            g_set.live--;
+            clipboard_log_remove(f, i);
+        }
+    }
+    clipboard_log_close(f);
+    clipboard_settle();
+}
+
+// Index of the item at 'path', or -1 if it is not held
+static int clipboard_find(const char* path)
+{
+    const char* name = path_get_filename(path);
+    if (name == NULL || name[0] == '\0' || g_set.folder_table.slots == NULL ||
+        g_set.item_table.slots == NULL)
+        return -1;
+    char folder_path[FS_MAX_PATH];
+    if (path_get_parent(path, folder_path) != 0)
+        str_copy(folder_path, "/", sizeof(folder_path));
+
+    int folder = -1;
+    uint32_t i = clipboard_hash(CLIPBOARD_HASH_SEED, folder_path) & g_set.folder_table.mask;
+    while (folder < 0 && g_set.folder_table.slots[i] != 0) {
+        int index = (int)g_set.folder_table.slots[i] - 1;
+        if (strcmp(fs_dir_name(g_set.folders, index), folder_path) == 0)
+            folder = index;
+        i = (i + 1) & g_set.folder_table.mask;
+    }
+    if (folder < 0)
+        return -1;
+
+    i = clipboard_item_key((uint32_t)folder, name) & g_set.item_table.mask;
+    while (g_set.item_table.slots[i] != 0) {
+        int index = (int)g_set.item_table.slots[i] - 1;
+        if (g_set.item_folder[index] == (uint32_t)folder &&
+            strcmp(fs_dir_name(g_set.names, index), name) == 0)
+            return index;
+        i = (i + 1) & g_set.item_table.mask;
+    }
+    return -1;
+}
+
+void clipboard_remove_list(const FsDirectory* paths)
+{
+    if (paths == NULL)
+        return;
+    clipboard_load();
+
+    FILE* f = clipboard_log_open();
+    for (int i = 0; i < fs_dir_count(paths); i++) {
+        int item = clipboard_find(fs_dir_name(paths, i));
+        if (item >= 0 && g_set.item_op[item] != CLIPBOARD_NONE) {
+            g_set.item_op[item] = CLIPBOARD_NONE;
+            g_set.live--;
+            clipboard_log_remove(f, item);
+        }
+    }
+    clipboard_log_close(f);
+    clipboard_settle();
+}
+
+// 1 if item 'index' is held with intent 'op' (CLIPBOARD_NONE: any)
+static int clipboard_matches(int index, ClipboardOp op)
+{
+    return g_set.item_op[index] != CLIPBOARD_NONE && (op == CLIPBOARD_NONE || g_set.item_op[index] == op);
+}
+
+// Full path of item 'index'
+static int clipboard_join(int index, char* path, int size)
+{
+    return walk_join(fs_dir_name(g_set.folders, (int)g_set.item_folder[index]),
+                     fs_dir_name(g_set.names, index), path, size);
+}
+
+int clipboard_get_list(ClipboardOp op, FsDirectory* out)
+{
+    if (out == NULL)
+        return -1;
+    clipboard_load();
+
+    char path[FS_MAX_PATH];
+    int added = 0;
+    for (int i = 0; i < fs_dir_count(g_set.names); i++) {
+        if (!clipboard_matches(i, op) || clipboard_join(i, path, sizeof(path)) != 0)
+            continue;
+        if (fs_dir_append(out, path, 0, 0) != 0)
+            return -1;
+        added++;
+    }
+    return added;
+}
+
+ClipboardOp clipboard_get_last(char* path, int size)
+{
+    clipboard_load();
+    for (int i = fs_dir_count(g_set.names) - 1; i >= 0; i--) {
+        if (clipboard_matches(i, CLIPBOARD_NONE) && clipboard_join(i, path, size) == 0)
+            return (ClipboardOp)g_set.item_op[i];
+    }
+    return CLIPBOARD_NONE;
+}
+
+int clipboard_count(ClipboardOp op)
+{
+    clipboard_load();
+    if (op == CLIPBOARD_NONE)
+        return g_set.live;
+
+    int count = 0;
+    for (int i = 0; i < fs_dir_count(g_set.names); i++)
+        count += g_set.item_op[i] == op;
+    return count;
 }
 
 int clipboard_has_item(void)
 {
-    return (g_clipboard_op != CLIPBOARD_NONE && g_clipboard_path[0] != '\0');
+    return clipboard_count(CLIPBOARD_NONE) > 0;
+}
+
+void clipboard_clear(void)
+{
+    clipboard_set_free(&g_set);
+    if (g_file[0] != '\0')
+        remove(g_file);
+    g_loaded = 1;
+    g_dirty = 0;
+    g_records = 0;
+}
+
+void clipboard_get_stats(ClipboardStats* out)
+{
+    if (out == NULL)
+        return;
+    clipboard_load();
+
+    memset(out, 0, sizeof(*out));
+    out->items = g_set.live;
+    out->folders = fs_dir_count(g_set.folders);
+    out->records = g_records;
+    for (int i = 0; i < out->folders; i++)
+        out->name_bytes += fs_dir_name_length(g_set.folders, i) + 1;
+    for (int i = 0; i < fs_dir_count(g_set.names); i++) {
+        int len = fs_dir_name_length(g_set.names, i);
+        out->name_bytes += len + 1;
+        if (g_set.item_op[i] != CLIPBOARD_NONE)
+            out->path_bytes += fs_dir_name_length(g_set.folders, (int)g_set.item_folder[i]) + len + 2;
+    }
+
+    struct stat st;
+    if (g_file[0] != '\0' && stat(g_file, &st) == 0)
+        out->file_bytes = (uint64_t)st.st_size;
 }
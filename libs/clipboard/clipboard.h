@@ -1,29 +1,121 @@
 #ifndef CLIPBOARD_H
 #define CLIPBOARD_H
 
+#include "fs.h"
+
+/**
+ * Clipboard module
+ *
+ * Collects paths to paste later, from any number of folders and across
+ * runs of the app. Each item carries its own intent (copy or move), so
+ * one paste can copy some items and move others.
+ *
+ * Items are stored as a folder and a name: every folder path is kept once
+ * and shared by all the items in it, so thousands of files from a few
+ * folders cost little more than their names. Adding a path that is
+ * already held only changes its intent.
+ *
+ * The clipboard is saved to a small file on the card as it changes. Each
+ * change appends a record, and the file is rewritten only when removed
+ * items make up most of it. The file is read on first use, not at
+ * startup. Only the main thread uses the clipboard.
+ */
+
+#define CLIPBOARD_DEFAULT_FILE "/switch/DBFM/clipboard.log"
+
 /** Clipboard operation types */
 typedef enum {
-    CLIPBOARD_NONE = 0,
+    CLIPBOARD_NONE = 0,          // No item (or, as a filter, every item)
     CLIPBOARD_COPY = 1,
     CLIPBOARD_MOVE = 2
 } ClipboardOp;
 
-/* Initialize clipboard system */
-void clipboard_init(void);
+/**
+ * ClipboardStats - What the clipboard holds and costs
+ */
+typedef struct {
+    int items;                   // Items held
+    int folders;                 // Distinct folders they are in
+    uint64_t name_bytes;         // Folder paths and names, as stored
+    uint64_t path_bytes;         // The same items as full paths
+    uint64_t file_bytes;         // Size of the clipboard file
+    uint64_t records;            // Records in the file
+} ClipboardStats;
 
-/* Set clipboard item and operation */
-int clipboard_set(const char* path, ClipboardOp op);
+/**
+ * clipboard_init(file)
+ * Keep the clipboard in 'file' (NULL selects CLIPBOARD_DEFAULT_FILE,
+ * "" keeps it in memory only). The file is read on first use.
+ */
+void clipboard_init(const char* file);
 
-/* Get clipboard path (returns pointer to internal buffer, NULL if none) */
-const char* clipboard_get_path(void);
+/**
+ * clipboard_cleanup()
+ * Forget the items in memory; the file keeps them for the next run.
+ */
+void clipboard_cleanup(void);
 
-/* Get clipboard operation (CLIPBOARD_NONE/COPY/MOVE) */
-ClipboardOp clipboard_get_operation(void);
+/**
+ * clipboard_add(path, op) / clipboard_add_list(paths, op)
+ * Add 'path', or every path in 'paths' (names are full paths), with
+ * intent 'op'. A path already held takes the new intent.
+ * Returns 0 on success, -1 on a bad path or allocation failure (items
+ * added before the failure stay). A file that cannot be written does
+ * not fail the call; the items are then kept for this run only.
+ */
+int clipboard_add(const char* path, ClipboardOp op);
+int clipboard_add_list(const FsDirectory* paths, ClipboardOp op);
 
-/* Clear clipboard */
-void clipboard_clear(void);
+/**
+ * clipboard_remove_op(op)
+ * Remove every item with intent 'op' (CLIPBOARD_NONE removes all).
+ */
+void clipboard_remove_op(ClipboardOp op);
+
+/**
+ * clipboard_remove_list(paths)
+ * Remove the items at the paths in 'paths' (names are full paths),
+ * whatever their intent. Paths not held are ignored.
+ */
+void clipboard_remove_list(const FsDirectory* paths);
+
+/**
+ * clipboard_get_list(op, out)
+ * Append the full path of every item with intent 'op' (CLIPBOARD_NONE
+ * for all) to 'out', oldest first.
+ * Returns the number appended, or -1 on allocation failure.
+ */
+int clipboard_get_list(ClipboardOp op, FsDirectory* out);
 
-/* Check if clipboard has an item */
+/**
+ * clipboard_get_last(path, size)
+ * Write the most recently added item to 'path'.
+ * Returns its intent, or CLIPBOARD_NONE if the clipboard is empty.
+ */
+ClipboardOp clipboard_get_last(char* path, int size);
+
+/**
+ * clipboard_count(op)
+ * Returns the number of items with intent 'op' (CLIPBOARD_NONE for all).
+ */
+int clipboard_count(ClipboardOp op);
+
+/**
+ * clipboard_has_item()
+ * Returns 1 if the clipboard holds anything.
+ */
 int clipboard_has_item(void);
 
+/**
+ * clipboard_clear()
+ * Remove every item and the file.
+ */
+void clipboard_clear(void);
+
+/**
+ * clipboard_get_stats(out)
+ * Fill 'out' with what the clipboard holds.
+ */
+void clipboard_get_stats(ClipboardStats* out);
+
 #endif
@@ -1,156 +1,196 @@
 #include "copy.h"
-#include <switch.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "../utils/utils.h"
+#include "../vfs/vfs.h"
+#include "../walk/walk.h"
+#include "../transfer/transfer.h"
+#include "../copysched/copysched.h"
+#include "../dircache/dircache.h"
+#include "../dirsize/dirsize.h"
+#include "../delete/delete.h"
+#include "../journal/journal.h"
+#include "../hash/hash.h"
+
+static atomic_int g_verify = HASH_NONE;
+
+void copy_set_verify(int algo)
+{
+    atomic_store(&g_verify, algo > HASH_NONE && algo < HASH_ALGO_COUNT ? algo : HASH_NONE);
+}
 
-// Helper: normalize incoming paths to be relative to the SdCard FsFileSystem.
-// Accepts paths like "/switch/foo" or "sdmc:/switch/foo" and returns
-// "switch/foo" in out (no leading slash).
-static void normalize_sd_path(const char* in, char* out, size_t outlen)
+int copy_get_verify(void)
 {
-    if (!in || !out || outlen == 0) return;
-    const char* p = in;
-    // strip leading "sdmc:/"
-    if (strncmp(p, "sdmc:/", 6) == 0) p += 6;
-    // strip single leading '/'
-    if (*p == '/') p++;
-    // copy remaining
-    strncpy(out, p, outlen - 1);
-    out[outlen - 1] = '\0';
+    return atomic_load(&g_verify);
 }
 
-static int copy_file_contents_libnx(const char* src, const char* dest)
+static int copy_file_contents(const char* src, const char* dest, uint64_t size, Progress* progress)
 {
     if (!src || !dest) return -1;
-
-    Result rc;
-    FsFileSystem fs;
-    rc = fsOpenSdCardFileSystem(&fs);
-    if (R_FAILED(rc)) return -1;
-
-    char src_n[512];
-    char dest_n[512];
-    normalize_sd_path(src, src_n, sizeof(src_n));
-    normalize_sd_path(dest, dest_n, sizeof(dest_n));
-
-    FsFile inFile, outFile;
-    rc = fsFsOpenFile(&fs, src_n, FsOpenMode_Read, &inFile);
-    if (R_FAILED(rc)) { fsFsClose(&fs); return -1; }
-
-    // Ensure destination exists (create empty file if needed)
-    fsFsCreateFile(&fs, dest_n, 0, 0);
-    rc = fsFsOpenFile(&fs, dest_n, FsOpenMode_Write, &outFile);
-    if (R_FAILED(rc)) { fsFileClose(&inFile); fsFsClose(&fs); return -1; }
-
-    char buf[4096];
-    s64 off_in = 0;
-    s64 off_out = 0;
-    while (1) {
-        u64 bytesRead = 0;
-        rc = fsFileRead(&inFile, off_in, buf, sizeof(buf), FsReadOption_None, &bytesRead);
-        if (R_FAILED(rc)) { fsFileClose(&inFile); fsFileClose(&outFile); fsFsClose(&fs); return -1; }
-        if (bytesRead == 0) break;
-        rc = fsFileWrite(&outFile, off_out, buf, bytesRead, FsWriteOption_None);
-        if (R_FAILED(rc)) { fsFileClose(&inFile); fsFileClose(&outFile); fsFsClose(&fs); return -1; }
-        off_in += (s64)bytesRead;
-        off_out += (s64)bytesRead;
-    }
-
-    fsFileClose(&inFile);
-    fsFileClose(&outFile);
-    fsFsClose(&fs);
+    progress_add_total(progress, 1, size);
+    progress_set_phase(progress, PROGRESS_COPYING);
+    progress_set_current(progress, src);
+    TransferOptions opt = {0};
+    opt.verify = copy_get_verify();
+    int rc = transfer_file(src, dest, &opt, progress, NULL, NULL);
+    if (rc == TRANSFER_ERR_VERIFY) return COPY_ERR_VERIFY;
+    if (rc != 0) return rc > 0 ? COPY_CANCELLED : -1;
+    progress_add_done(progress, 1, 0);
     return 0;
 }
 
-static int copy_dir_recursive_libnx(const char* src_dir, const char* dest_dir)
+// Source bytes counted by the space check, stopping once over the limit
+typedef struct {
+    uint64_t bytes;
+    uint64_t limit;
+} CopySpace;
+
+static int copy_space_visit(const char* path, const FsEntry* entry, int depth, void* user)
 {
-    if (!src_dir || !dest_dir) return -1;
+    (void)path;
+    (void)depth;
+    CopySpace* s = (CopySpace*)user;
+    if (!entry->is_dir)
+        s->bytes += entry->size;
+    return s->bytes > s->limit ? WALK_STOP : WALK_CONTINUE;
+}
 
-    Result rc;
-    FsFileSystem fs;
-    rc = fsOpenSdCardFileSystem(&fs);
-    if (R_FAILED(rc)) return -1;
-
-    char src_n[512];
-    char dest_n[512];
-    normalize_sd_path(src_dir, src_n, sizeof(src_n));
-    normalize_sd_path(dest_dir, dest_n, sizeof(dest_n));
-
-    // Ensure dest exists
-    rc = fsFsCreateDirectory(&fs, dest_n);
-    if (R_FAILED(rc) && rc != (Result)0x402) { /* ignore already exists (converted below) */ }
-
-    FsDir dir;
-    rc = fsFsOpenDirectory(&fs, src_n, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &dir);
-    if (R_FAILED(rc)) { fsFsClose(&fs); return -1; }
-
-    while (1) {
-        s64 entries = 0;
-        FsDirectoryEntry entry;
-        rc = fsDirRead(&dir, &entries, 1, &entry);
-        if (R_FAILED(rc)) { fsDirClose(&dir); fsFsClose(&fs); return -1; }
-        if (entries == 0) break;
-
-        // entry.name is a UTF-8 string
-        if (strcmp(entry.name, ".") == 0 || strcmp(entry.name, "..") == 0) continue;
-
-        char child_src[512];
-        char child_dest[512];
-        snprintf(child_src, sizeof(child_src), "%s/%s", src_n, entry.name);
-        snprintf(child_dest, sizeof(child_dest), "%s/%s", dest_n, entry.name);
-
-        if (entry.type == FsDirEntryType_Dir) {
-            if (copy_dir_recursive_libnx(child_src, child_dest) != 0) {
-                fsDirClose(&dir);
-                fsFsClose(&fs);
-                return -1;
-            }
-        } else {
-            if (copy_file_contents_libnx(child_src, child_dest) != 0) {
-                fsDirClose(&dir);
-                fsFsClose(&fs);
-                return -1;
-            }
-        }
+// 0 if all 'count' sources fit in the free space of 'dest_dir' together
+// (or the backend cannot tell), COPY_ERR_NO_SPACE if they do not
+static int copy_check_space(const char* const* srcs, const VfsStat* sts, int count,
+                            const char* dest_dir)
+{
+    CopySpace s;
+    if (vfs_get_free_space(dest_dir, &s.limit) != 0)
+        return 0;
+
+    s.bytes = 0;
+    for (int i = 0; i < count && s.bytes <= s.limit; i++) {
+        s.bytes += sts[i].size;
+        if (sts[i].is_dir)
+            walk_tree(srcs[i], copy_space_visit, NULL, &s, NULL, NULL);
     }
+    return s.bytes > s.limit ? COPY_ERR_NO_SPACE : 0;
+}
 
-    fsDirClose(&dir);
-    fsFsClose(&fs);
-    return 0;
+// Folders go through the scheduler: skeleton first, then files in parallel
+static int copy_dir(const char* src_dir, const char* dest_dir, Progress* progress)
+{
+    if (!src_dir || !dest_dir) return -1;
+    CopySchedOptions opt = {0};
+    CopySchedStats stats;
+    opt.verify = copy_get_verify();
+    int rc = copysched_copy_tree(src_dir, dest_dir, &opt, progress, NULL, &stats);
+    if (rc < 0 && stats.verify_failed > 0) return COPY_ERR_VERIFY;
+    return rc > 0 ? COPY_CANCELLED : rc;
 }
 
-int copy_item(const char* src, const char* dest_dir)
+// Copy one checked item to 'dest_path'
+static int copy_one(const char* src, const VfsStat* st, const char* dest_path, Progress* progress)
 {
-    if (src == NULL || dest_dir == NULL) return -1;
+    VfsStat existing;
+    int existed = (vfs_stat(dest_path, &existing) == 0);
+
+    int rc;
+    if (st->is_dir)
+        rc = copy_dir(src, dest_path, progress);
+    else
+        rc = copy_file_contents(src, dest_path, st->size, progress);
+
+    // Take back a cancelled copy, unless it was merged into something
+    // that was already there
+    if (rc == COPY_CANCELLED && !existed)
+        delete_item(dest_path, NULL);
+
+    // The destination folder changed, even if the copy failed part way
+    dircache_invalidate_entry(dest_path);
+    dirsize_invalidate_entry(dest_path);
+    return rc;
+}
 
-    // Determine name
-    const char* name = path_get_filename(src);
-    if (!name) return -1;
+int copy_batch(const char* const* srcs, int count, const char* dest_dir, Progress* progress)
+{
+    if (srcs == NULL || count <= 0 || dest_dir == NULL) return -1;
+
+    // One filesystem session for every tree
+    if (vfs_session_acquire() != 0) return -1;
+
+    // The destination and every source are checked before anything is written
+    VfsStat dest_st;
+    VfsStat* sts = (VfsStat*)malloc(sizeof(VfsStat) * count);
+    const char** usable = (const char**)malloc(sizeof(char*) * count);
+    if (sts == NULL || usable == NULL || vfs_stat(dest_dir, &dest_st) != 0 || !dest_st.is_dir) {
+        free(sts);
+        free(usable);
+        vfs_session_release();
+        return -1;
+    }
 
+    // A source that is gone or would be copied into itself fails on its own
+    int rc = 0;
+    int usable_count = 0;
     char dest_path[512];
-    snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, name);
-
-    // Try open src as directory using libnx to detect type
-    Result rc;
-    FsFileSystem fs;
-    rc = fsOpenSdCardFileSystem(&fs);
-    if (R_FAILED(rc)) return -1;
-
-    char src_n[512];
-    normalize_sd_path(src, src_n, sizeof(src_n));
-
-    FsDir dir;
-    rc = fsFsOpenDirectory(&fs, src_n, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &dir);
-    if (R_SUCCEEDED(rc)) {
-        // It's a directory
-        fsDirClose(&dir);
-        fsFsClose(&fs);
-        return copy_dir_recursive_libnx(src, dest_path);
+    for (int i = 0; i < count; i++) {
+        const char* name = srcs[i] != NULL ? path_get_filename(srcs[i]) : NULL;
+        if (name == NULL || walk_join(dest_dir, name, dest_path, sizeof(dest_path)) != 0 ||
+            path_is_within(dest_path, srcs[i]) || vfs_stat(srcs[i], &sts[usable_count]) != 0) {
+            rc = -1;
+            continue;
+        }
+        usable[usable_count++] = srcs[i];
+    }
+
+    int space = usable_count > 0 ? copy_check_space(usable, sts, usable_count, dest_dir) : 0;
+    if (space != 0)
+        rc = space;
+
+    // An item that fails is skipped; running out of room or a cancel ends the batch
+    for (int i = 0; space == 0 && i < usable_count; i++) {
+        walk_join(dest_dir, path_get_filename(usable[i]), dest_path, sizeof(dest_path));
+        int item_rc = copy_one(usable[i], &sts[i], dest_path, progress);
+        if (item_rc == COPY_CANCELLED || item_rc == COPY_ERR_NO_SPACE) {
+            rc = item_rc;
+            break;
+        }
+        if (rc == 0)
+            rc = item_rc;
     }
 
-    // Not a directory -> copy file
-    fsFsClose(&fs);
-    return copy_file_contents_libnx(src, dest_path);
+    free(sts);
+    free(usable);
+    vfs_session_release();
+    return rc;
+}
+
+int copy_item(const char* src, const char* dest_dir, Progress* progress)
+{
+    if (src == NULL) return -1;
+    return copy_batch(&src, 1, dest_dir, progress);
+}
+
+int copy_resume(const char* dest, Progress* progress)
+{
+    JournalEntry entry;
+    int64_t offset = journal_verify(dest, &entry);
+    if (offset < 0) return -1;
+
+    if (vfs_session_acquire() != 0) return -1;
+    TransferOptions opt = {0};
+    opt.resume_offset = (uint64_t)offset;
+    opt.verify = copy_get_verify();
+    progress_add_total(progress, 1, entry.size - opt.resume_offset);
+    progress_set_phase(progress, PROGRESS_COPYING);
+    progress_set_current(progress, entry.src);
+    int rc = transfer_file(entry.src, entry.dest, &opt, progress, NULL, NULL);
+    if (rc == 0)
+        progress_add_done(progress, 1, 0);
+    else if (rc > 0)
+        vfs_remove(entry.dest);
+    vfs_session_release();
+
+    dircache_invalidate_entry(entry.dest);
+    dirsize_invalidate_entry(entry.dest);
+    if (rc == TRANSFER_ERR_VERIFY) return COPY_ERR_VERIFY;
+    return rc > 0 ? COPY_CANCELLED : rc;
 }
@@ -1,10 +1,55 @@
 #ifndef COPY_H
 #define COPY_H
 
+#include "progress.h"
+
+/* copy_item() result when the destination lacks room for the copy */
+#define COPY_ERR_NO_SPACE -2
+
+/* copy_item() result when a copied file reads back different (see
+ * copy_set_verify()) */
+#define COPY_ERR_VERIFY -3
+
+/* copy_item() result when cancelled through its Progress */
+#define COPY_CANCELLED 1
+
+/* Check every file copy_item() writes against its source with HashAlgo
+ * 'algo', or stop checking with HASH_NONE (the default). Applies to
+ * copies started afterwards, moves across volumes included. */
+void copy_set_verify(int algo);
+int copy_get_verify(void);
+
 /* Copy an item (file or directory) from src into dest_dir.
- * If src is a directory, copy recursively.
- * Returns 0 on success, -1 on error.
+ * If src is a directory, copy recursively. Checks the free space of the
+ * destination before writing anything. Totals and completed work are
+ * reported to 'progress' (may be NULL), which can also pause or cancel
+ * the copy; its phase is left at PROGRESS_COPYING for the caller to
+ * finish. A cancelled copy is removed again if nothing was at the
+ * destination before.
+ * Returns 0 on success, COPY_CANCELLED, COPY_ERR_NO_SPACE if the copy
+ * cannot fit, COPY_ERR_VERIFY if a file did not verify, or -1 on other
+ * errors.
+ */
+int copy_item(const char* src, const char* dest_dir, Progress* progress);
+
+/* Copy 'count' items into dest_dir as one operation: one filesystem
+ * session, the destination and every source checked once up front and
+ * the free space checked for all of them together. Totals and progress
+ * cover the whole batch. An item that fails, including a source that no
+ * longer exists or a folder that would be copied into itself, is skipped
+ * and the rest copied; running out of room or a cancel stops the batch.
+ * Returns like copy_item() (the first failure if several items failed).
+ */
+int copy_batch(const char* const* srcs, int count, const char* dest_dir, Progress* progress);
+
+/* Carry on with the interrupted copy to file 'dest' recorded in the copy
+ * journal, from the last offset that checks out (or from the start if
+ * none does). Reports to 'progress' (may be NULL) like copy_item(). A
+ * cancelled resume removes the partial file. With verification on (see
+ * copy_set_verify()) the whole file is checked against its source.
+ * Returns 0 on success, COPY_CANCELLED, COPY_ERR_VERIFY if the file did
+ * not verify, or -1 on error (including no journal record for 'dest').
  */
-int copy_item(const char* src, const char* dest_dir);
+int copy_resume(const char* dest, Progress* progress);
 
 #endif
@@ -0,0 +1,351 @@
+#include "copysched.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../utils/utils.h"
+#include "../vfs/vfs.h"
+#include "../walk/walk.h"
+#include "../transfer/transfer.h"
+
+/**
+ * Copy scheduler implementation
+ *
+ * The file lists are FsDirectory listings whose names are paths relative
+ * to the source root ("/sub/file.bin"), so one arena holds every path.
+ * Small files are handed out by index: each range is [next, end) of the
+ * small list, guarded by its own lock. The owner takes from 'next'; a
+ * thief moves the upper half of the fullest range into its own.
+ *
+ * Range 0 belongs to the calling thread, which first drains the large
+ * lane. With one worker no threads are started and the copy is serial.
+ */
+
+typedef struct {
+    pthread_mutex_t lock;
+    int next;                // Next task the owner takes
+    int end;                 // One past the last task of the range
+} CopyRange;
+
+typedef struct {
+    FsDirectory* small;      // Files below the large threshold
+    FsDirectory* large;      // Streaming lane
+    uint64_t large_file;
+    int verify;              // HashAlgo passed on to every transfer
+    char src[FS_MAX_PATH];   // Source root, canonical
+    int src_len;
+    char dest[FS_MAX_PATH];  // Destination root, canonical
+    int dest_len;
+    uint64_t dirs;
+    int walk_failed;
+
+    CopyRange ranges[COPYSCHED_MAX_WORKERS];
+    int range_count;
+
+    pthread_mutex_t handle_lock;
+    pthread_cond_t handle_free;
+    int handles;             // Handles still available
+
+    Progress* progress;
+    const atomic_int* cancel;
+    atomic_int failed;
+    atomic_uint_fast64_t files;
+    atomic_uint_fast64_t large_files;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t steals;
+    atomic_uint_fast64_t verify_failed;
+} CopySched;
+
+typedef struct {
+    CopySched* sched;
+    int range;
+} CopyWorker;
+
+static void copysched_defaults(const CopySchedOptions* in, CopySchedOptions* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (in != NULL)
+        *out = *in;
+    if (out->workers <= 0)
+        out->workers = COPYSCHED_DEFAULT_WORKERS;
+    if (out->workers > COPYSCHED_MAX_WORKERS)
+        out->workers = COPYSCHED_MAX_WORKERS;
+    if (out->max_handles < 2)
+        out->max_handles = COPYSCHED_MAX_HANDLES;
+    if (out->large_file == 0)
+        out->large_file = COPYSCHED_LARGE_FILE;
+}
+
+// Skeleton pass: create every folder, sort the files into the two lists
+static int copysched_visit(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)depth;
+    CopySched* s = (CopySched*)user;
+
+    const char* rel = path + s->src_len;
+    int rel_len = str_len(rel);
+    if (s->dest_len + rel_len >= FS_MAX_PATH) {
+        s->walk_failed = 1;
+        return WALK_STOP;
+    }
+
+    if (entry->is_dir) {
+        char dest[FS_MAX_PATH];
+        memcpy(dest, s->dest, s->dest_len);
+        memcpy(dest + s->dest_len, rel, rel_len + 1);
+        if (vfs_mkdir(dest) != 0) {
+            s->walk_failed = 1;
+            return WALK_STOP;
+        }
+        s->dirs++;
+        return WALK_CONTINUE;
+    }
+
+    FsDirectory* list = entry->size >= s->large_file ? s->large : s->small;
+    if (fs_dir_append(list, rel, 0, entry->size) != 0) {
+        s->walk_failed = 1;
+        return WALK_STOP;
+    }
+    progress_add_total(s->progress, 1, entry->size);
+    return WALK_CONTINUE;
+}
+
+// Also where a paused copy waits
+static int copysched_stopped(CopySched* s)
+{
+    return atomic_load(&s->failed) || (s->cancel != NULL && atomic_load(s->cancel)) ||
+           progress_checkpoint(s->progress);
+}
+
+static void copysched_acquire_handles(CopySched* s)
+{
+    pthread_mutex_lock(&s->handle_lock);
+    while (s->handles < 2)
+        pthread_cond_wait(&s->handle_free, &s->handle_lock);
+    s->handles -= 2;
+    pthread_mutex_unlock(&s->handle_lock);
+}
+
+static void copysched_release_handles(CopySched* s)
+{
+    pthread_mutex_lock(&s->handle_lock);
+    s->handles += 2;
+    pthread_cond_signal(&s->handle_free);
+    pthread_mutex_unlock(&s->handle_lock);
+}
+
+static void copysched_copy_file(CopySched* s, const FsDirectory* list, int index)
+{
+    const char* rel = fs_dir_name(list, index);
+    int rel_len = fs_dir_name_length(list, index);
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    memcpy(src, s->src, s->src_len);
+    memcpy(src + s->src_len, rel, rel_len + 1);
+    memcpy(dest, s->dest, s->dest_len);
+    memcpy(dest + s->dest_len, rel, rel_len + 1);
+
+    TransferStats ts;
+    TransferOptions topt = {0};
+    topt.verify = s->verify;
+    copysched_acquire_handles(s);
+    progress_set_current(s->progress, src);
+    int rc = transfer_file(src, dest, &topt, s->progress, s->cancel, &ts);
+    copysched_release_handles(s);
+
+    if (rc < 0) {
+        if (rc == TRANSFER_ERR_VERIFY)
+            atomic_fetch_add(&s->verify_failed, 1);
+        atomic_store(&s->failed, 1);
+        return;
+    }
+    if (rc == 0) {
+        atomic_fetch_add(&s->files, 1);
+        progress_add_done(s->progress, 1, 0);
+        if (list == s->large)
+            atomic_fetch_add(&s->large_files, 1);
+        atomic_fetch_add(&s->bytes, ts.bytes);
+    }
+}
+
+// Next task of range 'r', or -1 if it is empty
+static int copysched_take(CopySched* s, int r)
+{
+    CopyRange* range = &s->ranges[r];
+    pthread_mutex_lock(&range->lock);
+    int task = range->next < range->end ? range->next++ : -1;
+    pthread_mutex_unlock(&range->lock);
+    return task;
+}
+
+// Move the upper half of the fullest other range into range 'r'.
+// Returns 0 if something was stolen, -1 if every range is empty.
+static int copysched_steal(CopySched* s, int r)
+{
+    while (1) {
+        int victim = -1;
+        int most = 0;
+        for (int i = 0; i < s->range_count; i++) {
+            if (i == r)
+                continue;
+            pthread_mutex_lock(&s->ranges[i].lock);
+            int left = s->ranges[i].end - s->ranges[i].next;
+            pthread_mutex_unlock(&s->ranges[i].lock);
+            if (left > most) {
+                most = left;
+                victim = i;
+            }
+        }
+        if (victim < 0)
+            return -1;
+
+        // The victim may have moved on since it was measured
+        CopyRange* v = &s->ranges[victim];
+        pthread_mutex_lock(&v->lock);
+        int left = v->end - v->next;
+        int lo = v->next + left / 2;
+        int hi = v->end;
+        if (left > 0)
+            v->end = lo;
+        pthread_mutex_unlock(&v->lock);
+        if (left <= 0)
+            continue;
+
+        CopyRange* own = &s->ranges[r];
+        pthread_mutex_lock(&own->lock);
+        own->next = lo;
+        own->end = hi;
+        pthread_mutex_unlock(&own->lock);
+        atomic_fetch_add(&s->steals, 1);
+        return 0;
+    }
+}
+
+static void copysched_run(CopySched* s, int r)
+{
+    while (!copysched_stopped(s)) {
+        int task = copysched_take(s, r);
+        if (task < 0) {
+            if (copysched_steal(s, r) != 0)
+                break;
+            continue;
+        }
+        copysched_copy_file(s, s->small, task);
+    }
+}
+
+static void* copysched_worker(void* arg)
+{
+    CopyWorker* w = (CopyWorker*)arg;
+    copysched_run(w->sched, w->range);
+    return NULL;
+}
+
+int copysched_copy_tree(const char* src, const char* dest, const CopySchedOptions* options,
+                        Progress* progress, const atomic_int* cancel, CopySchedStats* stats)
+{
+    CopySchedStats local;
+    if (stats == NULL)
+        stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    if (src == NULL || dest == NULL)
+        return -1;
+
+    CopySchedOptions opt;
+    copysched_defaults(options, &opt);
+    uint64_t start = fs_now_ns();
+
+    CopySched* s = (CopySched*)calloc(1, sizeof(CopySched));
+    if (s == NULL)
+        return -1;
+    s->small = fs_dir_create(256);
+    s->large = fs_dir_create(16);
+    if (s->small == NULL || s->large == NULL) {
+        fs_free_directory(s->small);
+        fs_free_directory(s->large);
+        free(s);
+        return -1;
+    }
+    s->large_file = opt.large_file;
+    s->verify = opt.verify;
+    s->progress = progress;
+    s->cancel = cancel;
+    path_canonicalize(src, s->src, sizeof(s->src));
+    path_canonicalize(dest, s->dest, sizeof(s->dest));
+    s->src_len = str_len(s->src);
+    s->dest_len = str_len(s->dest);
+
+    // Skeleton first: every folder exists before the first file is copied
+    progress_set_phase(progress, PROGRESS_SCANNING);
+    int rc = vfs_mkdir(s->dest);
+    if (rc == 0) {
+        s->dirs = 1;
+        rc = walk_tree(s->src, copysched_visit, NULL, s,
+                       cancel != NULL ? cancel : progress_cancel_flag(progress), NULL);
+        if (s->walk_failed)
+            rc = -1;
+    }
+    stats->skeleton_ns = fs_now_ns() - start;
+    stats->dirs = s->dirs;
+
+    if (rc == 0) {
+        progress_set_phase(progress, PROGRESS_COPYING);
+
+        // One contiguous range of the small list per worker
+        int count = fs_dir_count(s->small);
+        s->range_count = opt.workers;
+        for (int i = 0; i < s->range_count; i++) {
+            pthread_mutex_init(&s->ranges[i].lock, NULL);
+            s->ranges[i].next = (int)((int64_t)count * i / s->range_count);
+            s->ranges[i].end = (int)((int64_t)count * (i + 1) / s->range_count);
+        }
+        pthread_mutex_init(&s->handle_lock, NULL);
+        pthread_cond_init(&s->handle_free, NULL);
+        s->handles = opt.max_handles;
+
+        pthread_t threads[COPYSCHED_MAX_WORKERS];
+        CopyWorker workers[COPYSCHED_MAX_WORKERS];
+        int started = 1;  // The calling thread owns range 0
+        for (int i = 1; i < s->range_count; i++) {
+            workers[i].sched = s;
+            workers[i].range = i;
+            if (pthread_create(&threads[i], NULL, copysched_worker, &workers[i]) != 0)
+                break;  // Fewer threads; their ranges get stolen
+            started++;
+        }
+
+        // Large lane, then help with the small files
+        int large = fs_dir_count(s->large);
+        for (int i = 0; i < large && !copysched_stopped(s); i++)
+            copysched_copy_file(s, s->large, i);
+        copysched_run(s, 0);
+
+        for (int i = 1; i < started; i++)
+            pthread_join(threads[i], NULL);
+
+        pthread_cond_destroy(&s->handle_free);
+        pthread_mutex_destroy(&s->handle_lock);
+        for (int i = 0; i < s->range_count; i++)
+            pthread_mutex_destroy(&s->ranges[i].lock);
+
+        stats->workers = started;
+        if (atomic_load(&s->failed))
+            rc = -1;
+        else if ((cancel != NULL && atomic_load(cancel)) || progress_checkpoint(progress))
+            rc = 1;
+    } else if (rc > 0) {
+        rc = 1;  // Walk cancelled
+    }
+
+    stats->files = atomic_load(&s->files);
+    stats->bytes = atomic_load(&s->bytes);
+    stats->large_files = atomic_load(&s->large_files);
+    stats->steals = atomic_load(&s->steals);
+    stats->verify_failed = atomic_load(&s->verify_failed);
+    stats->elapsed_ns = fs_now_ns() - start;
+
+    fs_free_directory(s->small);
+    fs_free_directory(s->large);
+    free(s);
+    return rc;
+}
@@ -0,0 +1,74 @@
+#ifndef COPYSCHED_H
+#define COPYSCHED_H
+
+#include "fs.h"
+#include <stdatomic.h>
+#include "progress.h"
+
+/**
+ * Copy scheduler module
+ *
+ * Copies a folder tree with several threads. A first pass walks the
+ * source, creates the whole destination folder skeleton and collects
+ * the files. Small files are then split into one contiguous range per
+ * worker; a worker that runs dry steals the upper half of the busiest
+ * range, so a folder of many tiny files cannot leave the others idle.
+ * Files of COPYSCHED_LARGE_FILE and up go to a separate lane served by
+ * the calling thread, one at a time through the transfer pipeline, so
+ * they neither starve the small-file workers nor compete with each
+ * other for the card. The lane joins the stealing once it is empty.
+ *
+ * Every copy holds two file handles; a shared budget caps how many are
+ * open at once.
+ */
+
+/* Copying threads, the caller included (Switch apps own 3 cores) */
+#define COPYSCHED_DEFAULT_WORKERS 3
+#define COPYSCHED_MAX_WORKERS     8
+
+/* Files at least this large take the streaming lane */
+#define COPYSCHED_LARGE_FILE      (8ull << 20)
+
+/* Open file handles allowed at once, two per copy in flight */
+#define COPYSCHED_MAX_HANDLES     8
+
+/**
+ * CopySchedOptions - Tuning for one tree copy (zeroed fields take defaults)
+ */
+typedef struct {
+    int workers;             // Copying threads, 1 = serial (COPYSCHED_DEFAULT_WORKERS)
+    int max_handles;         // Handle budget, at least 2 (COPYSCHED_MAX_HANDLES)
+    uint64_t large_file;     // Streaming lane threshold (COPYSCHED_LARGE_FILE)
+    int verify;              // HashAlgo to check every copied file with (TransferOptions)
+} CopySchedOptions;
+
+/**
+ * CopySchedStats - What one tree copy did
+ */
+typedef struct {
+    int workers;             // Threads that copied, the caller included
+    uint64_t dirs;           // Folders created, including the root
+    uint64_t files;          // Files copied
+    uint64_t large_files;    // Of which through the streaming lane
+    uint64_t bytes;          // File bytes copied
+    uint64_t steals;         // Ranges taken from another worker
+    uint64_t verify_failed;  // Files that read back different (options.verify)
+    uint64_t skeleton_ns;    // Walk and folder creation
+    uint64_t elapsed_ns;     // Wall time, skeleton included
+} CopySchedStats;
+
+/**
+ * copysched_copy_tree(src, dest, options, progress, cancel, stats)
+ * Copy the contents of folder 'src' into folder 'dest', which is
+ * created if missing. 'options', 'progress', 'cancel' and 'stats' may
+ * be NULL. The skeleton pass fills the totals of 'progress'
+ * (PROGRESS_SCANNING), the copy its done counters (PROGRESS_COPYING).
+ * 'cancel' and the pause and cancel requests of 'progress' are honoured
+ * between files.
+ * Returns 0 on success, 1 if cancelled, -1 if anything failed (the
+ * remaining files are skipped).
+ */
+int copysched_copy_tree(const char* src, const char* dest, const CopySchedOptions* options,
+                        Progress* progress, const atomic_int* cancel, CopySchedStats* stats);
+
+#endif
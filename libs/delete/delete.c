@@ -1,66 +1,223 @@
 #include "delete.h"
-#include <switch.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../vfs/vfs.h"
+#include "../walk/walk.h"
+#include "../dircache/dircache.h"
+#include "../dirsize/dirsize.h"
 
-// Normalize sd path helper
-static void normalize_sd_path(const char* in, char* out, size_t outlen)
+/* Threads removing files when the backend cannot delete a whole tree */
+#define DELETE_WORKERS 4
+
+/* Files collected before they are removed in parallel */
+#define DELETE_BATCH   512
+
+/* Consecutive batch entries a thread takes at a time */
+#define DELETE_RUN     32
+
+typedef struct {
+    Progress* progress;
+    FsDirectory* batch;      // Full paths (and sizes) of files to remove
+    FsDirectory* dirs;       // Folders below the root, deepest first
+    atomic_int next;         // Next batch entry to take
+    atomic_int failed;
+    atomic_int cancelled;
+} DeleteWalk;
+
+// Pre-scan for the progress totals
+static int delete_count(const char* path, const FsEntry* entry, int depth, void* user)
 {
-    if (!in || !out || outlen == 0) return;
-    const char* p = in;
-    if (strncmp(p, "sdmc:/", 6) == 0) p += 6;
-    if (*p == '/') p++;
-    strncpy(out, p, outlen - 1);
-    out[outlen - 1] = '\0';
+    (void)path;
+    (void)depth;
+    if (!entry->is_dir)
+        progress_add_total((Progress*)user, 1, entry->size);
+    return WALK_CONTINUE;
 }
 
-static int delete_recursive_libnx(const char* path)
+static void* delete_batch_worker(void* arg)
 {
-    if (!path) return -1;
-
-    Result rc;
-    FsFileSystem fs;
-    rc = fsOpenSdCardFileSystem(&fs);
-    if (R_FAILED(rc)) return -1;
-
-    char path_n[512];
-    normalize_sd_path(path, path_n, sizeof(path_n));
-
-    // Try to open as directory
-    FsDir dir;
-    rc = fsFsOpenDirectory(&fs, path_n, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &dir);
-    if (R_SUCCEEDED(rc)) {
-        // Directory: iterate and delete children
-        while (1) {
-            s64 entries = 0;
-            FsDirectoryEntry entry;
-            rc = fsDirRead(&dir, &entries, 1, &entry);
-            if (R_FAILED(rc)) { fsDirClose(&dir); fsFsClose(&fs); return -1; }
-            if (entries == 0) break;
-            if (strcmp(entry.name, ".") == 0 || strcmp(entry.name, "..") == 0) continue;
-
-            char child[512];
-            snprintf(child, sizeof(child), "%s/%s", path, entry.name);
-            if (delete_recursive_libnx(child) != 0) { fsDirClose(&dir); fsFsClose(&fs); return -1; }
+    DeleteWalk* d = (DeleteWalk*)arg;
+    int count = fs_dir_count(d->batch);
+    int i = count;
+    int end = count;
+    while (1) {
+        // Runs of neighbours, so threads mostly work in different folders
+        if (i >= end) {
+            i = atomic_fetch_add(&d->next, DELETE_RUN);
+            end = i + DELETE_RUN < count ? i + DELETE_RUN : count;
+            if (i >= count)
+                break;
         }
-        fsDirClose(&dir);
-        // Remove directory
-        rc = fsFsDeleteDirectory(&fs, path_n);
-        fsFsClose(&fs);
-        if (R_FAILED(rc)) return -1;
-        return 0;
+        if (atomic_load(&d->failed) || atomic_load(&d->cancelled))
+            break;
+        // Pauses wait here, between files
+        if (progress_checkpoint(d->progress)) {
+            atomic_store(&d->cancelled, 1);
+            break;
+        }
+        const char* path = fs_dir_name(d->batch, i);
+        progress_set_current(d->progress, path);
+        if (vfs_remove(path) != 0) {
+            atomic_store(&d->failed, 1);
+            break;
+        }
+        progress_add_done(d->progress, 1, fs_dir_size(d->batch, i));
+        i++;
+    }
+    return NULL;
+}
+
+// Remove the collected files on DELETE_WORKERS threads (this one included)
+static void delete_flush(DeleteWalk* d)
+{
+    if (fs_dir_count(d->batch) == 0)
+        return;
+
+    pthread_t threads[DELETE_WORKERS];
+    int started = 0;
+    atomic_store(&d->next, 0);
+    for (int i = 1; i < DELETE_WORKERS && fs_dir_count(d->batch) > i * DELETE_RUN; i++) {
+        if (pthread_create(&threads[started], NULL, delete_batch_worker, d) != 0)
+            break;  // Fewer threads take more files each
+        started++;
+    }
+    delete_batch_worker(d);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    fs_dir_clear(d->batch);
+}
+
+static int delete_stopped(DeleteWalk* d)
+{
+    return atomic_load(&d->failed) || atomic_load(&d->cancelled);
+}
+
+// Files are collected and removed a batch at a time
+static int delete_visit_file(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)depth;
+    DeleteWalk* d = (DeleteWalk*)user;
+    if (entry->is_dir)
+        return delete_stopped(d) ? WALK_STOP : WALK_CONTINUE;
+
+    if (fs_dir_append(d->batch, path, 0, entry->size) != 0) {
+        atomic_store(&d->failed, 1);
+        return WALK_STOP;
+    }
+    if (fs_dir_count(d->batch) >= DELETE_BATCH)
+        delete_flush(d);
+    return delete_stopped(d) ? WALK_STOP : WALK_CONTINUE;
+}
+
+// Folders wait until every file is gone, then go deepest first
+static int delete_visit_dir(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)entry;
+    (void)depth;
+    DeleteWalk* d = (DeleteWalk*)user;
+    if (fs_dir_append(d->dirs, path, 1, 0) != 0) {
+        atomic_store(&d->failed, 1);
+        return WALK_STOP;
+    }
+    return WALK_CONTINUE;
+}
+
+// Entry by entry, for backends without a tree delete (or when it failed)
+static int delete_tree_entries(const char* path, Progress* progress)
+{
+    if (progress != NULL) {
+        progress_set_phase(progress, PROGRESS_SCANNING);
+        if (walk_tree(path, delete_count, NULL, progress, progress_cancel_flag(progress), NULL) > 0)
+            return 1;
+    }
+    progress_set_phase(progress, PROGRESS_DELETING);
+
+    DeleteWalk d;
+    memset(&d, 0, sizeof(d));
+    d.progress = progress;
+    d.batch = fs_dir_create(DELETE_BATCH);
+    d.dirs = fs_dir_create(64);
+    if (d.batch == NULL || d.dirs == NULL) {
+        fs_free_directory(d.batch);
+        fs_free_directory(d.dirs);
+        return -1;
+    }
+
+    int rc = walk_tree(path, delete_visit_file, delete_visit_dir, &d,
+                       progress_cancel_flag(progress), NULL);
+    delete_flush(&d);
+    for (int i = 0; i < fs_dir_count(d.dirs) && !delete_stopped(&d); i++) {
+        if (vfs_rmdir(fs_dir_name(d.dirs, i)) != 0)
+            atomic_store(&d.failed, 1);
     }
+    fs_free_directory(d.batch);
+    fs_free_directory(d.dirs);
 
-    // Not a directory -> delete file
-    rc = fsFsDeleteFile(&fs, path_n);
-    fsFsClose(&fs);
-    if (R_FAILED(rc)) return -1;
+    if (atomic_load(&d.failed) || rc < 0)
+        return -1;
+    if (atomic_load(&d.cancelled) || rc > 0)
+        return 1;
+    return vfs_rmdir(path);
+}
+
+static int delete_tree(const char* path, Progress* progress)
+{
+    // One call when the backend can delete the whole tree; it cannot be
+    // paused or report files, but it is over long before either matters
+    progress_set_phase(progress, PROGRESS_DELETING);
+    progress_set_current(progress, path);
+    if (vfs_remove_tree(path) == 0)
+        return 0;
+    return delete_tree_entries(path, progress);
+}
+
+static int delete_file(const char* path, uint64_t size, Progress* progress)
+{
+    progress_add_total(progress, 1, size);
+    progress_set_phase(progress, PROGRESS_DELETING);
+    if (progress_checkpoint(progress))
+        return 1;
+    progress_set_current(progress, path);
+    if (vfs_remove(path) != 0)
+        return -1;
+    progress_add_done(progress, 1, size);
     return 0;
 }
 
-int delete_item(const char* path)
+int delete_batch(const char* const* paths, int count, Progress* progress)
+{
+    if (paths == NULL || count <= 0) return -1;
+
+    // One filesystem session for every tree
+    if (vfs_session_acquire() != 0) return -1;
+    int rc = 0;
+    for (int i = 0; i < count && rc != 1; i++) {
+        VfsStat st;
+        int item_rc = -1;
+        if (paths[i] != NULL && vfs_stat(paths[i], &st) == 0)
+            item_rc = st.is_dir ? delete_tree(paths[i], progress) :
+                                  delete_file(paths[i], st.size, progress);
+        if (item_rc != 0 && rc == 0)
+            rc = item_rc;
+        if (item_rc == 1)
+            rc = 1;
+
+        // Dropped once the tree is gone (or partly gone), so nothing reloads
+        // a listing that is still changing
+        if (paths[i] != NULL) {
+            dircache_invalidate_entry(paths[i]);
+            dirsize_invalidate_entry(paths[i]);
+        }
+    }
+    vfs_session_release();
+    return rc;
+}
+
+int delete_item(const char* path, Progress* progress)
 {
     if (path == NULL) return -1;
-    return delete_recursive_libnx(path);
+    return delete_batch(&path, 1, progress);
 }
@@ -1,7 +1,21 @@
 #ifndef DELETE_H
 #define DELETE_H
 
-/* Delete a file or directory (recursively). Returns 0 on success, -1 on error. */
-int delete_item(const char* path);
+#include "progress.h"
+
+/* Delete a file or directory (recursively). A folder goes in one call
+ * where the backend can delete whole trees; otherwise its files are
+ * removed in parallel batches. With a 'progress' (may be NULL) such a
+ * folder is counted first, then files are reported as they go; its
+ * pause and cancel requests are honoured between files.
+ * Returns 0 on success, 1 if cancelled (part of a folder may be gone),
+ * -1 on error. */
+int delete_item(const char* path, Progress* progress);
+
+/* Delete 'count' files or directories in one filesystem session,
+ * reporting to 'progress' like delete_item(). An item that fails is
+ * skipped and the rest deleted; a cancel stops the batch.
+ * Returns 0 on success, 1 if cancelled, -1 if any item failed. */
+int delete_batch(const char* const* paths, int count, Progress* progress);
 
 #endif
@@ -0,0 +1,249 @@
+#include "dircache.h"
+#include <string.h>
+#include <pthread.h>
+#include "../utils/utils.h"
+
+/**
+ * Directory cache implementation
+ *
+ * A small fixed table with a use counter for LRU ordering: the cache holds
+ * at most DIRCACHE_MAX_SLOTS folders and is consulted once per navigation,
+ * so a linear scan is cheaper than maintaining a hash table and list.
+ * File operations may invalidate from worker threads, hence the lock.
+ */
+
+typedef struct {
+    int used;                    // Slot holds a folder
+    char key[FS_MAX_PATH];       // Normalized path
+    FsDirectory* dir;            // Cached listing (NULL = cursor only)
+    uint64_t bytes;              // fs_dir_memory_usage(dir)
+    uint64_t last_use;           // LRU clock value
+    int selected_index;          // Remembered cursor
+    int scroll_offset;
+} DirCacheSlot;
+
+static DirCacheSlot g_slots[DIRCACHE_MAX_SLOTS];
+static uint64_t g_budget = DIRCACHE_DEFAULT_BUDGET;
+static uint64_t g_clock = 0;
+static DirCacheStats g_stats;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void dircache_key(const char* path, char* out, size_t outlen)
+{
+    path_canonicalize(path, out, (int)outlen);
+}
+
+static DirCacheSlot* dircache_find(const char* key)
+{
+    for (int i = 0; i < DIRCACHE_MAX_SLOTS; i++) {
+        if (g_slots[i].used && strcmp(g_slots[i].key, key) == 0)
+            return &g_slots[i];
+    }
+    return NULL;
+}
+
+static void dircache_drop_listing(DirCacheSlot* slot)
+{
+    if (slot->dir == NULL)
+        return;
+    fs_free_directory(slot->dir);
+    g_stats.bytes -= slot->bytes;
+    g_stats.listings--;
+    slot->dir = NULL;
+    slot->bytes = 0;
+}
+
+// Least recently used slot, optionally only among slots holding listings
+static DirCacheSlot* dircache_lru(int with_listing)
+{
+    DirCacheSlot* victim = NULL;
+    for (int i = 0; i < DIRCACHE_MAX_SLOTS; i++) {
+        DirCacheSlot* slot = &g_slots[i];
+        if (!slot->used || (with_listing && slot->dir == NULL))
+            continue;
+        if (victim == NULL || slot->last_use < victim->last_use)
+            victim = slot;
+    }
+    return victim;
+}
+
+void dircache_init(uint64_t budget_bytes)
+{
+    dircache_cleanup();
+    pthread_mutex_lock(&g_lock);
+    g_budget = budget_bytes ? budget_bytes : DIRCACHE_DEFAULT_BUDGET;
+    memset(&g_stats, 0, sizeof(g_stats));
+    pthread_mutex_unlock(&g_lock);
+}
+
+void dircache_cleanup(void)
+{
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < DIRCACHE_MAX_SLOTS; i++) {
+        dircache_drop_listing(&g_slots[i]);
+        g_slots[i].used = 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void dircache_put(const char* path, FsDirectory* dir, int selected_index, int scroll_offset)
+{
+    if (path == NULL) {
+        fs_free_directory(dir);
+        return;
+    }
+
+    char key[FS_MAX_PATH];
+    dircache_key(path, key, sizeof(key));
+    uint64_t bytes = fs_dir_memory_usage(dir);
+
+    pthread_mutex_lock(&g_lock);
+    DirCacheSlot* slot = dircache_find(key);
+    if (slot == NULL) {
+        // Reuse a free slot, else forget the least recently used folder
+        for (int i = 0; i < DIRCACHE_MAX_SLOTS && slot == NULL; i++) {
+            if (!g_slots[i].used)
+                slot = &g_slots[i];
+        }
+        if (slot == NULL) {
+            slot = dircache_lru(0);
+            if (slot->dir != NULL)
+                g_stats.evictions++;
+            dircache_drop_listing(slot);
+        }
+        slot->used = 1;
+        str_copy(slot->key, key, sizeof(slot->key));
+    }
+    dircache_drop_listing(slot);
+
+    slot->selected_index = selected_index;
+    slot->scroll_offset = scroll_offset;
+    slot->last_use = ++g_clock;
+
+    if (dir != NULL && bytes <= g_budget) {
+        // Evict older listings until the new one fits
+        while (g_stats.bytes + bytes > g_budget) {
+            DirCacheSlot* victim = dircache_lru(1);
+            if (victim == NULL)
+                break;
+            dircache_drop_listing(victim);
+            g_stats.evictions++;
+        }
+        slot->dir = dir;
+        slot->bytes = bytes;
+        g_stats.bytes += bytes;
+        g_stats.listings++;
+        dir = NULL;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    // Too large for the whole budget
+    fs_free_directory(dir);
+}
+
+int dircache_has(const char* path)
+{
+    if (path == NULL)
+        return 0;
+
+    char key[FS_MAX_PATH];
+    dircache_key(path, key, sizeof(key));
+
+    pthread_mutex_lock(&g_lock);
+    DirCacheSlot* slot = dircache_find(key);
+    int has = (slot != NULL && slot->dir != NULL);
+    pthread_mutex_unlock(&g_lock);
+    return has;
+}
+
+FsDirectory* dircache_take(const char* path, int* selected_index, int* scroll_offset)
+{
+    if (path == NULL)
+        return NULL;
+
+    char key[FS_MAX_PATH];
+    dircache_key(path, key, sizeof(key));
+
+    pthread_mutex_lock(&g_lock);
+    FsDirectory* dir = NULL;
+    DirCacheSlot* slot = dircache_find(key);
+    if (slot != NULL) {
+        if (selected_index) *selected_index = slot->selected_index;
+        if (scroll_offset) *scroll_offset = slot->scroll_offset;
+        slot->last_use = ++g_clock;
+        if (slot->dir != NULL) {
+            dir = slot->dir;
+            g_stats.bytes -= slot->bytes;
+            g_stats.listings--;
+            slot->dir = NULL;
+            slot->bytes = 0;
+        }
+    }
+    if (dir != NULL)
+        g_stats.hits++;
+    else
+        g_stats.misses++;
+    pthread_mutex_unlock(&g_lock);
+    return dir;
+}
+
+void dircache_invalidate(const char* path)
+{
+    if (path == NULL)
+        return;
+
+    char key[FS_MAX_PATH];
+    dircache_key(path, key, sizeof(key));
+
+    pthread_mutex_lock(&g_lock);
+    DirCacheSlot* slot = dircache_find(key);
+    if (slot != NULL && slot->dir != NULL) {
+        dircache_drop_listing(slot);
+        g_stats.invalidations++;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void dircache_invalidate_tree(const char* path)
+{
+    if (path == NULL)
+        return;
+
+    char key[FS_MAX_PATH];
+    dircache_key(path, key, sizeof(key));
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < DIRCACHE_MAX_SLOTS; i++) {
+        DirCacheSlot* slot = &g_slots[i];
+        if (slot->used && slot->dir != NULL && path_is_within(slot->key, key)) {
+            dircache_drop_listing(slot);
+            g_stats.invalidations++;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void dircache_invalidate_entry(const char* path)
+{
+    if (path == NULL)
+        return;
+
+    char key[FS_MAX_PATH];
+    char parent[FS_MAX_PATH];
+    dircache_key(path, key, sizeof(key));
+    if (path_get_parent(key, parent) == 0)
+        dircache_invalidate(parent);
+    else
+        dircache_invalidate("/");
+    dircache_invalidate_tree(key);
+}
+
+void dircache_get_stats(DirCacheStats* out)
+{
+    if (out == NULL)
+        return;
+
+    pthread_mutex_lock(&g_lock);
+    *out = g_stats;
+    pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,101 @@
+#ifndef DIRCACHE_H
+#define DIRCACHE_H
+
+#include "fs.h"
+
+/**
+ * Directory cache module
+ *
+ * Bounded LRU cache of directory listings keyed by normalized path
+ * ("sdmc:/a//b/" and "/a/b" are the same key). Besides the listing each
+ * slot remembers the folder's selection and scroll position; that cursor
+ * survives invalidation so returning to a folder that had to be re-listed
+ * still lands on the same row.
+ *
+ * The cache owns the listings put into it. The browser takes a listing
+ * out while it is displayed and puts it back when navigating away, so a
+ * cached FsDirectory is never visible to the UI and the cache may free it
+ * at any time. File operations call dircache_invalidate_entry() for every
+ * path they touch.
+ */
+
+/* Default memory budget for cached listings */
+#define DIRCACHE_DEFAULT_BUDGET (8u * 1024u * 1024u)
+
+/* Maximum number of remembered folders (listings and cursors) */
+#define DIRCACHE_MAX_SLOTS 64
+
+/**
+ * DirCacheStats - Cache effectiveness counters
+ */
+typedef struct {
+    uint64_t hits;           // dircache_take() returned a listing
+    uint64_t misses;         // dircache_take() found no listing
+    uint64_t evictions;      // Listings dropped to stay within budget
+    uint64_t invalidations;  // Listings dropped because the folder changed
+    uint64_t bytes;          // Memory held by cached listings
+    int listings;            // Number of cached listings
+} DirCacheStats;
+
+/**
+ * dircache_init(budget_bytes)
+ * Initialize the cache. 0 selects DIRCACHE_DEFAULT_BUDGET.
+ */
+void dircache_init(uint64_t budget_bytes);
+
+/**
+ * dircache_cleanup()
+ * Free every cached listing and forget all cursors.
+ */
+void dircache_cleanup(void);
+
+/**
+ * dircache_put(path, dir, selected_index, scroll_offset)
+ * Store a complete listing of 'path' with its cursor. Ownership of 'dir'
+ * always passes to the cache (it is freed immediately if it cannot fit).
+ * 'dir' may be NULL to remember only the cursor.
+ */
+void dircache_put(const char* path, FsDirectory* dir, int selected_index, int scroll_offset);
+
+/**
+ * dircache_take(path, selected_index, scroll_offset)
+ * Remove and return the cached listing of 'path' (NULL on miss). The
+ * remembered cursor is written to the out parameters when known (they
+ * are left untouched otherwise; either may be NULL).
+ * Returns the listing, which the caller now owns.
+ */
+FsDirectory* dircache_take(const char* path, int* selected_index, int* scroll_offset);
+
+/**
+ * dircache_has(path)
+ * Returns 1 if a listing of 'path' is cached (without taking it or
+ * touching its LRU position).
+ */
+int dircache_has(const char* path);
+
+/**
+ * dircache_invalidate(path)
+ * Drop the cached listing of the folder 'path' (cursor is kept).
+ */
+void dircache_invalidate(const char* path);
+
+/**
+ * dircache_invalidate_tree(path)
+ * Drop the listings of 'path' and every folder below it.
+ */
+void dircache_invalidate_tree(const char* path);
+
+/**
+ * dircache_invalidate_entry(path)
+ * An entry at 'path' was created, removed or changed: drop the listing of
+ * its parent folder and, if it is a folder, its own subtree.
+ */
+void dircache_invalidate_entry(const char* path);
+
+/**
+ * dircache_get_stats(out)
+ * Copy the current counters into 'out'.
+ */
+void dircache_get_stats(DirCacheStats* out);
+
+#endif
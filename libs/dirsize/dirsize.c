@@ -0,0 +1,345 @@
+#include "dirsize.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../utils/utils.h"
+#include "../walk/walk.h"
+
+/**
+ * Folder size implementation
+ *
+ * One lock guards the request queue, the result list, the cache and the
+ * counters; workers only hold it to take a request and to publish a
+ * result, never while walking. Cancellation bumps a generation counter
+ * that running walks poll from their visitor.
+ *
+ * A folder's timestamp does not change when something deep inside it
+ * does, so a walk that overlapped an invalidation may have counted the
+ * old contents: its total is reported but not cached.
+ */
+
+typedef struct {
+    char path[FS_MAX_PATH];      // As requested
+    uint32_t cookie;
+} DirSizeJob;
+
+typedef struct {
+    int used;
+    char key[FS_MAX_PATH];       // Canonical path
+    uint64_t mtime;              // Folder timestamp when measured
+    uint64_t bytes;
+    uint64_t files;
+    uint64_t last_use;           // LRU clock value
+} DirSizeSlot;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t g_threads[DIRSIZE_MAX_THREADS];
+static int g_thread_count = 0;
+static atomic_int g_quit = 0;
+static atomic_uint g_generation = 0;
+
+static DirSizeJob* g_jobs = NULL;        // FIFO: [g_job_head, g_job_tail)
+static int g_job_head = 0;
+static int g_job_tail = 0;
+static int g_job_capacity = 0;
+
+static DirSizeResult* g_results = NULL;
+static int g_result_count = 0;
+static int g_result_capacity = 0;
+
+static DirSizeSlot g_cache[DIRSIZE_CACHE_SLOTS];
+static uint64_t g_clock = 0;
+static uint64_t g_invalidations = 0;     // dirsize_invalidate_entry() calls
+static DirSizeStats g_stats;
+
+// Cached total for 'key' at 'mtime' (lock held). Returns 1 on a hit.
+static int dirsize_cache_get(const char* key, uint64_t mtime, uint64_t* bytes, uint64_t* files)
+{
+    if (mtime == 0)
+        return 0;  // Unknown timestamp: never trust the cache
+
+    for (int i = 0; i < DIRSIZE_CACHE_SLOTS; i++) {
+        DirSizeSlot* slot = &g_cache[i];
+        if (slot->used && slot->mtime == mtime && strcmp(slot->key, key) == 0) {
+            slot->last_use = ++g_clock;
+            *bytes = slot->bytes;
+            *files = slot->files;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Remember a total (lock held), replacing the least recently used slot
+static void dirsize_cache_put(const char* key, uint64_t mtime, uint64_t bytes, uint64_t files)
+{
+    DirSizeSlot* victim = &g_cache[0];
+    for (int i = 0; i < DIRSIZE_CACHE_SLOTS; i++) {
+        DirSizeSlot* slot = &g_cache[i];
+        if (slot->used && strcmp(slot->key, key) == 0) {
+            victim = slot;
+            break;
+        }
+        if (!slot->used || (victim->used && slot->last_use < victim->last_use))
+            victim = slot;
+    }
+
+    victim->used = 1;
+    str_copy(victim->key, key, sizeof(victim->key));
+    victim->mtime = mtime;
+    victim->bytes = bytes;
+    victim->files = files;
+    victim->last_use = ++g_clock;
+}
+
+// Make room for 'count' results (lock held). Returns -1 on failure.
+static int dirsize_reserve_results(int count)
+{
+    if (count <= g_result_capacity)
+        return 0;
+    int capacity = g_result_capacity > 0 ? g_result_capacity : 64;
+    while (capacity < count)
+        capacity *= 2;
+    DirSizeResult* results = (DirSizeResult*)realloc(g_results, sizeof(DirSizeResult) * capacity);
+    if (results == NULL)
+        return -1;
+    g_results = results;
+    g_result_capacity = capacity;
+    return 0;
+}
+
+// Publish a result (lock held). Room for it was reserved with its request.
+static void dirsize_post(const DirSizeJob* job, uint64_t bytes, uint64_t files, int cached,
+                         int failed)
+{
+    if (g_result_count >= g_result_capacity)
+        return;  // Not reached
+
+    DirSizeResult* r = &g_results[g_result_count++];
+    str_copy(r->path, job->path, sizeof(r->path));
+    r->cookie = job->cookie;
+    r->bytes = bytes;
+    r->files = files;
+    r->cached = cached;
+    r->failed = failed;
+}
+
+typedef struct {
+    unsigned generation;         // Generation the walk belongs to
+} DirSizeWalk;
+
+// Nothing to do per entry (the walker sums sizes); just honour cancels
+static int dirsize_visit(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)path;
+    (void)entry;
+    (void)depth;
+    const DirSizeWalk* walk = (const DirSizeWalk*)user;
+    if (atomic_load(&g_quit) || atomic_load(&g_generation) != walk->generation)
+        return WALK_STOP;
+    return WALK_CONTINUE;
+}
+
+static void* dirsize_worker(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_lock);
+    while (1) {
+        while (!atomic_load(&g_quit) && g_job_head == g_job_tail)
+            pthread_cond_wait(&g_wake, &g_lock);
+        if (atomic_load(&g_quit))
+            break;
+
+        DirSizeJob job = g_jobs[g_job_head++];
+        if (g_job_head == g_job_tail)
+            g_job_head = g_job_tail = 0;
+        g_stats.queued = g_job_tail - g_job_head;
+        DirSizeWalk walk;
+        walk.generation = atomic_load(&g_generation);
+        uint64_t invalidations = g_invalidations;
+        pthread_mutex_unlock(&g_lock);
+
+        char key[FS_MAX_PATH];
+        path_canonicalize(job.path, key, sizeof(key));
+        uint64_t mtime = 0;
+        fs_get_mtime(job.path, &mtime);
+
+        uint64_t bytes = 0;
+        uint64_t files = 0;
+        pthread_mutex_lock(&g_lock);
+        int hit = dirsize_cache_get(key, mtime, &bytes, &files);
+        pthread_mutex_unlock(&g_lock);
+
+        WalkStats stats;
+        int rc = 0;
+        if (!hit) {
+            rc = walk_tree(job.path, dirsize_visit, NULL, &walk, NULL, &stats);
+            bytes = stats.bytes;
+            files = stats.files;
+        }
+
+        pthread_mutex_lock(&g_lock);
+        if (hit) {
+            g_stats.cache_hits++;
+        } else {
+            g_stats.dirs_listed += stats.dirs;
+            if (rc == 0) {
+                g_stats.walked++;
+                if (invalidations == g_invalidations)
+                    dirsize_cache_put(key, mtime, bytes, files);
+            } else if (rc == 1) {
+                g_stats.cancelled++;
+            }
+        }
+        // Results of a cancelled generation are not wanted any more; a
+        // walk that failed is still answered, so callers stop waiting
+        if (rc <= 0 && walk.generation == atomic_load(&g_generation))
+            dirsize_post(&job, rc == 0 ? bytes : 0, rc == 0 ? files : 0, hit, rc < 0);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+int dirsize_init(int threads)
+{
+    if (g_thread_count > 0)
+        return 0;
+
+    if (threads <= 0)
+        threads = DIRSIZE_DEFAULT_THREADS;
+    if (threads > DIRSIZE_MAX_THREADS)
+        threads = DIRSIZE_MAX_THREADS;
+
+    atomic_store(&g_quit, 0);
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&g_threads[g_thread_count], NULL, dirsize_worker, NULL) == 0)
+            g_thread_count++;
+    }
+    return g_thread_count > 0 ? 0 : -1;
+}
+
+void dirsize_cleanup(void)
+{
+    pthread_mutex_lock(&g_lock);
+    atomic_store(&g_quit, 1);
+    pthread_cond_broadcast(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+
+    for (int i = 0; i < g_thread_count; i++)
+        pthread_join(g_threads[i], NULL);
+    g_thread_count = 0;
+
+    free(g_jobs);
+    g_jobs = NULL;
+    g_job_head = g_job_tail = g_job_capacity = 0;
+    free(g_results);
+    g_results = NULL;
+    g_result_count = g_result_capacity = 0;
+    memset(g_cache, 0, sizeof(g_cache));
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+int dirsize_request(const char* path, uint32_t cookie)
+{
+    if (path == NULL || g_thread_count == 0)
+        return -1;
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = g_job_head; i < g_job_tail; i++) {
+        if (g_jobs[i].cookie == cookie && strcmp(g_jobs[i].path, path) == 0) {
+            pthread_mutex_unlock(&g_lock);
+            return 1;  // Its result answers this request too
+        }
+    }
+
+    // Every queued or running request gets a result: keep room for them
+    if (dirsize_reserve_results(g_result_count + g_job_tail - g_job_head + g_thread_count + 1) != 0) {
+        pthread_mutex_unlock(&g_lock);
+        return -1;
+    }
+
+    if (g_job_tail >= g_job_capacity) {
+        // Reclaim the consumed front before growing
+        if (g_job_head > 0) {
+            memmove(g_jobs, g_jobs + g_job_head, sizeof(DirSizeJob) * (g_job_tail - g_job_head));
+            g_job_tail -= g_job_head;
+            g_job_head = 0;
+        }
+        if (g_job_tail >= g_job_capacity) {
+            int capacity = g_job_capacity > 0 ? g_job_capacity * 2 : 64;
+            DirSizeJob* jobs = (DirSizeJob*)realloc(g_jobs, sizeof(DirSizeJob) * capacity);
+            if (jobs == NULL) {
+                pthread_mutex_unlock(&g_lock);
+                return -1;
+            }
+            g_jobs = jobs;
+            g_job_capacity = capacity;
+        }
+    }
+
+    DirSizeJob* job = &g_jobs[g_job_tail++];
+    str_copy(job->path, path, sizeof(job->path));
+    job->cookie = cookie;
+    g_stats.requests++;
+    g_stats.queued = g_job_tail - g_job_head;
+    pthread_cond_signal(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+}
+
+int dirsize_poll(DirSizeResult* out, int max)
+{
+    if (out == NULL || max <= 0)
+        return 0;
+
+    pthread_mutex_lock(&g_lock);
+    int n = g_result_count < max ? g_result_count : max;
+    if (n > 0) {
+        memcpy(out, g_results, sizeof(DirSizeResult) * n);
+        memmove(g_results, g_results + n, sizeof(DirSizeResult) * (g_result_count - n));
+        g_result_count -= n;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return n;
+}
+
+void dirsize_cancel_all(void)
+{
+    pthread_mutex_lock(&g_lock);
+    atomic_fetch_add(&g_generation, 1);
+    g_job_head = g_job_tail = 0;
+    g_result_count = 0;
+    g_stats.queued = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void dirsize_invalidate_entry(const char* path)
+{
+    if (path == NULL)
+        return;
+
+    char key[FS_MAX_PATH];
+    path_canonicalize(path, key, sizeof(key));
+
+    pthread_mutex_lock(&g_lock);
+    g_invalidations++;
+    for (int i = 0; i < DIRSIZE_CACHE_SLOTS; i++) {
+        DirSizeSlot* slot = &g_cache[i];
+        if (slot->used && (path_is_within(slot->key, key) || path_is_within(key, slot->key)))
+            slot->used = 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void dirsize_get_stats(DirSizeStats* out)
+{
+    if (out == NULL)
+        return;
+
+    pthread_mutex_lock(&g_lock);
+    *out = g_stats;
+    pthread_mutex_unlock(&g_lock);
+}
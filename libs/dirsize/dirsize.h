@@ -0,0 +1,103 @@
+#ifndef DIRSIZE_H
+#define DIRSIZE_H
+
+#include "fs.h"
+
+/**
+ * Folder size module
+ *
+ * Computes the total size of folders in the background. Requests are
+ * queued and served by a small pool of worker threads, each walking one
+ * folder's subtree with the shared tree walker, so several folders are
+ * measured at once while the UI thread only queues requests and polls
+ * finished results.
+ *
+ * Totals are cached by canonical path together with the folder's
+ * timestamp; a request for an unchanged folder is answered from the
+ * cache without walking it. A folder's timestamp does not change when
+ * something deeper in its subtree does, so file operations call
+ * dirsize_invalidate_entry() for the paths they touch.
+ */
+
+/* Default number of worker threads */
+#define DIRSIZE_DEFAULT_THREADS 2
+
+/* Most worker threads */
+#define DIRSIZE_MAX_THREADS 4
+
+/* Remembered folder totals */
+#define DIRSIZE_CACHE_SLOTS 256
+
+/**
+ * DirSizeResult - A finished folder total
+ */
+typedef struct {
+    char path[FS_MAX_PATH];  // Path as passed to dirsize_request()
+    uint32_t cookie;         // Cookie passed to dirsize_request()
+    uint64_t bytes;          // Total size of all files below the folder
+    uint64_t files;          // Number of files below the folder
+    int cached;              // 1 if answered from the cache
+    int failed;              // 1 if the folder could not be measured (bytes and files are 0)
+} DirSizeResult;
+
+/**
+ * DirSizeStats - Aggregator counters
+ */
+typedef struct {
+    uint64_t requests;       // Folders requested
+    uint64_t walked;         // Folders measured by walking
+    uint64_t cache_hits;     // Folders answered from the cache
+    uint64_t cancelled;      // Walks abandoned by dirsize_cancel_all()
+    uint64_t dirs_listed;    // Folders listed by all walks
+    int queued;              // Requests waiting for a worker
+} DirSizeStats;
+
+/**
+ * dirsize_init(threads)
+ * Start 'threads' workers (0 selects DIRSIZE_DEFAULT_THREADS).
+ * Returns 0 on success, -1 if no worker could be started.
+ */
+int dirsize_init(int threads);
+
+/**
+ * dirsize_cleanup()
+ * Stop the workers and drop all queued work, results and cached totals.
+ */
+void dirsize_cleanup(void);
+
+/**
+ * dirsize_request(path, cookie)
+ * Queue 'path' for measuring. The result is returned by dirsize_poll()
+ * tagged with 'cookie'. A request for a path already queued with the same
+ * cookie is not queued again: one result answers both.
+ * Returns 0 if queued, 1 if already queued, -1 on failure.
+ */
+int dirsize_request(const char* path, uint32_t cookie);
+
+/**
+ * dirsize_poll(out, max)
+ * Move up to 'max' finished results into 'out'.
+ * Returns the number of results written.
+ */
+int dirsize_poll(DirSizeResult* out, int max);
+
+/**
+ * dirsize_cancel_all()
+ * Drop queued requests and unpolled results and stop running walks.
+ */
+void dirsize_cancel_all(void);
+
+/**
+ * dirsize_invalidate_entry(path)
+ * Something at 'path' was created, removed or changed: forget the cached
+ * totals of 'path', every folder above it and every folder below it.
+ */
+void dirsize_invalidate_entry(const char* path);
+
+/**
+ * dirsize_get_stats(out)
+ * Copy the current counters into 'out'.
+ */
+void dirsize_get_stats(DirSizeStats* out);
+
+#endif
@@ -2,8 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
 #include "../utils/utils.h"
+#include "../vfs/vfs.h"
 
 /**
  * File Operations Module Implementation
@@ -60,33 +60,37 @@ int fileops_paste(const char* dest_dir)
     snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, filename);
 
     // Copy file from clipboard to destination
-    FILE* src = fopen(g_fileops_state.clipboard_path, "rb");
+    VfsFile* src = vfs_open(g_fileops_state.clipboard_path, VFS_OPEN_READ);
     if (src == NULL)
         return -1;
 
-    FILE* dst = fopen(dest_path, "wb");
+    VfsFile* dst = vfs_open(dest_path, VFS_OPEN_WRITE | VFS_OPEN_CREATE);
     if (dst == NULL) {
-        fclose(src);
+        vfs_close(src);
         return -1;
     }
 
     // Copy file data in chunks
     char buffer[4096];
-    size_t bytes_read;
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), src)) > 0) {
-        if (fwrite(buffer, 1, bytes_read, dst) != bytes_read) {
-            fclose(src);
-            fclose(dst);
+    uint64_t offset = 0;
+    int64_t bytes_read;
+    while ((bytes_read = vfs_read(src, offset, buffer, sizeof(buffer))) > 0) {
+        if (vfs_write(dst, offset, buffer, (uint64_t)bytes_read) != 0) {
+            vfs_close(src);
+            vfs_close(dst);
             return -1;
         }
+        offset += (uint64_t)bytes_read;
     }
 
-    fclose(src);
-    fclose(dst);
+    vfs_close(src);
+    vfs_close(dst);
+    if (bytes_read < 0)
+        return -1;
 
     // If this was a move (cut), delete the original
     if (g_fileops_state.clipboard_is_cut) {
-        remove(g_fileops_state.clipboard_path);
+        vfs_remove(g_fileops_state.clipboard_path);
         g_fileops_state.clipboard_has_data = 0;
         g_fileops_state.clipboard_path[0] = '\0';
     }
@@ -113,8 +117,8 @@ int fileops_delete(const char* path)
     if (path == NULL)
         return -1;
 
-    // Try to delete file using remove()
-    if (remove(path) == 0) {
+    // Try to delete file
+    if (vfs_remove(path) == 0) {
         // If we deleted the clipboard item, clear it
         if (strcmp(path, g_fileops_state.clipboard_path) == 0) {
             g_fileops_state.clipboard_has_data = 0;
@@ -0,0 +1,298 @@
+#include "filter.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FILTER_USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FILTER_USE_SSE2 1
+#endif
+
+/**
+ * Filter module implementation
+ */
+
+static inline unsigned char filter_fold(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static inline int filter_is_boundary(unsigned char c)
+{
+    return c == ' ' || c == '_' || c == '-' || c == '.' || c == '(' || c == '[';
+}
+
+// Does 'needle' match hay[pos..] case-insensitively?
+static inline int filter_match_at(const char* hay, int pos, const char* needle, int needle_len)
+{
+    for (int k = 0; k < needle_len; k++) {
+        if (filter_fold((unsigned char)hay[pos + k]) != (unsigned char)needle[k])
+            return 0;
+    }
+    return 1;
+}
+
+int filter_find_ci(const char* hay, int hay_len, const char* needle, int needle_len)
+{
+    if (needle_len <= 0)
+        return 0;
+    int last = hay_len - needle_len;  // Last possible match start
+    if (last < 0)
+        return -1;
+
+    unsigned char first = (unsigned char)needle[0];
+    int is_letter = (first >= 'a' && first <= 'z');
+
+#if defined(FILTER_USE_NEON) || defined(FILTER_USE_SSE2)
+    // Find candidates for the first byte 16 at a time. For a letter, OR-ing
+    // 0x20 maps exactly the upper and lower case forms onto 'first'.
+#if defined(FILTER_USE_NEON)
+    const uint8x16_t want = vdupq_n_u8(first);
+    const uint8x16_t fold = vdupq_n_u8(is_letter ? 0x20 : 0x00);
+#else
+    const __m128i want = _mm_set1_epi8((char)first);
+    const __m128i fold = _mm_set1_epi8(is_letter ? 0x20 : 0x00);
+#endif
+    for (int base = 0; base <= last; base += 16) {
+#if defined(FILTER_USE_NEON)
+        uint8x16_t v = vorrq_u8(vld1q_u8((const uint8_t*)hay + base), fold);
+        uint8x16_t eq = vceqq_u8(v, want);
+        // Narrow to one nibble per byte: bit 4k set <=> byte k matched
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        mask &= 0x1111111111111111ull;
+        const int shift = 2;
+#else
+        __m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)(hay + base)), fold);
+        uint64_t mask = (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, want));
+        const int shift = 0;
+#endif
+        while (mask != 0) {
+            int pos = base + (__builtin_ctzll(mask) >> shift);
+            if (pos > last)
+                return -1;
+            if (filter_match_at(hay, pos + 1, needle + 1, needle_len - 1))
+                return pos;
+            mask &= mask - 1;
+        }
+    }
+    return -1;
+#else
+    for (int pos = 0; pos <= last; pos++) {
+        unsigned char c = (unsigned char)hay[pos];
+        if ((is_letter ? (c | 0x20) : c) == first &&
+            filter_match_at(hay, pos + 1, needle + 1, needle_len - 1))
+            return pos;
+    }
+    return -1;
+#endif
+}
+
+int filter_score(const char* name, int len, const char* query, int query_len)
+{
+    if (query_len == 0)
+        return 0;
+
+    // Substring hits rank above any fuzzy match: earlier is better, and
+    // a hit at the start or after a separator gets a bonus
+    int pos = filter_find_ci(name, len, query, query_len);
+    if (pos >= 0) {
+        if (query_len == len)
+            return FILTER_MAX_SCORE;
+        int score = 800 - (pos < 200 ? pos : 200);
+        if (pos == 0)
+            score += 200;
+        else if (filter_is_boundary((unsigned char)name[pos - 1]))
+            score += 100;
+        return score;
+    }
+
+    // Fuzzy: every query character in order, penalizing gaps
+    int score = 400;
+    int i = 0;
+    for (int k = 0; k < query_len; k++) {
+        int start = i;
+        while (i < len && filter_fold((unsigned char)name[i]) != (unsigned char)query[k])
+            i++;
+        if (i >= len)
+            return -1;
+        int gap = i - start;
+        score -= gap < 20 ? gap : 20;
+        if (i == 0 || filter_is_boundary((unsigned char)name[i - 1]))
+            score += 5;
+        i++;
+    }
+    if (score < 1) score = 1;
+    if (score > 599) score = 599;
+    return score;
+}
+
+static int filter_reserve(FilterState* state, int needed)
+{
+    if (needed <= state->capacity)
+        return 0;
+
+    int capacity = state->capacity > 0 ? state->capacity : 256;
+    while (capacity < needed)
+        capacity *= 2;
+
+    uint32_t* hits = (uint32_t*)realloc(state->hits, sizeof(uint32_t) * capacity);
+    if (hits == NULL) return -1;
+    state->hits = hits;
+    uint16_t* scores = (uint16_t*)realloc(state->hit_scores, sizeof(uint16_t) * capacity);
+    if (scores == NULL) return -1;
+    state->hit_scores = scores;
+    uint32_t* matches = (uint32_t*)realloc(state->matches, sizeof(uint32_t) * capacity);
+    if (matches == NULL) return -1;
+    state->matches = matches;
+
+    state->capacity = capacity;
+    return 0;
+}
+
+// Score entries [from, to) of 'dir' and append the hits
+static void filter_scan(FilterState* state, const FsDirectory* dir, int from, int to)
+{
+    for (int i = from; i < to; i++) {
+        int score = filter_score(dir->names + dir->name_offsets[i], dir->name_lengths[i],
+                                 state->query, state->query_len);
+        if (score >= 0) {
+            state->hits[state->hit_count] = (uint32_t)i;
+            state->hit_scores[state->hit_count] = (uint16_t)score;
+            state->hit_count++;
+        }
+    }
+}
+
+// Rank hits by score (descending) with a stable counting sort, so equal
+// scores keep listing order
+static void filter_rank(FilterState* state)
+{
+    static int counts[FILTER_MAX_SCORE + 2];
+    memset(counts, 0, sizeof(counts));
+
+    for (int i = 0; i < state->hit_count; i++)
+        counts[FILTER_MAX_SCORE - state->hit_scores[i] + 1]++;
+    for (int s = 1; s <= FILTER_MAX_SCORE + 1; s++)
+        counts[s] += counts[s - 1];
+    for (int i = 0; i < state->hit_count; i++)
+        state->matches[counts[FILTER_MAX_SCORE - state->hit_scores[i]]++] = state->hits[i];
+    state->match_count = state->hit_count;
+}
+
+void filter_init(FilterState* state)
+{
+    if (state == NULL)
+        return;
+    memset(state, 0, sizeof(*state));
+}
+
+void filter_free(FilterState* state)
+{
+    if (state == NULL)
+        return;
+    free(state->hits);
+    free(state->hit_scores);
+    free(state->matches);
+    memset(state, 0, sizeof(*state));
+}
+
+int filter_set_query(FilterState* state, const FsDirectory* dir, const char* query)
+{
+    if (state == NULL || dir == NULL || query == NULL)
+        return -1;
+
+    char folded[FILTER_MAX_QUERY];
+    int len = 0;
+    for (; query[len] != '\0' && len < FILTER_MAX_QUERY - 1; len++)
+        folded[len] = (char)filter_fold((unsigned char)query[len]);
+    folded[len] = '\0';
+
+    if (filter_reserve(state, dir->count) != 0)
+        return -1;
+
+    int same_listing = (state->dir == dir && state->dir_sort_tag == dir->sort_tag &&
+                        state->dir_count <= dir->count);
+    int refines = same_listing && len >= state->query_len &&
+                  memcmp(folded, state->query, (size_t)state->query_len) == 0;
+    int same_query = refines && len == state->query_len;
+
+    memcpy(state->query, folded, (size_t)len + 1);
+    state->query_len = len;
+
+    if (same_query) {
+        // Listing grew: only the appended entries need scoring
+        filter_scan(state, dir, state->dir_count, dir->count);
+    } else if (refines) {
+        // Narrow the previous hits, then consider newly appended entries
+        int kept = 0;
+        for (int i = 0; i < state->hit_count; i++) {
+            uint32_t e = state->hits[i];
+            int score = filter_score(dir->names + dir->name_offsets[e], dir->name_lengths[e],
+                                     folded, len);
+            if (score >= 0) {
+                state->hits[kept] = e;
+                state->hit_scores[kept] = (uint16_t)score;
+                kept++;
+            }
+        }
+        state->hit_count = kept;
+        filter_scan(state, dir, state->dir_count, dir->count);
+    } else {
+        state->hit_count = 0;
+        filter_scan(state, dir, 0, dir->count);
+    }
+
+    state->dir = dir;
+    state->dir_count = dir->count;
+    state->dir_sort_tag = dir->sort_tag;
+    filter_rank(state);
+    return 0;
+}
+
+int filter_refresh(FilterState* state, const FsDirectory* dir)
+{
+    if (state == NULL || dir == NULL)
+        return -1;
+
+    char query[FILTER_MAX_QUERY];
+    memcpy(query, state->query, (size_t)state->query_len + 1);
+    return filter_set_query(state, dir, query);
+}
+
+int filter_jump_initial(const FsDirectory* dir, int from, int direction)
+{
+    int count = fs_dir_count(dir);
+    if (count == 0 || from < 0 || from >= count)
+        return from;
+
+    #define INITIAL(i) filter_fold((unsigned char)dir->names[dir->name_offsets[(i)]])
+    unsigned char cur = INITIAL(from);
+
+    if (direction > 0) {
+        for (int step = 1; step < count; step++) {
+            int i = (from + step) % count;
+            if (INITIAL(i) != cur)
+                return i;
+        }
+        return from;
+    }
+
+    // Backwards: start of the current run, or of the previous run if
+    // we are already at the start
+    int i = from;
+    while (i > 0 && INITIAL(i - 1) == cur)
+        i--;
+    if (i != from)
+        return i;
+
+    int prev = (from - 1 + count) % count;
+    unsigned char target = INITIAL(prev);
+    if (target == cur)
+        return from;
+    while (prev > 0 && INITIAL(prev - 1) == target)
+        prev--;
+    return prev;
+    #undef INITIAL
+}
@@ -0,0 +1,93 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "fs.h"
+
+/**
+ * Filter module
+ *
+ * Incremental type-to-filter over a listing. Every entry is scored against
+ * the query: a case-insensitive substring hit (found with a NEON/SSE2
+ * scan, scalar elsewhere) scores highest, earlier and word-aligned hits
+ * more so; otherwise the query may match fuzzily as a subsequence.
+ * Appending a character only rescores the previous matches, since any
+ * name matching "abc" also matches "ab".
+ */
+
+#define FILTER_MAX_QUERY 64
+
+/* Scores are kept in [0, FILTER_MAX_SCORE] so results rank in O(n) */
+#define FILTER_MAX_SCORE 1023
+
+/**
+ * FilterState - Query and ranked matches for one listing
+ */
+typedef struct {
+    char query[FILTER_MAX_QUERY];  // Case-folded query
+    int query_len;
+    uint32_t* hits;                // Matching entry indices in listing order
+    uint16_t* hit_scores;          // Score of each hit (parallel to hits)
+    int hit_count;
+    uint32_t* matches;             // Same entries ranked, best score first
+    int match_count;
+    int capacity;                  // Allocated slots in each array
+    const FsDirectory* dir;        // Listing the matches refer to
+    int dir_count;                 // Entries of 'dir' already considered
+    int dir_sort_tag;              // dir->sort_tag when matches were built
+} FilterState;
+
+/**
+ * filter_init(state)
+ * Initialize an empty filter (matches nothing until a listing is set).
+ */
+void filter_init(FilterState* state);
+
+/**
+ * filter_free(state)
+ * Release the match arrays. The state may be reused after filter_init().
+ */
+void filter_free(FilterState* state);
+
+/**
+ * filter_set_query(state, dir, query)
+ * (Call filter_free() + filter_init() when the displayed listing is
+ * replaced: a new listing may reuse the old one's address.)
+ * Filter 'dir' by 'query'. When 'dir' is the listing of the previous
+ * call and 'query' extends the previous query, only previous matches are
+ * rescored. Entries appended to 'dir' since the last call are scanned too.
+ * An empty query matches every entry in listing order.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int filter_set_query(FilterState* state, const FsDirectory* dir, const char* query);
+
+/**
+ * filter_refresh(state, dir)
+ * Re-apply the current query after 'dir' changed (entries streamed in or
+ * the listing was re-sorted). Returns 0 on success, -1 on failure.
+ */
+int filter_refresh(FilterState* state, const FsDirectory* dir);
+
+/**
+ * filter_score(name, len, query, query_len)
+ * Score one name against a case-folded query.
+ * Returns -1 if it does not match, else a score in [0, FILTER_MAX_SCORE].
+ */
+int filter_score(const char* name, int len, const char* query, int query_len);
+
+/**
+ * filter_find_ci(hay, hay_len, needle, needle_len)
+ * Case-insensitive substring search ('needle' must be lower-case ASCII).
+ * 'hay' must be readable for 16 bytes past hay_len (FS_NAME_SLACK).
+ * Returns the offset of the first match or -1.
+ */
+int filter_find_ci(const char* hay, int hay_len, const char* needle, int needle_len);
+
+/**
+ * filter_jump_initial(dir, from, direction)
+ * Jump-to-letter: from entry 'from', return the first entry of the next
+ * (direction > 0) or previous (direction < 0) run of names sharing a
+ * first letter, wrapping around. Returns 'from' if there is none.
+ */
+int filter_jump_initial(const FsDirectory* dir, int from, int direction);
+
+#endif
@@ -0,0 +1,433 @@
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../vfs/vfs.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/**
+ * Hash implementation
+ *
+ * The CRC is kept finished (inverted) between calls, so a context's
+ * 'crc' is always the CRC of everything fed so far. The portable CRC
+ * works on eight bytes per step with eight derived tables (slicing by
+ * 8), loading words little-endian as every supported host is.
+ */
+
+#if defined(__ARM_FEATURE_CRC32)
+
+static uint32_t hash_crc32(uint32_t crc, const uint8_t* p, uint64_t size)
+{
+    crc = ~crc;
+    while (size > 0 && ((uintptr_t)p & 7) != 0) {
+        crc = __crc32b(crc, *p++);
+        size--;
+    }
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = __crc32d(crc, word);
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = __crc32b(crc, *p++);
+        size--;
+    }
+    return ~crc;
+}
+
+#else
+
+static uint32_t g_crc_table[8][256];
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+static void hash_crc_table_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+        g_crc_table[0][i] = c;
+    }
+    for (int i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++)
+            g_crc_table[t][i] = (g_crc_table[t - 1][i] >> 8) ^
+                                g_crc_table[0][g_crc_table[t - 1][i] & 0xFF];
+    }
+}
+
+static uint32_t hash_crc32(uint32_t crc, const uint8_t* p, uint64_t size)
+{
+    pthread_once(&g_crc_once, hash_crc_table_init);
+    uint32_t (*t)[256] = g_crc_table;
+
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t lo;
+        uint32_t hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+        size--;
+    }
+    return ~crc;
+}
+
+#endif
+
+#ifndef __SWITCH__
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t hash_load_be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void hash_sha1_block(uint32_t* state, const uint8_t* block)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++)
+        w[i] = hash_load_be32(block + i * 4);
+    for (int i = 16; i < 80; i++)
+        w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    // One loop per round function keeps the branches out of the rounds
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+#define SHA1_ROUND(f, k, i) do {                         \
+        uint32_t temp = ROL(a, 5) + (f) + e + (k) + w[i]; \
+        e = d;                                           \
+        d = c;                                           \
+        c = ROL(b, 30);                                  \
+        b = a;                                           \
+        a = temp;                                        \
+    } while (0)
+    for (int i = 0; i < 20; i++)
+        SHA1_ROUND((b & c) | (~b & d), 0x5A827999, i);
+    for (int i = 20; i < 40; i++)
+        SHA1_ROUND(b ^ c ^ d, 0x6ED9EBA1, i);
+    for (int i = 40; i < 60; i++)
+        SHA1_ROUND((b & c) | (b & d) | (c & d), 0x8F1BBCDC, i);
+    for (int i = 60; i < 80; i++)
+        SHA1_ROUND(b ^ c ^ d, 0xCA62C1D6, i);
+#undef SHA1_ROUND
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+static const uint32_t g_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static void hash_sha256_block(uint32_t* state, const uint8_t* block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = hash_load_be32(block + i * 4);
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + g_sha256_k[i] + w[i];
+        uint32_t s0 = ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+static void hash_block(HashContext* ctx, const uint8_t* block)
+{
+    if (ctx->algo == HASH_SHA1)
+        hash_sha1_block(ctx->state, block);
+    else
+        hash_sha256_block(ctx->state, block);
+}
+
+static void hash_blocks_update(HashContext* ctx, const uint8_t* p, uint64_t size)
+{
+    ctx->length += size;
+    if (ctx->block_used > 0) {
+        uint64_t take = 64 - ctx->block_used;
+        if (take > size)
+            take = size;
+        memcpy(ctx->block + ctx->block_used, p, take);
+        ctx->block_used += (uint32_t)take;
+        p += take;
+        size -= take;
+        if (ctx->block_used < 64)
+            return;
+        hash_block(ctx, ctx->block);
+        ctx->block_used = 0;
+    }
+    while (size >= 64) {
+        hash_block(ctx, p);
+        p += 64;
+        size -= 64;
+    }
+    memcpy(ctx->block, p, size);
+    ctx->block_used = (uint32_t)size;
+}
+
+// Pad, append the bit length and write 'words' state words big-endian
+static void hash_blocks_final(HashContext* ctx, int words, uint8_t* out)
+{
+    uint64_t bits = ctx->length * 8;
+    uint8_t pad = 0x80;
+    hash_blocks_update(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->block_used != 56)
+        hash_blocks_update(ctx, &pad, 1);
+
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++)
+        length[i] = (uint8_t)(bits >> (56 - 8 * i));
+    hash_blocks_update(ctx, length, 8);
+
+    for (int i = 0; i < words; i++) {
+        out[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+#endif
+
+void hash_init(HashContext* ctx, HashAlgo algo)
+{
+    if (ctx == NULL)
+        return;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->algo = algo;
+#ifdef __SWITCH__
+    if (algo == HASH_SHA1)
+        sha1ContextCreate(&ctx->sha1);
+    else if (algo == HASH_SHA256)
+        sha256ContextCreate(&ctx->sha256);
+#else
+    static const uint32_t sha1_init[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0,
+    };
+    static const uint32_t sha256_init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    if (algo == HASH_SHA1)
+        memcpy(ctx->state, sha1_init, sizeof(sha1_init));
+    else if (algo == HASH_SHA256)
+        memcpy(ctx->state, sha256_init, sizeof(sha256_init));
+#endif
+}
+
+void hash_update(HashContext* ctx, const void* data, uint64_t size)
+{
+    if (ctx == NULL || data == NULL || size == 0)
+        return;
+
+    switch (ctx->algo) {
+        case HASH_CRC32:
+            ctx->crc = hash_crc32(ctx->crc, (const uint8_t*)data, size);
+            break;
+#ifdef __SWITCH__
+        case HASH_SHA1:
+            sha1ContextUpdate(&ctx->sha1, data, size);
+            break;
+        case HASH_SHA256:
+            sha256ContextUpdate(&ctx->sha256, data, size);
+            break;
+#else
+        case HASH_SHA1:
+        case HASH_SHA256:
+            hash_blocks_update(ctx, (const uint8_t*)data, size);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+void hash_final(HashContext* ctx, HashDigest* out)
+{
+    if (ctx == NULL || out == NULL)
+        return;
+
+    memset(out, 0, sizeof(*out));
+    out->algo = ctx->algo;
+    out->size = hash_digest_size(ctx->algo);
+    switch (ctx->algo) {
+        case HASH_CRC32:
+            // Big-endian, so the hex reads like the CRC's value
+            out->bytes[0] = (uint8_t)(ctx->crc >> 24);
+            out->bytes[1] = (uint8_t)(ctx->crc >> 16);
+            out->bytes[2] = (uint8_t)(ctx->crc >> 8);
+            out->bytes[3] = (uint8_t)ctx->crc;
+            break;
+#ifdef __SWITCH__
+        case HASH_SHA1:
+            sha1ContextGetHash(&ctx->sha1, out->bytes);
+            break;
+        case HASH_SHA256:
+            sha256ContextGetHash(&ctx->sha256, out->bytes);
+            break;
+#else
+        case HASH_SHA1:
+            hash_blocks_final(ctx, 5, out->bytes);
+            break;
+        case HASH_SHA256:
+            hash_blocks_final(ctx, 8, out->bytes);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+const char* hash_name(HashAlgo algo)
+{
+    switch (algo) {
+        case HASH_CRC32:  return "CRC32";
+        case HASH_SHA1:   return "SHA-1";
+        case HASH_SHA256: return "SHA-256";
+        default:          return "none";
+    }
+}
+
+int hash_digest_size(HashAlgo algo)
+{
+    switch (algo) {
+        case HASH_CRC32:  return 4;
+        case HASH_SHA1:   return 20;
+        case HASH_SHA256: return 32;
+        default:          return 0;
+    }
+}
+
+int hash_equal(const HashDigest* a, const HashDigest* b)
+{
+    if (a == NULL || b == NULL || a->algo != b->algo || a->size != b->size)
+        return 0;
+    return memcmp(a->bytes, b->bytes, (size_t)a->size) == 0;
+}
+
+void hash_to_hex(const HashDigest* digest, char* out, int size)
+{
+    if (out == NULL || size <= 0)
+        return;
+
+    out[0] = '\0';
+    if (digest == NULL)
+        return;
+    static const char hex[] = "0123456789abcdef";
+    int len = 0;
+    for (int i = 0; i < digest->size && len + 2 < size; i++) {
+        out[len++] = hex[digest->bytes[i] >> 4];
+        out[len++] = hex[digest->bytes[i] & 0x0F];
+    }
+    out[len] = '\0';
+}
+
+int hash_file(const char* path, unsigned algos, HashDigest out[HASH_ALGO_COUNT],
+              Progress* progress, const atomic_int* cancel)
+{
+    if (path == NULL || out == NULL || (algos & HASH_ALL) == 0)
+        return -1;
+
+    VfsFile* file = vfs_open(path, VFS_OPEN_READ);
+    if (file == NULL)
+        return -1;
+    uint64_t size = 0;
+    uint8_t* buf = (uint8_t*)malloc(HASH_FILE_CHUNK);
+    if (buf == NULL || vfs_get_size(file, &size) != 0) {
+        free(buf);
+        vfs_close(file);
+        return -1;
+    }
+
+    HashContext ctx[HASH_ALGO_COUNT];
+    for (int a = HASH_CRC32; a < HASH_ALGO_COUNT; a++) {
+        if (algos & HASH_MASK(a))
+            hash_init(&ctx[a], (HashAlgo)a);
+    }
+    progress_add_total(progress, 1, size);
+    progress_set_phase(progress, PROGRESS_HASHING);
+    progress_set_current(progress, path);
+
+    uint64_t offset = 0;
+    int rc = 0;
+    while (1) {
+        if ((cancel != NULL && atomic_load(cancel)) || progress_checkpoint(progress)) {
+            rc = 1;
+            break;
+        }
+        int64_t n = vfs_read(file, offset, buf, HASH_FILE_CHUNK);
+        if (n < 0) {
+            rc = -1;
+            break;
+        }
+        if (n == 0)
+            break;
+        for (int a = HASH_CRC32; a < HASH_ALGO_COUNT; a++) {
+            if (algos & HASH_MASK(a))
+                hash_update(&ctx[a], buf, (uint64_t)n);
+        }
+        offset += (uint64_t)n;
+        progress_add_done(progress, 0, (uint64_t)n);
+    }
+
+    if (rc == 0) {
+        for (int a = HASH_CRC32; a < HASH_ALGO_COUNT; a++) {
+            if (algos & HASH_MASK(a))
+                hash_final(&ctx[a], &out[a]);
+        }
+        progress_add_done(progress, 1, 0);
+    }
+    free(buf);
+    vfs_close(file);
+    return rc;
+}
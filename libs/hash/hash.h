@@ -0,0 +1,107 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include "fs.h"
+#include <stdatomic.h>
+#include "progress.h"
+
+/**
+ * Hash module
+ *
+ * CRC32, SHA-1 and SHA-256 over memory and files. On Switch the CPU's
+ * ARMv8 extensions do the work: CRC32 through the crc32 instructions,
+ * SHA-1 and SHA-256 through libnx's hashers, which are built on the
+ * crypto instructions. Host builds use portable C versions that give
+ * the same results.
+ *
+ * A context hashes a stream fed in pieces of any size, so the copy
+ * engine can hash the buffers it is already moving instead of reading
+ * the file a second time.
+ */
+
+typedef enum {
+    HASH_NONE = 0,
+    HASH_CRC32,              // CRC-32 (IEEE, as zip and No-Intro use)
+    HASH_SHA1,
+    HASH_SHA256,
+    HASH_ALGO_COUNT,
+} HashAlgo;
+
+/* hash_file() selection bits */
+#define HASH_MASK(algo) (1u << (algo))
+#define HASH_ALL        (HASH_MASK(HASH_CRC32) | HASH_MASK(HASH_SHA1) | HASH_MASK(HASH_SHA256))
+
+/* Longest digest (SHA-256), in bytes */
+#define HASH_MAX_DIGEST 32
+
+/* Bytes read per call by hash_file() */
+#define HASH_FILE_CHUNK (4u << 20)
+
+/**
+ * HashContext - One stream being hashed
+ */
+typedef struct {
+    HashAlgo algo;
+    uint32_t crc;
+#ifdef __SWITCH__
+    Sha1Context sha1;
+    Sha256Context sha256;
+#else
+    uint32_t state[8];       // SHA-1 uses the first five words
+    uint8_t block[64];       // Bytes waiting for a full block
+    uint32_t block_used;
+    uint64_t length;         // Bytes hashed so far
+#endif
+} HashContext;
+
+/**
+ * HashDigest - A finished hash
+ */
+typedef struct {
+    HashAlgo algo;
+    int size;                // Bytes used in 'bytes'
+    uint8_t bytes[HASH_MAX_DIGEST];
+} HashDigest;
+
+/**
+ * hash_init(ctx, algo) / hash_update(ctx, data, size) / hash_final(ctx, out)
+ * Start a stream, feed it bytes and finish it. A finished context must
+ * be initialised again before reuse.
+ */
+void hash_init(HashContext* ctx, HashAlgo algo);
+void hash_update(HashContext* ctx, const void* data, uint64_t size);
+void hash_final(HashContext* ctx, HashDigest* out);
+
+/**
+ * hash_name(algo) / hash_digest_size(algo)
+ * Display name ("CRC32", "SHA-1", "SHA-256") and digest length in bytes.
+ */
+const char* hash_name(HashAlgo algo);
+int hash_digest_size(HashAlgo algo);
+
+/**
+ * hash_equal(a, b)
+ * Returns 1 if both digests are of the same algorithm and match.
+ */
+int hash_equal(const HashDigest* a, const HashDigest* b);
+
+/**
+ * hash_to_hex(digest, out, size)
+ * Write the digest as lowercase hex (CRC32 as its 8-digit value).
+ * 'out' needs 2 * HASH_MAX_DIGEST + 1 bytes for any digest.
+ */
+void hash_to_hex(const HashDigest* digest, char* out, int size);
+
+/**
+ * hash_file(path, algos, out, progress, cancel)
+ * Hash file 'path' with every algorithm in the HASH_MASK() set 'algos'
+ * in one pass over the file; out[algo] receives each digest. Totals and
+ * bytes read go to 'progress' (may be NULL, PROGRESS_HASHING). 'cancel'
+ * and the pause and cancel requests of 'progress' are honoured between
+ * chunks.
+ * Returns 0 on success, 1 if cancelled, -1 on error.
+ */
+int hash_file(const char* path, unsigned algos, HashDigest out[HASH_ALGO_COUNT],
+              Progress* progress, const atomic_int* cancel);
+
+#endif
@@ -0,0 +1,864 @@
+#include "index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../utils/utils.h"
+#include "../sort/sort.h"
+#include "../filter/filter.h"
+
+/**
+ * File index implementation
+ *
+ * In memory the index is a table of folders plus one FsDirectory holding
+ * every entry, grouped by folder: a folder's entries are the contiguous
+ * range [first, first + count). Folders are stored in walk order (depth
+ * first, children by name), so consecutive paths share long prefixes and
+ * front-code well. A hash table maps paths to folders for the rescan.
+ *
+ * File layout (all integers unsigned LEB128 varints):
+ *   "DBFMIDX1" version dir_count entry_count
+ *   per folder: shared suffix_len suffix mtime count
+ *     per entry: (size << 1 | is_dir) shared suffix_len suffix
+ * 'shared' is the prefix length reused from the previous folder path, or
+ * from the previous name within the same folder.
+ */
+
+#define INDEX_MAGIC "DBFMIDX1"
+#define INDEX_VERSION 1
+
+typedef struct {
+    uint32_t path_offset;        // Into FileIndex.paths
+    uint16_t path_len;
+    uint64_t mtime;              // 0 = unknown (always re-listed)
+    uint32_t first;              // First entry in FileIndex.entries
+    uint32_t count;
+} IndexDir;
+
+typedef struct {
+    IndexDir* dirs;
+    int dir_count;
+    int dir_capacity;
+    char* paths;                 // Folder paths, NUL-terminated
+    uint32_t paths_used;
+    uint32_t paths_capacity;
+    int32_t* buckets;            // Path hash table (-1 = empty)
+    uint32_t bucket_mask;
+    FsDirectory* entries;        // Every entry, grouped by folder
+} FileIndex;
+
+static char g_file[FS_MAX_PATH] = INDEX_DEFAULT_FILE;
+static char g_root[FS_MAX_PATH] = "/";
+static FileIndex* g_index = NULL;      // Searchable index (guarded by g_lock)
+static int g_loaded = 0;               // Saved index has been read
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t g_thread;
+static int g_thread_running = 0;       // g_thread needs joining
+static atomic_int g_state = INDEX_STATE_IDLE;
+static atomic_int g_cancel = 0;
+static _Atomic uint64_t g_dirs_listed = 0;
+static _Atomic uint64_t g_dirs_reused = 0;
+static _Atomic uint64_t g_file_bytes = 0;
+static _Atomic uint64_t g_scan_start_ns = 0;
+static _Atomic uint64_t g_scan_ns = 0;
+
+/**
+ * In-memory index
+ */
+
+static FileIndex* index_create(void)
+{
+    FileIndex* idx = (FileIndex*)calloc(1, sizeof(FileIndex));
+    if (idx == NULL)
+        return NULL;
+
+    idx->entries = fs_dir_create(1024);
+    if (idx->entries == NULL) {
+        free(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+static void index_destroy(FileIndex* idx)
+{
+    if (idx == NULL)
+        return;
+
+    free(idx->dirs);
+    free(idx->paths);
+    free(idx->buckets);
+    fs_free_directory(idx->entries);
+    free(idx);
+}
+
+static const char* index_dir_path(const FileIndex* idx, int d)
+{
+    return idx->paths + idx->dirs[d].path_offset;
+}
+
+// Start a new folder; its entries are the ones appended next.
+// Returns the folder's index or -1 on allocation failure.
+static int index_add_dir(FileIndex* idx, const char* path, size_t len, uint64_t mtime)
+{
+    if (len > 0xFFFF)
+        return -1;
+
+    if (idx->dir_count >= idx->dir_capacity) {
+        int capacity = idx->dir_capacity > 0 ? idx->dir_capacity * 2 : 256;
+        IndexDir* dirs = (IndexDir*)realloc(idx->dirs, sizeof(IndexDir) * capacity);
+        if (dirs == NULL)
+            return -1;
+        idx->dirs = dirs;
+        idx->dir_capacity = capacity;
+    }
+
+    if (idx->paths_used + len + 1 > idx->paths_capacity) {
+        uint32_t capacity = idx->paths_capacity > 0 ? idx->paths_capacity : 16384;
+        while (idx->paths_used + len + 1 > capacity)
+            capacity *= 2;
+        char* paths = (char*)realloc(idx->paths, capacity);
+        if (paths == NULL)
+            return -1;
+        idx->paths = paths;
+        idx->paths_capacity = capacity;
+    }
+
+    IndexDir* dir = &idx->dirs[idx->dir_count];
+    dir->path_offset = idx->paths_used;
+    dir->path_len = (uint16_t)len;
+    dir->mtime = mtime;
+    dir->first = (uint32_t)fs_dir_count(idx->entries);
+    dir->count = 0;
+    memcpy(idx->paths + idx->paths_used, path, len);
+    idx->paths[idx->paths_used + len] = '\0';
+    idx->paths_used += (uint32_t)len + 1;
+    return idx->dir_count++;
+}
+
+static int index_add_entry(FileIndex* idx, int d, const char* name, int is_dir, uint64_t size)
+{
+    if (fs_dir_append(idx->entries, name, is_dir, size) != 0)
+        return -1;
+    idx->dirs[d].count = (uint32_t)fs_dir_count(idx->entries) - idx->dirs[d].first;
+    return 0;
+}
+
+static uint32_t index_hash(const char* path, size_t len)
+{
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (uint8_t)path[i]) * 16777619u;
+    return h;
+}
+
+// Build the path lookup table once all folders are added
+static int index_build_lookup(FileIndex* idx)
+{
+    uint32_t size = 64;
+    while (size < (uint32_t)idx->dir_count * 2)
+        size *= 2;
+
+    free(idx->buckets);
+    idx->buckets = (int32_t*)malloc(sizeof(int32_t) * size);
+    if (idx->buckets == NULL)
+        return -1;
+    memset(idx->buckets, 0xFF, sizeof(int32_t) * size);
+    idx->bucket_mask = size - 1;
+
+    for (int d = 0; d < idx->dir_count; d++) {
+        uint32_t b = index_hash(index_dir_path(idx, d), idx->dirs[d].path_len) & idx->bucket_mask;
+        while (idx->buckets[b] >= 0)
+            b = (b + 1) & idx->bucket_mask;
+        idx->buckets[b] = d;
+    }
+    return 0;
+}
+
+static int index_find_dir(const FileIndex* idx, const char* path, size_t len)
+{
+    if (idx == NULL || idx->buckets == NULL)
+        return -1;
+
+    uint32_t b = index_hash(path, len) & idx->bucket_mask;
+    while (idx->buckets[b] >= 0) {
+        int d = idx->buckets[b];
+        if (idx->dirs[d].path_len == len && memcmp(index_dir_path(idx, d), path, len) == 0)
+            return d;
+        b = (b + 1) & idx->bucket_mask;
+    }
+    return -1;
+}
+
+static int index_join(const char* dir, const char* name, char* out, size_t outlen)
+{
+    int n = (dir[0] == '/' && dir[1] == '\0') ?
+            snprintf(out, outlen, "/%s", name) : snprintf(out, outlen, "%s/%s", dir, name);
+    return (n > 0 && (size_t)n < outlen) ? 0 : -1;
+}
+
+/**
+ * Index file
+ */
+
+typedef struct {
+    uint8_t* data;
+    size_t used;
+    size_t capacity;
+    int failed;
+} IndexBuffer;
+
+static void index_put_bytes(IndexBuffer* buf, const void* bytes, size_t len)
+{
+    if (buf->failed)
+        return;
+
+    if (buf->used + len > buf->capacity) {
+        size_t capacity = buf->capacity > 0 ? buf->capacity : 65536;
+        while (buf->used + len > capacity)
+            capacity *= 2;
+        uint8_t* data = (uint8_t*)realloc(buf->data, capacity);
+        if (data == NULL) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->used, bytes, len);
+    buf->used += len;
+}
+
+static void index_put_varint(IndexBuffer* buf, uint64_t v)
+{
+    uint8_t bytes[10];
+    size_t n = 0;
+    do {
+        bytes[n] = (uint8_t)(v & 0x7F);
+        v >>= 7;
+        if (v != 0)
+            bytes[n] |= 0x80;
+        n++;
+    } while (v != 0);
+    index_put_bytes(buf, bytes, n);
+}
+
+static size_t index_shared_prefix(const char* a, size_t alen, const char* b, size_t blen)
+{
+    size_t n = 0;
+    while (n < alen && n < blen && a[n] == b[n])
+        n++;
+    return n;
+}
+
+// Append 'str' front-coded against 'prev'
+static void index_put_string(IndexBuffer* buf, const char* prev, size_t prev_len,
+                             const char* str, size_t len)
+{
+    size_t shared = index_shared_prefix(prev, prev_len, str, len);
+    index_put_varint(buf, shared);
+    index_put_varint(buf, len - shared);
+    index_put_bytes(buf, str + shared, len - shared);
+}
+
+static int index_save(const FileIndex* idx, const char* file)
+{
+    IndexBuffer buf = {NULL, 0, 0, 0};
+    index_put_bytes(&buf, INDEX_MAGIC, 8);
+    index_put_varint(&buf, INDEX_VERSION);
+    index_put_varint(&buf, (uint64_t)idx->dir_count);
+    index_put_varint(&buf, (uint64_t)fs_dir_count(idx->entries));
+
+    const char* prev_path = "";
+    size_t prev_path_len = 0;
+    for (int d = 0; d < idx->dir_count; d++) {
+        const IndexDir* dir = &idx->dirs[d];
+        const char* path = index_dir_path(idx, d);
+        index_put_string(&buf, prev_path, prev_path_len, path, dir->path_len);
+        index_put_varint(&buf, dir->mtime);
+        index_put_varint(&buf, dir->count);
+        prev_path = path;
+        prev_path_len = dir->path_len;
+
+        const char* prev_name = "";
+        size_t prev_name_len = 0;
+        for (uint32_t i = dir->first; i < dir->first + dir->count; i++) {
+            const char* name = fs_dir_name(idx->entries, (int)i);
+            size_t len = (size_t)fs_dir_name_length(idx->entries, (int)i);
+            index_put_varint(&buf, (fs_dir_size(idx->entries, (int)i) << 1) |
+                                   (uint64_t)(fs_dir_is_dir(idx->entries, (int)i) ? 1 : 0));
+            index_put_string(&buf, prev_name, prev_name_len, name, len);
+            prev_name = name;
+            prev_name_len = len;
+        }
+    }
+
+    if (buf.failed) {
+        free(buf.data);
+        return -1;
+    }
+
+    // Write a temporary file and rename it over the old index, so an
+    // interrupted save never leaves a truncated index behind
+    char dir[FS_MAX_PATH];
+    if (path_get_parent(file, dir) == 0)
+        mkdir(dir, 0777);
+
+    char tmp[FS_MAX_PATH + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL) {
+        free(buf.data);
+        return -1;
+    }
+    int ok = fwrite(buf.data, 1, buf.used, f) == buf.used;
+    ok = (fclose(f) == 0) && ok;
+    if (ok) {
+        remove(file);
+        ok = rename(tmp, file) == 0;
+    }
+    if (!ok)
+        remove(tmp);
+    else
+        g_file_bytes = buf.used;
+
+    free(buf.data);
+    return ok ? 0 : -1;
+}
+
+typedef struct {
+    const uint8_t* data;
+    size_t used;
+    size_t size;
+    int failed;
+} IndexReader;
+
+static uint64_t index_get_varint(IndexReader* rd)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (rd->used >= rd->size) {
+            rd->failed = 1;
+            return 0;
+        }
+        uint8_t b = rd->data[rd->used++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return v;
+    }
+    rd->failed = 1;
+    return 0;
+}
+
+// Decode a front-coded string into 'str' (holding the previous one)
+static int index_get_string(IndexReader* rd, char* str, size_t* len, size_t max)
+{
+    uint64_t shared = index_get_varint(rd);
+    uint64_t suffix = index_get_varint(rd);
+    if (rd->failed || shared > *len || shared + suffix >= max || suffix > rd->size - rd->used) {
+        rd->failed = 1;
+        return -1;
+    }
+    memcpy(str + shared, rd->data + rd->used, (size_t)suffix);
+    rd->used += (size_t)suffix;
+    *len = (size_t)(shared + suffix);
+    str[*len] = '\0';
+    return 0;
+}
+
+static FileIndex* index_load(const char* file)
+{
+    FILE* f = fopen(file, "rb");
+    if (f == NULL)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 8) {
+        fclose(f);
+        return NULL;
+    }
+
+    uint8_t* data = (uint8_t*)malloc((size_t)size);
+    if (data == NULL || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+
+    IndexReader rd = {data, 8, (size_t)size, 0};
+    FileIndex* idx = NULL;
+    if (memcmp(data, INDEX_MAGIC, 8) != 0 || index_get_varint(&rd) != INDEX_VERSION)
+        goto fail;
+
+    uint64_t dir_count = index_get_varint(&rd);
+    uint64_t entry_count = index_get_varint(&rd);
+    if (rd.failed || dir_count > (uint64_t)size || entry_count > (uint64_t)size)
+        goto fail;
+
+    idx = index_create();
+    if (idx == NULL)
+        goto fail;
+
+    char path[FS_MAX_PATH];
+    char name[FS_MAX_PATH];
+    size_t path_len = 0;
+    path[0] = '\0';
+    for (uint64_t d = 0; d < dir_count; d++) {
+        if (index_get_string(&rd, path, &path_len, sizeof(path)) != 0)
+            goto fail;
+        uint64_t mtime = index_get_varint(&rd);
+        uint64_t count = index_get_varint(&rd);
+        if (rd.failed || count > entry_count)
+            goto fail;
+
+        int dir = index_add_dir(idx, path, path_len, mtime);
+        if (dir < 0)
+            goto fail;
+
+        size_t name_len = 0;
+        name[0] = '\0';
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t packed = index_get_varint(&rd);
+            if (index_get_string(&rd, name, &name_len, sizeof(name)) != 0 ||
+                index_add_entry(idx, dir, name, (int)(packed & 1), packed >> 1) != 0)
+                goto fail;
+        }
+    }
+
+    if ((uint64_t)fs_dir_count(idx->entries) != entry_count || index_build_lookup(idx) != 0)
+        goto fail;
+
+    g_file_bytes = (uint64_t)size;
+    free(data);
+    return idx;
+
+fail:
+    // A damaged or outdated index is simply rebuilt
+    index_destroy(idx);
+    free(data);
+    return NULL;
+}
+
+/**
+ * Scanning
+ */
+
+// Walk everything below 'root', reusing folders of 'old' (may be NULL)
+// whose timestamp is unchanged. Returns the new index, NULL on failure
+// or cancellation.
+static FileIndex* index_scan(const FileIndex* old, const char* root)
+{
+    FileIndex* idx = index_create();
+    if (idx == NULL)
+        return NULL;
+
+    // Folders still to visit, as a stack of NUL-terminated paths
+    char* stack = NULL;
+    size_t stack_used = 0;
+    size_t stack_capacity = 0;
+    int ok = 1;
+
+    SortOptions by_name;
+    by_name.mode = SORT_NAME;
+    by_name.dirs_first = 0;
+    by_name.max_threads = 1;
+
+    char path[FS_MAX_PATH];
+    char child[FS_MAX_PATH];
+    str_copy(path, root, sizeof(path));
+    size_t len = strlen(path);
+
+    while (ok) {
+        if (atomic_load(&g_cancel)) {
+            ok = 0;
+            break;
+        }
+
+        // A folder whose timestamp is unchanged is copied from the old index
+        uint64_t mtime = 0;
+        fs_get_mtime(path, &mtime);
+        int prev = (mtime != 0) ? index_find_dir(old, path, len) : -1;
+        int d = -1;
+
+        if (prev >= 0 && old->dirs[prev].mtime == mtime) {
+            d = index_add_dir(idx, path, len, mtime);
+            const IndexDir* src = &old->dirs[prev];
+            for (uint32_t i = src->first; d >= 0 && i < src->first + src->count; i++) {
+                if (index_add_entry(idx, d, fs_dir_name(old->entries, (int)i),
+                                    fs_dir_is_dir(old->entries, (int)i),
+                                    fs_dir_size(old->entries, (int)i)) != 0)
+                    d = -1;
+            }
+            ok = (d >= 0);
+            g_dirs_reused++;
+        } else {
+            FsDirectory* listing = fs_list_directory(path);
+            if (listing != NULL) {
+                sort_directory(listing, &by_name);
+                d = index_add_dir(idx, path, len, mtime);
+                for (int i = 0; d >= 0 && i < fs_dir_count(listing); i++) {
+                    if (index_add_entry(idx, d, fs_dir_name(listing, i), fs_dir_is_dir(listing, i),
+                                        fs_dir_size(listing, i)) != 0)
+                        d = -1;
+                }
+                fs_free_directory(listing);
+                ok = (d >= 0);
+            }
+            // An unreadable folder is left out of the index
+            g_dirs_listed++;
+        }
+
+        // Push subfolders in reverse so they are visited in name order
+        if (ok && d >= 0) {
+            const IndexDir* dir = &idx->dirs[d];
+            for (int i = (int)(dir->first + dir->count) - 1; i >= (int)dir->first; i--) {
+                if (!fs_dir_is_dir(idx->entries, i) ||
+                    index_join(path, fs_dir_name(idx->entries, i), child, sizeof(child)) != 0)
+                    continue;
+
+                size_t child_len = strlen(child) + 1;
+                if (stack_used + child_len > stack_capacity) {
+                    size_t capacity = stack_capacity > 0 ? stack_capacity * 2 : 8192;
+                    while (stack_used + child_len > capacity)
+                        capacity *= 2;
+                    char* grown = (char*)realloc(stack, capacity);
+                    if (grown == NULL) {
+                        ok = 0;
+                        break;
+                    }
+                    stack = grown;
+                    stack_capacity = capacity;
+                }
+                memcpy(stack + stack_used, child, child_len);
+                stack_used += child_len;
+            }
+        }
+
+        if (stack_used == 0)
+            break;
+
+        // Pop the most recently pushed path
+        size_t end = stack_used - 1;
+        size_t begin = end;
+        while (begin > 0 && stack[begin - 1] != '\0')
+            begin--;
+        memcpy(path, stack + begin, end - begin + 1);
+        len = end - begin;
+        stack_used = begin;
+    }
+
+    free(stack);
+    if (!ok || index_build_lookup(idx) != 0) {
+        index_destroy(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+static void* index_worker(void* arg)
+{
+    (void)arg;
+
+    // The saved index is only needed by the first scan; after that the
+    // in-memory index is always at least as fresh
+    if (!g_loaded) {
+        FileIndex* saved = index_load(g_file);
+        pthread_mutex_lock(&g_lock);
+        if (g_index == NULL)
+            g_index = saved;
+        else
+            index_destroy(saved);
+        g_loaded = 1;
+        pthread_mutex_unlock(&g_lock);
+    }
+
+    // Only this thread replaces g_index, so it can be read without the lock
+    FileIndex* old = g_index;
+    FileIndex* built = index_scan(old, g_root);
+
+    if (built == NULL) {
+        g_scan_ns = fs_now_ns() - g_scan_start_ns;
+        atomic_store(&g_state, INDEX_STATE_ERROR);
+        return NULL;
+    }
+
+    index_save(built, g_file);
+
+    pthread_mutex_lock(&g_lock);
+    g_index = built;
+    pthread_mutex_unlock(&g_lock);
+    index_destroy(old);
+
+    g_scan_ns = fs_now_ns() - g_scan_start_ns;
+    atomic_store(&g_state, INDEX_STATE_READY);
+    return NULL;
+}
+
+void index_init(const char* index_file)
+{
+    str_copy(g_file, index_file != NULL ? index_file : INDEX_DEFAULT_FILE, sizeof(g_file));
+}
+
+int index_start_scan(const char* root)
+{
+    if (atomic_load(&g_state) == INDEX_STATE_SCANNING)
+        return -1;
+
+    // Reap the previous (finished) worker
+    if (g_thread_running) {
+        pthread_join(g_thread, NULL);
+        g_thread_running = 0;
+    }
+
+    path_canonicalize(root != NULL ? root : "/", g_root, sizeof(g_root));
+    atomic_store(&g_cancel, 0);
+    g_dirs_listed = 0;
+    g_dirs_reused = 0;
+    g_scan_ns = 0;
+    g_scan_start_ns = fs_now_ns();
+    atomic_store(&g_state, INDEX_STATE_SCANNING);
+
+    if (pthread_create(&g_thread, NULL, index_worker, NULL) != 0) {
+        atomic_store(&g_state, INDEX_STATE_ERROR);
+        return -1;
+    }
+    g_thread_running = 1;
+    return 0;
+}
+
+void index_cancel_scan(void)
+{
+    if (!g_thread_running)
+        return;
+
+    atomic_store(&g_cancel, 1);
+    pthread_join(g_thread, NULL);
+    g_thread_running = 0;
+}
+
+int index_search(const char* query, IndexMatch match, int max_results, FsDirectory* out)
+{
+    if (query == NULL || out == NULL || max_results <= 0)
+        return -1;
+
+    char folded[FILTER_MAX_QUERY];
+    int qlen = 0;
+    for (; query[qlen] != '\0' && qlen < FILTER_MAX_QUERY - 1; qlen++) {
+        char c = query[qlen];
+        folded[qlen] = (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+    folded[qlen] = '\0';
+    if (qlen == 0)
+        return 0;
+
+    pthread_mutex_lock(&g_lock);
+    const FileIndex* idx = g_index;
+    int found = 0;
+    int d = 0;
+    char path[FS_MAX_PATH];
+
+    int count = idx != NULL ? fs_dir_count(idx->entries) : 0;
+    for (int i = 0; i < count && found < max_results; i++) {
+        const char* name = idx->entries->names + idx->entries->name_offsets[i];
+        int len = idx->entries->name_lengths[i];
+        if (len < qlen)
+            continue;
+
+        int hit;
+        if (match == INDEX_MATCH_PREFIX)
+            hit = filter_find_ci(name, qlen, folded, qlen) == 0;
+        else
+            hit = filter_find_ci(name, len, folded, qlen) >= 0;
+        if (!hit)
+            continue;
+
+        // Entries are grouped by folder in folder order
+        while (d + 1 < idx->dir_count && idx->dirs[d + 1].first <= (uint32_t)i)
+            d++;
+        if (index_join(index_dir_path(idx, d), name, path, sizeof(path)) != 0)
+            continue;
+        if (fs_dir_append(out, path, fs_dir_is_dir(idx->entries, i),
+                          fs_dir_size(idx->entries, i)) != 0) {
+            found = -1;
+            break;
+        }
+        found++;
+    }
+
+    pthread_mutex_unlock(&g_lock);
+    return found;
+}
+
+/**
+ * Largest items
+ *
+ * Folder totals are summed bottom-up: folders are stored in walk order,
+ * so every folder comes after its parent and a reverse pass sees all
+ * children before their parent. The N largest items are kept in a
+ * min-heap whose root is the smallest item still in the running.
+ */
+
+typedef struct {
+    uint64_t size;
+    int32_t dir;                 // Owning folder (or the folder itself)
+    int32_t entry;               // Entry index, -1 for the folder itself
+} IndexItem;
+
+static void index_heap_sift_down(IndexItem* heap, int n, int i)
+{
+    while (1) {
+        int smallest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < n && heap[l].size < heap[smallest].size) smallest = l;
+        if (r < n && heap[r].size < heap[smallest].size) smallest = r;
+        if (smallest == i)
+            return;
+        IndexItem tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void index_heap_offer(IndexItem* heap, int* n, int max, IndexItem item)
+{
+    if (*n < max) {
+        // Sift up
+        int i = (*n)++;
+        heap[i] = item;
+        while (i > 0 && heap[(i - 1) / 2].size > heap[i].size) {
+            IndexItem tmp = heap[i];
+            heap[i] = heap[(i - 1) / 2];
+            heap[(i - 1) / 2] = tmp;
+            i = (i - 1) / 2;
+        }
+    } else if (item.size > heap[0].size) {
+        heap[0] = item;
+        index_heap_sift_down(heap, *n, 0);
+    }
+}
+
+int index_largest(int count, FsDirectory* out)
+{
+    if (count <= 0 || out == NULL)
+        return -1;
+
+    pthread_mutex_lock(&g_lock);
+    const FileIndex* idx = g_index;
+    if (idx == NULL || idx->dir_count == 0) {
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+
+    uint64_t* totals = (uint64_t*)calloc((size_t)idx->dir_count, sizeof(uint64_t));
+    IndexItem* heap = (IndexItem*)malloc(sizeof(IndexItem) * count);
+    if (totals == NULL || heap == NULL) {
+        pthread_mutex_unlock(&g_lock);
+        free(totals);
+        free(heap);
+        return -1;
+    }
+
+    int n = 0;
+    char parent[FS_MAX_PATH];
+    for (int d = idx->dir_count - 1; d >= 0; d--) {
+        const IndexDir* dir = &idx->dirs[d];
+        for (uint32_t i = dir->first; i < dir->first + dir->count; i++) {
+            if (fs_dir_is_dir(idx->entries, (int)i))
+                continue;
+            uint64_t size = fs_dir_size(idx->entries, (int)i);
+            totals[d] += size;
+            IndexItem item = {size, d, (int32_t)i};
+            index_heap_offer(heap, &n, count, item);
+        }
+
+        if (d == 0)
+            continue;  // The root itself is not an item
+        IndexItem item = {totals[d], d, -1};
+        index_heap_offer(heap, &n, count, item);
+
+        // Carry the total up to the parent folder
+        const char* path = index_dir_path(idx, d);
+        const char* slash = strrchr(path, '/');
+        size_t len = (slash == NULL || slash == path) ? 1 : (size_t)(slash - path);
+        memcpy(parent, path, len);
+        parent[len] = '\0';
+        int p = index_find_dir(idx, parent, len);
+        if (p >= 0 && p != d)
+            totals[p] += totals[d];
+    }
+
+    // Heap-sort: moving each root (the smallest) to the back leaves the
+    // items largest first
+    for (int k = n - 1; k > 0; k--) {
+        IndexItem tmp = heap[0];
+        heap[0] = heap[k];
+        heap[k] = tmp;
+        index_heap_sift_down(heap, k, 0);
+    }
+
+    int found = n;
+    char path[FS_MAX_PATH];
+    for (int k = 0; k < n; k++) {
+        const IndexItem* item = &heap[k];
+        int rc;
+        if (item->entry < 0) {
+            rc = fs_dir_append(out, index_dir_path(idx, item->dir), 1, 0);
+            if (rc == 0)
+                fs_dir_set_size(out, fs_dir_count(out) - 1, item->size);
+        } else if (index_join(index_dir_path(idx, item->dir),
+                              fs_dir_name(idx->entries, item->entry), path, sizeof(path)) == 0) {
+            rc = fs_dir_append(out, path, 0, item->size);
+        } else {
+            continue;
+        }
+        if (rc != 0) {
+            found = -1;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&g_lock);
+    free(totals);
+    free(heap);
+    return found;
+}
+
+void index_get_stats(IndexStats* out)
+{
+    if (out == NULL)
+        return;
+
+    memset(out, 0, sizeof(*out));
+    out->state = atomic_load(&g_state);
+    out->dirs_listed = g_dirs_listed;
+    out->dirs_reused = g_dirs_reused;
+    out->file_bytes = g_file_bytes;
+    out->elapsed_ns = (out->state == INDEX_STATE_SCANNING) ?
+                      fs_now_ns() - g_scan_start_ns : g_scan_ns;
+
+    pthread_mutex_lock(&g_lock);
+    if (g_index != NULL) {
+        out->dirs = (uint64_t)g_index->dir_count;
+        out->entries = (uint64_t)fs_dir_count(g_index->entries);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void index_cleanup(void)
+{
+    index_cancel_scan();
+
+    pthread_mutex_lock(&g_lock);
+    index_destroy(g_index);
+    g_index = NULL;
+    g_loaded = 0;
+    pthread_mutex_unlock(&g_lock);
+    atomic_store(&g_state, INDEX_STATE_IDLE);
+}
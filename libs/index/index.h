@@ -0,0 +1,109 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include "fs.h"
+
+/**
+ * File index module
+ *
+ * Whole-card index of every file and folder name, used for global search.
+ * A background worker walks the card once and saves a compact index file
+ * (directory paths and entry names front-coded, integers as varints, plus
+ * each folder's modification time). Later scans start from the saved
+ * index and only re-list folders whose timestamp changed; unchanged
+ * folders are copied over without opening them.
+ *
+ * A folder's timestamp changes when entries are added, removed or
+ * renamed in it, not when a file's contents change, so sizes of files
+ * rewritten in place may be stale until their folder changes.
+ *
+ * Searches run against the last completed index while a rescan is in
+ * progress.
+ */
+
+/* Where the index is kept between runs */
+#define INDEX_DEFAULT_FILE "/switch/DBFM/index.bin"
+
+/* Most results returned by one search */
+#define INDEX_MAX_RESULTS 500
+
+/* Scan states (IndexStats.state) */
+#define INDEX_STATE_IDLE     0  // No scan has run yet
+#define INDEX_STATE_SCANNING 1  // Worker is walking the card
+#define INDEX_STATE_READY    2  // Last scan completed
+#define INDEX_STATE_ERROR    3  // Last scan failed or was cancelled
+
+/**
+ * IndexMatch - How a search query is compared with names
+ */
+typedef enum {
+    INDEX_MATCH_PREFIX,      // Name starts with the query
+    INDEX_MATCH_SUBSTRING    // Name contains the query
+} IndexMatch;
+
+/**
+ * IndexStats - Index contents and progress of the last scan
+ */
+typedef struct {
+    int state;               // INDEX_STATE_*
+    uint64_t dirs;           // Folders in the searchable index
+    uint64_t entries;        // Files and folders in the searchable index
+    uint64_t dirs_listed;    // Last scan: folders read from the card
+    uint64_t dirs_reused;    // Last scan: folders unchanged since the saved index
+    uint64_t file_bytes;     // Size of the saved index file
+    uint64_t elapsed_ns;     // Duration of the last (or running) scan
+} IndexStats;
+
+/**
+ * index_init(index_file)
+ * Set the file the index is loaded from and saved to (NULL selects
+ * INDEX_DEFAULT_FILE). Does no I/O; the file is read by the first scan.
+ */
+void index_init(const char* index_file);
+
+/**
+ * index_start_scan(root)
+ * Start a background scan of everything below 'root' ("/" for the whole
+ * card). The saved index is loaded first if this is the first scan.
+ * Returns 0 if started, -1 if a scan is already running or no worker
+ * thread could be created.
+ */
+int index_start_scan(const char* root);
+
+/**
+ * index_cancel_scan()
+ * Stop a running scan and wait for it. The previous index stays in use.
+ */
+void index_cancel_scan(void);
+
+/**
+ * index_search(query, match, max_results, out)
+ * Append the full paths of up to 'max_results' indexed entries whose
+ * name matches 'query' (case-insensitive) to 'out', with their size and
+ * folder flag. Results are in path order.
+ * Returns the number of results, or -1 on failure.
+ */
+int index_search(const char* query, IndexMatch match, int max_results, FsDirectory* out);
+
+/**
+ * index_largest(count, out)
+ * Append the 'count' largest files and folders on the card to 'out',
+ * largest first, as full paths. Folder sizes are the totals of everything
+ * below them (marked with fs_dir_set_size()).
+ * Returns the number of results, or -1 on failure.
+ */
+int index_largest(int count, FsDirectory* out);
+
+/**
+ * index_get_stats(out)
+ * Copy the current counters into 'out'.
+ */
+void index_get_stats(IndexStats* out);
+
+/**
+ * index_cleanup()
+ * Cancel any scan and free the in-memory index.
+ */
+void index_cleanup(void);
+
+#endif
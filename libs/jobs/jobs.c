@@ -0,0 +1,573 @@
+#include "jobs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../utils/utils.h"
+#include "../copy/copy.h"
+#include "../move/move.h"
+#include "../delete/delete.h"
+#include "../rename/rename.h"
+#include "../hash/hash.h"
+#include "../sync/sync.h"
+#include "../trash/trash.h"
+
+/**
+ * Background jobs implementation
+ *
+ * Jobs live in a fixed table of slots guarded by one lock; ids grow with
+ * every submission, so the lowest id is the oldest job. Workers sleep on
+ * a condition that is signalled whenever a job is queued, resumed or
+ * finishes (a finished job may unblock one that overlapped it). The
+ * engines run without the lock; pause and cancel go straight to the
+ * job's Progress, which the engines poll.
+ */
+
+typedef struct {
+    int used;
+    uint32_t id;
+    JobType type;
+    JobState state;
+    int rc;
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    char target[FS_MAX_PATH];
+    char result[JOBS_RESULT_MAX];
+    FsDirectory* items;          // Paths of a batch job (NULL for one item)
+    int move_from;               // Items from here on are moved (JOB_PASTE)
+    Progress progress;
+} JobSlot;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t g_threads[JOBS_MAX_WORKERS];
+static int g_thread_count = 0;
+static atomic_int g_quit = 0;
+
+static JobSlot g_slots[JOBS_MAX];
+static uint32_t g_next_id = 1;
+
+static int jobs_finished(JobState state)
+{
+    return state == JOB_DONE || state == JOB_FAILED || state == JOB_CANCELLED;
+}
+
+// 1 if either path is the other or lies below it ("" never overlaps)
+static int jobs_paths_overlap(const char* a, const char* b)
+{
+    if (a[0] == '\0' || b[0] == '\0')
+        return 0;
+    return path_is_within(a, b) || path_is_within(b, a);
+}
+
+// 1 if 'job' works on a tree that job 'other' also works on
+static int jobs_conflict(const JobSlot* job, const JobSlot* other)
+{
+    return jobs_paths_overlap(job->src, other->src) ||
+           jobs_paths_overlap(job->src, other->target) ||
+           jobs_paths_overlap(job->target, other->src) ||
+           jobs_paths_overlap(job->target, other->target);
+}
+
+// Oldest queued job that is not paused and overlaps no running job or
+// unfinished older one, so jobs on the same tree run in order (lock held)
+static JobSlot* jobs_pick(void)
+{
+    JobSlot* best = NULL;
+    for (int i = 0; i < JOBS_MAX; i++) {
+        JobSlot* job = &g_slots[i];
+        if (!job->used || job->state != JOB_QUEUED || atomic_load(&job->progress.paused))
+            continue;
+        if (best != NULL && job->id > best->id)
+            continue;
+
+        int blocked = 0;
+        for (int j = 0; j < JOBS_MAX && !blocked; j++) {
+            const JobSlot* other = &g_slots[j];
+            blocked = other->used && other != job && !jobs_finished(other->state) &&
+                      (other->state == JOB_RUNNING || other->id < job->id) &&
+                      jobs_conflict(job, other);
+        }
+        if (!blocked)
+            best = job;
+    }
+    return best;
+}
+
+// Slot of job 'id' (lock held), or NULL
+static JobSlot* jobs_find(uint32_t id)
+{
+    for (int i = 0; i < JOBS_MAX; i++) {
+        if (g_slots[i].used && g_slots[i].id == id)
+            return &g_slots[i];
+    }
+    return NULL;
+}
+
+// Hash 'src' with every algorithm and write the digests to the result
+static int jobs_hash(JobSlot* job)
+{
+    HashDigest digests[HASH_ALGO_COUNT];
+    int rc = hash_file(job->src, HASH_ALL, digests, &job->progress, NULL);
+    if (rc != 0)
+        return rc;
+
+    int len = 0;
+    for (int a = HASH_CRC32; a < HASH_ALGO_COUNT; a++) {
+        char hex[2 * HASH_MAX_DIGEST + 1];
+        hash_to_hex(&digests[a], hex, sizeof(hex));
+        len += snprintf(job->result + len, sizeof(job->result) - len, "%s%-7s %s",
+                        len > 0 ? "\n" : "", hash_name((HashAlgo)a), hex);
+        if (len >= (int)sizeof(job->result))
+            break;
+    }
+    return 0;
+}
+
+// Contents are compared when copies are verified, timestamps otherwise
+static SyncCompare jobs_sync_compare(void)
+{
+    return copy_get_verify() != HASH_NONE ? SYNC_COMPARE_CONTENT : SYNC_COMPARE_METADATA;
+}
+
+// Plan the sync and keep the plan for the JOB_SYNC that follows review
+static int jobs_compare(JobSlot* job)
+{
+    SyncPlan* plan = sync_plan_build(job->src, job->dest, jobs_sync_compare(), &job->progress);
+    if (plan == NULL)
+        return -1;
+
+    SyncSummary summary;
+    sync_plan_summary(plan, &summary);
+    sync_format_summary(&summary, job->result, sizeof(job->result));
+    sync_plan_keep(plan);
+    return 0;
+}
+
+// Carry out the reviewed plan, or compare afresh if there is none
+static int jobs_sync(JobSlot* job)
+{
+    SyncPlan* plan = sync_plan_take(job->src, job->dest);
+    if (plan == NULL)
+        plan = sync_plan_build(job->src, job->dest, jobs_sync_compare(), &job->progress);
+    if (plan == NULL)
+        return -1;
+
+    SyncSummary summary;
+    sync_plan_summary(plan, &summary);
+    sync_format_summary(&summary, job->result, sizeof(job->result));
+    int rc = sync_plan_execute(plan, &job->progress);
+    sync_plan_free(plan);
+    return rc;
+}
+
+// Run a batch job with one engine call over all its paths
+static int jobs_run_batch(JobSlot* job)
+{
+    int count = fs_dir_count(job->items);
+    const char** paths = (const char**)malloc(sizeof(*paths) * count);
+    if (paths == NULL)
+        return -1;
+    for (int i = 0; i < count; i++)
+        paths[i] = fs_dir_name(job->items, i);
+
+    int rc = -1;
+    switch (job->type) {
+        case JOB_COPY:
+            rc = copy_batch(paths, count, job->dest, &job->progress);
+            break;
+        case JOB_MOVE:
+            rc = move_batch(paths, count, job->dest, &job->progress);
+            break;
+        case JOB_PASTE: {
+            // Copies first: a copied item may lie inside a folder being moved
+            rc = copy_batch(paths, job->move_from, job->dest, &job->progress);
+            if (rc == COPY_CANCELLED)
+                break;
+            int moved = move_batch(paths + job->move_from, count - job->move_from, job->dest,
+                                   &job->progress);
+            if (rc == 0)
+                rc = moved;
+            break;
+        }
+        case JOB_DELETE: {
+            // One undo for the whole batch where the items share a folder,
+            // else one per item; what cannot go to the trash is deleted
+            if (trash_move_batch(paths, count) == 0) {
+                rc = 0;
+                break;
+            }
+            int left = 0;
+            for (int i = 0; i < count; i++) {
+                if (trash_move(paths[i]) != 0)
+                    paths[left++] = paths[i];
+            }
+            rc = left > 0 ? delete_batch(paths, left, &job->progress) : 0;
+            break;
+        }
+        default:
+            break;
+    }
+    free(paths);
+    return rc;
+}
+
+static int jobs_run(JobSlot* job)
+{
+    if (job->items != NULL)
+        return jobs_run_batch(job);
+
+    switch (job->type) {
+        case JOB_COPY:
+            return copy_item(job->src, job->dest, &job->progress);
+        case JOB_MOVE:
+            return move_file(job->src, job->dest, &job->progress);
+        case JOB_DELETE:
+            // One rename now; the purge follows once it can no longer be undone
+            if (trash_move(job->src) == 0)
+                return 0;
+            return delete_item(job->src, &job->progress);
+        case JOB_RENAME:
+            return rename_item(job->src, job->dest);
+        case JOB_RESUME:
+            return copy_resume(job->dest, &job->progress);
+        case JOB_HASH:
+            return jobs_hash(job);
+        case JOB_COMPARE:
+            return jobs_compare(job);
+        case JOB_SYNC:
+            return jobs_sync(job);
+        case JOB_PURGE:
+            return delete_item(job->src, &job->progress);
+        case JOB_PASTE:
+            break;  // Always a batch
+    }
+    return -1;
+}
+
+static void* jobs_worker(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_lock);
+    while (1) {
+        JobSlot* job = NULL;
+        while (!atomic_load(&g_quit) && (job = jobs_pick()) == NULL)
+            pthread_cond_wait(&g_wake, &g_lock);
+        if (atomic_load(&g_quit))
+            break;
+
+        job->state = JOB_RUNNING;
+        progress_reset(&job->progress);
+        pthread_mutex_unlock(&g_lock);
+
+        // The slot stays ours: only finished jobs are freed
+        int rc = jobs_run(job);
+        progress_set_phase(&job->progress, PROGRESS_DONE);
+
+        pthread_mutex_lock(&g_lock);
+        job->rc = rc;
+        if (rc == 0)
+            job->state = JOB_DONE;
+        else if (rc == COPY_CANCELLED || atomic_load(&job->progress.cancel))
+            job->state = JOB_CANCELLED;
+        else
+            job->state = JOB_FAILED;
+        pthread_cond_broadcast(&g_wake);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+int jobs_init(int workers)
+{
+    if (g_thread_count > 0)
+        return 0;
+
+    if (workers <= 0)
+        workers = JOBS_DEFAULT_WORKERS;
+    if (workers > JOBS_MAX_WORKERS)
+        workers = JOBS_MAX_WORKERS;
+
+    atomic_store(&g_quit, 0);
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&g_threads[g_thread_count], NULL, jobs_worker, NULL) != 0)
+            break;
+        g_thread_count++;
+    }
+    return g_thread_count > 0 ? 0 : -1;
+}
+
+void jobs_cleanup(void)
+{
+    pthread_mutex_lock(&g_lock);
+    atomic_store(&g_quit, 1);
+    for (int i = 0; i < JOBS_MAX; i++) {
+        if (g_slots[i].used)
+            progress_cancel(&g_slots[i].progress);
+    }
+    pthread_cond_broadcast(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+
+    for (int i = 0; i < g_thread_count; i++)
+        pthread_join(g_threads[i], NULL);
+    g_thread_count = 0;
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < JOBS_MAX; i++)
+        fs_free_directory(g_slots[i].items);
+    memset(g_slots, 0, sizeof(g_slots));
+    pthread_mutex_unlock(&g_lock);
+}
+
+// Take a free slot and fill in a new queued job (lock held), or NULL
+static JobSlot* jobs_new(JobType type, const char* src, const char* dest)
+{
+    JobSlot* job = NULL;
+    for (int i = 0; i < JOBS_MAX && job == NULL; i++) {
+        if (!g_slots[i].used)
+            job = &g_slots[i];
+    }
+    if (job == NULL)
+        return NULL;
+
+    memset(job, 0, sizeof(*job));
+    job->used = 1;
+    job->id = g_next_id++;
+    job->type = type;
+    job->state = JOB_QUEUED;
+    job->rc = -1;
+    progress_reset(&job->progress);
+    str_copy(job->src, src, sizeof(job->src));
+    if (dest != NULL)
+        str_copy(job->dest, dest, sizeof(job->dest));
+    return job;
+}
+
+uint32_t jobs_submit(JobType type, const char* src, const char* dest)
+{
+    if (src == NULL || (dest == NULL && type != JOB_DELETE && type != JOB_HASH))
+        return 0;
+
+    pthread_mutex_lock(&g_lock);
+    JobSlot* job = jobs_new(type, src, dest);
+    if (job == NULL) {
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+
+    // Where the job writes: the item's new home, or its new name
+    char parent[512];
+    const char* name = path_get_filename(src);
+    if ((type == JOB_COPY || type == JOB_MOVE) && name != NULL)
+        snprintf(job->target, sizeof(job->target), "%s/%s", dest, name);
+    else if (type == JOB_RENAME && path_get_parent(src, parent) == 0)
+        snprintf(job->target, sizeof(job->target), "%s/%s", parent, dest);
+    else if (type == JOB_RESUME || type == JOB_SYNC)
+        str_copy(job->target, dest, sizeof(job->target));
+
+    uint32_t id = job->id;
+    pthread_cond_signal(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+    return id;
+}
+
+// Deepest folder holding every path of 'items' ("/" at worst)
+static void jobs_common_folder(const FsDirectory* items, char* out)
+{
+    char up[FS_MAX_PATH];
+    if (path_get_parent(fs_dir_name(items, 0), out) != 0)
+        str_copy(out, "/", FS_MAX_PATH);
+    for (int i = 1; i < fs_dir_count(items); i++) {
+        while (!path_is_within(fs_dir_name(items, i), out)) {
+            if (path_get_parent(out, up) != 0) {
+                str_copy(out, "/", FS_MAX_PATH);
+                break;
+            }
+            str_copy(out, up, FS_MAX_PATH);
+        }
+    }
+}
+
+// Append every entry of 'from' (may be NULL) to 'to'
+static int jobs_append_items(FsDirectory* to, const FsDirectory* from)
+{
+    for (int i = 0; i < fs_dir_count(from); i++) {
+        if (fs_dir_append(to, fs_dir_name(from, i), fs_dir_is_dir(from, i),
+                          fs_dir_size(from, i)) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Queue a batch job over the paths of 'first' followed by 'second'
+static uint32_t jobs_queue_batch(JobType type, const FsDirectory* first, const FsDirectory* second,
+                                 const char* dest)
+{
+    FsDirectory* copy = fs_dir_create(fs_dir_count(first) + fs_dir_count(second));
+    if (copy == NULL || jobs_append_items(copy, first) != 0 || jobs_append_items(copy, second) != 0) {
+        fs_free_directory(copy);
+        return 0;
+    }
+
+    // The folder holding every item stands for them in overlap checks
+    char common[FS_MAX_PATH];
+    jobs_common_folder(copy, common);
+
+    pthread_mutex_lock(&g_lock);
+    JobSlot* job = jobs_new(type, common, dest);
+    if (job == NULL) {
+        pthread_mutex_unlock(&g_lock);
+        fs_free_directory(copy);
+        return 0;
+    }
+    job->items = copy;
+    job->move_from = fs_dir_count(first);
+    if (dest != NULL)
+        str_copy(job->target, dest, sizeof(job->target));
+
+    uint32_t id = job->id;
+    pthread_cond_signal(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+    return id;
+}
+
+uint32_t jobs_submit_batch(JobType type, const FsDirectory* items, const char* dest)
+{
+    int count = fs_dir_count(items);
+    if (count <= 0 || (type != JOB_COPY && type != JOB_MOVE && type != JOB_DELETE) ||
+        (dest == NULL && type != JOB_DELETE))
+        return 0;
+    if (count == 1)
+        return jobs_submit(type, fs_dir_name(items, 0), dest);
+    return jobs_queue_batch(type, items, NULL, dest);
+}
+
+uint32_t jobs_submit_paste(const FsDirectory* copies, const FsDirectory* moves, const char* dest)
+{
+    if (fs_dir_count(moves) == 0)
+        return jobs_submit_batch(JOB_COPY, copies, dest);
+    if (fs_dir_count(copies) == 0)
+        return jobs_submit_batch(JOB_MOVE, moves, dest);
+    if (dest == NULL)
+        return 0;
+    return jobs_queue_batch(JOB_PASTE, copies, moves, dest);
+}
+
+int jobs_pause(uint32_t id, int paused)
+{
+    pthread_mutex_lock(&g_lock);
+    JobSlot* job = jobs_find(id);
+    int rc = -1;
+    if (job != NULL && !jobs_finished(job->state)) {
+        progress_pause(&job->progress, paused);
+        rc = 0;
+    }
+    // A resumed queued job may be runnable now
+    pthread_cond_broadcast(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+    return rc;
+}
+
+int jobs_cancel(uint32_t id)
+{
+    pthread_mutex_lock(&g_lock);
+    JobSlot* job = jobs_find(id);
+    int rc = -1;
+    if (job != NULL && !jobs_finished(job->state)) {
+        progress_cancel(&job->progress);
+        if (job->state == JOB_QUEUED) {
+            job->state = JOB_CANCELLED;
+            job->rc = COPY_CANCELLED;
+            progress_set_phase(&job->progress, PROGRESS_DONE);
+        }
+        rc = 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return rc;
+}
+
+// Fill 'out' from 'job' (lock held)
+static void jobs_snapshot(const JobSlot* job, JobInfo* out)
+{
+    out->id = job->id;
+    out->type = job->type;
+    out->state = job->state;
+    out->paused = atomic_load(&job->progress.paused);
+    out->rc = job->rc;
+    out->item_count = job->items != NULL ? fs_dir_count(job->items) : 1;
+    str_copy(out->src, job->src, sizeof(out->src));
+    str_copy(out->dest, job->dest, sizeof(out->dest));
+    str_copy(out->target, job->target, sizeof(out->target));
+    str_copy(out->result, job->result, sizeof(out->result));
+    out->progress = &job->progress;
+
+    ProgressView view;
+    progress_view_init(&view);
+    progress_view(&job->progress, &view);
+    out->done_bytes = view.done_bytes;
+    out->done_files = view.done_files;
+    out->elapsed_ns = view.elapsed_ns;
+}
+
+int jobs_list(JobInfo* out, int max)
+{
+    if (out == NULL || max <= 0)
+        return 0;
+
+    pthread_mutex_lock(&g_lock);
+    int count = 0;
+    uint32_t last = 0;
+    // Oldest first: repeatedly take the lowest id above the last one
+    while (count < max) {
+        const JobSlot* next = NULL;
+        for (int i = 0; i < JOBS_MAX; i++) {
+            const JobSlot* job = &g_slots[i];
+            if (job->used && !jobs_finished(job->state) && job->id > last &&
+                (next == NULL || job->id < next->id))
+                next = job;
+        }
+        if (next == NULL)
+            break;
+        jobs_snapshot(next, &out[count++]);
+        last = next->id;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
+
+int jobs_poll_finished(JobInfo* out, int max)
+{
+    if (out == NULL || max <= 0)
+        return 0;
+
+    pthread_mutex_lock(&g_lock);
+    int count = 0;
+    for (int i = 0; i < JOBS_MAX && count < max; i++) {
+        JobSlot* job = &g_slots[i];
+        if (!job->used || !jobs_finished(job->state))
+            continue;
+        jobs_snapshot(job, &out[count]);
+        out[count].progress = NULL;  // The slot is reused from here on
+        count++;
+        job->used = 0;
+        fs_free_directory(job->items);
+        job->items = NULL;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
+
+int jobs_touches(const JobInfo* info, const char* dir)
+{
+    if (info == NULL || dir == NULL)
+        return 0;
+    // A copy leaves its source as it was, a hash or compare changes nothing
+    if (info->type == JOB_HASH || info->type == JOB_COMPARE)
+        return 0;
+    if (info->type != JOB_COPY && info->type != JOB_RESUME && info->type != JOB_SYNC &&
+        jobs_paths_overlap(info->src, dir))
+        return 1;
+    return jobs_paths_overlap(info->target, dir);
+}
@@ -0,0 +1,154 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "fs.h"
+#include "progress.h"
+
+/**
+ * Background jobs module
+ *
+ * Runs copy, move, delete, rename, hash and sync operations on worker threads so the
+ * UI keeps drawing and browsing while they work. Jobs are queued in the
+ * order they are submitted; a worker takes the oldest queued job whose
+ * paths overlap neither a running job nor an older unfinished one (queued
+ * or paused), so jobs on the same tree run one at a time, in the order
+ * they were submitted.
+ *
+ * Every job owns a Progress that the UI reads for its panel and uses to
+ * pause or cancel the job. Cancelling is cooperative: the engines stop at
+ * their next checkpoint and a cancelled copy removes what it created.
+ *
+ * A batch job works on several items with one engine call: one
+ * filesystem session, destination checks done once and one Progress
+ * whose totals and throughput cover every item.
+ *
+ * Listings are not touched while a job runs. The engines invalidate the
+ * caches for the paths they changed when they finish, and the UI polls
+ * finished jobs to decide whether the folder on screen needs a reload.
+ */
+
+/* Jobs remembered at once, queued, running and unpolled finished ones */
+#define JOBS_MAX             32
+
+/* Default number of worker threads */
+#define JOBS_DEFAULT_WORKERS 2
+
+/* Most worker threads */
+#define JOBS_MAX_WORKERS     4
+
+/* Bytes of a job's result text */
+#define JOBS_RESULT_MAX      160
+
+typedef enum {
+    JOB_COPY = 0,            // Copy 'src' into folder 'dest'
+    JOB_MOVE,                // Move 'src' into folder 'dest'
+    JOB_DELETE,              // Delete 'src' (into the trash where possible)
+    JOB_RENAME,              // Rename 'src' to the name 'dest'
+    JOB_RESUME,              // Finish the journaled copy of 'src' to file 'dest'
+    JOB_HASH,                // Hash file 'src' (result holds the digests)
+    JOB_COMPARE,             // Plan syncing folder 'src' to folder 'dest' (result holds the summary)
+    JOB_SYNC,                // Bring folder 'dest' up to date with folder 'src'
+    JOB_PURGE,               // Delete trash item 'src' for good ('dest' is where it was)
+    JOB_PASTE,               // Copy some items and move others into folder 'dest' (a batch)
+} JobType;
+
+typedef enum {
+    JOB_QUEUED = 0,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_FAILED,
+    JOB_CANCELLED,
+} JobState;
+
+/**
+ * JobInfo - A snapshot of one job
+ */
+typedef struct {
+    uint32_t id;
+    JobType type;
+    JobState state;
+    int paused;                  // Held by jobs_pause()
+    int rc;                      // Engine result once finished
+    int item_count;              // Items worked on (more than 1 for a batch)
+    char src[FS_MAX_PATH];       // The item, or the folder holding a batch's items
+    char dest[FS_MAX_PATH];      // Folder or new name, as submitted
+    char target[FS_MAX_PATH];    // Path the job creates ("" for deletes)
+    const Progress* progress;    // Valid until the job is polled as finished
+    uint64_t done_bytes;         // Final counters, set once finished
+    uint64_t done_files;
+    uint64_t elapsed_ns;
+    char result[JOBS_RESULT_MAX];  // What the job found, one line per value ("" if nothing)
+} JobInfo;
+
+/**
+ * jobs_init(workers)
+ * Start 'workers' threads (0 selects JOBS_DEFAULT_WORKERS).
+ * Returns 0 on success, -1 if no worker could be started.
+ */
+int jobs_init(int workers);
+
+/**
+ * jobs_cleanup()
+ * Cancel every job, wait for the running ones to stop and forget them all.
+ */
+void jobs_cleanup(void);
+
+/**
+ * jobs_submit(type, src, dest)
+ * Queue a job ('dest' is unused for JOB_DELETE and JOB_HASH and may be NULL).
+ * Returns the job id, or 0 if it could not be queued (table full).
+ */
+uint32_t jobs_submit(JobType type, const char* src, const char* dest);
+
+/**
+ * jobs_submit_batch(type, items, dest)
+ * Queue one JOB_COPY, JOB_MOVE or JOB_DELETE of every path in 'items'
+ * (names of the list are full paths; the list is copied). The job's 'src'
+ * is the folder holding all of them and its 'target' the whole 'dest',
+ * so no job overlapping either runs alongside it.
+ * Returns the job id, or 0 if it could not be queued.
+ */
+uint32_t jobs_submit_batch(JobType type, const FsDirectory* items, const char* dest);
+
+/**
+ * jobs_submit_paste(copies, moves, dest)
+ * Queue one job that copies every path in 'copies' into folder 'dest',
+ * then moves every path in 'moves' there, all under one Progress. Either
+ * list may be NULL or empty; with only one of them this is a plain
+ * jobs_submit_batch().
+ * Returns the job id, or 0 if it could not be queued.
+ */
+uint32_t jobs_submit_paste(const FsDirectory* copies, const FsDirectory* moves, const char* dest);
+
+/**
+ * jobs_pause(id, paused) / jobs_cancel(id)
+ * Hold or resume a job, or ask it to stop. A queued job that is paused is
+ * skipped until resumed; a queued job that is cancelled never starts.
+ * Returns 0 on success, -1 if 'id' is not queued or running.
+ */
+int jobs_pause(uint32_t id, int paused);
+int jobs_cancel(uint32_t id);
+
+/**
+ * jobs_list(out, max)
+ * Snapshot up to 'max' queued and running jobs, oldest first.
+ * Returns the number of jobs written.
+ */
+int jobs_list(JobInfo* out, int max);
+
+/**
+ * jobs_poll_finished(out, max)
+ * Move up to 'max' finished jobs into 'out' and forget them.
+ * Returns the number of jobs written.
+ */
+int jobs_poll_finished(JobInfo* out, int max);
+
+/**
+ * jobs_touches(info, dir)
+ * Check whether job 'info' changed what the listing of 'dir' shows: an
+ * entry of 'dir' itself, something below it, or 'dir' and its parents.
+ * Returns 1 if it did, 0 otherwise.
+ */
+int jobs_touches(const JobInfo* info, const char* dir);
+
+#endif
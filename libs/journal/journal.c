@@ -0,0 +1,389 @@
+#include "journal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "../utils/utils.h"
+#include "../vfs/vfs.h"
+
+/**
+ * Copy journal implementation
+ *
+ * The records are a small table guarded by one lock. Every change
+ * rewrites the whole file (a temporary file renamed over the old one, as
+ * the index does), which is a few hundred bytes once per
+ * JOURNAL_COMMIT_BYTES copied.
+ *
+ * File layout (integers unsigned LEB128 varints):
+ *   "DBFMJRN1" version count
+ *   per record: src_len src dest_len dest size src_mtime committed
+ *               check_offset check_size check_sum
+ */
+
+#define JOURNAL_MAGIC "DBFMJRN1"
+#define JOURNAL_VERSION 1
+
+typedef struct {
+    int used;
+    int owned;                   // A copy in this run holds the record
+    JournalEntry entry;
+} JournalSlot;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_file[FS_MAX_PATH];
+static int g_active = 0;
+static JournalSlot g_slots[JOURNAL_MAX_ENTRIES];
+
+// FNV-1a; the window is small, so speed hardly matters
+static uint64_t journal_checksum(const void* data, uint64_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (uint64_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static void journal_put_varint(FILE* f, uint64_t v)
+{
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, f);
+        v >>= 7;
+    }
+    fputc((int)v, f);
+}
+
+static void journal_put_string(FILE* f, const char* str)
+{
+    size_t len = strlen(str);
+    journal_put_varint(f, len);
+    fwrite(str, 1, len, f);
+}
+
+static uint64_t journal_get_varint(FILE* f, int* failed)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF)
+            break;
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+            return v;
+    }
+    *failed = 1;
+    return 0;
+}
+
+static void journal_get_string(FILE* f, char* str, size_t max, int* failed)
+{
+    uint64_t len = journal_get_varint(f, failed);
+    if (*failed || len >= max || fread(str, 1, (size_t)len, f) != (size_t)len) {
+        *failed = 1;
+        str[0] = '\0';
+        return;
+    }
+    str[len] = '\0';
+}
+
+// Rewrite the journal file (lock held)
+static int journal_save(void)
+{
+    int count = 0;
+    for (int i = 0; i < JOURNAL_MAX_ENTRIES; i++)
+        count += g_slots[i].used;
+
+    // Nothing in flight: no file at all
+    if (count == 0) {
+        remove(g_file);
+        return 0;
+    }
+
+    char dir[FS_MAX_PATH];
+    if (path_get_parent(g_file, dir) == 0)
+        mkdir(dir, 0777);
+
+    char tmp[FS_MAX_PATH + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_file);
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL)
+        return -1;
+
+    fwrite(JOURNAL_MAGIC, 1, 8, f);
+    journal_put_varint(f, JOURNAL_VERSION);
+    journal_put_varint(f, (uint64_t)count);
+    for (int i = 0; i < JOURNAL_MAX_ENTRIES; i++) {
+        const JournalEntry* e = &g_slots[i].entry;
+        if (!g_slots[i].used)
+            continue;
+        journal_put_string(f, e->src);
+        journal_put_string(f, e->dest);
+        journal_put_varint(f, e->size);
+        journal_put_varint(f, e->src_mtime);
+        journal_put_varint(f, e->committed);
+        journal_put_varint(f, e->check_offset);
+        journal_put_varint(f, e->check_size);
+        journal_put_varint(f, e->check_sum);
+    }
+
+    int ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    if (ok) {
+        remove(g_file);
+        ok = rename(tmp, g_file) == 0;
+    }
+    if (!ok)
+        remove(tmp);
+    return ok ? 0 : -1;
+}
+
+// Read the records of a previous run (lock held)
+static int journal_load(void)
+{
+    FILE* f = fopen(g_file, "rb");
+    if (f == NULL)
+        return 0;  // No file: nothing was interrupted
+
+    char magic[8];
+    int failed = 0;
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, JOURNAL_MAGIC, 8) != 0 ||
+        journal_get_varint(f, &failed) != JOURNAL_VERSION) {
+        fclose(f);
+        return -1;
+    }
+
+    uint64_t count = journal_get_varint(f, &failed);
+    int loaded = 0;
+    for (uint64_t i = 0; i < count && !failed && loaded < JOURNAL_MAX_ENTRIES; i++) {
+        JournalEntry* e = &g_slots[loaded].entry;
+        journal_get_string(f, e->src, sizeof(e->src), &failed);
+        journal_get_string(f, e->dest, sizeof(e->dest), &failed);
+        e->size = journal_get_varint(f, &failed);
+        e->src_mtime = journal_get_varint(f, &failed);
+        e->committed = journal_get_varint(f, &failed);
+        e->check_offset = journal_get_varint(f, &failed);
+        e->check_size = (uint32_t)journal_get_varint(f, &failed);
+        e->check_sum = journal_get_varint(f, &failed);
+        if (failed)
+            break;
+        g_slots[loaded].used = 1;
+        g_slots[loaded].owned = 0;
+        loaded++;
+    }
+    fclose(f);
+    return failed ? -1 : loaded;
+}
+
+// Record for 'dest' (lock held), or NULL
+static JournalSlot* journal_find(const char* dest)
+{
+    for (int i = 0; i < JOURNAL_MAX_ENTRIES; i++) {
+        if (g_slots[i].used && strcmp(g_slots[i].entry.dest, dest) == 0)
+            return &g_slots[i];
+    }
+    return NULL;
+}
+
+int journal_init(const char* file)
+{
+    pthread_mutex_lock(&g_lock);
+    str_copy(g_file, file != NULL ? file : JOURNAL_DEFAULT_FILE, sizeof(g_file));
+    memset(g_slots, 0, sizeof(g_slots));
+    g_active = 1;
+    int rc = journal_load();
+    pthread_mutex_unlock(&g_lock);
+    return rc;
+}
+
+void journal_cleanup(void)
+{
+    pthread_mutex_lock(&g_lock);
+    g_active = 0;
+    memset(g_slots, 0, sizeof(g_slots));
+    pthread_mutex_unlock(&g_lock);
+}
+
+int journal_begin(const char* src, const char* dest, uint64_t size, uint64_t src_mtime,
+                  uint64_t committed)
+{
+    if (src == NULL || dest == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(dest, canon, sizeof(canon));
+
+    pthread_mutex_lock(&g_lock);
+    JournalSlot* slot = g_active ? journal_find(canon) : NULL;
+    // A resumed copy keeps the record (and window) it was verified against
+    int resumed = slot != NULL && committed > 0 && slot->entry.committed == committed;
+    if (slot != NULL && slot->owned) {
+        slot = NULL;  // Another copy writes the same file; leave it be
+    } else if (slot == NULL && g_active) {
+        for (int i = 0; i < JOURNAL_MAX_ENTRIES && slot == NULL; i++) {
+            if (!g_slots[i].used)
+                slot = &g_slots[i];
+        }
+    }
+    if (slot == NULL) {
+        pthread_mutex_unlock(&g_lock);
+        return -1;
+    }
+
+    slot->used = 1;
+    slot->owned = 1;
+    if (!resumed) {
+        JournalEntry* e = &slot->entry;
+        memset(e, 0, sizeof(*e));
+        path_canonicalize(src, e->src, sizeof(e->src));
+        str_copy(e->dest, canon, sizeof(e->dest));
+        e->size = size;
+        e->src_mtime = src_mtime;
+    }
+    journal_save();
+    int handle = (int)(slot - g_slots);
+    pthread_mutex_unlock(&g_lock);
+    return handle;
+}
+
+int journal_commit(int handle, uint64_t committed, const void* tail, uint64_t tail_size)
+{
+    if (handle < 0 || handle >= JOURNAL_MAX_ENTRIES || tail == NULL || tail_size > committed)
+        return -1;
+
+    // Only the end of the chunk is kept as the check window
+    uint64_t window = tail_size < JOURNAL_CHECK_BYTES ? tail_size : JOURNAL_CHECK_BYTES;
+    const uint8_t* data = (const uint8_t*)tail + (tail_size - window);
+    uint64_t sum = journal_checksum(data, window);
+
+    pthread_mutex_lock(&g_lock);
+    int rc = -1;
+    JournalSlot* slot = &g_slots[handle];
+    if (slot->used && slot->owned) {
+        slot->entry.committed = committed;
+        slot->entry.check_offset = committed - window;
+        slot->entry.check_size = (uint32_t)window;
+        slot->entry.check_sum = sum;
+        rc = journal_save();
+    }
+    pthread_mutex_unlock(&g_lock);
+    return rc;
+}
+
+void journal_end(int handle, int keep)
+{
+    if (handle < 0 || handle >= JOURNAL_MAX_ENTRIES)
+        return;
+
+    pthread_mutex_lock(&g_lock);
+    JournalSlot* slot = &g_slots[handle];
+    if (slot->used && slot->owned) {
+        slot->owned = 0;
+        if (!keep || slot->entry.committed == 0)
+            slot->used = 0;
+        journal_save();
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+int journal_pending(JournalEntry* out, int max)
+{
+    if (out == NULL || max <= 0)
+        return 0;
+
+    pthread_mutex_lock(&g_lock);
+    int count = 0;
+    for (int i = 0; i < JOURNAL_MAX_ENTRIES && count < max; i++) {
+        if (g_slots[i].used && !g_slots[i].owned)
+            out[count++] = g_slots[i].entry;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
+
+// Checksum of the window of 'path', or 0 with *ok cleared if unreadable
+static uint64_t journal_read_window(const char* path, const JournalEntry* e, uint8_t* buf, int* ok)
+{
+    VfsFile* f = vfs_open(path, VFS_OPEN_READ);
+    if (f == NULL) {
+        *ok = 0;
+        return 0;
+    }
+    int64_t n = vfs_read(f, e->check_offset, buf, e->check_size);
+    vfs_close(f);
+    if (n != (int64_t)e->check_size) {
+        *ok = 0;
+        return 0;
+    }
+    return journal_checksum(buf, e->check_size);
+}
+
+// Resume offset for record 'e'
+static int64_t journal_check(const JournalEntry* e)
+{
+    VfsStat src;
+    VfsStat dest;
+    uint64_t mtime = 0;
+    if (e->committed == 0 || e->committed > e->size || e->check_size == 0 ||
+        vfs_stat(e->src, &src) != 0 || src.size != e->size ||
+        vfs_get_mtime(e->src, &mtime) != 0 || mtime != e->src_mtime ||
+        vfs_stat(e->dest, &dest) != 0 || dest.is_dir || dest.size < e->committed)
+        return 0;
+
+    uint8_t* buf = (uint8_t*)malloc(e->check_size);
+    if (buf == NULL)
+        return 0;
+    int ok = 1;
+    uint64_t src_sum = journal_read_window(e->src, e, buf, &ok);
+    uint64_t dest_sum = journal_read_window(e->dest, e, buf, &ok);
+    free(buf);
+    return ok && src_sum == e->check_sum && dest_sum == e->check_sum ? (int64_t)e->committed : 0;
+}
+
+int64_t journal_verify(const char* dest, JournalEntry* out)
+{
+    if (dest == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(dest, canon, sizeof(canon));
+
+    pthread_mutex_lock(&g_lock);
+    JournalSlot* slot = journal_find(canon);
+    JournalEntry e;
+    if (slot != NULL)
+        e = slot->entry;
+    pthread_mutex_unlock(&g_lock);
+    if (slot == NULL)
+        return -1;
+
+    // The files are read without the lock, from a copy of the record
+
+    if (out != NULL)
+        *out = e;
+    return journal_check(&e);
+}
+
+int journal_discard(const char* dest)
+{
+    if (dest == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(dest, canon, sizeof(canon));
+
+    pthread_mutex_lock(&g_lock);
+    JournalSlot* slot = journal_find(canon);
+    if (slot == NULL || slot->owned) {
+        pthread_mutex_unlock(&g_lock);
+        return -1;
+    }
+    slot->used = 0;
+    journal_save();
+    pthread_mutex_unlock(&g_lock);
+
+    vfs_remove(canon);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "fs.h"
+
+/**
+ * Copy journal module
+ *
+ * Remembers large copies in flight in a small file on the card, so a
+ * copy cut short by a crash, a card error or the console sleeping can
+ * carry on where it stopped instead of starting again from byte 0.
+ *
+ * Each record names the source and destination, the source's size and
+ * timestamp, and how much of the destination is committed: written and
+ * flushed. With the committed offset goes a checksum of the last
+ * JOURNAL_CHECK_BYTES before it. Before resuming, that window is read
+ * back from both files and compared, which catches a destination that
+ * was changed or never reached the card for the price of a couple of
+ * small reads instead of re-reading the whole prefix.
+ *
+ * Records live only while a copy runs: a finished or cancelled copy
+ * drops its record. Whatever is in the file at startup was interrupted.
+ * Nothing is journaled until journal_init() names the file.
+ */
+
+#define JOURNAL_DEFAULT_FILE "/switch/DBFM/copy.journal"
+
+/* Copies recorded at once */
+#define JOURNAL_MAX_ENTRIES  8
+
+/* Files smaller than this are simply copied again */
+#define JOURNAL_MIN_SIZE     (512ull << 20)
+
+/* Bytes written between two commits */
+#define JOURNAL_COMMIT_BYTES (256ull << 20)
+
+/* Window checked before resuming */
+#define JOURNAL_CHECK_BYTES  (1u << 20)
+
+/**
+ * JournalEntry - One recorded copy
+ */
+typedef struct {
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    uint64_t size;               // Source size when the copy started
+    uint64_t src_mtime;          // Source timestamp when the copy started
+    uint64_t committed;          // Bytes of 'dest' known to be on the card
+    uint64_t check_offset;       // Window ending at 'committed'
+    uint32_t check_size;
+    uint64_t check_sum;          // Checksum of the window
+} JournalEntry;
+
+/**
+ * journal_init(file)
+ * Journal copies to 'file' (NULL selects JOURNAL_DEFAULT_FILE) and load
+ * the copies a previous run left unfinished.
+ * Returns the number of unfinished copies, or -1 if the file is unreadable.
+ */
+int journal_init(const char* file);
+
+/**
+ * journal_cleanup()
+ * Stop journaling. Records still open stay in the file.
+ */
+void journal_cleanup(void);
+
+/**
+ * journal_begin(src, dest, size, src_mtime, committed)
+ * Record a copy about to start with 'committed' bytes already in place
+ * (0 for a fresh copy). An unfinished record for 'dest' is taken over.
+ * Returns a handle, or -1 if journaling is off or the table is full (the
+ * copy then simply runs unrecorded).
+ */
+int journal_begin(const char* src, const char* dest, uint64_t size, uint64_t src_mtime,
+                  uint64_t committed);
+
+/**
+ * journal_commit(handle, committed, tail, tail_size)
+ * The first 'committed' bytes of the destination are flushed; 'tail'
+ * holds the last 'tail_size' of them (the end of the chunk just written).
+ * Returns 0 on success, -1 if the record could not be saved.
+ */
+int journal_commit(int handle, uint64_t committed, const void* tail, uint64_t tail_size);
+
+/**
+ * journal_end(handle, keep)
+ * The copy stopped. Its record is dropped, or with 'keep' left for a
+ * later resume (the copy failed part way).
+ */
+void journal_end(int handle, int keep);
+
+/**
+ * journal_pending(out, max)
+ * Copy up to 'max' unfinished records no copy is working on into 'out'.
+ * Returns the number of records written.
+ */
+int journal_pending(JournalEntry* out, int max);
+
+/**
+ * journal_verify(dest, out)
+ * Check the unfinished copy to 'dest': the source is unchanged and the
+ * checked window reads back the same from both files. Fills 'out' (may
+ * be NULL) with the record.
+ * Returns the offset to resume from, 0 to start over, or -1 if there is
+ * no unfinished copy to 'dest'.
+ */
+int64_t journal_verify(const char* dest, JournalEntry* out);
+
+/**
+ * journal_discard(dest)
+ * Give up the unfinished copy to 'dest': remove the partial file and
+ * forget the record.
+ * Returns 0 on success, -1 if there is no such record.
+ */
+int journal_discard(const char* dest);
+
+#endif
@@ -1,44 +1,271 @@
 #include "move.h"
-#include <switch.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include "../copy/copy.h"
 #include "../utils/utils.h"
 #include "../delete/delete.h"
+#include "../vfs/vfs.h"
+#include "../walk/walk.h"
+#include "../dircache/dircache.h"
+#include "../dirsize/dirsize.h"
 
-int move_file(const char* src, const char* dest_dir)
-{
-    if (src == NULL || dest_dir == NULL) return -1;
-
-    const char* filename = path_get_filename(src);
-    if (!filename) return -1;
-    char dest_path[512];
-    snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, filename);
-
-    // Try libnx rename first
-    Result rc;
-    FsFileSystem fs;
-    rc = fsOpenSdCardFileSystem(&fs);
-    if (R_SUCCEEDED(rc)) {
-        char src_n[512];
-        char dest_n[512];
-        // normalize
-        const char* p = src;
-        if (strncmp(p, "sdmc:/", 6) == 0) p += 6;
-        if (*p == '/') p++;
-        strncpy(src_n, p, sizeof(src_n)-1); src_n[sizeof(src_n)-1] = '\0';
-        p = dest_path;
-        if (strncmp(p, "sdmc:/", 6) == 0) p += 6;
-        if (*p == '/') p++;
-        strncpy(dest_n, p, sizeof(dest_n)-1); dest_n[sizeof(dest_n)-1] = '\0';
-
-        rc = fsFsRenameFile(&fs, src_n, dest_n);
-        fsFsClose(&fs);
-        if (R_SUCCEEDED(rc)) return 0;
-    }
-
-    // Fallback: copy then delete
-    if (copy_item(src, dest_dir) != 0) return -1;
-    if (delete_item(src) != 0) return -1;
+/**
+ * Move implementation
+ *
+ * A batch is planned in full before anything moves. On one volume every
+ * item is renamed, folders included, which costs one filesystem call
+ * whatever they hold; a file already at the destination is renamed aside
+ * first and only removed once the whole batch of renames stands, so any
+ * rename can be undone. Copy and delete is kept for items that really
+ * change volume.
+ */
+
+typedef enum {
+    MOVE_SKIP = 0,           // Already where it would go
+    MOVE_RENAME,             // Same volume, rename (replacing a file)
+    MOVE_MERGE,              // Same volume, into an existing folder
+    MOVE_COPY,               // Other volume: copy, then delete
+    MOVE_TRY,                // Volume unknown: rename, else copy
+} MoveKind;
+
+typedef struct {
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    char aside[FS_MAX_PATH];     // Replaced file kept until the batch stands
+    MoveKind kind;
+    int done;
+} MoveItem;
+
+// Both the source and destination folders changed
+static void move_invalidate(const char* src, const char* dest)
+{
+    dircache_invalidate_entry(src);
+    dirsize_invalidate_entry(src);
+    dircache_invalidate_entry(dest);
+    dirsize_invalidate_entry(dest);
+}
+
+// Rename file 'dest' to a free name next to it, written to 'aside'
+static int move_set_aside(const char* dest, char* aside, int size)
+{
+    VfsStat st;
+    for (unsigned n = 0; n < 100; n++) {
+        int len = snprintf(aside, size, "%s.dbfm-old%u", dest, n);
+        if (len <= 0 || len >= size)
+            break;
+        if (vfs_stat(aside, &st) != 0)
+            return vfs_rename(dest, aside);
+    }
+    aside[0] = '\0';
+    return -1;
+}
+
+// Rename 'src' to 'dest', a file already there going to 'aside' ("" if none)
+static int move_rename(const char* src, const char* dest, char* aside, int size)
+{
+    VfsStat st;
+    aside[0] = '\0';
+    if (vfs_stat(dest, &st) == 0 && move_set_aside(dest, aside, size) != 0)
+        return -1;
+    if (vfs_rename(src, dest) == 0)
+        return 0;
+    if (aside[0] != '\0')
+        vfs_rename(aside, dest);
+    aside[0] = '\0';
+    return -1;
+}
+
+// Move 'src' onto 'dest', entry by entry where a folder is already there
+static int move_merge(const char* src, const char* dest)
+{
+    VfsStat src_st, dest_st;
+    if (vfs_stat(src, &src_st) != 0)
+        return -1;
+    if (vfs_stat(dest, &dest_st) != 0)
+        return vfs_rename(src, dest);
+    if (src_st.is_dir != dest_st.is_dir)
+        return -1;
+
+    if (!src_st.is_dir) {
+        char aside[FS_MAX_PATH];
+        if (move_rename(src, dest, aside, sizeof(aside)) != 0)
+            return -1;
+        if (aside[0] != '\0')
+            vfs_remove(aside);
+        return 0;
+    }
+
+    FsDirectory* dir = fs_dir_create(16);
+    if (dir == NULL || vfs_list(src, dir, NULL, NULL, NULL) != 0) {
+        fs_free_directory(dir);
+        return -1;
+    }
+
+    int rc = 0;
+    char* child_src = malloc(FS_MAX_PATH * 2);
+    char* child_dest = child_src + FS_MAX_PATH;
+    if (child_src == NULL)
+        rc = -1;
+    for (int i = 0; rc == 0 && i < fs_dir_count(dir); i++) {
+        const char* name = fs_dir_name(dir, i);
+        if (walk_join(src, name, child_src, FS_MAX_PATH) != 0 ||
+            walk_join(dest, name, child_dest, FS_MAX_PATH) != 0 ||
+            move_merge(child_src, child_dest) != 0)
+            rc = -1;
+    }
+    free(child_src);
+    fs_free_directory(dir);
+
+    // Emptied: the folder itself goes too
+    if (rc == 0 && vfs_rmdir(src) != 0)
+        rc = -1;
+    return rc;
+}
+
+// Copy 'src' into 'dest_dir', then delete it
+static int move_copy(const char* src, const char* dest_dir, Progress* progress)
+{
+    // The source delete is not counted: the totals describe the copy
+    int rc = copy_item(src, dest_dir, progress);
+    if (rc == 0) {
+        progress_set_phase(progress, PROGRESS_DELETING);
+        if (delete_item(src, NULL) != 0)
+            rc = -1;
+    }
+    return rc;
+}
+
+// Work out how item 'src' reaches canonical folder 'dest_dir'
+static int move_plan(MoveItem* item, const char* src, const char* dest_dir)
+{
+    path_canonicalize(src, item->src, sizeof(item->src));
+    const char* name = path_get_filename(item->src);
+    if (name == NULL || name[0] == '\0' ||
+        walk_join(dest_dir, name, item->dest, sizeof(item->dest)) != 0)
+        return -1;
+
+    if (strcmp(item->src, item->dest) == 0) {
+        item->kind = MOVE_SKIP;
+        return 0;
+    }
+    // Never into itself
+    if (path_is_within(dest_dir, item->src))
+        return -1;
+
+    VfsStat src_st, dest_st;
+    if (vfs_stat(item->src, &src_st) != 0)
+        return -1;
+    int exists = vfs_stat(item->dest, &dest_st) == 0;
+    if (exists && src_st.is_dir != dest_st.is_dir)
+        return -1;
+
+    int same = vfs_same_volume(item->src, dest_dir);
+    if (same == 0)
+        item->kind = MOVE_COPY;
+    else if (same < 0)
+        item->kind = MOVE_TRY;
+    else if (exists && src_st.is_dir)
+        item->kind = MOVE_MERGE;
+    else
+        item->kind = MOVE_RENAME;
     return 0;
 }
+
+// Put the batch's renames back, newest first
+static void move_rollback(MoveItem* items, int count)
+{
+    for (int i = count - 1; i >= 0; i--) {
+        MoveItem* item = &items[i];
+        if (!item->done)
+            continue;
+        vfs_rename(item->dest, item->src);
+        if (item->aside[0] != '\0')
+            vfs_rename(item->aside, item->dest);
+        item->done = 0;
+        move_invalidate(item->src, item->dest);
+    }
+}
+
+int move_batch(const char* const* srcs, int count, const char* dest_dir, Progress* progress)
+{
+    if (srcs == NULL || count <= 0 || dest_dir == NULL) return -1;
+
+    char dir[FS_MAX_PATH];
+    path_canonicalize(dest_dir, dir, sizeof(dir));
+    MoveItem* items = calloc(count, sizeof(*items));
+    if (items == NULL) return -1;
+
+    int rc = 0;
+    for (int i = 0; rc == 0 && i < count; i++) {
+        if (srcs[i] == NULL || move_plan(&items[i], srcs[i], dir) != 0)
+            rc = -1;
+        // Two items cannot both end up at one name
+        for (int j = 0; rc == 0 && j < i; j++)
+            if (strcmp(items[j].dest, items[i].dest) == 0)
+                rc = -1;
+    }
+
+    // Held throughout so copies and deletes share the session
+    if (rc == 0 && vfs_session_acquire() != 0)
+        rc = -1;
+    if (rc != 0) {
+        free(items);
+        return -1;
+    }
+
+    // The renames stand or fall together
+    for (int i = 0; i < count; i++) {
+        MoveItem* item = &items[i];
+        if (item->kind != MOVE_RENAME)
+            continue;
+        if (move_rename(item->src, item->dest, item->aside, sizeof(item->aside)) != 0) {
+            move_rollback(items, i);
+            vfs_session_release();
+            free(items);
+            return -1;
+        }
+        item->done = 1;
+        move_invalidate(item->src, item->dest);
+    }
+    for (int i = 0; i < count; i++)
+        if (items[i].aside[0] != '\0')
+            vfs_remove(items[i].aside);
+
+    // Then merges and copies, one at a time
+    for (int i = 0; i < count; i++) {
+        MoveItem* item = &items[i];
+        int item_rc = 0;
+        switch (item->kind) {
+        case MOVE_MERGE:
+            item_rc = move_merge(item->src, item->dest);
+            break;
+        case MOVE_TRY:
+            if (vfs_rename(item->src, item->dest) == 0)
+                break;
+            // fall through
+        case MOVE_COPY:
+            item_rc = move_copy(item->src, dir, progress);
+            break;
+        default:
+            continue;
+        }
+        move_invalidate(item->src, item->dest);
+        if (item_rc == COPY_CANCELLED || item_rc == COPY_ERR_NO_SPACE) {
+            rc = item_rc;
+            break;
+        }
+        if (item_rc != 0)
+            rc = -1;
+    }
+
+    vfs_session_release();
+    free(items);
+    return rc;
+}
+
+int move_file(const char* src, const char* dest_dir, Progress* progress)
+{
+    if (src == NULL) return -1;
+    return move_batch(&src, 1, dest_dir, progress);
+}
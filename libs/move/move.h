@@ -1,7 +1,26 @@
 #ifndef MOVE_H
 #define MOVE_H
 
-/* Move a file from src to dest_dir. Returns 0 on success, -1 on error. */
-int move_file(const char* src, const char* dest_dir);
+#include "progress.h"
+
+/* Move a file or folder from src into dest_dir. On one volume this is a
+ * rename, however big the item: a file already at the destination is
+ * replaced, and a folder already there is merged into, its entries
+ * renamed one by one. Only across volumes is the item copied (reported
+ * to 'progress', may be NULL) and the source deleted.
+ * Returns 0 on success, -1 on error, COPY_ERR_NO_SPACE if the copy
+ * does not fit, or COPY_CANCELLED if it was cancelled through
+ * 'progress' (the source is then left in place). */
+int move_file(const char* src, const char* dest_dir, Progress* progress);
+
+/* Move 'count' items into dest_dir as one batch. Every item is checked
+ * before anything moves. The plain renames are done together: if one of
+ * them fails, those already done are renamed back and nothing has moved.
+ * Merges into existing folders and copies across volumes follow, one
+ * item at a time, once the renames stand.
+ * Returns like move_file(); -1 before anything moved if an item cannot
+ * be moved at all (missing, into itself, a file onto a folder) or two
+ * items have the same name. */
+int move_batch(const char* const* srcs, int count, const char* dest_dir, Progress* progress);
 
 #endif
@@ -1,31 +1,53 @@
 #include "paste.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include "../clipboard/clipboard.h"
 #include "../copy/copy.h"
 #include "../move/move.h"
 
-int paste_item(const char* dest_dir)
+/* Paste every clipboard item with intent 'op' in one engine call, so the
+ * engines check and report once */
+static int paste_op(ClipboardOp op, const char* dest_dir, Progress* progress)
 {
-    if (dest_dir == NULL) return -1;
-
-    if (!clipboard_has_item()) return -1;
-
-    const char* path = clipboard_get_path();
-    if (path == NULL) return -1;
+    FsDirectory* list = fs_dir_create(clipboard_count(op) + 1);
+    if (list == NULL || clipboard_get_list(op, list) < 0) {
+        fs_free_directory(list);
+        return -1;
+    }
 
-    ClipboardOp op = clipboard_get_operation();
+    int count = fs_dir_count(list);
+    const char** paths = (const char**)malloc(sizeof(*paths) * (count + 1));
     int rc = -1;
-    if (op == CLIPBOARD_COPY) {
-        rc = copy_item(path, dest_dir);
-    } else if (op == CLIPBOARD_MOVE) {
-        rc = move_file(path, dest_dir);
+    if (paths != NULL) {
+        for (int i = 0; i < count; i++)
+            paths[i] = fs_dir_name(list, i);
+        if (count == 0)
+            rc = 0;
+        else if (op == CLIPBOARD_COPY)
+            rc = copy_batch(paths, count, dest_dir, progress);
+        else
+            rc = move_batch(paths, count, dest_dir, progress);
     }
+    free(paths);
+    fs_free_directory(list);
+    return rc;
+}
+
+int paste_item(const char* dest_dir, Progress* progress)
+{
+    if (dest_dir == NULL) return -1;
+
+    if (!clipboard_has_item()) return -1;
 
-    if (rc == 0) {
-        /* Clear clipboard after successful paste for MOVE; keep for COPY */
-        if (op == CLIPBOARD_MOVE) clipboard_clear();
-        return 0;
+    /* Copies first: a copied item may lie inside a folder being moved */
+    int rc = paste_op(CLIPBOARD_COPY, dest_dir, progress);
+    if (rc != COPY_CANCELLED) {
+        int moved = paste_op(CLIPBOARD_MOVE, dest_dir, progress);
+        /* Moved items are gone from where they were; copied ones stay */
+        if (moved == 0) clipboard_remove_op(CLIPBOARD_MOVE);
+        if (rc == 0) rc = moved;
     }
 
-    return -1;
+    if (rc == 0) return 0;
+    return rc == COPY_ERR_NO_SPACE || rc == COPY_CANCELLED ? rc : -1;
 }
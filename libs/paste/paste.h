@@ -1,7 +1,11 @@
 #ifndef PASTE_H
 #define PASTE_H
 
-/* Paste clipboard item into dest_dir. Returns 0 on success, -1 on error. */
-int paste_item(const char* dest_dir);
+#include "progress.h"
+
+/* Paste the clipboard items into dest_dir, reporting to 'progress' (may be
+ * NULL). Returns 0 on success, -1 on error, COPY_ERR_NO_SPACE if the
+ * destination lacks room, or COPY_CANCELLED. */
+int paste_item(const char* dest_dir, Progress* progress);
 
 #endif
@@ -0,0 +1,192 @@
+#include "prefetch.h"
+#include <string.h>
+#include "../utils/utils.h"
+
+/**
+ * Prefetch implementation
+ *
+ * Only the UI thread calls into this module, so it needs no locking; the
+ * listing itself runs on the stream's worker.
+ */
+
+typedef struct {
+    FsListStream* stream;
+    FsDirectory* dir;
+} PrefetchRetired;
+
+static char g_slot_key[FS_MAX_PATH];     // Canonical path of the slot
+static FsDirectory* g_slot_dir = NULL;   // NULL = slot empty
+static FsListStream* g_slot_stream = NULL; // Non-NULL while still loading
+
+static char g_hint_key[FS_MAX_PATH];     // Folder under the cursor
+static uint64_t g_hint_since = 0;        // When the cursor arrived there
+
+static PrefetchRetired g_retired[PREFETCH_MAX_RETIRED];
+static int g_retired_count = 0;
+static PrefetchStats g_stats;
+
+// Free a retired stream once its worker has stopped. 'wait' blocks
+// until it has. Returns 1 if it was released.
+static int prefetch_release(PrefetchRetired* r, int wait)
+{
+    int state = fs_stream_pump(r->stream, r->dir);
+    if (state == FS_STREAM_LOADING && !wait)
+        return 0;
+
+    fs_stream_close(r->stream);
+    g_stats.wasted_entries += (uint64_t)fs_dir_count(r->dir);
+    fs_free_directory(r->dir);
+    return 1;
+}
+
+static void prefetch_reap(void)
+{
+    int kept = 0;
+    for (int i = 0; i < g_retired_count; i++) {
+        if (!prefetch_release(&g_retired[i], 0))
+            g_retired[kept++] = g_retired[i];
+    }
+    g_retired_count = kept;
+}
+
+// Empty the slot, cancelling its listing if it is still running
+static void prefetch_clear_slot(void)
+{
+    if (g_slot_dir == NULL)
+        return;
+
+    if (g_slot_stream != NULL) {
+        // Don't wait for the worker: park it until it notices the cancel
+        fs_stream_cancel(g_slot_stream);
+        if (g_retired_count == PREFETCH_MAX_RETIRED) {
+            prefetch_release(&g_retired[0], 1);
+            memmove(g_retired, g_retired + 1, sizeof(PrefetchRetired) * (PREFETCH_MAX_RETIRED - 1));
+            g_retired_count--;
+        }
+        g_retired[g_retired_count].stream = g_slot_stream;
+        g_retired[g_retired_count].dir = g_slot_dir;
+        g_retired_count++;
+        g_stats.cancelled++;
+    } else {
+        g_stats.wasted++;
+        g_stats.wasted_entries += (uint64_t)fs_dir_count(g_slot_dir);
+        fs_free_directory(g_slot_dir);
+    }
+
+    g_slot_dir = NULL;
+    g_slot_stream = NULL;
+    g_slot_key[0] = '\0';
+}
+
+// Advance the slot's listing
+static void prefetch_pump(void)
+{
+    if (g_slot_stream == NULL)
+        return;
+
+    int state = fs_stream_pump(g_slot_stream, g_slot_dir);
+    if (state == FS_STREAM_LOADING)
+        return;
+
+    fs_stream_close(g_slot_stream);
+    g_slot_stream = NULL;
+    if (state == FS_STREAM_ERROR) {
+        // Unreadable folder: entering it will report the error itself
+        fs_free_directory(g_slot_dir);
+        g_slot_dir = NULL;
+        g_slot_key[0] = '\0';
+    }
+}
+
+void prefetch_hint(const char* path)
+{
+    prefetch_reap();
+    prefetch_pump();
+
+    if (path == NULL) {
+        // Keep a finished listing, stop an unfinished one
+        if (g_slot_stream != NULL)
+            prefetch_clear_slot();
+        g_hint_key[0] = '\0';
+        return;
+    }
+
+    char key[FS_MAX_PATH];
+    path_canonicalize(path, key, sizeof(key));
+    if (g_slot_dir != NULL && strcmp(g_slot_key, key) == 0)
+        return;  // Already prefetched or in progress
+
+    uint64_t now = fs_now_ns();
+    if (strcmp(g_hint_key, key) != 0) {
+        // The cursor moved: whatever is still loading is no longer wanted
+        str_copy(g_hint_key, key, sizeof(g_hint_key));
+        g_hint_since = now;
+        if (g_slot_stream != NULL)
+            prefetch_clear_slot();
+        return;
+    }
+    if (now - g_hint_since < PREFETCH_DELAY_NS)
+        return;
+
+    prefetch_clear_slot();
+    FsDirectory* dir = fs_dir_create(FS_LIST_BATCH);
+    if (dir == NULL)
+        return;
+    FsListStream* stream = fs_stream_open_background(path);
+    if (stream == NULL) {
+        fs_free_directory(dir);
+        return;
+    }
+
+    str_copy(g_slot_key, key, sizeof(g_slot_key));
+    g_slot_dir = dir;
+    g_slot_stream = stream;
+    g_stats.started++;
+}
+
+int prefetch_take(const char* path, FsDirectory** dir, FsListStream** stream)
+{
+    if (path == NULL || dir == NULL || stream == NULL)
+        return 0;
+
+    prefetch_pump();
+
+    char key[FS_MAX_PATH];
+    path_canonicalize(path, key, sizeof(key));
+    if (g_slot_dir == NULL || strcmp(g_slot_key, key) != 0) {
+        g_stats.misses++;
+        return 0;
+    }
+
+    *dir = g_slot_dir;
+    *stream = g_slot_stream;
+    if (g_slot_stream != NULL)
+        g_stats.partial_hits++;
+    else
+        g_stats.hits++;
+
+    g_slot_dir = NULL;
+    g_slot_stream = NULL;
+    g_slot_key[0] = '\0';
+    return 1;
+}
+
+void prefetch_drop(void)
+{
+    prefetch_clear_slot();
+    g_hint_key[0] = '\0';
+}
+
+void prefetch_get_stats(PrefetchStats* out)
+{
+    if (out != NULL)
+        *out = g_stats;
+}
+
+void prefetch_cleanup(void)
+{
+    prefetch_drop();
+    for (int i = 0; i < g_retired_count; i++)
+        prefetch_release(&g_retired[i], 1);
+    g_retired_count = 0;
+}
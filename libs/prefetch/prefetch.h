@@ -0,0 +1,76 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "fs.h"
+
+/**
+ * Prefetch module
+ *
+ * Speculatively lists the folder under the cursor so entering it costs
+ * no I/O. The browser reports the highlighted folder every frame; once
+ * the cursor has rested on it for PREFETCH_DELAY_NS a low-priority
+ * background stream starts listing it into a single prefetch slot.
+ * Moving the cursor cancels an unfinished prefetch without waiting for
+ * its worker (the stream is reaped on a later frame). A completed
+ * listing stays in the slot until another folder is prefetched.
+ *
+ * Entering the prefetched folder takes the slot: a complete listing is
+ * used as is, an unfinished one is handed over together with its stream
+ * so the browser keeps pumping it instead of starting again.
+ */
+
+/* How long the cursor must rest on a folder before it is prefetched */
+#define PREFETCH_DELAY_NS (150ull * 1000000ull)
+
+/* Cancelled streams waiting for their worker to stop */
+#define PREFETCH_MAX_RETIRED 4
+
+/**
+ * PrefetchStats - Effectiveness counters
+ */
+typedef struct {
+    uint64_t started;        // Prefetches started
+    uint64_t hits;           // Taken complete (zero I/O on enter)
+    uint64_t partial_hits;   // Taken while still loading
+    uint64_t misses;         // Entered a folder that was not prefetched
+    uint64_t cancelled;      // Dropped before completion
+    uint64_t wasted;         // Completed but replaced without being used
+    uint64_t wasted_entries; // Entries listed by dropped prefetches
+} PrefetchStats;
+
+/**
+ * prefetch_hint(path)
+ * Report the folder under the cursor (NULL when the cursor is not on a
+ * folder, or prefetching should pause). Call once per frame; it also
+ * advances the background listing.
+ */
+void prefetch_hint(const char* path);
+
+/**
+ * prefetch_take(path, dir, stream)
+ * Claim the prefetched listing of 'path'. On a hit '*dir' receives the
+ * listing and '*stream' the stream still filling it (NULL if complete);
+ * the caller owns both.
+ * Returns 1 on a hit, 0 otherwise.
+ */
+int prefetch_take(const char* path, FsDirectory** dir, FsListStream** stream);
+
+/**
+ * prefetch_drop()
+ * Discard the slot, e.g. after a file operation may have made it stale.
+ */
+void prefetch_drop(void);
+
+/**
+ * prefetch_get_stats(out)
+ * Copy the current counters into 'out'.
+ */
+void prefetch_get_stats(PrefetchStats* out);
+
+/**
+ * prefetch_cleanup()
+ * Cancel everything and wait for all workers. Call before fs_cleanup().
+ */
+void prefetch_cleanup(void);
+
+#endif
@@ -0,0 +1,196 @@
+#include "progress.h"
+#include <string.h>
+#include <time.h>
+#include "../utils/utils.h"
+
+/**
+ * Progress implementation
+ *
+ * The current file name is a seqlock: a writer claims it by moving the
+ * sequence from even to odd with a compare-and-swap (giving up if
+ * another writer holds it) and releases it by moving it on to the next
+ * even value. The reader retries a few times if the sequence changed
+ * under it and otherwise keeps the name it had.
+ */
+
+#define PROGRESS_READ_TRIES 4
+
+void progress_reset(Progress* p)
+{
+    if (p == NULL)
+        return;
+
+    atomic_store(&p->phase, PROGRESS_IDLE);
+    atomic_store(&p->total_bytes, 0);
+    atomic_store(&p->total_files, 0);
+    atomic_store(&p->done_bytes, 0);
+    atomic_store(&p->done_files, 0);
+    atomic_store(&p->end_ns, 0);
+    atomic_store(&p->paused_ns, 0);
+    atomic_store(&p->cancel, 0);
+    atomic_store(&p->paused, 0);
+    atomic_store(&p->current_seq, 0);
+    p->current[0] = '\0';
+    atomic_store(&p->start_ns, fs_now_ns());
+}
+
+void progress_set_phase(Progress* p, ProgressPhase phase)
+{
+    if (p == NULL)
+        return;
+    if (phase == PROGRESS_DONE)
+        atomic_store(&p->end_ns, fs_now_ns());
+    atomic_store(&p->phase, phase);
+}
+
+void progress_add_total(Progress* p, uint64_t files, uint64_t bytes)
+{
+    if (p == NULL)
+        return;
+    atomic_fetch_add_explicit(&p->total_files, files, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->total_bytes, bytes, memory_order_relaxed);
+}
+
+void progress_add_done(Progress* p, uint64_t files, uint64_t bytes)
+{
+    if (p == NULL)
+        return;
+    if (files > 0)
+        atomic_fetch_add_explicit(&p->done_files, files, memory_order_relaxed);
+    if (bytes > 0)
+        atomic_fetch_add_explicit(&p->done_bytes, bytes, memory_order_relaxed);
+}
+
+void progress_set_current(Progress* p, const char* path)
+{
+    if (p == NULL || path == NULL)
+        return;
+
+    unsigned seq = atomic_load_explicit(&p->current_seq, memory_order_relaxed);
+    if ((seq & 1) != 0 ||
+        !atomic_compare_exchange_strong_explicit(&p->current_seq, &seq, seq + 1,
+                                                 memory_order_acquire, memory_order_relaxed))
+        return;  // Someone else is writing; their name is as good as ours
+
+    str_copy(p->current, path, sizeof(p->current));
+    atomic_store_explicit(&p->current_seq, seq + 2, memory_order_release);
+}
+
+void progress_cancel(Progress* p)
+{
+    if (p == NULL)
+        return;
+    atomic_store(&p->cancel, 1);
+    atomic_store(&p->paused, 0);
+}
+
+void progress_pause(Progress* p, int paused)
+{
+    if (p != NULL && !atomic_load(&p->cancel))
+        atomic_store(&p->paused, paused ? 1 : 0);
+}
+
+int progress_checkpoint(Progress* p)
+{
+    if (p == NULL)
+        return 0;
+
+    if (atomic_load(&p->paused)) {
+        uint64_t start = fs_now_ns();
+        struct timespec ts = {0, PROGRESS_PAUSE_POLL_MS * 1000000L};
+        while (atomic_load(&p->paused) && !atomic_load(&p->cancel))
+            nanosleep(&ts, NULL);
+        atomic_fetch_add(&p->paused_ns, fs_now_ns() - start);
+    }
+    return atomic_load(&p->cancel) ? 1 : 0;
+}
+
+const atomic_int* progress_cancel_flag(Progress* p)
+{
+    return p != NULL ? &p->cancel : NULL;
+}
+
+void progress_view_init(ProgressView* view)
+{
+    if (view != NULL)
+        memset(view, 0, sizeof(*view));
+}
+
+// Copy the current name if no writer interfered
+static void progress_read_current(const Progress* p, ProgressView* view)
+{
+    char name[FS_MAX_PATH];
+    for (int i = 0; i < PROGRESS_READ_TRIES; i++) {
+        unsigned before = atomic_load_explicit(&p->current_seq, memory_order_acquire);
+        if ((before & 1) != 0)
+            continue;
+        memcpy(name, p->current, sizeof(name));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&p->current_seq, memory_order_relaxed) == before) {
+            name[sizeof(name) - 1] = '\0';
+            memcpy(view->current, name, sizeof(name));
+            return;
+        }
+    }
+}
+
+static double progress_smooth(double avg, double sample)
+{
+    return avg == 0.0 ? sample : avg + PROGRESS_SMOOTHING * (sample - avg);
+}
+
+void progress_view(const Progress* p, ProgressView* view)
+{
+    if (p == NULL || view == NULL)
+        return;
+
+    view->phase = (ProgressPhase)atomic_load(&p->phase);
+    view->total_bytes = atomic_load_explicit(&p->total_bytes, memory_order_relaxed);
+    view->total_files = atomic_load_explicit(&p->total_files, memory_order_relaxed);
+    view->done_bytes = atomic_load_explicit(&p->done_bytes, memory_order_relaxed);
+    view->done_files = atomic_load_explicit(&p->done_files, memory_order_relaxed);
+    progress_read_current(p, view);
+
+    uint64_t start = atomic_load(&p->start_ns);
+    uint64_t end = atomic_load(&p->end_ns);
+    uint64_t now = end != 0 ? end : fs_now_ns();
+    uint64_t paused_ns = atomic_load(&p->paused_ns);
+    view->elapsed_ns = now - start > paused_ns ? now - start - paused_ns : 0;
+    view->paused = atomic_load(&p->paused);
+
+    // Resample the rates once per window; a pause keeps the last rates
+    if (view->sample_ns == 0) {
+        view->sample_ns = start;
+    } else if (view->paused) {
+        view->sample_ns = now;
+    } else if (now - view->sample_ns >= PROGRESS_SAMPLE_NS) {
+        double secs = (now - view->sample_ns) / 1e9;
+        view->bytes_per_sec = (view->done_bytes - view->sample_bytes) / secs;
+        view->bytes_per_sec_avg = progress_smooth(view->bytes_per_sec_avg, view->bytes_per_sec);
+        view->files_per_sec_avg = progress_smooth(view->files_per_sec_avg,
+                                                  (view->done_files - view->sample_files) / secs);
+        view->sample_ns = now;
+        view->sample_bytes = view->done_bytes;
+        view->sample_files = view->done_files;
+    }
+
+    // Copies are measured in bytes; deletes (and empty files) in files
+    view->eta_ns = 0;
+    view->percent = 0;
+    int by_bytes = view->phase != PROGRESS_DELETING && view->total_bytes > 0;
+    if (by_bytes) {
+        uint64_t left = view->total_bytes > view->done_bytes ? view->total_bytes - view->done_bytes : 0;
+        view->percent = (int)(view->done_bytes * 100 / view->total_bytes);
+        if (view->bytes_per_sec_avg > 0.0)
+            view->eta_ns = (uint64_t)(left / view->bytes_per_sec_avg * 1e9);
+    } else if (view->total_files > 0) {
+        uint64_t left = view->total_files > view->done_files ? view->total_files - view->done_files : 0;
+        view->percent = (int)(view->done_files * 100 / view->total_files);
+        if (view->files_per_sec_avg > 0.0)
+            view->eta_ns = (uint64_t)(left / view->files_per_sec_avg * 1e9);
+    }
+    if (view->percent > 100)
+        view->percent = 100;
+    if (view->phase == PROGRESS_SCANNING || view->phase == PROGRESS_DONE)
+        view->eta_ns = 0;
+}
@@ -0,0 +1,139 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include "fs.h"
+#include <stdatomic.h>
+
+/**
+ * Progress module
+ *
+ * Shared state between a long file operation (copy, move, delete) and
+ * the UI showing it. The operation's threads publish counters with
+ * relaxed atomic adds and never wait on the reader; the UI takes a
+ * ProgressView once per frame, which also derives throughput and ETA.
+ *
+ * Totals come from a quick pre-scan and may still grow while the
+ * operation is in the PROGRESS_SCANNING phase. Every function accepts a
+ * NULL Progress and does nothing, so engines report unconditionally.
+ *
+ * The other direction carries control: whoever owns the operation can
+ * pause or cancel it, and the engines honour that at their next
+ * progress_checkpoint() (between files and between chunks).
+ */
+
+typedef enum {
+    PROGRESS_IDLE = 0,
+    PROGRESS_SCANNING,       // Counting what is to be done
+    PROGRESS_COPYING,
+    PROGRESS_DELETING,
+    PROGRESS_HASHING,        // Reading files to hash or verify them
+    PROGRESS_DONE,
+} ProgressPhase;
+
+/* Throughput window and smoothing */
+#define PROGRESS_SAMPLE_NS    (250ull * 1000000ull)  // Instantaneous rate window
+#define PROGRESS_SMOOTHING    0.25                   // Weight of a new sample
+
+/* How often a paused operation checks whether it may go on */
+#define PROGRESS_PAUSE_POLL_MS 20
+
+/**
+ * Progress - Written by the operation, read by the UI
+ */
+typedef struct {
+    atomic_int phase;                    // ProgressPhase
+    atomic_uint_fast64_t total_bytes;
+    atomic_uint_fast64_t total_files;
+    atomic_uint_fast64_t done_bytes;
+    atomic_uint_fast64_t done_files;
+    atomic_uint_fast64_t start_ns;
+    atomic_uint_fast64_t end_ns;         // 0 while running
+    atomic_uint_fast64_t paused_ns;      // Time spent paused (not in rates)
+    atomic_int cancel;                   // Set by progress_cancel()
+    atomic_int paused;                   // Set by progress_pause()
+    atomic_uint current_seq;             // Odd while 'current' is written
+    char current[FS_MAX_PATH];           // File being worked on
+} Progress;
+
+/**
+ * ProgressView - What the UI draws, plus its sampling state
+ */
+typedef struct {
+    ProgressPhase phase;
+    uint64_t total_bytes;
+    uint64_t total_files;
+    uint64_t done_bytes;
+    uint64_t done_files;
+    uint64_t elapsed_ns;         // Wall time, pauses excluded
+    int paused;
+    char current[FS_MAX_PATH];
+    double bytes_per_sec;        // Over the last PROGRESS_SAMPLE_NS
+    double bytes_per_sec_avg;    // Exponentially smoothed
+    double files_per_sec_avg;    // Exponentially smoothed
+    uint64_t eta_ns;             // 0 when unknown
+    int percent;                 // 0..100
+
+    // Sampling state, kept between frames
+    uint64_t sample_ns;
+    uint64_t sample_bytes;
+    uint64_t sample_files;
+} ProgressView;
+
+/**
+ * progress_reset(p)
+ * Zero every counter and start the clock. Call before handing 'p' to an
+ * operation.
+ */
+void progress_reset(Progress* p);
+
+/**
+ * progress_set_phase(p, phase)
+ * Enter 'phase'. PROGRESS_DONE also stops the clock.
+ */
+void progress_set_phase(Progress* p, ProgressPhase phase);
+
+/**
+ * progress_add_total(p, files, bytes) / progress_add_done(p, files, bytes)
+ * Grow the totals found by the pre-scan, or the work completed.
+ */
+void progress_add_total(Progress* p, uint64_t files, uint64_t bytes);
+void progress_add_done(Progress* p, uint64_t files, uint64_t bytes);
+
+/**
+ * progress_set_current(p, path)
+ * Name the file being worked on. Never blocks: if another thread is
+ * updating the name at the same moment, this update is dropped.
+ */
+void progress_set_current(Progress* p, const char* path);
+
+/**
+ * progress_cancel(p) / progress_pause(p, paused)
+ * Ask the operation to stop, or to hold (paused = 1) and resume.
+ * Cancelling also ends a pause.
+ */
+void progress_cancel(Progress* p);
+void progress_pause(Progress* p, int paused);
+
+/**
+ * progress_checkpoint(p)
+ * Called by engines between units of work: blocks while the operation is
+ * paused. Returns 1 if it has been cancelled, 0 to carry on.
+ */
+int progress_checkpoint(Progress* p);
+
+/**
+ * progress_cancel_flag(p)
+ * The cancel flag in the form walk_tree() and transfer_file() poll, or
+ * NULL for a NULL 'p'.
+ */
+const atomic_int* progress_cancel_flag(Progress* p);
+
+/**
+ * progress_view_init(view) / progress_view(p, view)
+ * Start a view, then refresh it from 'p' (once per frame). Rates are
+ * resampled every PROGRESS_SAMPLE_NS.
+ */
+void progress_view_init(ProgressView* view);
+void progress_view(const Progress* p, ProgressView* view);
+
+#endif
@@ -4,7 +4,7 @@
 /**
  * Rename module
  *
- * Provides cross-type rename operations using libnx filesystem APIs.
+ * Renames files and directories in place through the VFS.
  */
 
 /**
@@ -0,0 +1,238 @@
+#include "select.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/**
+ * Selection implementation
+ *
+ * Bits past 'count' in the last word are always zero, so whole-word
+ * operations only need to mask that one word and population counts never
+ * see stray bits.
+ */
+
+#define SELECT_WORD_BITS 64
+
+static int select_words_for(int count)
+{
+    return (count + SELECT_WORD_BITS - 1) / SELECT_WORD_BITS;
+}
+
+// Mask of the bits in word 'w' that belong to an entry
+static uint64_t select_valid_mask(const Selection* sel, int w)
+{
+    int rest = sel->count - w * SELECT_WORD_BITS;
+    return rest >= SELECT_WORD_BITS ? ~0ull : (1ull << rest) - 1;
+}
+
+void select_init(Selection* sel)
+{
+    if (sel == NULL)
+        return;
+    memset(sel, 0, sizeof(*sel));
+}
+
+void select_free(Selection* sel)
+{
+    if (sel == NULL)
+        return;
+    free(sel->bits);
+    memset(sel, 0, sizeof(*sel));
+}
+
+int select_resize(Selection* sel, int count)
+{
+    if (sel == NULL || count < 0)
+        return -1;
+
+    int words = select_words_for(count);
+    if (words > sel->words) {
+        // Grow by half again so a streaming listing does not realloc per batch
+        int capacity = words + words / 2;
+        uint64_t* bits = (uint64_t*)realloc(sel->bits, sizeof(uint64_t) * capacity);
+        if (bits == NULL)
+            return -1;
+        memset(bits + sel->words, 0, sizeof(uint64_t) * (capacity - sel->words));
+        sel->bits = bits;
+        sel->words = capacity;
+    }
+
+    if (count < sel->count && sel->marked > 0) {
+        // Marks past the end go; their bytes are recounted by the owner
+        int first = count / SELECT_WORD_BITS;
+        if (count % SELECT_WORD_BITS != 0)
+            sel->bits[first++] &= (1ull << (count % SELECT_WORD_BITS)) - 1;
+        memset(sel->bits + first, 0, sizeof(uint64_t) * (select_words_for(sel->count) - first));
+        sel->marked = 0;
+        for (int w = 0; w < words; w++)
+            sel->marked += __builtin_popcountll(sel->bits[w]);
+    }
+    sel->count = count;
+    return 0;
+}
+
+void select_clear(Selection* sel)
+{
+    if (sel == NULL)
+        return;
+    if (sel->bits != NULL)
+        memset(sel->bits, 0, sizeof(uint64_t) * sel->words);
+    sel->marked = 0;
+    sel->bytes = 0;
+}
+
+int select_is_marked(const Selection* sel, int index)
+{
+    if (sel == NULL || index < 0 || index >= sel->count)
+        return 0;
+    return (sel->bits[index / SELECT_WORD_BITS] >> (index % SELECT_WORD_BITS)) & 1;
+}
+
+void select_set(Selection* sel, const FsDirectory* dir, int index, int marked)
+{
+    if (sel == NULL || index < 0 || index >= sel->count)
+        return;
+    if (select_is_marked(sel, index) == (marked != 0))
+        return;
+
+    sel->bits[index / SELECT_WORD_BITS] ^= 1ull << (index % SELECT_WORD_BITS);
+    uint64_t size = fs_dir_size(dir, index);
+    if (marked) {
+        sel->marked++;
+        sel->bytes += size;
+    } else {
+        sel->marked--;
+        sel->bytes -= size;
+    }
+}
+
+int select_toggle(Selection* sel, const FsDirectory* dir, int index)
+{
+    if (sel == NULL || index < 0 || index >= sel->count)
+        return -1;
+    int marked = !select_is_marked(sel, index);
+    select_set(sel, dir, index, marked);
+    return marked;
+}
+
+void select_all(Selection* sel, const FsDirectory* dir)
+{
+    if (sel == NULL)
+        return;
+    int words = select_words_for(sel->count);
+    for (int w = 0; w < words; w++)
+        sel->bits[w] = select_valid_mask(sel, w);
+    sel->marked = sel->count;
+    select_recount(sel, dir);
+}
+
+void select_invert(Selection* sel, const FsDirectory* dir)
+{
+    if (sel == NULL)
+        return;
+    int words = select_words_for(sel->count);
+    sel->marked = 0;
+    for (int w = 0; w < words; w++) {
+        sel->bits[w] = ~sel->bits[w] & select_valid_mask(sel, w);
+        sel->marked += __builtin_popcountll(sel->bits[w]);
+    }
+    select_recount(sel, dir);
+}
+
+// Glob match of 'name' against 'pattern', both compared case-folded
+static int select_glob(const char* pattern, const char* name)
+{
+    const char* star = NULL;     // Last '*' seen, to retry from on a mismatch
+    const char* resume = NULL;   // Where in 'name' that retry starts
+    while (*name != '\0') {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == '?' ||
+                   tolower((unsigned char)*pattern) == tolower((unsigned char)*name)) {
+            pattern++;
+            name++;
+        } else if (star != NULL) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return 0;
+        }
+    }
+    while (*pattern == '*')
+        pattern++;
+    return *pattern == '\0';
+}
+
+int select_match(Selection* sel, const FsDirectory* dir, const char* pattern)
+{
+    if (sel == NULL || dir == NULL || pattern == NULL || pattern[0] == '\0')
+        return 0;
+
+    // A plain word is looked for anywhere in the name
+    char glob[SELECT_MAX_PATTERN + 3];
+    if (strpbrk(pattern, "*?") == NULL) {
+        glob[0] = '*';
+        size_t len = strlen(pattern);
+        if (len > SELECT_MAX_PATTERN)
+            len = SELECT_MAX_PATTERN;
+        memcpy(glob + 1, pattern, len);
+        glob[len + 1] = '*';
+        glob[len + 2] = '\0';
+        pattern = glob;
+    }
+
+    int added = 0;
+    int count = fs_dir_count(dir) < sel->count ? fs_dir_count(dir) : sel->count;
+    for (int i = 0; i < count; i++) {
+        if (!select_is_marked(sel, i) && select_glob(pattern, fs_dir_name(dir, i))) {
+            select_set(sel, dir, i, 1);
+            added++;
+        }
+    }
+    return added;
+}
+
+int select_next(const Selection* sel, int from)
+{
+    if (sel == NULL || from < 0 || from >= sel->count || sel->marked == 0)
+        return -1;
+
+    int w = from / SELECT_WORD_BITS;
+    uint64_t word = sel->bits[w] & (~0ull << (from % SELECT_WORD_BITS));
+    int words = select_words_for(sel->count);
+    while (word == 0) {
+        if (++w >= words)
+            return -1;
+        word = sel->bits[w];
+    }
+    return w * SELECT_WORD_BITS + __builtin_ctzll(word);
+}
+
+int select_permute(Selection* sel, const uint32_t* order)
+{
+    if (sel == NULL || order == NULL)
+        return -1;
+    if (sel->marked == 0)
+        return 0;
+
+    uint64_t* bits = (uint64_t*)calloc(sel->words, sizeof(uint64_t));
+    if (bits == NULL)
+        return -1;
+    for (int i = 0; i < sel->count; i++) {
+        if (select_is_marked(sel, (int)order[i]))
+            bits[i / SELECT_WORD_BITS] |= 1ull << (i % SELECT_WORD_BITS);
+    }
+    free(sel->bits);
+    sel->bits = bits;
+    return 0;
+}
+
+void select_recount(Selection* sel, const FsDirectory* dir)
+{
+    if (sel == NULL)
+        return;
+    sel->bytes = 0;
+    for (int i = select_next(sel, 0); i >= 0; i = select_next(sel, i + 1))
+        sel->bytes += fs_dir_size(dir, i);
+}
@@ -0,0 +1,105 @@
+#ifndef SELECT_H
+#define SELECT_H
+
+#include "fs.h"
+
+/**
+ * Selection module
+ *
+ * Marks entries of one listing so a file operation can work on all of
+ * them at once. Marks are a bitset over listing indices, one bit per
+ * entry, and the number of marked entries and their bytes are kept up to
+ * date as marks change, so showing them costs nothing. Marking everything
+ * or inverting the marks works a 64-bit word at a time.
+ *
+ * Indices only mean something for the listing the marks were made in:
+ * the owner resizes the selection as the listing grows, permutes it when
+ * the listing is reordered and clears it when the listing is replaced.
+ */
+
+/* Longest pattern accepted by select_match() */
+#define SELECT_MAX_PATTERN 64
+
+/**
+ * Selection - Marked entries of one listing
+ */
+typedef struct {
+    uint64_t* bits;          // Bit i set while entry i is marked
+    int words;               // Words allocated
+    int count;               // Entries covered (the listing's size)
+    int marked;              // Bits set
+    uint64_t bytes;          // Sizes of the marked entries (folders as listed)
+} Selection;
+
+/**
+ * select_init(sel) / select_free(sel)
+ * Start with nothing marked, or release the bitset.
+ */
+void select_init(Selection* sel);
+void select_free(Selection* sel);
+
+/**
+ * select_resize(sel, count)
+ * Cover 'count' entries: new ones start unmarked, marks past 'count'
+ * are dropped.
+ * Returns 0 on success, -1 on allocation failure (nothing changed).
+ */
+int select_resize(Selection* sel, int count);
+
+/**
+ * select_clear(sel)
+ * Unmark everything.
+ */
+void select_clear(Selection* sel);
+
+/**
+ * select_is_marked(sel, index)
+ * Returns 1 if entry 'index' is marked.
+ */
+int select_is_marked(const Selection* sel, int index);
+
+/**
+ * select_set(sel, dir, index, marked) / select_toggle(sel, dir, index)
+ * Mark or unmark entry 'index' of 'dir', or flip its mark.
+ * select_toggle returns the new state (1 marked), or -1 if out of range.
+ */
+void select_set(Selection* sel, const FsDirectory* dir, int index, int marked);
+int select_toggle(Selection* sel, const FsDirectory* dir, int index);
+
+/**
+ * select_all(sel, dir) / select_invert(sel, dir)
+ * Mark every entry of 'dir', or flip every mark.
+ */
+void select_all(Selection* sel, const FsDirectory* dir);
+void select_invert(Selection* sel, const FsDirectory* dir);
+
+/**
+ * select_match(sel, dir, pattern)
+ * Mark the entries whose name matches 'pattern', ignoring case: '*'
+ * stands for any run of characters and '?' for one. A pattern without
+ * either matches names containing it.
+ * Returns the number of entries newly marked.
+ */
+int select_match(Selection* sel, const FsDirectory* dir, const char* pattern);
+
+/**
+ * select_next(sel, from)
+ * Returns the first marked index at or after 'from', or -1 if none.
+ */
+int select_next(const Selection* sel, int from);
+
+/**
+ * select_permute(sel, order)
+ * Follow a reordering of the listing in which entry i came from index
+ * order[i] (as passed to fs_dir_permute()).
+ * Returns 0 on success, -1 on allocation failure (marks unchanged).
+ */
+int select_permute(Selection* sel, const uint32_t* order);
+
+/**
+ * select_recount(sel, dir)
+ * Recompute the marked bytes, after sizes in 'dir' changed.
+ */
+void select_recount(Selection* sel, const FsDirectory* dir);
+
+#endif
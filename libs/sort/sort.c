@@ -0,0 +1,440 @@
+#include "sort.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * Sort module implementation
+ */
+
+// One sortable entry: compared by group, then key, then the full
+// case-folded name (or extension) when the 8-byte prefixes tie.
+typedef struct {
+    uint64_t key;        // Folded 8-byte prefix (big-endian) or size
+    uint32_t index;      // Entry index in the listing
+    uint32_t group;      // 0 = directories (when dirs_first), 1 = files
+} SortRecord;
+
+// Per-sort collation data shared by all workers (read-only)
+typedef struct {
+    const FsDirectory* dir;
+    const char* folded;          // Case-folded copy of the name arena
+    const uint16_t* ext_offsets; // Offset of the extension within each name
+    SortMode mode;
+} SortCtx;
+
+static inline unsigned char sort_fold(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static inline int sort_is_digit(unsigned char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Pack up to 8 bytes of 's' big-endian so integer order matches byte order
+static uint64_t sort_prefix_key(const char* s, int len)
+{
+    uint64_t key = 0;
+    int i = 0;
+    for (; i < 8 && i < len; i++)
+        key = (key << 8) | (unsigned char)s[i];
+    return i == 0 ? 0 : key << (8 * (8 - i));
+}
+
+// Natural-order prefix: text bytes as-is, then the first digit run as a
+// length byte (below any printable character, so numbers sort first)
+// followed by its significant digits; a run of 0x1F digits or more gets
+// the length byte 0x1F alone. The key stops after that run; ties
+// fall through to sort_natural_cmp().
+static uint64_t sort_natural_key(const char* s, int len)
+{
+    uint64_t key = 0;
+    int k = 0;
+    for (int i = 0; i < len && k < 8; ) {
+        unsigned char c = (unsigned char)s[i];
+        if (!sort_is_digit(c)) {
+            key = (key << 8) | c;
+            k++;
+            i++;
+            continue;
+        }
+
+        int j = i;
+        while (j < len && s[j] == '0') j++;
+        int e = j;
+        while (e < len && sort_is_digit((unsigned char)s[e])) e++;
+        if (e - j >= 0x1F) {
+            // Too long to encode: a saturated length, compared in full
+            key = (key << 8) | 0x1F;
+            k++;
+            break;
+        }
+        key = (key << 8) | (unsigned)(e - j);
+        k++;
+        for (; j < e && k < 8; j++, k++)
+            key = (key << 8) | (unsigned char)s[j];
+        break;
+    }
+    return k == 0 ? 0 : key << (8 * (8 - k));
+}
+
+// Natural comparison of two folded strings: digit runs compare by value,
+// a digit run sorts before any other character, shorter prefix first.
+static int sort_natural_cmp(const char* a, int alen, const char* b, int blen)
+{
+    int i = 0, j = 0;
+    while (i < alen && j < blen) {
+        unsigned char ca = (unsigned char)a[i];
+        unsigned char cb = (unsigned char)b[j];
+        int da = sort_is_digit(ca), db = sort_is_digit(cb);
+
+        if (da && db) {
+            // Skip leading zeros, then longer run = larger number
+            int si = i, sj = j;
+            while (i < alen && a[i] == '0') i++;
+            while (j < blen && b[j] == '0') j++;
+            int ni = i, nj = j;
+            while (ni < alen && sort_is_digit((unsigned char)a[ni])) ni++;
+            while (nj < blen && sort_is_digit((unsigned char)b[nj])) nj++;
+            if (ni - i != nj - j)
+                return (ni - i) < (nj - j) ? -1 : 1;
+            int c = memcmp(a + i, b + j, (size_t)(ni - i));
+            if (c != 0)
+                return c;
+            // Same value: fewer leading zeros first ("1" < "01")
+            if ((i - si) != (j - sj))
+                return (i - si) < (j - sj) ? -1 : 1;
+            i = ni;
+            j = nj;
+            continue;
+        }
+        if (da != db)
+            return da ? -1 : 1;
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+        i++;
+        j++;
+    }
+    if (i < alen) return 1;
+    if (j < blen) return -1;
+    return 0;
+}
+
+static int sort_bytes_cmp(const char* a, int alen, const char* b, int blen)
+{
+    int n = alen < blen ? alen : blen;
+    int c = memcmp(a, b, (size_t)n);
+    if (c != 0)
+        return c;
+    return (alen > blen) - (alen < blen);
+}
+
+static int sort_compare(const SortCtx* ctx, const SortRecord* x, const SortRecord* y)
+{
+    if (x->group != y->group)
+        return x->group < y->group ? -1 : 1;
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+
+    const FsDirectory* dir = ctx->dir;
+    const char* an = ctx->folded + dir->name_offsets[x->index];
+    const char* bn = ctx->folded + dir->name_offsets[y->index];
+    int al = dir->name_lengths[x->index];
+    int bl = dir->name_lengths[y->index];
+    int c = 0;
+
+    switch (ctx->mode) {
+        case SORT_NATURAL:
+            c = sort_natural_cmp(an, al, bn, bl);
+            break;
+        case SORT_TYPE: {
+            int ae = ctx->ext_offsets[x->index];
+            int be = ctx->ext_offsets[y->index];
+            c = sort_bytes_cmp(an + ae, al - ae, bn + be, bl - be);
+            if (c == 0)
+                c = sort_bytes_cmp(an, al, bn, bl);
+            break;
+        }
+        default:
+            // Prefixes already matched: compare the remainder
+            if (al > 8 && bl > 8)
+                c = sort_bytes_cmp(an + 8, al - 8, bn + 8, bl - 8);
+            else
+                c = sort_bytes_cmp(an, al, bn, bl);
+            break;
+    }
+    if (c != 0)
+        return c;
+    // Deterministic, stable result
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+// Bottom-up merge sort of recs[0..n) using tmp as scratch. Result ends
+// in recs.
+static void sort_merge_sort(const SortCtx* ctx, SortRecord* recs, SortRecord* tmp, size_t n)
+{
+    // Insertion sort runs of 16 first: cheap on nearly sorted input
+    const size_t run = 16;
+    for (size_t lo = 0; lo < n; lo += run) {
+        size_t hi = lo + run < n ? lo + run : n;
+        for (size_t i = lo + 1; i < hi; i++) {
+            SortRecord r = recs[i];
+            size_t j = i;
+            while (j > lo && sort_compare(ctx, &r, &recs[j - 1]) < 0) {
+                recs[j] = recs[j - 1];
+                j--;
+            }
+            recs[j] = r;
+        }
+    }
+
+    SortRecord* src = recs;
+    SortRecord* dst = tmp;
+    for (size_t width = run; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi)
+                dst[k++] = (sort_compare(ctx, &src[j], &src[i]) < 0) ? src[j++] : src[i++];
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        SortRecord* t = src; src = dst; dst = t;
+    }
+    if (src != recs)
+        memcpy(recs, src, n * sizeof(SortRecord));
+}
+
+// Merge two adjacent sorted ranges a[0..na) and b[0..nb) into out
+static void sort_merge(const SortCtx* ctx, const SortRecord* a, size_t na,
+                       const SortRecord* b, size_t nb, SortRecord* out)
+{
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb)
+        out[k++] = (sort_compare(ctx, &b[j], &a[i]) < 0) ? b[j++] : a[i++];
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+}
+
+typedef struct {
+    const SortCtx* ctx;
+    SortRecord* recs;
+    SortRecord* tmp;
+    size_t n;
+} SortChunk;
+
+static void* sort_chunk_worker(void* arg)
+{
+    SortChunk* chunk = (SortChunk*)arg;
+    sort_merge_sort(chunk->ctx, chunk->recs, chunk->tmp, chunk->n);
+    return NULL;
+}
+
+// Sort on up to 'threads' workers: each sorts a slice, then the slices
+// are merged. Falls back to a serial sort if threads cannot be started.
+static void sort_records(const SortCtx* ctx, SortRecord* recs, SortRecord* tmp, size_t n, int threads)
+{
+    if (threads <= 1 || n < SORT_PARALLEL_THRESHOLD) {
+        sort_merge_sort(ctx, recs, tmp, n);
+        return;
+    }
+
+    SortChunk chunks[SORT_MAX_THREADS];
+    pthread_t tids[SORT_MAX_THREADS];
+    int started[SORT_MAX_THREADS] = {0};
+    size_t per = (n + threads - 1) / threads;
+
+    for (int t = 0; t < threads; t++) {
+        size_t lo = per * t < n ? per * t : n;
+        size_t hi = lo + per < n ? lo + per : n;
+        chunks[t].ctx = ctx;
+        chunks[t].recs = recs + lo;
+        chunks[t].tmp = tmp + lo;
+        chunks[t].n = hi - lo;
+        // The calling thread sorts the first slice itself
+        if (t > 0 && pthread_create(&tids[t], NULL, sort_chunk_worker, &chunks[t]) == 0)
+            started[t] = 1;
+    }
+    sort_chunk_worker(&chunks[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t])
+            pthread_join(tids[t], NULL);
+        else
+            sort_chunk_worker(&chunks[t]);
+    }
+
+    // Fold the slices together left to right
+    size_t merged = chunks[0].n;
+    for (int t = 1; t < threads; t++) {
+        sort_merge(ctx, recs, merged, chunks[t].recs, chunks[t].n, tmp);
+        merged += chunks[t].n;
+        memcpy(recs, tmp, merged * sizeof(SortRecord));
+    }
+}
+
+// Stable LSD radix sort on the 64-bit key, skipping constant bytes
+static void sort_radix(SortRecord* recs, SortRecord* tmp, size_t n)
+{
+    SortRecord* src = recs;
+    SortRecord* dst = tmp;
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < n; i++)
+            counts[(src[i].key >> shift) & 0xFF]++;
+        if (counts[(src[0].key >> shift) & 0xFF] == n)
+            continue;  // Every key has the same byte here
+
+        size_t pos = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[b];
+            counts[b] = pos;
+            pos += c;
+        }
+        for (size_t i = 0; i < n; i++)
+            dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+        SortRecord* t = src; src = dst; dst = t;
+    }
+    if (src != recs)
+        memcpy(recs, src, n * sizeof(SortRecord));
+}
+
+// Stable partition of records by group (directories first)
+static void sort_group(SortRecord* recs, SortRecord* tmp, size_t n)
+{
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++)
+        if (recs[i].group == 0) tmp[k++] = recs[i];
+    for (size_t i = 0; i < n; i++)
+        if (recs[i].group != 0) tmp[k++] = recs[i];
+    memcpy(recs, tmp, n * sizeof(SortRecord));
+}
+
+static int sort_thread_count(const SortOptions* opts, size_t n)
+{
+    if (n < SORT_PARALLEL_THRESHOLD)
+        return 1;
+    int threads = opts->max_threads > 0 ? opts->max_threads : SORT_MAX_THREADS;
+    return threads > SORT_MAX_THREADS ? SORT_MAX_THREADS : threads;
+}
+
+int sort_compute_order(const FsDirectory* dir, const SortOptions* opts, uint32_t* order)
+{
+    if (dir == NULL || opts == NULL || order == NULL)
+        return -1;
+
+    size_t n = (size_t)dir->count;
+    if (n == 0)
+        return 0;
+
+    SortRecord* recs = (SortRecord*)malloc(n * sizeof(SortRecord));
+    SortRecord* tmp = (SortRecord*)malloc(n * sizeof(SortRecord));
+    char* folded = (char*)malloc(dir->names_used > 0 ? dir->names_used : 1);
+    uint16_t* ext = (uint16_t*)malloc(n * sizeof(uint16_t));
+    if (recs == NULL || tmp == NULL || folded == NULL || ext == NULL) {
+        free(recs); free(tmp); free(folded); free(ext);
+        return -1;
+    }
+
+    // Collation keys: one pass over the arena
+    for (uint32_t i = 0; i < dir->names_used; i++)
+        folded[i] = (char)sort_fold((unsigned char)dir->names[i]);
+
+    SortCtx ctx;
+    ctx.dir = dir;
+    ctx.folded = folded;
+    ctx.ext_offsets = ext;
+    ctx.mode = opts->mode;
+
+    for (size_t i = 0; i < n; i++) {
+        const char* name = folded + dir->name_offsets[i];
+        int len = dir->name_lengths[i];
+        int is_dir = (dir->flags[i] & FS_ENTRY_DIR) != 0;
+
+        // Extension starts after the last '.', directories have none
+        int e = len;
+        if (!is_dir) {
+            for (int k = len - 1; k > 0; k--) {
+                if (name[k] == '.') { e = k + 1; break; }
+            }
+        }
+        ext[i] = (uint16_t)e;
+
+        recs[i].index = (uint32_t)i;
+        recs[i].group = (opts->dirs_first && !is_dir) ? 1 : 0;
+        switch (opts->mode) {
+            case SORT_NATURAL: recs[i].key = sort_natural_key(name, len); break;
+            case SORT_TYPE:    recs[i].key = sort_prefix_key(name + e, len - e); break;
+            default:           recs[i].key = sort_prefix_key(name, len); break;
+        }
+    }
+
+    int threads = sort_thread_count(opts, n);
+    if (opts->mode == SORT_SIZE) {
+        // Name order first so equal sizes read naturally, then a stable
+        // radix pass on the inverted size (largest first)
+        ctx.mode = SORT_NAME;
+        sort_records(&ctx, recs, tmp, n, threads);
+        for (size_t i = 0; i < n; i++)
+            recs[i].key = ~dir->sizes[recs[i].index];
+        sort_radix(recs, tmp, n);
+        if (opts->dirs_first)
+            sort_group(recs, tmp, n);
+    } else {
+        sort_records(&ctx, recs, tmp, n, threads);
+    }
+
+    for (size_t i = 0; i < n; i++)
+        order[i] = recs[i].index;
+
+    free(recs);
+    free(tmp);
+    free(folded);
+    free(ext);
+    return 0;
+}
+
+int sort_options_tag(const SortOptions* opts)
+{
+    if (opts == NULL)
+        return 0;
+    return 1 + (int)opts->mode * 2 + (opts->dirs_first ? 1 : 0);
+}
+
+int sort_directory(FsDirectory* dir, const SortOptions* opts)
+{
+    if (dir == NULL || opts == NULL)
+        return -1;
+
+    int tag = sort_options_tag(opts);
+    if (dir->sort_tag == tag || dir->count < 2) {
+        dir->sort_tag = tag;
+        return 0;
+    }
+
+    uint32_t* order = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)dir->count);
+    if (order == NULL)
+        return -1;
+
+    int rc = sort_compute_order(dir, opts, order);
+    if (rc == 0)
+        rc = fs_dir_permute(dir, order);
+    if (rc == 0)
+        dir->sort_tag = tag;
+
+    free(order);
+    return rc;
+}
+
+const char* sort_mode_name(SortMode mode)
+{
+    switch (mode) {
+        case SORT_NAME:    return "Name";
+        case SORT_NATURAL: return "Natural";
+        case SORT_SIZE:    return "Size";
+        case SORT_TYPE:    return "Type";
+        default:           return "?";
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include "fs.h"
+
+/**
+ * Sort module
+ *
+ * Orders FsDirectory listings. Case-folded collation keys are computed
+ * once per sort, records of (group, 8-byte key prefix, index) are sorted
+ * instead of entries, and the resulting permutation is applied to the
+ * listing's small per-entry columns (names never move in the arena).
+ * Large listings are sorted on several threads and merged; size order
+ * uses an LSD radix sort.
+ */
+
+/**
+ * SortMode - Listing order
+ */
+typedef enum {
+    SORT_NAME = 0,       // Case-insensitive byte order
+    SORT_NATURAL,        // Case-insensitive, digit runs by value ("file2" < "file10")
+    SORT_SIZE,           // Largest first
+    SORT_TYPE,           // By extension, then name
+    SORT_MODE_COUNT
+} SortMode;
+
+/* Listings at least this large are sorted on several threads */
+#define SORT_PARALLEL_THRESHOLD 8192
+
+/* Maximum worker threads for a parallel sort (Switch apps own 3 cores) */
+#define SORT_MAX_THREADS 3
+
+/**
+ * SortOptions - How to order a listing
+ */
+typedef struct {
+    SortMode mode;
+    int dirs_first;      // 1 to group directories before files
+    int max_threads;     // 0 = automatic, 1 = always single-threaded
+} SortOptions;
+
+/**
+ * sort_compute_order(dir, opts, order)
+ * Compute the sorted permutation of 'dir' into 'order' (fs_dir_count
+ * entries) without modifying the listing.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int sort_compute_order(const FsDirectory* dir, const SortOptions* opts, uint32_t* order);
+
+/**
+ * sort_directory(dir, opts)
+ * Sort 'dir' in place. Records the applied order in dir->sort_tag so
+ * sorting an already sorted listing again is free.
+ * Returns 0 on success, -1 on allocation failure (listing unchanged).
+ */
+int sort_directory(FsDirectory* dir, const SortOptions* opts);
+
+/**
+ * sort_options_tag(opts)
+ * Non-zero identifier of an ordering, as stored in FsDirectory.sort_tag.
+ */
+int sort_options_tag(const SortOptions* opts);
+
+/**
+ * sort_mode_name(mode)
+ * Short label for 'mode' ("Name", "Natural", "Size", "Type").
+ */
+const char* sort_mode_name(SortMode mode);
+
+#endif
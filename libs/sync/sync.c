@@ -0,0 +1,567 @@
+#include "sync.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../utils/utils.h"
+#include "../vfs/vfs.h"
+#include "../walk/walk.h"
+#include "../hash/hash.h"
+#include "../copy/copy.h"
+#include "../delete/delete.h"
+
+/**
+ * Folder sync implementation
+ *
+ * Folders are compared breadth first from a queue of relative paths, so
+ * deep trees need no recursion. Each pair is listed once, both listings
+ * are sorted by name and walked side by side. Only the items to act on
+ * are kept, as relative paths in an FsDirectory with their actions in a
+ * parallel array: a plan for an unchanged tree stays empty whatever its
+ * size. Deletes are collected apart and put first, so a file that became
+ * a folder (or the reverse) is cleared before it is copied.
+ */
+
+struct SyncPlan {
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    FsDirectory* items;      // Relative paths, type and size
+    uint8_t* actions;        // SyncAction per item
+    int action_capacity;
+    SyncSummary summary;
+};
+
+typedef struct {
+    SyncPlan* plan;
+    FsDirectory* deletes;    // Collected apart, moved in front at the end
+    SyncCompare compare;
+    Progress* progress;
+    const atomic_int* cancel;
+    uint8_t* probe;          // 2 * SYNC_PROBE_BYTES, content compares only
+} SyncBuild;
+
+static pthread_mutex_t g_kept_lock = PTHREAD_MUTEX_INITIALIZER;
+static SyncPlan* g_kept = NULL;
+
+const char* sync_action_name(SyncAction action)
+{
+    switch (action) {
+        case SYNC_IDENTICAL: return "identical";
+        case SYNC_NEW:       return "new";
+        case SYNC_CHANGED:   return "changed";
+        case SYNC_DELETED:   return "deleted";
+        default:             return "?";
+    }
+}
+
+// "rel/name", or "name" at the top
+static int sync_rel_join(const char* rel, const char* name, char* out, int size)
+{
+    int n = rel[0] == '\0' ? snprintf(out, size, "%s", name) : snprintf(out, size, "%s/%s", rel, name);
+    return n >= 0 && n < size ? 0 : -1;
+}
+
+// "root/rel", or "root" for the top
+static int sync_full_path(const char* root, const char* rel, char* out, int size)
+{
+    if (rel[0] == '\0') {
+        str_copy(out, root, size);
+        return 0;
+    }
+    return walk_join(root, rel, out, size);
+}
+
+static int sync_add(SyncPlan* plan, const char* rel, SyncAction action, int is_dir, uint64_t size)
+{
+    int count = fs_dir_count(plan->items);
+    if (count >= plan->action_capacity) {
+        int capacity = plan->action_capacity * 2;
+        uint8_t* actions = (uint8_t*)realloc(plan->actions, capacity);
+        if (actions == NULL)
+            return -1;
+        plan->actions = actions;
+        plan->action_capacity = capacity;
+    }
+    if (fs_dir_append(plan->items, rel, is_dir, size) != 0)
+        return -1;
+    plan->actions[count] = (uint8_t)action;
+    plan->summary.count[action]++;
+    plan->summary.bytes[action] += size;
+    return 0;
+}
+
+// Listing indices in name order
+typedef struct {
+    const char* name;
+    int index;
+} SyncName;
+
+static int sync_name_compare(const void* a, const void* b)
+{
+    return strcmp(((const SyncName*)a)->name, ((const SyncName*)b)->name);
+}
+
+static SyncName* sync_sorted(const FsDirectory* dir)
+{
+    int count = fs_dir_count(dir);
+    SyncName* names = (SyncName*)malloc(sizeof(SyncName) * (count > 0 ? count : 1));
+    if (names == NULL)
+        return NULL;
+    for (int i = 0; i < count; i++) {
+        names[i].name = fs_dir_name(dir, i);
+        names[i].index = i;
+    }
+    qsort(names, count, sizeof(SyncName), sync_name_compare);
+    return names;
+}
+
+static int sync_sum_visit(const char* path, const FsEntry* entry, int depth, void* user)
+{
+    (void)path;
+    (void)entry;
+    (void)depth;
+    (void)user;
+    return WALK_CONTINUE;
+}
+
+// Bytes below folder 'path'
+static uint64_t sync_tree_bytes(const char* path, const atomic_int* cancel)
+{
+    WalkStats stats;
+    if (walk_tree(path, sync_sum_visit, NULL, NULL, cancel, &stats) < 0)
+        return 0;
+    return stats.bytes;
+}
+
+// Read 'size' bytes at 'offset' of both files; 1 if they match
+static int sync_probe_range(VfsFile* a, VfsFile* b, uint64_t offset, uint64_t size, uint8_t* buf)
+{
+    return vfs_read(a, offset, buf, size) == (int64_t)size &&
+           vfs_read(b, offset, buf + SYNC_PROBE_BYTES, size) == (int64_t)size &&
+           memcmp(buf, buf + SYNC_PROBE_BYTES, size) == 0;
+}
+
+// 1 if the first and last SYNC_PROBE_BYTES of both files match
+static int sync_probe(SyncBuild* b, const char* src, const char* dest, uint64_t size)
+{
+    VfsFile* fs = vfs_open(src, VFS_OPEN_READ);
+    VfsFile* fd = vfs_open(dest, VFS_OPEN_READ);
+    int same = fs != NULL && fd != NULL;
+
+    uint64_t head = size < SYNC_PROBE_BYTES ? size : SYNC_PROBE_BYTES;
+    if (same)
+        same = sync_probe_range(fs, fd, 0, head, b->probe);
+    if (same && size > head) {
+        uint64_t tail = size - head < SYNC_PROBE_BYTES ? size - head : SYNC_PROBE_BYTES;
+        same = sync_probe_range(fs, fd, size - tail, tail, b->probe);
+    }
+    vfs_close(fs);
+    vfs_close(fd);
+    b->plan->summary.probed++;
+    return same;
+}
+
+// Whether two files of 'size' bytes hold the same contents (-1 if cancelled)
+static int sync_same_content(SyncBuild* b, const char* src, const char* dest, uint64_t size)
+{
+    if (!sync_probe(b, src, dest, size))
+        return 0;
+    // The probe has seen every byte of a small file
+    if (size <= 2ull * SYNC_PROBE_BYTES)
+        return 1;
+
+    HashDigest a[HASH_ALGO_COUNT];
+    HashDigest c[HASH_ALGO_COUNT];
+    int rc = hash_file(src, HASH_MASK(HASH_CRC32), a, NULL, b->cancel);
+    if (rc == 0)
+        rc = hash_file(dest, HASH_MASK(HASH_CRC32), c, NULL, b->cancel);
+    if (rc > 0)
+        return -1;
+    b->plan->summary.hashed++;
+    return rc == 0 && hash_equal(&a[HASH_CRC32], &c[HASH_CRC32]);
+}
+
+// Compare two files of equal size: SYNC_IDENTICAL or SYNC_CHANGED (-1 if cancelled)
+static int sync_compare_files(SyncBuild* b, const char* rel, const char* name, uint64_t size)
+{
+    char item[FS_MAX_PATH];
+    char src[FS_MAX_PATH];
+    char dest[FS_MAX_PATH];
+    if (sync_rel_join(rel, name, item, sizeof(item)) != 0 ||
+        sync_full_path(b->plan->src, item, src, sizeof(src)) != 0 ||
+        sync_full_path(b->plan->dest, item, dest, sizeof(dest)) != 0)
+        return SYNC_CHANGED;
+
+    if (b->compare == SYNC_COMPARE_CONTENT) {
+        int same = sync_same_content(b, src, dest, size);
+        return same < 0 ? -1 : same ? SYNC_IDENTICAL : SYNC_CHANGED;
+    }
+
+    // Copies get a new timestamp, so an up-to-date copy is never older
+    uint64_t src_time;
+    uint64_t dest_time;
+    if (vfs_get_mtime(src, &src_time) != 0 || vfs_get_mtime(dest, &dest_time) != 0)
+        return SYNC_CHANGED;
+    return dest_time >= src_time ? SYNC_IDENTICAL : SYNC_CHANGED;
+}
+
+// Record source entry 'i' of 'src' as new
+static int sync_add_new(SyncBuild* b, const char* rel, const FsDirectory* src, int i)
+{
+    char item[FS_MAX_PATH];
+    if (sync_rel_join(rel, fs_dir_name(src, i), item, sizeof(item)) != 0)
+        return -1;
+
+    uint64_t size = fs_dir_size(src, i);
+    int is_dir = fs_dir_is_dir(src, i);
+    if (is_dir) {
+        char path[FS_MAX_PATH];
+        if (sync_full_path(b->plan->src, item, path, sizeof(path)) != 0)
+            return -1;
+        size = sync_tree_bytes(path, b->cancel);
+    }
+    return sync_add(b->plan, item, SYNC_NEW, is_dir, size);
+}
+
+static int sync_add_deleted(SyncBuild* b, const char* rel, const FsDirectory* dest, int i)
+{
+    char item[FS_MAX_PATH];
+    if (sync_rel_join(rel, fs_dir_name(dest, i), item, sizeof(item)) != 0)
+        return -1;
+    int is_dir = fs_dir_is_dir(dest, i);
+    uint64_t size = is_dir ? 0 : fs_dir_size(dest, i);
+    b->plan->summary.count[SYNC_DELETED]++;
+    b->plan->summary.bytes[SYNC_DELETED] += size;
+    return fs_dir_append(b->deletes, item, is_dir, size);
+}
+
+// Compare folder 'rel' on both sides; folders present on both go to 'queue'
+static int sync_compare_dir(SyncBuild* b, const char* rel, FsDirectory* queue)
+{
+    char path[FS_MAX_PATH];
+    FsDirectory* src = fs_dir_create(64);
+    FsDirectory* dest = fs_dir_create(64);
+    SyncName* src_names = NULL;
+    SyncName* dest_names = NULL;
+    int rc = -1;
+
+    // Pauses wait here, between folders
+    if (progress_checkpoint(b->progress))
+        rc = 1;
+    if (rc == 1 || src == NULL || dest == NULL)
+        goto out;
+    if (sync_full_path(b->plan->src, rel, path, sizeof(path)) != 0 ||
+        vfs_list(path, src, NULL, NULL, NULL) != 0)
+        goto out;
+    progress_set_current(b->progress, path);
+    // A destination that does not exist yet is empty
+    if (sync_full_path(b->plan->dest, rel, path, sizeof(path)) != 0)
+        goto out;
+    vfs_list(path, dest, NULL, NULL, NULL);
+    b->plan->summary.dirs++;
+
+    src_names = sync_sorted(src);
+    dest_names = sync_sorted(dest);
+    if (src_names == NULL || dest_names == NULL)
+        goto out;
+
+    int ns = fs_dir_count(src);
+    int nd = fs_dir_count(dest);
+    int i = 0;
+    int j = 0;
+    rc = 0;
+    while (rc == 0 && (i < ns || j < nd)) {
+        int order = i >= ns ? 1 : j >= nd ? -1 : strcmp(src_names[i].name, dest_names[j].name);
+        if (order < 0) {
+            rc = sync_add_new(b, rel, src, src_names[i++].index);
+            continue;
+        }
+        if (order > 0) {
+            rc = sync_add_deleted(b, rel, dest, dest_names[j++].index);
+            continue;
+        }
+
+        int si = src_names[i++].index;
+        int di = dest_names[j++].index;
+        const char* name = fs_dir_name(src, si);
+        int src_dir = fs_dir_is_dir(src, si);
+        if (src_dir != fs_dir_is_dir(dest, di)) {
+            // A file where a folder was, or the reverse: replace it
+            rc = sync_add_deleted(b, rel, dest, di);
+            if (rc == 0)
+                rc = sync_add_new(b, rel, src, si);
+        } else if (src_dir) {
+            char item[FS_MAX_PATH];
+            rc = sync_rel_join(rel, name, item, sizeof(item));
+            if (rc == 0)
+                rc = fs_dir_append(queue, item, 1, 0);
+        } else {
+            uint64_t size = fs_dir_size(src, si);
+            int action = SYNC_CHANGED;
+            if (size == fs_dir_size(dest, di)) {
+                if (progress_checkpoint(b->progress)) {
+                    rc = 1;
+                    break;
+                }
+                action = sync_compare_files(b, rel, name, size);
+            }
+            if (action < 0) {
+                rc = 1;
+            } else if (action == SYNC_IDENTICAL) {
+                b->plan->summary.count[SYNC_IDENTICAL]++;
+                b->plan->summary.bytes[SYNC_IDENTICAL] += size;
+            } else {
+                char item[FS_MAX_PATH];
+                rc = sync_rel_join(rel, name, item, sizeof(item));
+                if (rc == 0)
+                    rc = sync_add(b->plan, item, SYNC_CHANGED, 0, size);
+            }
+        }
+    }
+
+out:
+    free(src_names);
+    free(dest_names);
+    fs_free_directory(src);
+    fs_free_directory(dest);
+    return rc;
+}
+
+// Put the collected deletes in front of the copies
+static int sync_finish(SyncBuild* b)
+{
+    SyncPlan* plan = b->plan;
+    int deletes = fs_dir_count(b->deletes);
+    int copies = fs_dir_count(plan->items);
+    if (deletes == 0)
+        return 0;
+
+    FsDirectory* items = fs_dir_create(deletes + copies);
+    uint8_t* actions = (uint8_t*)malloc(deletes + copies);
+    int rc = items != NULL && actions != NULL ? 0 : -1;
+    for (int i = 0; rc == 0 && i < deletes; i++) {
+        rc = fs_dir_append(items, fs_dir_name(b->deletes, i), fs_dir_is_dir(b->deletes, i),
+                           fs_dir_size(b->deletes, i));
+        actions[i] = SYNC_DELETED;
+    }
+    for (int i = 0; rc == 0 && i < copies; i++) {
+        rc = fs_dir_append(items, fs_dir_name(plan->items, i), fs_dir_is_dir(plan->items, i),
+                           fs_dir_size(plan->items, i));
+        actions[deletes + i] = plan->actions[i];
+    }
+    if (rc != 0) {
+        fs_free_directory(items);
+        free(actions);
+        return -1;
+    }
+
+    fs_free_directory(plan->items);
+    free(plan->actions);
+    plan->items = items;
+    plan->actions = actions;
+    plan->action_capacity = deletes + copies;
+    return 0;
+}
+
+SyncPlan* sync_plan_build(const char* src, const char* dest, SyncCompare compare,
+                          Progress* progress)
+{
+    if (src == NULL || dest == NULL)
+        return NULL;
+
+    SyncPlan* plan = (SyncPlan*)calloc(1, sizeof(SyncPlan));
+    if (plan == NULL)
+        return NULL;
+    path_canonicalize(src, plan->src, sizeof(plan->src));
+    path_canonicalize(dest, plan->dest, sizeof(plan->dest));
+    plan->items = fs_dir_create(64);
+    plan->action_capacity = 64;
+    plan->actions = (uint8_t*)malloc(plan->action_capacity);
+
+    SyncBuild b = {0};
+    b.plan = plan;
+    b.deletes = fs_dir_create(16);
+    b.compare = compare;
+    b.progress = progress;
+    b.cancel = progress_cancel_flag(progress);
+    if (compare == SYNC_COMPARE_CONTENT)
+        b.probe = (uint8_t*)malloc(2 * SYNC_PROBE_BYTES);
+
+    // Both sides inside each other would never finish
+    VfsStat st;
+    int rc = -1;
+    FsDirectory* queue = fs_dir_create(16);
+    if (plan->items != NULL && plan->actions != NULL && b.deletes != NULL && queue != NULL &&
+        (compare != SYNC_COMPARE_CONTENT || b.probe != NULL) &&
+        !path_is_within(plan->dest, plan->src) && !path_is_within(plan->src, plan->dest) &&
+        vfs_stat(plan->src, &st) == 0 && st.is_dir) {
+        uint64_t start = fs_now_ns();
+        progress_set_phase(progress, PROGRESS_SCANNING);
+        if (vfs_session_acquire() == 0) {
+            rc = sync_compare_dir(&b, "", queue);
+            for (int i = 0; rc == 0 && i < fs_dir_count(queue); i++)
+                rc = sync_compare_dir(&b, fs_dir_name(queue, i), queue);
+            vfs_session_release();
+        }
+        if (rc == 0)
+            rc = sync_finish(&b);
+        plan->summary.elapsed_ns = fs_now_ns() - start;
+    }
+
+    fs_free_directory(queue);
+    fs_free_directory(b.deletes);
+    free(b.probe);
+    if (rc != 0) {
+        sync_plan_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void sync_plan_free(SyncPlan* plan)
+{
+    if (plan == NULL)
+        return;
+    fs_free_directory(plan->items);
+    free(plan->actions);
+    free(plan);
+}
+
+void sync_plan_summary(const SyncPlan* plan, SyncSummary* out)
+{
+    if (out == NULL)
+        return;
+    if (plan == NULL)
+        memset(out, 0, sizeof(*out));
+    else
+        *out = plan->summary;
+}
+
+int sync_plan_count(const SyncPlan* plan)
+{
+    return plan != NULL ? fs_dir_count(plan->items) : 0;
+}
+
+const char* sync_plan_item(const SyncPlan* plan, int index, SyncAction* action, int* is_dir,
+                           uint64_t* size)
+{
+    if (plan == NULL || index < 0 || index >= fs_dir_count(plan->items))
+        return NULL;
+    if (action != NULL)
+        *action = (SyncAction)plan->actions[index];
+    if (is_dir != NULL)
+        *is_dir = fs_dir_is_dir(plan->items, index);
+    if (size != NULL)
+        *size = fs_dir_size(plan->items, index);
+    return fs_dir_name(plan->items, index);
+}
+
+int sync_plan_execute(const SyncPlan* plan, Progress* progress)
+{
+    if (plan == NULL)
+        return -1;
+    if (vfs_mkdir(plan->dest) != 0)
+        return -1;
+
+    int failed = 0;
+    for (int i = 0; i < fs_dir_count(plan->items); i++) {
+        if (progress_checkpoint(progress))
+            return COPY_CANCELLED;
+
+        const char* rel = fs_dir_name(plan->items, i);
+        char src[FS_MAX_PATH];
+        char dest[FS_MAX_PATH];
+        if (sync_full_path(plan->src, rel, src, sizeof(src)) != 0 ||
+            sync_full_path(plan->dest, rel, dest, sizeof(dest)) != 0) {
+            failed = 1;
+            continue;
+        }
+
+        int rc;
+        VfsStat st;
+        if (plan->actions[i] == SYNC_DELETED) {
+            // Already gone is as good as deleted
+            rc = vfs_stat(dest, &st) == 0 ? delete_item(dest, progress) : 0;
+        } else {
+            char parent[512];
+            rc = path_get_parent(dest, parent) == 0 ? copy_item(src, parent, progress) : -1;
+        }
+
+        if (rc == COPY_CANCELLED || rc == COPY_ERR_NO_SPACE)
+            return rc;
+        if (rc != 0)
+            failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+void sync_plan_keep(SyncPlan* plan)
+{
+    pthread_mutex_lock(&g_kept_lock);
+    SyncPlan* old = g_kept;
+    g_kept = plan;
+    pthread_mutex_unlock(&g_kept_lock);
+    sync_plan_free(old);
+}
+
+// 1 if the held plan is for 'src' and 'dest' (lock held)
+static int sync_kept_matches(const char* src, const char* dest)
+{
+    char csrc[FS_MAX_PATH];
+    char cdest[FS_MAX_PATH];
+    path_canonicalize(src, csrc, sizeof(csrc));
+    path_canonicalize(dest, cdest, sizeof(cdest));
+    return g_kept != NULL && strcmp(g_kept->src, csrc) == 0 && strcmp(g_kept->dest, cdest) == 0;
+}
+
+SyncPlan* sync_plan_take(const char* src, const char* dest)
+{
+    if (src == NULL || dest == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&g_kept_lock);
+    SyncPlan* plan = NULL;
+    if (sync_kept_matches(src, dest)) {
+        plan = g_kept;
+        g_kept = NULL;
+    }
+    pthread_mutex_unlock(&g_kept_lock);
+    return plan;
+}
+
+int sync_plan_kept(const char* src, const char* dest)
+{
+    if (src == NULL || dest == NULL)
+        return -1;
+
+    pthread_mutex_lock(&g_kept_lock);
+    int count = sync_kept_matches(src, dest) ? sync_plan_count(g_kept) : -1;
+    pthread_mutex_unlock(&g_kept_lock);
+    return count;
+}
+
+static void sync_format_bytes(uint64_t bytes, char* out, int size)
+{
+    if (bytes > 10ull << 30)
+        snprintf(out, size, "%lluGB", (unsigned long long)(bytes >> 30));
+    else if (bytes > 1ull << 20)
+        snprintf(out, size, "%lluMB", (unsigned long long)(bytes >> 20));
+    else if (bytes > 1ull << 10)
+        snprintf(out, size, "%lluKB", (unsigned long long)(bytes >> 10));
+    else
+        snprintf(out, size, "%lluB", (unsigned long long)bytes);
+}
+
+void sync_format_summary(const SyncSummary* summary, char* out, int size)
+{
+    if (summary == NULL || out == NULL || size <= 0)
+        return;
+
+    char copy[32];
+    sync_format_bytes(summary->bytes[SYNC_NEW] + summary->bytes[SYNC_CHANGED], copy, sizeof(copy));
+    snprintf(out, size, "%llu new, %llu changed (%s to copy)\n%llu to delete, %llu identical",
+             (unsigned long long)summary->count[SYNC_NEW],
+             (unsigned long long)summary->count[SYNC_CHANGED], copy,
+             (unsigned long long)summary->count[SYNC_DELETED],
+             (unsigned long long)summary->count[SYNC_IDENTICAL]);
+}
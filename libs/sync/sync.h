@@ -0,0 +1,131 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include "fs.h"
+#include "progress.h"
+
+/**
+ * Folder sync module
+ *
+ * Compares a source folder with a destination folder and brings the
+ * destination up to date, skipping what is already there. Comparing
+ * builds a plan first: every file and folder that is new on the source
+ * side, changed, or only left at the destination, plus a count of the
+ * identical ones. The plan can be shown for review and then executed,
+ * which deletes what the source no longer has and copies the rest
+ * through the copy engine.
+ *
+ * The comparison lists each pair of folders once and merges the two
+ * sorted listings, so an unchanged tree costs little more than reading
+ * its metadata. Files are compared by size and timestamp, or (with
+ * SYNC_COMPARE_CONTENT) by size, then the first and last
+ * SYNC_PROBE_BYTES, and only then by a full CRC32 of both sides.
+ */
+
+typedef enum {
+    SYNC_IDENTICAL = 0,      // Same on both sides (counted, not kept in plans)
+    SYNC_NEW,                // Only at the source: copy
+    SYNC_CHANGED,            // Both sides, contents differ: copy over
+    SYNC_DELETED,            // Only at the destination: delete
+    SYNC_ACTION_COUNT,
+} SyncAction;
+
+typedef enum {
+    SYNC_COMPARE_METADATA = 0,  // Same size and the copy is not older
+    SYNC_COMPARE_CONTENT,       // Same size and the same bytes
+} SyncCompare;
+
+/* Bytes compared at each end of a file before hashing it in full */
+#define SYNC_PROBE_BYTES (64u << 10)
+
+/**
+ * SyncSummary - What a plan holds and what building it cost
+ */
+typedef struct {
+    uint64_t count[SYNC_ACTION_COUNT];   // Items per action
+    uint64_t bytes[SYNC_ACTION_COUNT];   // Their bytes (source side; destination for deletes)
+    uint64_t dirs;           // Folder pairs compared
+    uint64_t probed;         // Files whose ends were compared
+    uint64_t hashed;         // Files hashed in full (both sides)
+    uint64_t elapsed_ns;     // Time spent comparing
+} SyncSummary;
+
+/* A source and destination pair with its pending actions */
+typedef struct SyncPlan SyncPlan;
+
+/**
+ * sync_plan_build(src, dest, compare, progress)
+ * Compare folder 'src' with folder 'dest' ('dest' need not exist yet) by
+ * SyncCompare 'compare'. The folder being compared goes to 'progress'
+ * (may be NULL, PROGRESS_SCANNING), whose pause and cancel requests are
+ * honoured between files.
+ * Returns the plan, or NULL on error or if cancelled.
+ * Release with sync_plan_free().
+ */
+SyncPlan* sync_plan_build(const char* src, const char* dest, SyncCompare compare,
+                          Progress* progress);
+
+/**
+ * sync_plan_free(plan)
+ * Release a plan (NULL is ignored).
+ */
+void sync_plan_free(SyncPlan* plan);
+
+/**
+ * sync_plan_summary(plan, out) / sync_plan_count(plan)
+ * The plan's totals, and the number of items to act on.
+ */
+void sync_plan_summary(const SyncPlan* plan, SyncSummary* out);
+int sync_plan_count(const SyncPlan* plan);
+
+/**
+ * sync_plan_item(plan, index, action, is_dir, size)
+ * Path of item 'index' relative to both folders, with its action, type
+ * and size (any out pointer may be NULL). Deletes come before copies.
+ * Returns NULL if 'index' is out of range.
+ */
+const char* sync_plan_item(const SyncPlan* plan, int index, SyncAction* action, int* is_dir,
+                           uint64_t* size);
+
+/**
+ * sync_plan_execute(plan, progress)
+ * Apply a plan: delete the SYNC_DELETED items, then copy the SYNC_NEW
+ * and SYNC_CHANGED ones with copy_item(). Items that fail are skipped
+ * and the rest carried out. Reports to 'progress' (may be NULL) like
+ * copy_item() and delete_item().
+ * Returns 0 on success, COPY_CANCELLED, COPY_ERR_NO_SPACE (nothing after
+ * that item is copied), or -1 if any item failed.
+ */
+int sync_plan_execute(const SyncPlan* plan, Progress* progress);
+
+/**
+ * sync_plan_keep(plan) / sync_plan_take(src, dest)
+ * Hold a reviewed plan until it is executed: sync_plan_keep() takes
+ * ownership (replacing and freeing any plan held before) and
+ * sync_plan_take() hands it back if it is for 'src' and 'dest', or
+ * returns NULL. Safe to call from any thread.
+ */
+void sync_plan_keep(SyncPlan* plan);
+SyncPlan* sync_plan_take(const char* src, const char* dest);
+
+/**
+ * sync_plan_kept(src, dest)
+ * Returns the number of items in the plan held for 'src' and 'dest', or
+ * -1 if none is held.
+ */
+int sync_plan_kept(const char* src, const char* dest);
+
+/**
+ * sync_format_summary(summary, out, size)
+ * Describe a plan in two short lines, e.g.
+ * "3 new, 1 changed (12MB to copy)\n2 to delete, 9994 identical".
+ */
+void sync_format_summary(const SyncSummary* summary, char* out, int size);
+
+/**
+ * sync_action_name(action)
+ * Display name of a SyncAction ("identical", "new", "changed", "deleted").
+ */
+const char* sync_action_name(SyncAction action);
+
+#endif
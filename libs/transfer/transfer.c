@@ -0,0 +1,387 @@
+#include "transfer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../vfs/vfs.h"
+#include "../journal/journal.h"
+#include "../hash/hash.h"
+
+/**
+ * Transfer implementation
+ *
+ * The ring is a fixed array of slots. The reader fills the slot after
+ * the last filled one and the writer drains from 'head'; 'filled' counts
+ * slots waiting to be written. Both sides do their I/O outside the lock
+ * and only take it to hand a slot over.
+ */
+
+typedef struct {
+    uint8_t* data;
+    uint64_t offset;         // File offset of the chunk
+    uint64_t size;           // Bytes in the chunk
+} TransferSlot;
+
+typedef struct {
+    VfsFile* out;
+    Progress* progress;
+    int journal;             // Journal handle, -1 if not recorded
+    uint64_t committed;      // Offset last committed to the journal
+    HashContext* hash;       // Source hash for verification, or NULL
+    TransferSlot slots[TRANSFER_MAX_BUFFERS];
+    int count;               // Slots in the ring
+    int head;                // Next slot to write
+    int filled;              // Slots waiting to be written
+    int done;                // Reader finished
+    int abort;               // Reader gave up: drop unwritten chunks
+    int error;               // Writer failed
+    uint64_t written;        // Bytes written, always a prefix of the file
+    uint64_t writes;
+    uint64_t writer_wait_ns;
+    pthread_mutex_t lock;
+    pthread_cond_t can_read;
+    pthread_cond_t can_write;
+} TransferRing;
+
+static void transfer_defaults(const TransferOptions* in, TransferOptions* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (in != NULL)
+        *out = *in;
+    if (out->chunk_min == 0)
+        out->chunk_min = TRANSFER_CHUNK_MIN;
+    if (out->chunk_max == 0)
+        out->chunk_max = TRANSFER_CHUNK_MAX;
+    if (out->chunk_max < out->chunk_min)
+        out->chunk_max = out->chunk_min;
+    if (out->buffers < 2)
+        out->buffers = TRANSFER_BUFFERS;
+    if (out->buffers > TRANSFER_MAX_BUFFERS)
+        out->buffers = TRANSFER_MAX_BUFFERS;
+}
+
+static void* transfer_alloc(uint64_t size)
+{
+    // aligned_alloc wants a multiple of the alignment
+    size = (size + TRANSFER_ALIGN - 1) & ~(uint64_t)(TRANSFER_ALIGN - 1);
+    return aligned_alloc(TRANSFER_ALIGN, size);
+}
+
+// Buffer size for a file: enough that the ring holds the whole file,
+// within [chunk_min, chunk_max]
+static uint32_t transfer_buffer_size(const TransferOptions* opt, uint64_t file_size)
+{
+    if (opt->fixed)
+        return opt->chunk_max;
+
+    uint64_t want = file_size / (uint64_t)opt->buffers;
+    uint32_t size = opt->chunk_min;
+    while (size < opt->chunk_max && size < want)
+        size *= 2;
+    return size > opt->chunk_max ? opt->chunk_max : size;
+}
+
+static int transfer_serial(VfsFile* in, VfsFile* out, uint64_t start, uint64_t file_size,
+                           HashContext* hash, Progress* progress, const atomic_int* cancel,
+                           TransferStats* stats)
+{
+    uint64_t size = file_size < TRANSFER_CHUNK_MIN ? file_size : TRANSFER_CHUNK_MIN;
+    uint8_t* buf = (uint8_t*)malloc(size > 0 ? size : 1);
+    if (buf == NULL)
+        return -1;
+    stats->buffer_size = stats->chunk_final = (uint32_t)size;
+
+    uint64_t offset = start;
+    int rc = 0;
+    while (rc == 0) {
+        if ((cancel != NULL && atomic_load(cancel)) || progress_checkpoint(progress)) {
+            rc = 1;
+            break;
+        }
+        int64_t n = vfs_read(in, offset, buf, size > 0 ? size : 1);
+        stats->reads++;
+        if (n < 0) { rc = -1; break; }
+        if (n == 0) break;
+        if (vfs_write(out, offset, buf, (uint64_t)n) != 0) { rc = -1; break; }
+        stats->writes++;
+        hash_update(hash, buf, (uint64_t)n);
+        offset += (uint64_t)n;
+        progress_add_done(progress, 0, (uint64_t)n);
+    }
+
+    stats->bytes = offset - start;
+    free(buf);
+    return rc;
+}
+
+static void* transfer_writer(void* arg)
+{
+    TransferRing* ring = (TransferRing*)arg;
+
+    pthread_mutex_lock(&ring->lock);
+    while (1) {
+        uint64_t wait_start = fs_now_ns();
+        while (ring->filled == 0 && !ring->done && !ring->abort)
+            pthread_cond_wait(&ring->can_write, &ring->lock);
+        ring->writer_wait_ns += fs_now_ns() - wait_start;
+        if (ring->filled == 0 || ring->abort)
+            break;  // Ring drained after the reader finished, or aborted
+
+        TransferSlot* slot = &ring->slots[ring->head];
+        pthread_mutex_unlock(&ring->lock);
+
+        int rc = vfs_write(ring->out, slot->offset, slot->data, slot->size);
+        if (rc == 0)
+            progress_add_done(ring->progress, 0, slot->size);
+        // In file order, while the slot is still ours
+        if (rc == 0)
+            hash_update(ring->hash, slot->data, slot->size);
+
+        // Chunks are written in order, so everything up to here is in place
+        uint64_t end = slot->offset + slot->size;
+        if (rc == 0 && ring->journal >= 0 && end - ring->committed >= JOURNAL_COMMIT_BYTES &&
+            vfs_flush(ring->out) == 0 &&
+            journal_commit(ring->journal, end, slot->data, slot->size) == 0)
+            ring->committed = end;
+
+        pthread_mutex_lock(&ring->lock);
+        ring->writes++;
+        if (rc == 0)
+            ring->written += slot->size;
+        if (rc != 0) {
+            ring->error = 1;
+            pthread_cond_signal(&ring->can_read);
+            break;
+        }
+        ring->head = (ring->head + 1) % ring->count;
+        ring->filled--;
+        pthread_cond_signal(&ring->can_read);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return NULL;
+}
+
+static int transfer_pipeline(VfsFile* in, VfsFile* out, uint64_t file_size, int journal,
+                             HashContext* hash, const TransferOptions* opt, Progress* progress,
+                             const atomic_int* cancel, TransferStats* stats)
+{
+    TransferRing ring;
+    memset(&ring, 0, sizeof(ring));
+    ring.out = out;
+    ring.hash = hash;
+    ring.progress = progress;
+    ring.journal = journal;
+    ring.committed = opt->resume_offset;
+    ring.count = opt->buffers;
+
+    uint32_t buffer_size = transfer_buffer_size(opt, file_size);
+    for (int i = 0; i < ring.count; i++) {
+        ring.slots[i].data = (uint8_t*)transfer_alloc(buffer_size);
+        if (ring.slots[i].data == NULL) {
+            for (int j = 0; j < i; j++)
+                free(ring.slots[j].data);
+            return -1;
+        }
+    }
+    stats->buffer_size = buffer_size;
+    stats->pipelined = 1;
+
+    pthread_mutex_init(&ring.lock, NULL);
+    pthread_cond_init(&ring.can_read, NULL);
+    pthread_cond_init(&ring.can_write, NULL);
+
+    pthread_t writer;
+    int rc = 0;
+    if (pthread_create(&writer, NULL, transfer_writer, &ring) != 0) {
+        rc = -1;
+    } else {
+        uint32_t chunk = opt->fixed ? buffer_size :
+                         (opt->chunk_min < buffer_size ? opt->chunk_min : buffer_size);
+        uint64_t offset = opt->resume_offset;
+        int tail = 0;
+        while (1) {
+            if ((cancel != NULL && atomic_load(cancel)) || progress_checkpoint(progress)) {
+                rc = 1;
+                break;
+            }
+
+            // Wait for a free slot
+            pthread_mutex_lock(&ring.lock);
+            uint64_t wait_start = fs_now_ns();
+            while (ring.filled == ring.count && !ring.error)
+                pthread_cond_wait(&ring.can_read, &ring.lock);
+            stats->reader_wait_ns += fs_now_ns() - wait_start;
+            int error = ring.error;
+            pthread_mutex_unlock(&ring.lock);
+            if (error) {
+                rc = -1;
+                break;
+            }
+
+            TransferSlot* slot = &ring.slots[tail];
+            uint64_t read_start = fs_now_ns();
+            int64_t n = vfs_read(in, offset, slot->data, chunk);
+            uint64_t read_ns = fs_now_ns() - read_start;
+            stats->reads++;
+            if (n < 0) {
+                rc = -1;
+                break;
+            }
+            if (n == 0)
+                break;
+
+            slot->offset = offset;
+            slot->size = (uint64_t)n;
+            offset += (uint64_t)n;
+            tail = (tail + 1) % ring.count;
+
+            pthread_mutex_lock(&ring.lock);
+            ring.filled++;
+            pthread_cond_signal(&ring.can_write);
+            pthread_mutex_unlock(&ring.lock);
+
+            // Adapt only on full chunks; the tail of the file says nothing
+            if (!opt->fixed && (uint64_t)n == chunk) {
+                if (read_ns < TRANSFER_GROW_NS && chunk * 2 <= buffer_size)
+                    chunk *= 2;
+                else if (read_ns > TRANSFER_SHRINK_NS && chunk / 2 >= opt->chunk_min)
+                    chunk /= 2;
+            }
+        }
+        stats->chunk_final = chunk;
+
+        // Let the writer drain what was read (or drop it), then stop it
+        pthread_mutex_lock(&ring.lock);
+        ring.done = 1;
+        ring.abort = (rc != 0);
+        pthread_cond_signal(&ring.can_write);
+        pthread_mutex_unlock(&ring.lock);
+        pthread_join(writer, NULL);
+
+        if (rc == 0 && ring.error)
+            rc = -1;
+        stats->bytes = ring.written;
+        stats->writes = ring.writes;
+        stats->writer_wait_ns = ring.writer_wait_ns;
+    }
+
+    pthread_cond_destroy(&ring.can_write);
+    pthread_cond_destroy(&ring.can_read);
+    pthread_mutex_destroy(&ring.lock);
+    for (int i = 0; i < ring.count; i++)
+        free(ring.slots[i].data);
+    return rc;
+}
+
+// Read 'dest' back and compare it with the hash of what was written
+static int transfer_verify(const char* dest, HashContext* source, const atomic_int* cancel)
+{
+    HashDigest expected;
+    HashDigest written[HASH_ALGO_COUNT];
+    hash_final(source, &expected);
+    int rc = hash_file(dest, HASH_MASK(expected.algo), written, NULL, cancel);
+    if (rc != 0)
+        return rc;
+    return hash_equal(&expected, &written[expected.algo]) ? 0 : TRANSFER_ERR_VERIFY;
+}
+
+// Read both files back and compare them (a resumed copy never saw the
+// bytes written before it started)
+static int transfer_compare(const char* src, const char* dest, HashAlgo algo, const atomic_int* cancel)
+{
+    HashDigest read[HASH_ALGO_COUNT];
+    HashDigest written[HASH_ALGO_COUNT];
+    int rc = hash_file(src, HASH_MASK(algo), read, NULL, cancel);
+    if (rc == 0)
+        rc = hash_file(dest, HASH_MASK(algo), written, NULL, cancel);
+    if (rc != 0)
+        return rc;
+    return hash_equal(&read[algo], &written[algo]) ? 0 : TRANSFER_ERR_VERIFY;
+}
+
+int transfer_file(const char* src, const char* dest, const TransferOptions* options,
+                  Progress* progress, const atomic_int* cancel, TransferStats* stats)
+{
+    TransferStats local;
+    if (stats == NULL)
+        stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    if (src == NULL || dest == NULL)
+        return -1;
+
+    TransferOptions opt;
+    transfer_defaults(options, &opt);
+    uint64_t start = fs_now_ns();
+
+    VfsFile* in = vfs_open(src, VFS_OPEN_READ);
+    if (in == NULL)
+        return -1;
+    uint64_t file_size = 0;
+    if (vfs_get_size(in, &file_size) != 0) {
+        vfs_close(in);
+        return -1;
+    }
+
+    // Allocated at its final size, then written in place. A resumed copy
+    // keeps what is there and only makes sure the length is right.
+    VfsFile* out = NULL;
+    if (opt.resume_offset > file_size)
+        opt.resume_offset = 0;
+    if (opt.resume_offset > 0) {
+        uint64_t dest_size = 0;
+        out = vfs_open(dest, VFS_OPEN_WRITE);
+        if (out != NULL && (vfs_get_size(out, &dest_size) != 0 ||
+                            (dest_size != file_size && vfs_set_size(out, file_size) != 0))) {
+            vfs_close(out);
+            out = NULL;
+        }
+    } else {
+        out = vfs_create(dest, file_size);
+    }
+    if (out == NULL) {
+        vfs_close(in);
+        return -1;
+    }
+
+    int journal = -1;
+    uint64_t mtime = 0;
+    if (file_size >= JOURNAL_MIN_SIZE && vfs_get_mtime(src, &mtime) == 0)
+        journal = journal_begin(src, dest, file_size, mtime, opt.resume_offset);
+
+    int verify = opt.verify > HASH_NONE && opt.verify < HASH_ALGO_COUNT;
+    HashContext source_hash;
+    HashContext* hash = NULL;
+    if (verify && opt.resume_offset == 0) {
+        hash_init(&source_hash, (HashAlgo)opt.verify);
+        hash = &source_hash;
+    }
+
+    int rc;
+    if (file_size >= TRANSFER_PIPELINE_MIN)
+        rc = transfer_pipeline(in, out, file_size, journal, hash, &opt, progress, cancel, stats);
+    else
+        rc = transfer_serial(in, out, opt.resume_offset, file_size, hash, progress, cancel, stats);
+
+    // Cut the preallocated tail if the copy stopped early or the source
+    // shrank while it was read
+    uint64_t end = opt.resume_offset + stats->bytes;
+    if (end != file_size)
+        vfs_set_size(out, end);
+
+    vfs_close(in);
+    vfs_close(out);
+
+    if (rc == 0 && verify) {
+        const atomic_int* stop = cancel != NULL ? cancel : progress_cancel_flag(progress);
+        uint64_t verify_start = fs_now_ns();
+        rc = hash != NULL ? transfer_verify(dest, hash, stop) :
+                            transfer_compare(src, dest, (HashAlgo)opt.verify, stop);
+        stats->verify_ns = fs_now_ns() - verify_start;
+    }
+
+    // A failed copy stays recorded; done, cancelled and mismatched ones
+    // are dropped (a mismatch cannot be trusted as a resume point)
+    journal_end(journal, rc == -1);
+    stats->elapsed_ns = fs_now_ns() - start;
+    return rc;
+}
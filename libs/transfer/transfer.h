@@ -0,0 +1,101 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include "fs.h"
+#include <stdatomic.h>
+#include "progress.h"
+
+/**
+ * Transfer module
+ *
+ * Copies file contents through the VFS. Large files go through a
+ * pipeline: the calling thread reads into a ring of large aligned
+ * buffers while a writer thread drains it, so reads and writes overlap.
+ *
+ * The chunk size adapts while copying. It starts at TRANSFER_CHUNK_MIN,
+ * doubles while a read finishes faster than TRANSFER_GROW_NS (per-call
+ * overhead dominates), and halves when one takes longer than
+ * TRANSFER_SHRINK_NS (keeps cancel latency low), staying within the
+ * buffers allocated for the file. Files up to TRANSFER_PIPELINE_MIN are
+ * copied serially through a single buffer.
+ *
+ * The destination is created at the source's size before the first
+ * write (vfs_create()), so it is allocated in one piece rather than
+ * grown by every write.
+ *
+ * Files of JOURNAL_MIN_SIZE and up are recorded in the copy journal
+ * while they are copied: every JOURNAL_COMMIT_BYTES the writer flushes
+ * the destination and commits the offset, so an interrupted copy can be
+ * resumed later with TransferOptions.resume_offset.
+ *
+ * With TransferOptions.verify the copy is checked once written: the
+ * source's hash is taken from the chunks as they pass through (by the
+ * writer, off the reading thread), so only the destination is read back.
+ * A resumed copy has no hash of what was written before it, so both
+ * files are read back in full instead.
+ */
+
+/* Buffer sizes (bytes) */
+#define TRANSFER_CHUNK_MIN    (1u << 20)   // 1 MiB
+#define TRANSFER_CHUNK_MAX    (8u << 20)   // 8 MiB
+#define TRANSFER_ALIGN        0x1000       // Buffer alignment
+
+/* Buffers in the ring */
+#define TRANSFER_BUFFERS      3
+#define TRANSFER_MAX_BUFFERS  8
+
+/* Smallest file worth a writer thread */
+#define TRANSFER_PIPELINE_MIN (2ull * TRANSFER_CHUNK_MIN)
+
+/* transfer_file() result when the destination does not match the source */
+#define TRANSFER_ERR_VERIFY   -2
+
+/* Chunk adaptation thresholds, per read */
+#define TRANSFER_GROW_NS      (25ull * 1000000ull)
+#define TRANSFER_SHRINK_NS    (100ull * 1000000ull)
+
+/**
+ * TransferOptions - Tuning for one copy (zeroed fields take defaults)
+ */
+typedef struct {
+    uint32_t chunk_min;      // Smallest chunk (TRANSFER_CHUNK_MIN)
+    uint32_t chunk_max;      // Largest chunk (TRANSFER_CHUNK_MAX)
+    int buffers;             // Ring size, 2..TRANSFER_MAX_BUFFERS (TRANSFER_BUFFERS)
+    int fixed;               // 1 to always use chunk_max (no adaptation)
+    uint64_t resume_offset;  // Bytes of 'dest' already copied (0 = fresh copy)
+    int verify;              // HashAlgo to check the copy with (HASH_NONE = no check)
+} TransferOptions;
+
+/**
+ * TransferStats - What one copy did
+ */
+typedef struct {
+    uint64_t bytes;          // Bytes written to the destination by this call
+    uint64_t reads;          // Read calls
+    uint64_t writes;         // Write calls
+    uint32_t chunk_final;    // Chunk size in use at the end
+    uint32_t buffer_size;    // Size of each ring buffer
+    int pipelined;           // 1 if the writer thread was used
+    uint64_t reader_wait_ns; // Reader blocked on a full ring
+    uint64_t writer_wait_ns; // Writer blocked on an empty ring
+    uint64_t verify_ns;      // Reading the destination back (0 if not verified)
+    uint64_t elapsed_ns;     // Wall time, verification included
+} TransferStats;
+
+/**
+ * transfer_file(src, dest, options, progress, cancel, stats)
+ * Copy the contents of file 'src' to 'dest' (created or truncated; with
+ * a resume offset, kept and continued from there). 'options',
+ * 'progress', 'cancel' and 'stats' may be NULL. Bytes are added to
+ * 'progress' as they are written. 'cancel' and the pause and cancel
+ * requests of 'progress' are honoured between chunks. A resumed copy is
+ * verified by reading back both files in full.
+ * Returns 0 on success, 1 if cancelled, TRANSFER_ERR_VERIFY if the
+ * written file reads back different, -1 on other errors. A cancelled or
+ * failed copy leaves 'dest' holding the bytes written so far; the
+ * journal keeps the record of a failed one for a later resume.
+ */
+int transfer_file(const char* src, const char* dest, const TransferOptions* options,
+                  Progress* progress, const atomic_int* cancel, TransferStats* stats);
+
+#endif
@@ -0,0 +1,361 @@
+#include "trash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../utils/utils.h"
+#include "../vfs/vfs.h"
+#include "../walk/walk.h"
+#include "../dircache/dircache.h"
+#include "../dirsize/dirsize.h"
+
+/**
+ * Trash implementation
+ *
+ * Items are renamed to "<session>-<n>" directly inside the trash folder,
+ * so a delete is one rename whatever the item holds. The items of a batch
+ * share one such entry, a folder holding them under their own names, so
+ * they are undone and purged together. The original path
+ * lives only in the table of held items; leftovers from earlier runs are
+ * kept as a list of names and handed out first. One lock guards the
+ * table, and is held across the rename of a move or restore so an item
+ * is never handed out for purging halfway through either.
+ */
+
+typedef struct {
+    int used;
+    uint32_t seq;                // Order of the deletes
+    uint64_t trashed_ns;
+    int items;                   // Items in a batch entry (0: the entry is the item)
+    TrashItem item;
+} TrashSlot;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_dir[FS_MAX_PATH] = "";
+static uint64_t g_session = 0;
+static uint32_t g_next_seq = 1;
+static TrashSlot g_slots[TRASH_MAX_ENTRIES];
+static FsDirectory* g_leftovers = NULL;  // Names to purge, unknown origin
+static int g_leftover_next = 0;
+
+int trash_init(const char* dir)
+{
+    trash_cleanup();
+
+    pthread_mutex_lock(&g_lock);
+    path_canonicalize(dir != NULL ? dir : TRASH_DEFAULT_DIR, g_dir, sizeof(g_dir));
+    // Distinct from the names a previous run used
+    g_session = fs_now_ns();
+    g_next_seq = 1;
+
+    int count = 0;
+    g_leftovers = fs_dir_create(16);
+    if (g_leftovers != NULL && vfs_list(g_dir, g_leftovers, NULL, NULL, NULL) == 0)
+        count = fs_dir_count(g_leftovers);
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
+
+void trash_cleanup(void)
+{
+    pthread_mutex_lock(&g_lock);
+    fs_free_directory(g_leftovers);
+    g_leftovers = NULL;
+    g_leftover_next = 0;
+    memset(g_slots, 0, sizeof(g_slots));
+    g_dir[0] = '\0';
+    pthread_mutex_unlock(&g_lock);
+}
+
+// 'path' is canonical; lock held
+static int trash_contains_locked(const char* path)
+{
+    return g_dir[0] != '\0' && path_is_within(path, g_dir);
+}
+
+int trash_contains(const char* path)
+{
+    if (path == NULL)
+        return 0;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    pthread_mutex_lock(&g_lock);
+    int inside = trash_contains_locked(canon);
+    pthread_mutex_unlock(&g_lock);
+    return inside;
+}
+
+// The item's old and new places changed
+static void trash_invalidate(const char* a, const char* b)
+{
+    dircache_invalidate_entry(a);
+    dirsize_invalidate_entry(a);
+    dircache_invalidate_entry(b);
+    dirsize_invalidate_entry(b);
+}
+
+// Slot for a new item, pushing the oldest out if all are taken (lock held)
+static TrashSlot* trash_take_slot(void)
+{
+    TrashSlot* oldest = NULL;
+    for (int i = 0; i < TRASH_MAX_ENTRIES; i++) {
+        TrashSlot* slot = &g_slots[i];
+        if (!slot->used)
+            return slot;
+        if (oldest == NULL || slot->seq < oldest->seq)
+            oldest = slot;
+    }
+
+    // Its window ends now: it joins the leftovers waiting to be purged
+    if (g_leftovers == NULL)
+        g_leftovers = fs_dir_create(16);
+    if (fs_dir_append(g_leftovers, path_get_filename(oldest->item.entry), 1, 0) != 0)
+        return NULL;
+    memset(oldest, 0, sizeof(*oldest));
+    return oldest;
+}
+
+// Name a new entry of the trash, creating the trash if needed (lock held)
+static int trash_new_entry(char* entry, int size)
+{
+    if (vfs_mkdir(g_dir) != 0)
+        return -1;
+    VfsStat st;
+    do {
+        int len = snprintf(entry, size, "%s/%llx-%u", g_dir, (unsigned long long)g_session, g_next_seq++);
+        if (len < 0 || len >= size)
+            return -1;
+    } while (vfs_stat(entry, &st) == 0);
+    return 0;
+}
+
+// Hold 'entry', which came from 'origin', for undo (lock held)
+static void trash_fill_slot(TrashSlot* slot, const char* entry, const char* origin, int items)
+{
+    slot->used = 1;
+    slot->seq = g_next_seq;
+    slot->trashed_ns = fs_now_ns();
+    slot->items = items;
+    str_copy(slot->item.entry, entry, sizeof(slot->item.entry));
+    str_copy(slot->item.origin, origin, sizeof(slot->item.origin));
+}
+
+int trash_move(const char* path)
+{
+    if (path == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+
+    pthread_mutex_lock(&g_lock);
+    TrashSlot* slot = NULL;
+    char entry[FS_MAX_PATH];
+    int rc = -1;
+    // Never the trash itself or something holding it
+    if (g_dir[0] != '\0' && !trash_contains_locked(canon) && !path_is_within(g_dir, canon) &&
+        (slot = trash_take_slot()) != NULL && trash_new_entry(entry, sizeof(entry)) == 0 &&
+        vfs_rename(canon, entry) == 0) {
+        trash_fill_slot(slot, entry, canon, 0);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (rc == 0)
+        trash_invalidate(canon, g_dir);
+    return rc;
+}
+
+// Rename items 0..count-1 of 'canon' into folder 'entry' under their own
+// names, or put back those moved (lock held). Returns 0 when all moved.
+static int trash_move_into(char (*canon)[FS_MAX_PATH], int count, const char* entry)
+{
+    char dest[FS_MAX_PATH];
+    int moved = 0;
+    while (moved < count &&
+           walk_join(entry, path_get_filename(canon[moved]), dest, sizeof(dest)) == 0 &&
+           vfs_rename(canon[moved], dest) == 0)
+        moved++;
+    if (moved == count)
+        return 0;
+
+    while (moved-- > 0) {
+        walk_join(entry, path_get_filename(canon[moved]), dest, sizeof(dest));
+        vfs_rename(dest, canon[moved]);
+    }
+    return -1;
+}
+
+int trash_move_batch(const char* const* paths, int count)
+{
+    if (paths == NULL || count <= 0)
+        return -1;
+    if (count == 1)
+        return trash_move(paths[0]);
+
+    // Every item must come from one folder: that is where they go back to
+    char (*canon)[FS_MAX_PATH] = malloc(sizeof(*canon) * count);
+    char parent[FS_MAX_PATH];
+    char other[FS_MAX_PATH];
+    int rc = canon != NULL ? 0 : -1;
+    for (int i = 0; rc == 0 && i < count; i++) {
+        if (paths[i] == NULL) {
+            rc = -1;
+            break;
+        }
+        path_canonicalize(paths[i], canon[i], sizeof(canon[i]));
+        char* dir = i == 0 ? parent : other;
+        if (path_get_parent(canon[i], dir) != 0)
+            str_copy(dir, "/", sizeof(parent));
+        if (i > 0 && strcmp(parent, other) != 0)
+            rc = -1;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    // Never the trash itself or something holding it
+    if (rc == 0 && (g_dir[0] == '\0' || trash_contains_locked(parent)))
+        rc = -1;
+    for (int i = 0; rc == 0 && i < count; i++) {
+        if (path_is_within(g_dir, canon[i]))
+            rc = -1;
+    }
+
+    TrashSlot* slot = NULL;
+    char entry[FS_MAX_PATH];
+    if (rc == 0 && ((slot = trash_take_slot()) == NULL ||
+                    trash_new_entry(entry, sizeof(entry)) != 0 || vfs_mkdir(entry) != 0))
+        rc = -1;
+    if (rc == 0 && trash_move_into(canon, count, entry) != 0) {
+        vfs_rmdir(entry);
+        rc = -1;
+    }
+    if (rc == 0)
+        trash_fill_slot(slot, entry, parent, count);
+    pthread_mutex_unlock(&g_lock);
+
+    if (rc == 0) {
+        for (int i = 0; i < count; i++)
+            trash_invalidate(canon[i], g_dir);
+    }
+    free(canon);
+    return rc;
+}
+
+int trash_holds(const char* path)
+{
+    if (path == NULL)
+        return 0;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    pthread_mutex_lock(&g_lock);
+    int held = 0;
+    uint64_t now = fs_now_ns();
+    for (int i = 0; i < TRASH_MAX_ENTRIES && !held; i++) {
+        const TrashSlot* slot = &g_slots[i];
+        held = slot->used && now - slot->trashed_ns < TRASH_UNDO_NS &&
+               strcmp(slot->item.origin, canon) == 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return held;
+}
+
+// Put the items of batch entry 'item' back into their folder, all or
+// none (lock held). Returns the number of items, or -1.
+static int trash_restore_batch(const TrashItem* item)
+{
+    FsDirectory* names = fs_dir_create(16);
+    if (names == NULL || vfs_list(item->entry, names, NULL, NULL, NULL) != 0) {
+        fs_free_directory(names);
+        return -1;
+    }
+
+    char from[FS_MAX_PATH];
+    char to[FS_MAX_PATH];
+    VfsStat st;
+    int count = fs_dir_count(names);
+    int rc = count;
+    for (int i = 0; rc > 0 && i < count; i++) {
+        if (walk_join(item->origin, fs_dir_name(names, i), to, sizeof(to)) != 0 ||
+            vfs_stat(to, &st) == 0)
+            rc = -1;
+    }
+    for (int i = 0; rc > 0 && i < count; i++) {
+        walk_join(item->entry, fs_dir_name(names, i), from, sizeof(from));
+        walk_join(item->origin, fs_dir_name(names, i), to, sizeof(to));
+        if (vfs_rename(from, to) != 0)
+            rc = -1;
+        else
+            trash_invalidate(to, item->entry);
+    }
+    fs_free_directory(names);
+
+    // Should the empty entry stay, the next run purges it
+    if (rc > 0)
+        vfs_rmdir(item->entry);
+    return rc;
+}
+
+int trash_restore_last(char* origin, int size)
+{
+    pthread_mutex_lock(&g_lock);
+    TrashSlot* last = NULL;
+    uint64_t now = fs_now_ns();
+    for (int i = 0; i < TRASH_MAX_ENTRIES; i++) {
+        TrashSlot* slot = &g_slots[i];
+        if (slot->used && now - slot->trashed_ns < TRASH_UNDO_NS &&
+            (last == NULL || slot->seq > last->seq))
+            last = slot;
+    }
+
+    int rc = -1;
+    TrashItem item;
+    if (last != NULL) {
+        item = last->item;
+        // A taken place leaves the item where it is, to be purged in time
+        VfsStat st;
+        if (last->items > 0)
+            rc = trash_restore_batch(&item);
+        else if (vfs_stat(item.origin, &st) != 0 && vfs_rename(item.entry, item.origin) == 0)
+            rc = 1;
+        if (rc > 0)
+            memset(last, 0, sizeof(*last));
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (rc > 0) {
+        trash_invalidate(item.origin, item.entry);
+        if (origin != NULL)
+            str_copy(origin, item.origin, size);
+    }
+    return rc;
+}
+
+int trash_expired(TrashItem* out, int max)
+{
+    if (out == NULL || max <= 0)
+        return 0;
+
+    pthread_mutex_lock(&g_lock);
+    int count = 0;
+    while (count < max && g_leftovers != NULL && g_leftover_next < fs_dir_count(g_leftovers)) {
+        const char* name = fs_dir_name(g_leftovers, g_leftover_next++);
+        int len = snprintf(out[count].entry, sizeof(out[count].entry), "%s/%s", g_dir, name);
+        if (len > 0 && len < (int)sizeof(out[count].entry)) {
+            out[count].origin[0] = '\0';
+            count++;
+        }
+    }
+
+    uint64_t now = fs_now_ns();
+    for (int i = 0; i < TRASH_MAX_ENTRIES && count < max; i++) {
+        TrashSlot* slot = &g_slots[i];
+        if (!slot->used || now - slot->trashed_ns < TRASH_UNDO_NS)
+            continue;
+        out[count++] = slot->item;
+        memset(slot, 0, sizeof(*slot));
+    }
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
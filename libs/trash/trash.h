@@ -0,0 +1,97 @@
+#ifndef TRASH_H
+#define TRASH_H
+
+#include "fs.h"
+
+/**
+ * Trash module
+ *
+ * Makes deleting instant and undoable. A deleted item is renamed into a
+ * trash folder on the same card, which takes one filesystem call however
+ * big the item is, and can be renamed back until its undo window ends.
+ * After that it is handed out for purging, which the caller runs in the
+ * background with delete_item().
+ *
+ * The items of one batch delete are moved and undone together.
+ *
+ * Only the session's own deletes can be undone: what a previous run left
+ * in the trash is handed out for purging straight away.
+ */
+
+#define TRASH_DEFAULT_DIR  "/.dbfm_trash"
+
+/* Deletes held for undo at once; more push the oldest out early */
+#define TRASH_MAX_ENTRIES  16
+
+/* How long a delete can be undone */
+#define TRASH_UNDO_NS      (30ull * 1000000000ull)
+
+/**
+ * TrashItem - An item in the trash
+ */
+typedef struct {
+    char entry[FS_MAX_PATH];     // Where it lies in the trash
+    char origin[FS_MAX_PATH];    // Where it was ("" if left by a previous run)
+} TrashItem;
+
+/**
+ * trash_init(dir)
+ * Use folder 'dir' (NULL selects TRASH_DEFAULT_DIR; created on the first
+ * delete) and queue what a previous run left there for purging.
+ * Returns the number of items left over.
+ */
+int trash_init(const char* dir);
+
+/**
+ * trash_cleanup()
+ * Forget the trash. Items still in it are purged on the next run.
+ */
+void trash_cleanup(void);
+
+/**
+ * trash_contains(path)
+ * Returns 1 if 'path' is the trash folder or lies inside it.
+ */
+int trash_contains(const char* path);
+
+/**
+ * trash_move(path)
+ * Move 'path' into the trash. Safe to call from any thread.
+ * Returns 0 on success, -1 if it cannot go there (not initialised, part
+ * of the trash, or on another volume): delete it for real instead.
+ */
+int trash_move(const char* path);
+
+/**
+ * trash_move_batch(paths, count)
+ * Move 'count' items from one folder into the trash as one delete, which
+ * is undone in one go. Nothing moves unless all of them do.
+ * Returns 0 on success, -1 like trash_move() or if the items are not all
+ * in the same folder: delete them for real, or trash them one by one.
+ */
+int trash_move_batch(const char* const* paths, int count);
+
+/**
+ * trash_holds(path)
+ * Returns 1 if the delete of 'path' can still be undone.
+ */
+int trash_holds(const char* path);
+
+/**
+ * trash_restore_last(origin, size)
+ * Undo the most recent delete that can still be undone, writing where
+ * the item went back to into 'origin' (the folder, for a batch).
+ * Returns the number of items put back, or -1 if there is nothing to
+ * undo or an original place is taken (the items then stay in the trash).
+ */
+int trash_restore_last(char* origin, int size);
+
+/**
+ * trash_expired(out, max)
+ * Hand out up to 'max' items whose undo window has ended; they can no
+ * longer be restored and are the caller's to purge.
+ * Returns the number of items written.
+ */
+int trash_expired(TrashItem* out, int max);
+
+#endif
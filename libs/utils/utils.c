@@ -78,6 +78,43 @@ void path_normalize(char* path)
     }
 }
 
+void path_canonicalize(const char* path, char* dest, int dest_size)
+{
+    if (path == NULL || dest == NULL || dest_size < 2)
+        return;
+
+    const char* p = path;
+    if (strncmp(p, "sdmc:", 5) == 0)
+        p += 5;
+
+    int n = 0;
+    dest[n++] = '/';
+    for (; *p && n < dest_size - 1; p++) {
+        if (*p == '/' && dest[n - 1] == '/')
+            continue;
+        dest[n++] = *p;
+    }
+    while (n > 1 && dest[n - 1] == '/')
+        n--;
+    dest[n] = '\0';
+}
+
+int path_is_within(const char* path, const char* root)
+{
+    if (path == NULL || root == NULL)
+        return 0;
+
+    char p[512];
+    char r[512];
+    path_canonicalize(path, p, sizeof(p));
+    path_canonicalize(root, r, sizeof(r));
+
+    int len = str_len(r);
+    if (len == 1)
+        return 1;  // Everything is below "/"
+    return strncmp(p, r, len) == 0 && (p[len] == '\0' || p[len] == '/');
+}
+
 int path_get_parent(const char* path, char* dest)
 {
     if (path == NULL || dest == NULL)
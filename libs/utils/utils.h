@@ -45,6 +45,22 @@ int str_concat(char* dest, const char* src, int dest_size);
  */
 void path_normalize(char* path);
 
+/**
+ * path_canonicalize(path, dest, dest_size)
+ * Canonical form of an SD card path, for comparing paths or using them
+ * as keys: no "sdmc:" prefix, a single leading slash, no repeated or
+ * trailing slashes ("sdmc:/a//b/" and "/a/b" give the same result).
+ */
+void path_canonicalize(const char* path, char* dest, int dest_size);
+
+/**
+ * path_is_within(path, root)
+ * Check whether 'path' is 'root' or lies below it (compared in
+ * canonical form, so "sdmc:/a/b" is within "/a").
+ * Returns 1 if it is, 0 otherwise.
+ */
+int path_is_within(const char* path, const char* root);
+
 /**
  * path_get_parent(path, dest)
  * Get parent directory path.
@@ -0,0 +1,422 @@
+#include "vfs.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../utils/utils.h"
+
+/**
+ * VFS dispatch
+ *
+ * Canonicalises paths and forwards each call to the active backend.
+ * Open files remember the backend that created them.
+ *
+ * The backend's filesystem session is reference counted: vfs_init()
+ * takes the application's reference, and each file operation borrows
+ * one for its duration, so the SD card is opened once per run rather
+ * than once per file. Every call that reaches the backend is counted.
+ *
+ * Split files (vfs_split.c) are folded in here: when the backend sees a
+ * folder where a file was expected, the path is probed for parts.
+ */
+
+static const VfsBackend* g_backend = NULL;
+static pthread_mutex_t g_session_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_session_refs = 0;
+
+static struct {
+    atomic_uint_fast64_t session_opens;
+    atomic_uint_fast64_t session_closes;
+    atomic_uint_fast64_t file_opens;
+    atomic_uint_fast64_t file_closes;
+    atomic_uint_fast64_t reads;
+    atomic_uint_fast64_t writes;
+    atomic_uint_fast64_t dir_calls;
+    atomic_uint_fast64_t metadata;
+} g_counters;
+
+#define VFS_COUNT(field) atomic_fetch_add_explicit(&g_counters.field, 1, memory_order_relaxed)
+
+// Open the session on the first reference. Caller holds g_session_lock.
+static int vfs_session_open(const VfsBackend* backend)
+{
+    if (g_session_refs == 0) {
+        if (backend->init != NULL && backend->init() != 0)
+            return -1;
+        VFS_COUNT(session_opens);
+    }
+    g_session_refs++;
+    return 0;
+}
+
+// Drop a reference, closing the session on the last one
+static void vfs_session_close(void)
+{
+    if (g_session_refs == 0)
+        return;
+    if (--g_session_refs == 0) {
+        if (g_backend != NULL && g_backend->cleanup != NULL)
+            g_backend->cleanup();
+        VFS_COUNT(session_closes);
+    }
+}
+
+int vfs_init(const VfsBackend* backend)
+{
+    vfs_cleanup();
+
+    pthread_mutex_lock(&g_session_lock);
+    if (g_session_refs > 0) {
+        // Operations still borrow the old backend's session
+        pthread_mutex_unlock(&g_session_lock);
+        return -1;
+    }
+
+    int rc = 0;
+    const VfsBackend* native = vfs_backend_native();
+    if (backend == NULL && native != NULL && vfs_session_open(native) == 0) {
+        g_backend = native;
+    } else {
+        // POSIX is the fallback when the SD card service is unavailable
+        if (backend == NULL)
+            backend = vfs_backend_posix();
+        rc = vfs_session_open(backend);
+        if (rc == 0)
+            g_backend = backend;
+    }
+    pthread_mutex_unlock(&g_session_lock);
+    return rc;
+}
+
+void vfs_cleanup(void)
+{
+    // Operations still running keep the session open until they finish
+    pthread_mutex_lock(&g_session_lock);
+    vfs_session_close();
+    pthread_mutex_unlock(&g_session_lock);
+}
+
+int vfs_session_acquire(void)
+{
+    pthread_mutex_lock(&g_session_lock);
+    int rc = vfs_session_open(vfs_backend());
+    pthread_mutex_unlock(&g_session_lock);
+    return rc;
+}
+
+void vfs_session_release(void)
+{
+    pthread_mutex_lock(&g_session_lock);
+    vfs_session_close();
+    pthread_mutex_unlock(&g_session_lock);
+}
+
+void vfs_get_counters(VfsCounters* out)
+{
+    if (out == NULL)
+        return;
+
+    out->session_opens = atomic_load(&g_counters.session_opens);
+    out->session_closes = atomic_load(&g_counters.session_closes);
+    out->file_opens = atomic_load(&g_counters.file_opens);
+    out->file_closes = atomic_load(&g_counters.file_closes);
+    out->reads = atomic_load(&g_counters.reads);
+    out->writes = atomic_load(&g_counters.writes);
+    out->dir_calls = atomic_load(&g_counters.dir_calls);
+    out->metadata = atomic_load(&g_counters.metadata);
+}
+
+void vfs_counters_diff(const VfsCounters* before, const VfsCounters* after, VfsCounters* out)
+{
+    if (before == NULL || after == NULL || out == NULL)
+        return;
+
+    out->session_opens = after->session_opens - before->session_opens;
+    out->session_closes = after->session_closes - before->session_closes;
+    out->file_opens = after->file_opens - before->file_opens;
+    out->file_closes = after->file_closes - before->file_closes;
+    out->reads = after->reads - before->reads;
+    out->writes = after->writes - before->writes;
+    out->dir_calls = after->dir_calls - before->dir_calls;
+    out->metadata = after->metadata - before->metadata;
+}
+
+const VfsBackend* vfs_backend(void)
+{
+    return g_backend ? g_backend : vfs_backend_posix();
+}
+
+int vfs_stat(const char* path, VfsStat* out)
+{
+    if (path == NULL || out == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    VFS_COUNT(metadata);
+    if (vfs_backend()->stat(canon, out) != 0)
+        return -1;
+
+    uint64_t size;
+    if (out->is_dir && vfs_split_probe(canon, &size)) {
+        out->is_dir = 0;
+        out->size = size;
+    }
+    return 0;
+}
+
+int vfs_get_mtime(const char* path, uint64_t* out)
+{
+    if (path == NULL || out == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    VFS_COUNT(metadata);
+    return vfs_backend()->get_mtime(canon, out);
+}
+
+VfsFile* vfs_open(const char* path, int mode)
+{
+    if (path == NULL || (mode & (VFS_OPEN_READ | VFS_OPEN_WRITE)) == 0)
+        return NULL;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    VFS_COUNT(file_opens);
+    VfsFile* file = vfs_backend()->open(canon, mode);
+    if (file != NULL)
+        return file;
+
+    // Truncating a split file keeps it split
+    file = vfs_split_open(canon, mode);
+    if (file != NULL && (mode & VFS_OPEN_WRITE) && (mode & VFS_OPEN_CREATE) &&
+        vfs_set_size(file, 0) != 0) {
+        vfs_close(file);
+        return NULL;
+    }
+    return file;
+}
+
+VfsFile* vfs_create(const char* path, uint64_t size)
+{
+    if (path == NULL)
+        return NULL;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    const VfsBackend* backend = vfs_backend();
+    VFS_COUNT(file_opens);
+    VfsFile* file = NULL;
+    if (backend->create != NULL) {
+        file = backend->create(canon, size);
+    } else {
+        file = backend->open(canon, VFS_OPEN_WRITE | VFS_OPEN_CREATE);
+        if (file != NULL && size > 0 && vfs_set_size(file, size) != 0) {
+            vfs_close(file);
+            file = NULL;
+        }
+    }
+
+    // Too large for the volume as one file, or replacing a split file
+    if (file == NULL && (size > VFS_FAT32_MAX_FILE || vfs_split_probe(canon, NULL)))
+        file = vfs_split_create(canon, size, 0);
+    return file;
+}
+
+int64_t vfs_read(VfsFile* file, uint64_t offset, void* buf, uint64_t size)
+{
+    if (file == NULL || (buf == NULL && size > 0))
+        return -1;
+    VFS_COUNT(reads);
+    return file->backend->read(file, offset, buf, size);
+}
+
+int vfs_write(VfsFile* file, uint64_t offset, const void* buf, uint64_t size)
+{
+    if (file == NULL || (buf == NULL && size > 0))
+        return -1;
+    if (size == 0)
+        return 0;
+    VFS_COUNT(writes);
+    return file->backend->write(file, offset, buf, size);
+}
+
+int vfs_get_size(VfsFile* file, uint64_t* out)
+{
+    if (file == NULL || out == NULL)
+        return -1;
+    VFS_COUNT(metadata);
+    return file->backend->get_size(file, out);
+}
+
+int vfs_set_size(VfsFile* file, uint64_t size)
+{
+    if (file == NULL)
+        return -1;
+    VFS_COUNT(metadata);
+    return file->backend->set_size(file, size);
+}
+
+int vfs_flush(VfsFile* file)
+{
+    if (file == NULL)
+        return -1;
+    if (file->backend->flush == NULL)
+        return 0;
+    VFS_COUNT(metadata);
+    return file->backend->flush(file);
+}
+
+int vfs_get_free_space(const char* path, uint64_t* out)
+{
+    if (path == NULL || out == NULL || vfs_backend()->get_free_space == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    VFS_COUNT(metadata);
+    return vfs_backend()->get_free_space(canon, out);
+}
+
+void vfs_close(VfsFile* file)
+{
+    if (file == NULL)
+        return;
+    VFS_COUNT(file_closes);
+    file->backend->close(file);
+}
+
+/**
+ * SplitMarker - Listing in progress, for flagging the split files in it
+ */
+typedef struct {
+    const char* path;
+    FsDirectory* out;
+    int from;                // First entry not yet looked at
+    VfsBatchFn on_batch;     // Caller's callback and data
+    void* user;
+} SplitMarker;
+
+// Flag the split files among the entries appended since the last look
+static void vfs_mark_split(SplitMarker* marker)
+{
+    FsDirectory* out = marker->out;
+    for (int i = marker->from; i < fs_dir_count(out); i++) {
+        if (!fs_dir_is_dir(out, i))
+            continue;
+        char path[FS_MAX_PATH];
+        uint64_t size;
+        snprintf(path, sizeof(path), "%s/%s", marker->path, fs_dir_name(out, i));
+        if (vfs_split_probe(path, &size))
+            fs_dir_set_split(out, i, size);
+    }
+    marker->from = fs_dir_count(out);
+}
+
+static int vfs_split_batch(void* user)
+{
+    SplitMarker* marker = (SplitMarker*)user;
+    vfs_mark_split(marker);
+    int rc = marker->on_batch(marker->user);
+    marker->from = fs_dir_count(marker->out);  // The caller may have drained it
+    return rc;
+}
+
+int vfs_list(const char* path, FsDirectory* out, VfsBatchFn on_batch, void* user,
+             uint64_t* service_calls)
+{
+    if (path == NULL || out == NULL)
+        return -1;
+
+    uint64_t calls = 0;
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    SplitMarker marker = { canon, out, fs_dir_count(out), on_batch, user };
+    int rc = vfs_backend()->list(canon, out, on_batch != NULL ? vfs_split_batch : NULL,
+                                 &marker, &calls);
+    if (rc == 0)
+        vfs_mark_split(&marker);
+    atomic_fetch_add_explicit(&g_counters.dir_calls, calls, memory_order_relaxed);
+    if (service_calls != NULL)
+        *service_calls += calls;
+    return rc;
+}
+
+int vfs_mkdir(const char* path)
+{
+    if (path == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    VFS_COUNT(metadata);
+    return vfs_backend()->mkdir(canon);
+}
+
+int vfs_remove(const char* path)
+{
+    if (path == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    VFS_COUNT(metadata);
+    if (vfs_backend()->remove(canon) == 0)
+        return 0;
+    return vfs_split_probe(canon, NULL) ? vfs_split_remove(canon) : -1;
+}
+
+int vfs_rmdir(const char* path)
+{
+    if (path == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    if (strcmp(canon, "/") == 0)
+        return -1;
+    VFS_COUNT(metadata);
+    return vfs_backend()->rmdir(canon);
+}
+
+int vfs_remove_tree(const char* path)
+{
+    if (path == NULL || vfs_backend()->remove_tree == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    if (strcmp(canon, "/") == 0)
+        return -1;
+    VFS_COUNT(metadata);
+    return vfs_backend()->remove_tree(canon);
+}
+
+int vfs_same_volume(const char* a, const char* b)
+{
+    if (a == NULL || b == NULL || vfs_backend()->same_volume == NULL)
+        return -1;
+
+    char a_c[FS_MAX_PATH];
+    char b_c[FS_MAX_PATH];
+    path_canonicalize(a, a_c, sizeof(a_c));
+    path_canonicalize(b, b_c, sizeof(b_c));
+    VFS_COUNT(metadata);
+    return vfs_backend()->same_volume(a_c, b_c);
+}
+
+int vfs_rename(const char* from, const char* to)
+{
+    if (from == NULL || to == NULL)
+        return -1;
+
+    char from_c[FS_MAX_PATH];
+    char to_c[FS_MAX_PATH];
+    path_canonicalize(from, from_c, sizeof(from_c));
+    path_canonicalize(to, to_c, sizeof(to_c));
+    if (strcmp(from_c, "/") == 0)
+        return -1;
+    VFS_COUNT(metadata);
+    return vfs_backend()->rename(from_c, to_c);
+}
@@ -0,0 +1,334 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include "fs.h"
+
+/**
+ * Virtual filesystem module
+ *
+ * Single I/O interface for the browser and every file operation. Calls
+ * go to the active backend:
+ *   - native: the SD card service through libnx (Switch only)
+ *   - posix:  opendir/open/pread/rename (host builds, Switch fallback)
+ *   - memory: an in-memory tree, for benchmarks and host experiments
+ *
+ * Paths may be given as "/a/b", "sdmc:/a/b" or with stray slashes; they
+ * are canonicalised (path_canonicalize()) before reaching the backend.
+ * All functions are safe to call from worker threads.
+ */
+
+/* vfs_open() mode bits */
+#define VFS_OPEN_READ   0x01  // Read access
+#define VFS_OPEN_WRITE  0x02  // Write access, file grows as written
+#define VFS_OPEN_CREATE 0x04  // With WRITE: create if missing, truncate to 0
+
+/**
+ * VfsStat - Type and size of a path
+ */
+typedef struct {
+    int is_dir;              // 1 if directory
+    uint64_t size;           // File size in bytes (0 for directories)
+} VfsStat;
+
+/**
+ * VfsBatchFn - Called by vfs_list() after each batch of entries is
+ * appended; returning non-zero stops the listing early.
+ */
+typedef int (*VfsBatchFn)(void* user);
+
+typedef struct VfsBackend VfsBackend;
+
+/**
+ * VfsFile - Open file handle. Backends embed this as the first member
+ * of their own handle type.
+ */
+typedef struct {
+    const VfsBackend* backend;
+} VfsFile;
+
+/**
+ * VfsBackend - Operations a backend provides. Paths are canonical.
+ * Functions return 0 (or a byte count) on success and -1 on failure.
+ */
+struct VfsBackend {
+    const char* name;
+    int (*init)(void);       // Optional: open the session (first reference)
+    void (*cleanup)(void);   // Optional: close the session (last reference)
+    int (*stat)(const char* path, VfsStat* out);
+    int (*get_mtime)(const char* path, uint64_t* out);
+    VfsFile* (*open)(const char* path, int mode);
+    int64_t (*read)(VfsFile* file, uint64_t offset, void* buf, uint64_t size);
+    int (*write)(VfsFile* file, uint64_t offset, const void* buf, uint64_t size);
+    int (*get_size)(VfsFile* file, uint64_t* out);
+    int (*set_size)(VfsFile* file, uint64_t size);
+    void (*close)(VfsFile* file);
+    int (*list)(const char* path, FsDirectory* out, VfsBatchFn on_batch, void* user,
+                uint64_t* service_calls);
+    int (*mkdir)(const char* path);
+    int (*remove)(const char* path);
+    int (*rmdir)(const char* path);
+    int (*rename)(const char* from, const char* to);
+    // Optional: open for writing, created or truncated at 'size' bytes
+    VfsFile* (*create)(const char* path, uint64_t size);
+    // Optional: free bytes on the volume holding 'path'
+    int (*get_free_space)(const char* path, uint64_t* out);
+    // Optional: push written data of an open file to the medium
+    int (*flush)(VfsFile* file);
+    // Optional: mark folder 'path' as a concatenation (split) file
+    int (*set_concatenation)(const char* path);
+    // Optional: delete directory 'path' and everything below it in one call
+    int (*remove_tree)(const char* path);
+    // Optional: 1 if existing paths 'a' and 'b' are on one volume, 0 if not
+    int (*same_volume)(const char* a, const char* b);
+};
+
+/**
+ * VfsCounters - Calls that reached the backend since startup
+ */
+typedef struct {
+    uint64_t session_opens;  // Filesystem sessions opened
+    uint64_t session_closes; // Filesystem sessions closed
+    uint64_t file_opens;     // vfs_open()
+    uint64_t file_closes;    // vfs_close()
+    uint64_t reads;          // vfs_read()
+    uint64_t writes;         // vfs_write()
+    uint64_t dir_calls;      // Directory open/read/close round trips in listings
+    uint64_t metadata;       // stat, mtime, size, free space, flush, mkdir, remove, rmdir, rename
+} VfsCounters;
+
+/**
+ * vfs_init(backend)
+ * Select the backend (NULL picks native on Switch, falling back to posix
+ * if the SD card cannot be opened) and open its session, holding one
+ * reference for the application. Called by fs_init().
+ * Returns 0 on success, -1 if the backend failed to start or operations
+ * still hold the previous session.
+ */
+int vfs_init(const VfsBackend* backend);
+
+/**
+ * vfs_cleanup()
+ * Drop the application's session reference. The session closes once
+ * running operations release theirs. Called by fs_cleanup().
+ */
+void vfs_cleanup(void);
+
+/**
+ * vfs_session_acquire() / vfs_session_release()
+ * Borrow the filesystem session for the duration of an operation,
+ * opening it if no one else holds it. Every successful acquire must be
+ * paired with a release.
+ * vfs_session_acquire() returns 0 on success, -1 if the session could
+ * not be opened.
+ */
+int vfs_session_acquire(void);
+void vfs_session_release(void);
+
+/**
+ * vfs_get_counters(out) / vfs_counters_diff(before, after, out)
+ * Snapshot the call counters, and compute the calls made between two
+ * snapshots (the cost of one operation).
+ */
+void vfs_get_counters(VfsCounters* out);
+void vfs_counters_diff(const VfsCounters* before, const VfsCounters* after, VfsCounters* out);
+
+/**
+ * vfs_backend()
+ * The active backend (posix if vfs_init() was never called).
+ */
+const VfsBackend* vfs_backend(void);
+
+/**
+ * Built-in backends
+ * vfs_backend_native() returns NULL on host builds.
+ */
+const VfsBackend* vfs_backend_native(void);
+const VfsBackend* vfs_backend_posix(void);
+const VfsBackend* vfs_backend_memory(void);
+
+/**
+ * vfs_memory_reset()
+ * Remove everything stored in the memory backend, leaving an empty root.
+ */
+void vfs_memory_reset(void);
+
+/**
+ * vfs_stat(path, out)
+ * Returns 0 and fills 'out' if 'path' exists, -1 otherwise.
+ */
+int vfs_stat(const char* path, VfsStat* out);
+
+/**
+ * vfs_get_mtime(path, out)
+ * Modification timestamp of a file or directory (only meaningful for
+ * comparing against an earlier value).
+ * Returns 0 on success, -1 if the path cannot be queried.
+ */
+int vfs_get_mtime(const char* path, uint64_t* out);
+
+/**
+ * vfs_open(path, mode)
+ * Open a file with VFS_OPEN_* bits. Returns NULL on failure.
+ * Release with vfs_close().
+ */
+VfsFile* vfs_open(const char* path, int mode);
+
+/**
+ * vfs_create(path, size)
+ * Open 'path' for writing at its final length: the file is created (or
+ * an existing one resized) holding 'size' bytes before any are written,
+ * so the filesystem can allocate it in one piece. The contents are
+ * undefined until written. Returns NULL on failure.
+ */
+VfsFile* vfs_create(const char* path, uint64_t size);
+
+/**
+ * vfs_read(file, offset, buf, size)
+ * Read up to 'size' bytes at 'offset'.
+ * Returns the bytes read (0 at end of file), or -1 on error.
+ */
+int64_t vfs_read(VfsFile* file, uint64_t offset, void* buf, uint64_t size);
+
+/**
+ * vfs_write(file, offset, buf, size)
+ * Write all 'size' bytes at 'offset', growing the file if needed.
+ * Returns 0 on success, -1 on error.
+ */
+int vfs_write(VfsFile* file, uint64_t offset, const void* buf, uint64_t size);
+
+/**
+ * vfs_get_size(file, out) / vfs_set_size(file, size)
+ * Query or change the length of an open file.
+ * Return 0 on success, -1 on error.
+ */
+int vfs_get_size(VfsFile* file, uint64_t* out);
+int vfs_set_size(VfsFile* file, uint64_t size);
+
+/**
+ * vfs_flush(file)
+ * Make everything written to 'file' so far durable, e.g. before
+ * recording that it was written. Backends without caching succeed.
+ * Returns 0 on success, -1 on error.
+ */
+int vfs_flush(VfsFile* file);
+
+/**
+ * vfs_close(file)
+ * Close a handle from vfs_open(). Safe to call with NULL.
+ */
+void vfs_close(VfsFile* file);
+
+/**
+ * vfs_get_free_space(path, out)
+ * Free bytes on the volume holding 'path'.
+ * Returns 0 on success, -1 if the backend cannot tell.
+ */
+int vfs_get_free_space(const char* path, uint64_t* out);
+
+/**
+ * vfs_list(path, out, on_batch, user, service_calls)
+ * Append the entries of directory 'path' to 'out' in batches of up to
+ * FS_LIST_BATCH, calling 'on_batch' (if set) after each. When 'on_batch'
+ * is NULL the listing may be sized up front. Round trips to the
+ * filesystem are added to '*service_calls' if it is not NULL.
+ * Returns 0 on success (possibly partial on allocation failure), -1 if
+ * the directory cannot be opened.
+ */
+int vfs_list(const char* path, FsDirectory* out, VfsBatchFn on_batch, void* user,
+             uint64_t* service_calls);
+
+/**
+ * vfs_mkdir(path) / vfs_remove(path) / vfs_rmdir(path)
+ * Create a directory, delete a file, delete an empty directory.
+ * vfs_mkdir() succeeds if the directory already exists.
+ * Return 0 on success, -1 on error.
+ */
+int vfs_mkdir(const char* path);
+int vfs_remove(const char* path);
+int vfs_rmdir(const char* path);
+
+/**
+ * vfs_rename(from, to)
+ * Rename or move a file or directory within the filesystem.
+ * Returns 0 on success, -1 on error (including 'to' already existing).
+ */
+int vfs_rename(const char* from, const char* to);
+
+/**
+ * vfs_remove_tree(path)
+ * Delete directory 'path' with everything below it in one backend call.
+ * Returns 0 on success, -1 on error or if the backend cannot (callers
+ * then delete the tree entry by entry, which also clears what a failed
+ * call left behind).
+ */
+int vfs_remove_tree(const char* path);
+
+/**
+ * vfs_same_volume(a, b)
+ * Check whether existing paths 'a' and 'b' are on the same volume, so
+ * one can be renamed to a place in the other.
+ * Returns 1 if they are, 0 if not, -1 if the backend cannot tell.
+ */
+int vfs_same_volume(const char* a, const char* b);
+
+/**
+ * Split files
+ *
+ * FAT32 cannot hold a file of 4 GiB or more. Such files are stored as a
+ * folder of parts named 00, 01, 02, ... that concatenate to the file;
+ * on Switch the folder carries the archive attribute and the SD card
+ * service shows it as one file by itself. Folders without it (copied
+ * from a PC, or written through fsdev) are recognised here instead:
+ * vfs_stat() and vfs_list() report them as files of the combined size
+ * (flagged FS_ENTRY_SPLIT), and vfs_open(), vfs_create() and
+ * vfs_remove() work on them like on any file, reads and writes crossing
+ * part boundaries in place. vfs_create() switches to a split file when
+ * the backend cannot create a plain one that large.
+ *
+ * Only folders named like files, with an extension, are probed, so
+ * ordinary folders cost nothing extra.
+ */
+
+/* Part size used for new split files (the largest multiple of 64 KiB under 4 GiB) */
+#define VFS_SPLIT_PART_SIZE 0xFFFF0000ull
+
+/* Largest file FAT32 can hold */
+#define VFS_FAT32_MAX_FILE  0xFFFFFFFFull
+
+/* Most parts a split file may have */
+#define VFS_SPLIT_MAX_PARTS 256
+
+/**
+ * vfs_split_probe(path, size)
+ * Check whether folder 'path' is a split file: it holds only the files
+ * 00 up to its last part, every part but the last of the same size.
+ * Fills 'size' (may be NULL) with the combined size.
+ * Returns 1 if it is, 0 otherwise.
+ */
+int vfs_split_probe(const char* path, uint64_t* size);
+
+/**
+ * vfs_split_open(path, mode)
+ * Open split file 'path' with VFS_OPEN_READ and VFS_OPEN_WRITE bits
+ * (VFS_OPEN_CREATE is ignored: use vfs_split_create()).
+ * Returns NULL on failure or if 'path' is not a split file.
+ */
+VfsFile* vfs_split_open(const char* path, int mode);
+
+/**
+ * vfs_split_create(path, size, part_size)
+ * Like vfs_create(), but always store 'path' as a split file with parts
+ * of 'part_size' bytes (0 selects VFS_SPLIT_PART_SIZE). A file already
+ * at 'path' is replaced; a folder that is not a split file is not.
+ * Returns NULL on failure.
+ */
+VfsFile* vfs_split_create(const char* path, uint64_t size, uint64_t part_size);
+
+/**
+ * vfs_split_remove(path)
+ * Delete split file 'path', its parts and folder.
+ * Returns 0 on success, -1 on error or if 'path' is not a split file.
+ */
+int vfs_split_remove(const char* path);
+
+#endif
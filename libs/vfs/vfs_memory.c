@@ -0,0 +1,482 @@
+#include "vfs.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * Memory VFS backend
+ *
+ * A complete filesystem tree held in RAM, so the file operation stack can
+ * be exercised and benchmarked without touching storage. Nodes live in
+ * one growable array and are linked parent -> first child -> next
+ * sibling; removed nodes go on a free list and their generation is
+ * bumped so stale handles fail instead of touching a reused node.
+ * Timestamps come from a counter that ticks on every change.
+ *
+ * One mutex guards the whole tree.
+ */
+
+typedef struct {
+    char* name;              // Component name (malloc'd, "" for root)
+    int parent;              // Parent node, -1 for the root
+    int first_child;         // Directories: head of the child list
+    int next;                // Next sibling, or next free node
+    int is_dir;
+    int in_use;
+    uint32_t generation;     // Bumped when the node is freed
+    uint8_t* data;           // Files: contents
+    uint64_t size;
+    uint64_t capacity;
+    uint64_t mtime;
+} MemNode;
+
+typedef struct {
+    VfsFile base;
+    int node;
+    uint32_t generation;
+} MemFile;
+
+static pthread_mutex_t g_mem_lock = PTHREAD_MUTEX_INITIALIZER;
+static MemNode* g_nodes = NULL;
+static int g_node_count = 0;
+static int g_node_capacity = 0;
+static int g_free_head = -1;
+static uint64_t g_clock = 0;
+
+static const VfsBackend g_memory_backend;
+
+// Allocate a node. Returns its index, or -1 on OOM.
+static int mem_alloc(const char* name, int is_dir)
+{
+    char* copy = strdup(name);
+    if (copy == NULL)
+        return -1;
+
+    int index;
+    if (g_free_head >= 0) {
+        index = g_free_head;
+        g_free_head = g_nodes[index].next;
+    } else {
+        if (g_node_count == g_node_capacity) {
+            int capacity = g_node_capacity ? g_node_capacity * 2 : 64;
+            MemNode* nodes = (MemNode*)realloc(g_nodes, sizeof(MemNode) * capacity);
+            if (nodes == NULL) {
+                free(copy);
+                return -1;
+            }
+            g_nodes = nodes;
+            g_node_capacity = capacity;
+        }
+        index = g_node_count++;
+        g_nodes[index].generation = 0;
+    }
+
+    MemNode* n = &g_nodes[index];
+    n->name = copy;
+    n->parent = -1;
+    n->first_child = -1;
+    n->next = -1;
+    n->is_dir = is_dir;
+    n->in_use = 1;
+    n->data = NULL;
+    n->size = 0;
+    n->capacity = 0;
+    n->mtime = ++g_clock;
+    return index;
+}
+
+static void mem_free(int index)
+{
+    MemNode* n = &g_nodes[index];
+    free(n->name);
+    free(n->data);
+    n->name = NULL;
+    n->data = NULL;
+    n->in_use = 0;
+    n->generation++;
+    n->next = g_free_head;
+    g_free_head = index;
+}
+
+// The root is created on first use
+static int mem_root(void)
+{
+    if (g_node_count == 0 && mem_alloc("", 1) != 0)
+        return -1;
+    return 0;
+}
+
+static int mem_find_child(int dir, const char* name, size_t len)
+{
+    for (int c = g_nodes[dir].first_child; c >= 0; c = g_nodes[c].next) {
+        if (strncmp(g_nodes[c].name, name, len) == 0 && g_nodes[c].name[len] == '\0')
+            return c;
+    }
+    return -1;
+}
+
+// Resolve a canonical path. With 'leaf' set, resolve only the parent
+// directory and point '*leaf' at the final component.
+static int mem_lookup(const char* path, const char** leaf)
+{
+    if (mem_root() != 0)
+        return -1;
+
+    int node = 0;
+    const char* p = path;
+    while (*p == '/')
+        p++;
+    while (*p != '\0') {
+        const char* end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (leaf != NULL && end == NULL) {
+            *leaf = p;
+            return g_nodes[node].is_dir ? node : -1;
+        }
+        if (!g_nodes[node].is_dir)
+            return -1;
+        node = mem_find_child(node, p, len);
+        if (node < 0)
+            return -1;
+        p += len;
+        while (*p == '/')
+            p++;
+    }
+    return leaf != NULL ? -1 : node;  // The root has no parent
+}
+
+static void mem_link(int parent, int child)
+{
+    g_nodes[child].parent = parent;
+    g_nodes[child].next = g_nodes[parent].first_child;
+    g_nodes[parent].first_child = child;
+    g_nodes[parent].mtime = ++g_clock;
+}
+
+static void mem_unlink(int child)
+{
+    int parent = g_nodes[child].parent;
+    int* link = &g_nodes[parent].first_child;
+    while (*link != child)
+        link = &g_nodes[*link].next;
+    *link = g_nodes[child].next;
+    g_nodes[child].next = -1;
+    g_nodes[child].parent = -1;
+    g_nodes[parent].mtime = ++g_clock;
+}
+
+// Create a file or directory called 'leaf' in 'parent'
+static int mem_create(int parent, const char* leaf, int is_dir)
+{
+    int node = mem_alloc(leaf, is_dir);
+    if (node < 0)
+        return -1;
+    mem_link(parent, node);
+    return node;
+}
+
+// Valid handle -> its node, or -1 if the file was removed
+static int mem_file_node(VfsFile* file)
+{
+    MemFile* f = (MemFile*)file;
+    if (!g_nodes[f->node].in_use || g_nodes[f->node].generation != f->generation)
+        return -1;
+    return f->node;
+}
+
+static int mem_reserve(MemNode* n, uint64_t size)
+{
+    if (size <= n->capacity)
+        return 0;
+
+    uint64_t capacity = n->capacity ? n->capacity : 4096;
+    while (capacity < size)
+        capacity *= 2;
+    uint8_t* data = (uint8_t*)realloc(n->data, capacity);
+    if (data == NULL)
+        return -1;
+    n->data = data;
+    n->capacity = capacity;
+    return 0;
+}
+
+static int mem_resize(MemNode* n, uint64_t size)
+{
+    if (mem_reserve(n, size) != 0)
+        return -1;
+    if (size > n->size)
+        memset(n->data + n->size, 0, size - n->size);
+    n->size = size;
+    n->mtime = ++g_clock;
+    return 0;
+}
+
+static int memory_stat(const char* path, VfsStat* out)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_lookup(path, NULL);
+    if (node >= 0) {
+        out->is_dir = g_nodes[node].is_dir;
+        out->size = g_nodes[node].is_dir ? 0 : g_nodes[node].size;
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+    return node >= 0 ? 0 : -1;
+}
+
+static int memory_get_mtime(const char* path, uint64_t* out)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_lookup(path, NULL);
+    if (node >= 0)
+        *out = g_nodes[node].mtime;
+    pthread_mutex_unlock(&g_mem_lock);
+    return node >= 0 ? 0 : -1;
+}
+
+static VfsFile* memory_open(const char* path, int mode)
+{
+    MemFile* f = (MemFile*)malloc(sizeof(MemFile));
+    if (f == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&g_mem_lock);
+    int create = (mode & VFS_OPEN_WRITE) && (mode & VFS_OPEN_CREATE);
+    int node = mem_lookup(path, NULL);
+    if (node < 0 && create) {
+        const char* leaf = NULL;
+        int parent = mem_lookup(path, &leaf);
+        if (parent >= 0)
+            node = mem_create(parent, leaf, 0);
+    } else if (node >= 0 && create && !g_nodes[node].is_dir) {
+        mem_resize(&g_nodes[node], 0);
+    }
+    if (node >= 0 && g_nodes[node].is_dir)
+        node = -1;
+    if (node >= 0) {
+        f->node = node;
+        f->generation = g_nodes[node].generation;
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+
+    if (node < 0) {
+        free(f);
+        return NULL;
+    }
+    f->base.backend = &g_memory_backend;
+    return &f->base;
+}
+
+static int64_t memory_read(VfsFile* file, uint64_t offset, void* buf, uint64_t size)
+{
+    int64_t read = -1;
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_file_node(file);
+    if (node >= 0) {
+        MemNode* n = &g_nodes[node];
+        read = 0;
+        if (offset < n->size) {
+            uint64_t avail = n->size - offset;
+            read = (int64_t)(size < avail ? size : avail);
+            memcpy(buf, n->data + offset, (size_t)read);
+        }
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+    return read;
+}
+
+static int memory_write(VfsFile* file, uint64_t offset, const void* buf, uint64_t size)
+{
+    int rc = -1;
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_file_node(file);
+    if (node >= 0) {
+        MemNode* n = &g_nodes[node];
+        uint64_t end = offset + size;
+        if (end <= n->size || mem_resize(n, end) == 0) {
+            memcpy(n->data + offset, buf, (size_t)size);
+            n->mtime = ++g_clock;
+            rc = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+    return rc;
+}
+
+static int memory_get_size(VfsFile* file, uint64_t* out)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_file_node(file);
+    if (node >= 0)
+        *out = g_nodes[node].size;
+    pthread_mutex_unlock(&g_mem_lock);
+    return node >= 0 ? 0 : -1;
+}
+
+static int memory_set_size(VfsFile* file, uint64_t size)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_file_node(file);
+    int rc = node >= 0 ? mem_resize(&g_nodes[node], size) : -1;
+    pthread_mutex_unlock(&g_mem_lock);
+    return rc;
+}
+
+static void memory_close(VfsFile* file)
+{
+    free(file);
+}
+
+static int memory_list(const char* path, FsDirectory* out, VfsBatchFn on_batch, void* user,
+                       uint64_t* service_calls)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int dir = mem_lookup(path, NULL);
+    (*service_calls)++;
+    if (dir < 0 || !g_nodes[dir].is_dir) {
+        pthread_mutex_unlock(&g_mem_lock);
+        return -1;
+    }
+
+    int in_batch = 0;
+    for (int c = g_nodes[dir].first_child; c >= 0; c = g_nodes[c].next) {
+        const MemNode* n = &g_nodes[c];
+        if (fs_dir_append(out, n->name, n->is_dir, n->size) != 0)
+            break;  // Return partial results
+        if (++in_batch == FS_LIST_BATCH) {
+            in_batch = 0;
+            (*service_calls)++;
+            if (on_batch != NULL && on_batch(user) != 0)
+                break;
+        }
+    }
+    if (in_batch > 0) {
+        (*service_calls)++;
+        if (on_batch != NULL)
+            on_batch(user);
+    }
+    (*service_calls)++;
+    pthread_mutex_unlock(&g_mem_lock);
+    return 0;
+}
+
+static int memory_mkdir(const char* path)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int rc = -1;
+    int node = mem_lookup(path, NULL);
+    if (node >= 0) {
+        rc = g_nodes[node].is_dir ? 0 : -1;
+    } else {
+        const char* leaf = NULL;
+        int parent = mem_lookup(path, &leaf);
+        if (parent >= 0 && mem_create(parent, leaf, 1) >= 0)
+            rc = 0;
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+    return rc;
+}
+
+static int memory_remove(const char* path)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_lookup(path, NULL);
+    int rc = -1;
+    if (node > 0 && !g_nodes[node].is_dir) {
+        mem_unlink(node);
+        mem_free(node);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+    return rc;
+}
+
+static int memory_rmdir(const char* path)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int node = mem_lookup(path, NULL);
+    int rc = -1;
+    if (node > 0 && g_nodes[node].is_dir && g_nodes[node].first_child < 0) {
+        mem_unlink(node);
+        mem_free(node);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+    return rc;
+}
+
+static int memory_rename(const char* from, const char* to)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    int rc = -1;
+    const char* leaf = NULL;
+    int node = mem_lookup(from, NULL);
+    int parent = mem_lookup(to, &leaf);
+    if (node > 0 && parent >= 0 && mem_find_child(parent, leaf, strlen(leaf)) < 0) {
+        // A folder cannot move below itself
+        int p = parent;
+        while (p >= 0 && p != node)
+            p = g_nodes[p].parent;
+        char* name = p < 0 ? strdup(leaf) : NULL;
+        if (name != NULL) {
+            mem_unlink(node);
+            free(g_nodes[node].name);
+            g_nodes[node].name = name;
+            mem_link(parent, node);
+            rc = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_mem_lock);
+    return rc;
+}
+
+void vfs_memory_reset(void)
+{
+    pthread_mutex_lock(&g_mem_lock);
+    for (int i = 0; i < g_node_count; i++) {
+        free(g_nodes[i].name);
+        free(g_nodes[i].data);
+    }
+    free(g_nodes);
+    g_nodes = NULL;
+    g_node_count = 0;
+    g_node_capacity = 0;
+    g_free_head = -1;
+    pthread_mutex_unlock(&g_mem_lock);
+}
+
+static int memory_same_volume(const char* a, const char* b)
+{
+    (void)a;
+    (void)b;
+    return 1;
+}
+
+static const VfsBackend g_memory_backend = {
+    "memory",
+    NULL,
+    NULL,
+    memory_stat,
+    memory_get_mtime,
+    memory_open,
+    memory_read,
+    memory_write,
+    memory_get_size,
+    memory_set_size,
+    memory_close,
+    memory_list,
+    memory_mkdir,
+    memory_remove,
+    memory_rmdir,
+    memory_rename,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    memory_same_volume,
+};
+
+const VfsBackend* vfs_backend_memory(void)
+{
+    return &g_memory_backend;
+}
@@ -0,0 +1,334 @@
+#include "vfs.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Native VFS backend
+ *
+ * Talks to the SD card service directly, through the filesystem session
+ * the default __appInit already mounted as "sdmc" for stdio. Without
+ * that mount the backend opens a session of its own, which it does not
+ * mount and closes on cleanup; the fsdev session is never closed here.
+ * Listings use one fsFsOpenDirectory, a handful of fsDirRead calls
+ * returning FS_LIST_BATCH entries each (sizes included), and one
+ * fsDirClose.
+ */
+
+#ifdef __SWITCH__
+
+static FsFileSystem* g_sd_fs = NULL;
+static FsFileSystem g_own_fs;        // Used when "sdmc" is not mounted
+static int g_own_fs_open = 0;
+
+typedef struct {
+    VfsFile base;
+    FsFile file;
+} NativeFile;
+
+static const VfsBackend g_native_backend;
+
+static int native_init(void)
+{
+    if (g_sd_fs != NULL)
+        return 0;
+
+    g_sd_fs = fsdevGetDeviceFileSystem("sdmc");
+    if (g_sd_fs != NULL)
+        return 0;
+
+    if (R_FAILED(fsOpenSdCardFileSystem(&g_own_fs)))
+        return -1;
+    g_own_fs_open = 1;
+    g_sd_fs = &g_own_fs;
+    return 0;
+}
+
+static void native_cleanup(void)
+{
+    if (g_own_fs_open) {
+        fsFsClose(&g_own_fs);
+        g_own_fs_open = 0;
+    }
+    g_sd_fs = NULL;
+}
+
+static int native_stat(const char* path, VfsStat* out)
+{
+    FsDirEntryType type;
+    if (R_FAILED(fsFsGetEntryType(g_sd_fs, path, &type)))
+        return -1;
+
+    out->is_dir = (type == FsDirEntryType_Dir);
+    out->size = 0;
+    if (!out->is_dir) {
+        FsFile file;
+        s64 size = 0;
+        if (R_FAILED(fsFsOpenFile(g_sd_fs, path, FsOpenMode_Read, &file)))
+            return -1;
+        Result rc = fsFileGetSize(&file, &size);
+        fsFileClose(&file);
+        if (R_FAILED(rc))
+            return -1;
+        out->size = (uint64_t)size;
+    }
+    return 0;
+}
+
+static int native_get_mtime(const char* path, uint64_t* out)
+{
+    FsTimeStampRaw ts;
+    if (R_FAILED(fsFsGetFileTimeStampRaw(g_sd_fs, path, &ts)) || !ts.is_valid)
+        return -1;
+    *out = ts.modified;
+    return 0;
+}
+
+static VfsFile* native_open(const char* path, int mode)
+{
+    u32 fs_mode = 0;
+    if (mode & VFS_OPEN_READ)
+        fs_mode |= FsOpenMode_Read;
+    if (mode & VFS_OPEN_WRITE)
+        fs_mode |= FsOpenMode_Write | FsOpenMode_Append;
+
+    // Creating fails harmlessly if the file already exists
+    if ((mode & VFS_OPEN_WRITE) && (mode & VFS_OPEN_CREATE))
+        fsFsCreateFile(g_sd_fs, path, 0, 0);
+
+    NativeFile* f = (NativeFile*)malloc(sizeof(NativeFile));
+    if (f == NULL)
+        return NULL;
+    if (R_FAILED(fsFsOpenFile(g_sd_fs, path, fs_mode, &f->file))) {
+        free(f);
+        return NULL;
+    }
+    if ((mode & VFS_OPEN_WRITE) && (mode & VFS_OPEN_CREATE) &&
+        R_FAILED(fsFileSetSize(&f->file, 0))) {
+        fsFileClose(&f->file);
+        free(f);
+        return NULL;
+    }
+
+    f->base.backend = &g_native_backend;
+    return &f->base;
+}
+
+static int64_t native_read(VfsFile* file, uint64_t offset, void* buf, uint64_t size)
+{
+    NativeFile* f = (NativeFile*)file;
+    u64 read = 0;
+    if (R_FAILED(fsFileRead(&f->file, (s64)offset, buf, size, FsReadOption_None, &read)))
+        return -1;
+    return (int64_t)read;
+}
+
+static int native_write(VfsFile* file, uint64_t offset, const void* buf, uint64_t size)
+{
+    NativeFile* f = (NativeFile*)file;
+    return R_SUCCEEDED(fsFileWrite(&f->file, (s64)offset, buf, size, FsWriteOption_None)) ? 0 : -1;
+}
+
+static int native_get_size(VfsFile* file, uint64_t* out)
+{
+    NativeFile* f = (NativeFile*)file;
+    s64 size = 0;
+    if (R_FAILED(fsFileGetSize(&f->file, &size)))
+        return -1;
+    *out = (uint64_t)size;
+    return 0;
+}
+
+static int native_set_size(VfsFile* file, uint64_t size)
+{
+    NativeFile* f = (NativeFile*)file;
+    return R_SUCCEEDED(fsFileSetSize(&f->file, (s64)size)) ? 0 : -1;
+}
+
+static int native_flush(VfsFile* file)
+{
+    NativeFile* f = (NativeFile*)file;
+    return R_SUCCEEDED(fsFileFlush(&f->file)) ? 0 : -1;
+}
+
+static void native_close(VfsFile* file)
+{
+    NativeFile* f = (NativeFile*)file;
+    fsFileClose(&f->file);
+    free(f);
+}
+
+static int native_list(const char* path, FsDirectory* out, VfsBatchFn on_batch, void* user,
+                       uint64_t* service_calls)
+{
+    FsDir dir;
+    Result rc = fsFsOpenDirectory(g_sd_fs, path,
+                                  FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &dir);
+    (*service_calls)++;
+    if (R_FAILED(rc))
+        return -1;
+
+    // Size the result up front so the common case never reallocates.
+    // Streaming consumers drain 'out' per batch, so they skip this.
+    if (on_batch == NULL) {
+        s64 total = 0;
+        if (R_SUCCEEDED(fsDirGetEntryCount(&dir, &total)))
+            fs_dir_reserve(out, (int)total);
+        (*service_calls)++;
+    }
+
+    FsDirectoryEntry* batch = (FsDirectoryEntry*)malloc(sizeof(FsDirectoryEntry) * FS_LIST_BATCH);
+    if (batch == NULL) {
+        fsDirClose(&dir);
+        return -1;
+    }
+
+    while (1) {
+        s64 read = 0;
+        rc = fsDirRead(&dir, &read, FS_LIST_BATCH, batch);
+        (*service_calls)++;
+        if (R_FAILED(rc) || read <= 0)
+            break;
+
+        for (s64 i = 0; i < read; i++) {
+            const FsDirectoryEntry* e = &batch[i];
+            if (fs_dir_append(out, e->name, e->type == FsDirEntryType_Dir,
+                              (uint64_t)e->file_size) != 0)
+                goto done;  // Return partial results
+        }
+        if (on_batch != NULL && on_batch(user) != 0)
+            break;
+    }
+
+done:
+    free(batch);
+    fsDirClose(&dir);
+    (*service_calls)++;
+    return 0;
+}
+
+static int native_mkdir(const char* path)
+{
+    if (R_SUCCEEDED(fsFsCreateDirectory(g_sd_fs, path)))
+        return 0;
+
+    // Already there counts as success
+    FsDirEntryType type;
+    return R_SUCCEEDED(fsFsGetEntryType(g_sd_fs, path, &type)) &&
+           type == FsDirEntryType_Dir ? 0 : -1;
+}
+
+static int native_remove(const char* path)
+{
+    return R_SUCCEEDED(fsFsDeleteFile(g_sd_fs, path)) ? 0 : -1;
+}
+
+static int native_rmdir(const char* path)
+{
+    return R_SUCCEEDED(fsFsDeleteDirectory(g_sd_fs, path)) ? 0 : -1;
+}
+
+static int native_rename(const char* from, const char* to)
+{
+    FsDirEntryType type;
+    if (R_FAILED(fsFsGetEntryType(g_sd_fs, from, &type)))
+        return -1;
+
+    Result rc = (type == FsDirEntryType_Dir) ?
+                fsFsRenameDirectory(g_sd_fs, from, to) :
+                fsFsRenameFile(g_sd_fs, from, to);
+    return R_SUCCEEDED(rc) ? 0 : -1;
+}
+
+static VfsFile* native_create(const char* path, uint64_t size)
+{
+    // Creating at the final size lets the card allocate the clusters in
+    // one go instead of growing the chain write by write. If the file is
+    // already there, resize it instead. FAT32 cannot hold a file past
+    // 4 GiB; the service then stores it as a concatenation file.
+    int created = R_SUCCEEDED(fsFsCreateFile(g_sd_fs, path, (s64)size, 0));
+    if (!created && size > VFS_FAT32_MAX_FILE)
+        created = R_SUCCEEDED(fsFsCreateFile(g_sd_fs, path, (s64)size, FsCreateOption_BigFile));
+
+    NativeFile* f = (NativeFile*)malloc(sizeof(NativeFile));
+    if (f == NULL)
+        return NULL;
+    if (R_FAILED(fsFsOpenFile(g_sd_fs, path, FsOpenMode_Write | FsOpenMode_Append, &f->file))) {
+        free(f);
+        return NULL;
+    }
+    if (!created && R_FAILED(fsFileSetSize(&f->file, (s64)size))) {
+        fsFileClose(&f->file);
+        free(f);
+        return NULL;
+    }
+
+    f->base.backend = &g_native_backend;
+    return &f->base;
+}
+
+static int native_get_free_space(const char* path, uint64_t* out)
+{
+    (void)path;  // Everything lives on the one SD card filesystem
+    s64 free_bytes = 0;
+    if (R_FAILED(fsFsGetFreeSpace(g_sd_fs, "/", &free_bytes)))
+        return -1;
+    *out = (uint64_t)free_bytes;
+    return 0;
+}
+
+static int native_set_concatenation(const char* path)
+{
+    return R_SUCCEEDED(fsFsSetConcatenationFileAttribute(g_sd_fs, path)) ? 0 : -1;
+}
+
+static int native_remove_tree(const char* path)
+{
+    // The service walks the tree itself: one IPC round trip, not one per entry
+    return R_SUCCEEDED(fsFsDeleteDirectoryRecursively(g_sd_fs, path)) ? 0 : -1;
+}
+
+static int native_same_volume(const char* a, const char* b)
+{
+    (void)a;
+    (void)b;
+    return 1;  // Everything lives on the one SD card filesystem
+}
+
+static const VfsBackend g_native_backend = {
+    "native",
+    native_init,
+    native_cleanup,
+    native_stat,
+    native_get_mtime,
+    native_open,
+    native_read,
+    native_write,
+    native_get_size,
+    native_set_size,
+    native_close,
+    native_list,
+    native_mkdir,
+    native_remove,
+    native_rmdir,
+    native_rename,
+    native_create,
+    native_get_free_space,
+    native_flush,
+    native_set_concatenation,
+    native_remove_tree,
+    native_same_volume,
+};
+
+const VfsBackend* vfs_backend_native(void)
+{
+    return &g_native_backend;
+}
+
+#else
+
+const VfsBackend* vfs_backend_native(void)
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,274 @@
+#include "vfs.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+/**
+ * POSIX VFS backend
+ *
+ * Used on host builds, and on Switch if the SD card service could not
+ * be opened. Listings use readdir plus one fstatat per file for sizes.
+ */
+
+typedef struct {
+    VfsFile base;
+    int fd;
+} PosixFile;
+
+static const VfsBackend g_posix_backend;
+
+static int posix_stat(const char* path, VfsStat* out)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return -1;
+
+    out->is_dir = S_ISDIR(st.st_mode);
+    out->size = out->is_dir ? 0 : (uint64_t)st.st_size;
+    return 0;
+}
+
+static int posix_get_mtime(const char* path, uint64_t* out)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return -1;
+    *out = (uint64_t)st.st_mtime;
+    return 0;
+}
+
+static VfsFile* posix_open(const char* path, int mode)
+{
+    int flags;
+    if ((mode & VFS_OPEN_READ) && (mode & VFS_OPEN_WRITE))
+        flags = O_RDWR;
+    else if (mode & VFS_OPEN_WRITE)
+        flags = O_WRONLY;
+    else
+        flags = O_RDONLY;
+    if ((mode & VFS_OPEN_WRITE) && (mode & VFS_OPEN_CREATE))
+        flags |= O_CREAT | O_TRUNC;
+
+    PosixFile* f = (PosixFile*)malloc(sizeof(PosixFile));
+    if (f == NULL)
+        return NULL;
+    f->fd = open(path, flags, 0666);
+    if (f->fd < 0) {
+        free(f);
+        return NULL;
+    }
+    // Folders open read-only here; they are not files (split files are
+    // opened by the VFS layer above)
+    struct stat st;
+    if (fstat(f->fd, &st) == 0 && S_ISDIR(st.st_mode)) {
+        close(f->fd);
+        free(f);
+        return NULL;
+    }
+
+    f->base.backend = &g_posix_backend;
+    return &f->base;
+}
+
+static int64_t posix_read(VfsFile* file, uint64_t offset, void* buf, uint64_t size)
+{
+    PosixFile* f = (PosixFile*)file;
+    uint64_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(f->fd, (char*)buf + done, size - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            break;
+        done += (uint64_t)n;
+    }
+    return (int64_t)done;
+}
+
+static int posix_write(VfsFile* file, uint64_t offset, const void* buf, uint64_t size)
+{
+    PosixFile* f = (PosixFile*)file;
+    uint64_t done = 0;
+    while (done < size) {
+        ssize_t n = pwrite(f->fd, (const char*)buf + done, size - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int posix_get_size(VfsFile* file, uint64_t* out)
+{
+    PosixFile* f = (PosixFile*)file;
+    struct stat st;
+    if (fstat(f->fd, &st) != 0)
+        return -1;
+    *out = (uint64_t)st.st_size;
+    return 0;
+}
+
+static int posix_set_size(VfsFile* file, uint64_t size)
+{
+    PosixFile* f = (PosixFile*)file;
+    return ftruncate(f->fd, (off_t)size) == 0 ? 0 : -1;
+}
+
+static int posix_flush(VfsFile* file)
+{
+    PosixFile* f = (PosixFile*)file;
+    return fsync(f->fd) == 0 ? 0 : -1;
+}
+
+static void posix_close(VfsFile* file)
+{
+    PosixFile* f = (PosixFile*)file;
+    close(f->fd);
+    free(f);
+}
+
+static int posix_list(const char* path, FsDirectory* out, VfsBatchFn on_batch, void* user,
+                      uint64_t* service_calls)
+{
+    DIR* dir = opendir(path);
+    (*service_calls)++;
+    if (dir == NULL)
+        return -1;
+
+    int dfd = dirfd(dir);
+    int in_batch = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int is_dir = (entry->d_type == DT_DIR);
+        uint64_t size = 0;
+        if (!is_dir) {
+            struct stat file_stat;
+            (*service_calls)++;
+            if (dfd >= 0 && fstatat(dfd, entry->d_name, &file_stat, 0) == 0) {
+                is_dir = S_ISDIR(file_stat.st_mode);
+                size = (uint64_t)file_stat.st_size;
+            }
+        }
+        if (fs_dir_append(out, entry->d_name, is_dir, size) != 0)
+            break;  // Return partial results
+
+        if (++in_batch == FS_LIST_BATCH) {
+            in_batch = 0;
+            if (on_batch != NULL && on_batch(user) != 0)
+                break;
+        }
+    }
+    if (in_batch > 0 && on_batch != NULL)
+        on_batch(user);
+
+    closedir(dir);
+    (*service_calls)++;
+    return 0;
+}
+
+static int posix_mkdir(const char* path)
+{
+    if (mkdir(path, 0777) == 0)
+        return 0;
+
+    struct stat st;
+    return errno == EEXIST && stat(path, &st) == 0 && S_ISDIR(st.st_mode) ? 0 : -1;
+}
+
+static int posix_remove(const char* path)
+{
+    return unlink(path) == 0 ? 0 : -1;
+}
+
+static int posix_rmdir(const char* path)
+{
+    return rmdir(path) == 0 ? 0 : -1;
+}
+
+static int posix_rename(const char* from, const char* to)
+{
+    // rename() would replace an existing target; the native service refuses
+    struct stat st;
+    if (lstat(to, &st) == 0)
+        return -1;
+    return rename(from, to) == 0 ? 0 : -1;
+}
+
+static VfsFile* posix_create(const char* path, uint64_t size)
+{
+    PosixFile* f = (PosixFile*)posix_open(path, VFS_OPEN_WRITE | VFS_OPEN_CREATE);
+    if (f == NULL || size == 0)
+        return f != NULL ? &f->base : NULL;
+
+    // On hosts reserve real blocks where the filesystem supports it; on
+    // Switch, fsdev turns the truncate into fsFileSetSize, which allocates
+    int rc = -1;
+#ifndef __SWITCH__
+    rc = posix_fallocate(f->fd, 0, (off_t)size) == 0 ? 0 : -1;
+#endif
+    if (rc != 0 && ftruncate(f->fd, (off_t)size) != 0) {
+        posix_close(&f->base);
+        return NULL;
+    }
+    return &f->base;
+}
+
+static int posix_get_free_space(const char* path, uint64_t* out)
+{
+    struct statvfs st;
+    if (statvfs(path, &st) != 0)
+        return -1;
+    *out = (uint64_t)st.f_bavail * (uint64_t)st.f_frsize;
+    return 0;
+}
+
+static int posix_same_volume(const char* a, const char* b)
+{
+    struct stat sa;
+    struct stat sb;
+    if (stat(a, &sa) != 0 || stat(b, &sb) != 0)
+        return -1;
+    return sa.st_dev == sb.st_dev ? 1 : 0;
+}
+
+static const VfsBackend g_posix_backend = {
+    "posix",
+    NULL,
+    NULL,
+    posix_stat,
+    posix_get_mtime,
+    posix_open,
+    posix_read,
+    posix_write,
+    posix_get_size,
+    posix_set_size,
+    posix_close,
+    posix_list,
+    posix_mkdir,
+    posix_remove,
+    posix_rmdir,
+    posix_rename,
+    posix_create,
+    posix_get_free_space,
+    posix_flush,
+    NULL,
+    NULL,
+    posix_same_volume,
+};
+
+const VfsBackend* vfs_backend_posix(void)
+{
+    return &g_posix_backend;
+}
@@ -0,0 +1,430 @@
+#include "vfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/utils.h"
+
+/**
+ * Split files
+ *
+ * A split file is handled on top of the VFS calls for its parts, which
+ * are plain files, so it works over any backend and is counted like any
+ * other I/O. A handle keeps at most one part open and switches parts as
+ * reads and writes cross a boundary; a part is flushed before it is
+ * closed, so flushing the handle covers everything written through it.
+ * Existing parts are opened without VFS_OPEN_CREATE and never truncated.
+ */
+
+typedef struct {
+    int part_count;
+    uint64_t part_size;      // Size of part 00
+    uint64_t size;           // All parts together
+} SplitLayout;
+
+typedef struct {
+    VfsFile base;
+    char path[FS_MAX_PATH];
+    int mode;                // VFS_OPEN_READ / VFS_OPEN_WRITE
+    int mark;                // Set the concatenation attribute on close
+    int part_count;
+    uint64_t part_size;
+    uint64_t size;
+    VfsFile* part;           // Open part, or NULL
+    int part_index;
+} SplitFile;
+
+static const VfsBackend g_split_backend;
+
+// 1 if the last component of canonical 'path' has an extension
+static int split_candidate(const char* path)
+{
+    const char* name = path_get_filename(path);
+    return name != NULL && name[0] != '\0' && strchr(name + 1, '.') != NULL;
+}
+
+// Part number of 'name' ("00", "01", ... "100"), or -1 if it is none
+static int split_part_index(const char* name)
+{
+    int len = str_len(name);
+    if (len < 2 || len > 3)
+        return -1;
+
+    int index = 0;
+    for (int i = 0; i < len; i++) {
+        if (name[i] < '0' || name[i] > '9')
+            return -1;
+        index = index * 10 + (name[i] - '0');
+    }
+    if (index >= VFS_SPLIT_MAX_PARTS)
+        return -1;
+
+    // "007" is not part 7
+    char canonical[4];
+    int n = snprintf(canonical, sizeof(canonical), "%02d", index);
+    if (n < 0 || (size_t)n >= sizeof(canonical))
+        return -1;
+    return strcmp(canonical, name) == 0 ? index : -1;
+}
+
+// Path of part 'index' of 'path'. Returns -1 if it does not fit 'size'.
+static int split_part_path(const char* path, int index, char* out, size_t size)
+{
+    if (index < 0 || index >= VFS_SPLIT_MAX_PARTS)
+        return -1;
+    int n = snprintf(out, size, "%s/%02d", path, index);
+    return n >= 0 && (size_t)n < size ? 0 : -1;
+}
+
+/**
+ * SplitListing - Folder being listed as a split file candidate
+ */
+typedef struct {
+    FsDirectory* dir;
+    int checked;             // Entries already looked at
+    int failed;              // Found something that is not a part
+} SplitListing;
+
+// Stop the listing at the first folder or other name, or too many parts
+static int split_scan_batch(void* user)
+{
+    SplitListing* listing = (SplitListing*)user;
+    int count = fs_dir_count(listing->dir);
+    if (count > VFS_SPLIT_MAX_PARTS)
+        listing->failed = 1;
+    for (; !listing->failed && listing->checked < count; listing->checked++) {
+        if (fs_dir_is_dir(listing->dir, listing->checked) ||
+            split_part_index(fs_dir_name(listing->dir, listing->checked)) < 0)
+            listing->failed = 1;
+    }
+    return listing->failed;
+}
+
+// Read the parts of folder 'path'. Returns 0 if it is a split file.
+static int split_scan(const char* path, SplitLayout* out)
+{
+    FsDirectory* dir = fs_dir_create(16);
+    if (dir == NULL)
+        return -1;
+
+    // Straight to the backend (not counted): vfs_list() would probe the
+    // subfolders too
+    SplitListing listing = { dir, 0, 0 };
+    uint64_t calls = 0;
+    int count = 0;
+    int ok = vfs_backend()->list(path, dir, split_scan_batch, &listing, &calls) == 0 &&
+             split_scan_batch(&listing) == 0;
+    if (ok) {
+        count = fs_dir_count(dir);
+        ok = count > 0 && count <= VFS_SPLIT_MAX_PARTS;
+    }
+
+    // Every entry is a part file; 'count' distinct numbers below 'count'
+    // are exactly 00 to count - 1
+    uint64_t sizes[VFS_SPLIT_MAX_PARTS];
+    uint8_t seen[VFS_SPLIT_MAX_PARTS] = {0};
+    for (int i = 0; ok && i < count; i++) {
+        int index = split_part_index(fs_dir_name(dir, i));
+        ok = index >= 0 && index < count && !seen[index];
+        if (ok) {
+            seen[index] = 1;
+            sizes[index] = fs_dir_size(dir, i);
+        }
+    }
+    for (int i = 1; ok && i < count; i++)
+        ok = sizes[0] > 0 && (i == count - 1 ? sizes[i] <= sizes[0] : sizes[i] == sizes[0]);
+
+    if (ok) {
+        out->part_count = count;
+        out->part_size = sizes[0];
+        out->size = sizes[0] * (uint64_t)(count - 1) + sizes[count - 1];
+    }
+    fs_free_directory(dir);
+    return ok ? 0 : -1;
+}
+
+int vfs_split_probe(const char* path, uint64_t* size)
+{
+    if (path == NULL)
+        return 0;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    SplitLayout layout;
+    if (!split_candidate(canon) || split_scan(canon, &layout) != 0)
+        return 0;
+    if (size != NULL)
+        *size = layout.size;
+    return 1;
+}
+
+static SplitFile* split_new(const char* canon, int mode)
+{
+    SplitFile* f = (SplitFile*)calloc(1, sizeof(SplitFile));
+    if (f == NULL)
+        return NULL;
+    f->base.backend = &g_split_backend;
+    str_copy(f->path, canon, sizeof(f->path));
+    f->mode = mode & (VFS_OPEN_READ | VFS_OPEN_WRITE);
+    f->part_index = -1;
+    return f;
+}
+
+// Close the open part, flushing what was written to it
+static int split_release(SplitFile* f)
+{
+    int rc = 0;
+    if (f->part != NULL) {
+        if (f->mode & VFS_OPEN_WRITE)
+            rc = vfs_flush(f->part);
+        vfs_close(f->part);
+        f->part = NULL;
+    }
+    return rc;
+}
+
+static VfsFile* split_part(SplitFile* f, int index)
+{
+    if (f->part != NULL && f->part_index == index)
+        return f->part;
+    if (split_release(f) != 0)
+        return NULL;
+
+    char part[FS_MAX_PATH + 8];
+    if (split_part_path(f->path, index, part, sizeof(part)) != 0)
+        return NULL;
+    f->part = vfs_open(part, f->mode);
+    f->part_index = index;
+    return f->part;
+}
+
+// Bytes of part 'index' in a file of 'size' bytes
+static uint64_t split_part_length(const SplitFile* f, int index, uint64_t size)
+{
+    uint64_t start = (uint64_t)index * f->part_size;
+    if (size <= start)
+        return 0;
+    return size - start < f->part_size ? size - start : f->part_size;
+}
+
+// Add, resize and drop parts so they hold 'size' bytes
+static int split_resize(SplitFile* f, uint64_t size)
+{
+    uint64_t needed = size == 0 ? 1 : (size + f->part_size - 1) / f->part_size;
+    if (needed > VFS_SPLIT_MAX_PARTS || split_release(f) != 0)
+        return -1;
+
+    char part[FS_MAX_PATH + 8];
+    while ((uint64_t)f->part_count > needed) {
+        if (split_part_path(f->path, f->part_count - 1, part, sizeof(part)) != 0 ||
+            vfs_remove(part) != 0)
+            return -1;
+        f->part_count--;
+    }
+
+    for (int i = 0; i < (int)needed; i++) {
+        uint64_t length = split_part_length(f, i, size);
+        VfsFile* file = NULL;
+        if (split_part_path(f->path, i, part, sizeof(part)) != 0)
+            return -1;
+        if (i >= f->part_count) {
+            // New parts are created at their final length
+            file = vfs_create(part, length);
+            if (file == NULL)
+                return -1;
+            f->part_count = i + 1;
+        } else if (split_part_length(f, i, f->size) != length) {
+            file = vfs_open(part, VFS_OPEN_WRITE);
+            if (file == NULL || vfs_set_size(file, length) != 0) {
+                vfs_close(file);
+                return -1;
+            }
+        }
+        vfs_close(file);
+    }
+    f->size = size;
+    return 0;
+}
+
+static int64_t split_read(VfsFile* file, uint64_t offset, void* buf, uint64_t size)
+{
+    SplitFile* f = (SplitFile*)file;
+    if (offset >= f->size)
+        return 0;
+    if (size > f->size - offset)
+        size = f->size - offset;
+
+    uint64_t done = 0;
+    while (done < size) {
+        uint64_t at = offset + done;
+        uint64_t within = at % f->part_size;
+        uint64_t want = size - done < f->part_size - within ? size - done : f->part_size - within;
+        VfsFile* part = split_part(f, (int)(at / f->part_size));
+        if (part == NULL)
+            return -1;
+        int64_t n = vfs_read(part, within, (char*)buf + done, want);
+        if (n < 0)
+            return -1;
+        done += (uint64_t)n;
+        if ((uint64_t)n < want)
+            break;  // Part shorter than when opened
+    }
+    return (int64_t)done;
+}
+
+static int split_write(VfsFile* file, uint64_t offset, const void* buf, uint64_t size)
+{
+    SplitFile* f = (SplitFile*)file;
+    if (!(f->mode & VFS_OPEN_WRITE))
+        return -1;
+    if (offset + size > f->size && split_resize(f, offset + size) != 0)
+        return -1;
+
+    uint64_t done = 0;
+    while (done < size) {
+        uint64_t at = offset + done;
+        uint64_t within = at % f->part_size;
+        uint64_t n = size - done < f->part_size - within ? size - done : f->part_size - within;
+        VfsFile* part = split_part(f, (int)(at / f->part_size));
+        if (part == NULL || vfs_write(part, within, (const char*)buf + done, n) != 0)
+            return -1;
+        done += n;
+    }
+    return 0;
+}
+
+static int split_get_size(VfsFile* file, uint64_t* out)
+{
+    *out = ((SplitFile*)file)->size;
+    return 0;
+}
+
+static int split_set_size(VfsFile* file, uint64_t size)
+{
+    SplitFile* f = (SplitFile*)file;
+    if (!(f->mode & VFS_OPEN_WRITE))
+        return -1;
+    return split_resize(f, size);
+}
+
+static int split_flush(VfsFile* file)
+{
+    SplitFile* f = (SplitFile*)file;
+    return f->part != NULL ? vfs_flush(f->part) : 0;
+}
+
+static void split_close(VfsFile* file)
+{
+    SplitFile* f = (SplitFile*)file;
+    split_release(f);
+    // Once marked, the SD card service shows the folder as one file
+    const VfsBackend* backend = vfs_backend();
+    if (f->mark && backend->set_concatenation != NULL)
+        backend->set_concatenation(f->path);
+    free(f);
+}
+
+static const VfsBackend g_split_backend = {
+    "split",
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    split_read,
+    split_write,
+    split_get_size,
+    split_set_size,
+    split_close,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    split_flush,
+    NULL,
+    NULL,
+    NULL,
+};
+
+VfsFile* vfs_split_open(const char* path, int mode)
+{
+    if (path == NULL || (mode & (VFS_OPEN_READ | VFS_OPEN_WRITE)) == 0)
+        return NULL;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    SplitLayout layout;
+    if (!split_candidate(canon) || split_scan(canon, &layout) != 0)
+        return NULL;
+
+    SplitFile* f = split_new(canon, mode);
+    if (f == NULL)
+        return NULL;
+    f->part_count = layout.part_count;
+    f->size = layout.size;
+    // A lone part may still grow to a full one
+    f->part_size = layout.part_count == 1 && layout.part_size < VFS_SPLIT_PART_SIZE ?
+                   VFS_SPLIT_PART_SIZE : layout.part_size;
+    return &f->base;
+}
+
+VfsFile* vfs_split_create(const char* path, uint64_t size, uint64_t part_size)
+{
+    if (path == NULL)
+        return NULL;
+    if (part_size == 0)
+        part_size = VFS_SPLIT_PART_SIZE;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    if (!split_candidate(canon))
+        return NULL;
+
+    // Replace a file (split or not), never a folder
+    VfsStat st;
+    if (vfs_stat(canon, &st) == 0 && (st.is_dir || vfs_remove(canon) != 0))
+        return NULL;
+    if (vfs_mkdir(canon) != 0)
+        return NULL;
+
+    SplitFile* f = split_new(canon, VFS_OPEN_READ | VFS_OPEN_WRITE);
+    if (f == NULL) {
+        vfs_rmdir(canon);
+        return NULL;
+    }
+    f->part_size = part_size;
+    f->mark = 1;
+    if (split_resize(f, size) != 0) {
+        char part[FS_MAX_PATH + 8];
+        for (int i = 0; i < f->part_count; i++) {
+            if (split_part_path(canon, i, part, sizeof(part)) == 0)
+                vfs_remove(part);
+        }
+        vfs_rmdir(canon);
+        free(f);
+        return NULL;
+    }
+    return &f->base;
+}
+
+int vfs_split_remove(const char* path)
+{
+    if (path == NULL)
+        return -1;
+
+    char canon[FS_MAX_PATH];
+    path_canonicalize(path, canon, sizeof(canon));
+    SplitLayout layout;
+    if (!split_candidate(canon) || split_scan(canon, &layout) != 0)
+        return -1;
+
+    char part[FS_MAX_PATH + 8];
+    for (int i = 0; i < layout.part_count; i++) {
+        if (split_part_path(canon, i, part, sizeof(part)) != 0 ||
+            vfs_remove(part) != 0)
+            return -1;
+    }
+    return vfs_rmdir(canon);
+}
@@ -0,0 +1,183 @@
+#include "walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/utils.h"
+
+/**
+ * Tree walker implementation
+ *
+ * One frame per folder on the current branch: its listing, the next
+ * entry to visit and the length of its path in the shared path buffer.
+ * Entering a folder appends "/name" to the buffer and pushes a frame;
+ * finishing one pops the frame and truncates the buffer back to the
+ * parent, so no path is ever rebuilt from scratch.
+ */
+
+typedef struct {
+    FsDirectory* listing;
+    int next;                // Next entry to visit
+    int path_len;            // Length of this folder's path
+} WalkFrame;
+
+typedef struct {
+    WalkFrame* frames;
+    int count;
+    int capacity;
+    char path[FS_MAX_PATH];  // Path of the entry being visited
+    int path_len;
+} WalkState;
+
+// Append "/name" to the path. Returns -1 if it would not fit.
+static int walk_path_append(WalkState* w, const char* name, int name_len)
+{
+    int sep = (w->path_len > 0 && w->path[w->path_len - 1] == '/') ? 0 : 1;
+    if (w->path_len + sep + name_len >= FS_MAX_PATH)
+        return -1;
+    if (sep)
+        w->path[w->path_len++] = '/';
+    memcpy(w->path + w->path_len, name, name_len);
+    w->path_len += name_len;
+    w->path[w->path_len] = '\0';
+    return 0;
+}
+
+static void walk_path_truncate(WalkState* w, int len)
+{
+    w->path_len = len;
+    w->path[len] = '\0';
+}
+
+static int walk_push(WalkState* w, FsDirectory* listing)
+{
+    if (w->count == w->capacity) {
+        int capacity = w->capacity > 0 ? w->capacity * 2 : 32;
+        WalkFrame* frames = (WalkFrame*)realloc(w->frames, sizeof(WalkFrame) * capacity);
+        if (frames == NULL)
+            return -1;
+        w->frames = frames;
+        w->capacity = capacity;
+    }
+
+    WalkFrame* f = &w->frames[w->count++];
+    f->listing = listing;
+    f->next = 0;
+    f->path_len = w->path_len;
+    return 0;
+}
+
+// List the folder at the current path
+static FsDirectory* walk_list(WalkState* w, WalkStats* stats)
+{
+    FsListStats list_stats;
+    FsDirectory* listing = fs_list_directory_stats(w->path, &list_stats);
+    stats->service_calls += list_stats.service_calls;
+    if (listing == NULL)
+        stats->errors++;
+    else
+        stats->dirs++;
+    return listing;
+}
+
+int walk_join(const char* dir, const char* name, char* dest, int dest_size)
+{
+    int len = str_len(dir);
+    int n = (len > 0 && dir[len - 1] == '/') ?
+            snprintf(dest, dest_size, "%s%s", dir, name) :
+            snprintf(dest, dest_size, "%s/%s", dir, name);
+    return (n > 0 && n < dest_size) ? 0 : -1;
+}
+
+int walk_tree(const char* root, WalkVisitor pre, WalkVisitor post, void* user,
+              const atomic_int* cancel, WalkStats* stats)
+{
+    WalkStats local;
+    if (stats == NULL)
+        stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    if (root == NULL || pre == NULL)
+        return -1;
+
+    WalkState w;
+    memset(&w, 0, sizeof(w));
+    str_copy(w.path, root, sizeof(w.path));
+    w.path_len = str_len(w.path);
+
+    FsDirectory* listing = walk_list(&w, stats);
+    if (listing == NULL) {
+        stats->errors = 0;
+        return -1;
+    }
+    if (walk_push(&w, listing) != 0) {
+        fs_free_directory(listing);
+        return -1;
+    }
+
+    int result = 0;
+    while (w.count > 0 && result == 0) {
+        WalkFrame* f = &w.frames[w.count - 1];
+        int depth = w.count - 1;
+
+        if (f->next == fs_dir_count(f->listing)) {
+            // Folder finished: back up to its parent and report it
+            fs_free_directory(f->listing);
+            w.count--;
+            if (w.count == 0)
+                break;
+            WalkFrame* parent = &w.frames[w.count - 1];
+            if (post != NULL) {
+                FsEntry entry;
+                fs_dir_get_entry(parent->listing, parent->next - 1, &entry);
+                if (post(w.path, &entry, depth - 1, user) == WALK_STOP)
+                    result = 1;
+            }
+            walk_path_truncate(&w, parent->path_len);
+            continue;
+        }
+
+        if (cancel != NULL && atomic_load(cancel)) {
+            result = 1;
+            break;
+        }
+
+        FsEntry entry;
+        fs_dir_get_entry(f->listing, f->next++, &entry);
+        if (walk_path_append(&w, entry.name, entry.name_len) != 0) {
+            stats->errors++;  // Path too long for the filesystem
+            continue;
+        }
+        if (!entry.is_dir) {
+            stats->files++;
+            stats->bytes += entry.size;
+        }
+
+        int action = pre(w.path, &entry, depth, user);
+        if (action == WALK_STOP) {
+            result = 1;
+            break;
+        }
+        if (!entry.is_dir || action == WALK_SKIP) {
+            walk_path_truncate(&w, f->path_len);
+            continue;
+        }
+
+        // Descend; the frame pointer may move when the stack grows
+        FsDirectory* child = walk_list(&w, stats);
+        if (child == NULL)
+            child = fs_dir_create(1);  // Still report it to 'post'
+        if (child == NULL || walk_push(&w, child) != 0) {
+            fs_free_directory(child);
+            result = -1;
+            break;
+        }
+        if (w.count - 1 > stats->max_depth)
+            stats->max_depth = w.count - 1;
+    }
+
+    // Stopped early: release the listings still on the stack
+    while (w.count > 0)
+        fs_free_directory(w.frames[--w.count].listing);
+    free(w.frames);
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include "fs.h"
+#include <stdatomic.h>
+
+/**
+ * Tree walker module
+ *
+ * Iterative depth-first traversal of a folder tree, shared by every
+ * feature that needs to visit a whole subtree (copy, delete, folder
+ * sizes). Each folder is read with one batched listing. The folders
+ * being walked are kept on a heap-allocated stack of frames (listing
+ * plus position), so deep trees cannot overflow the thread stack, and
+ * the current path is built in one buffer by appending a name on the
+ * way down and truncating it on the way back up. Walks are synchronous:
+ * run them on a worker thread for large trees.
+ */
+
+/* Visitor return values */
+#define WALK_CONTINUE 0   // Keep going (descend into folders)
+#define WALK_SKIP     1   // Do not descend into this folder
+#define WALK_STOP     2   // Abort the walk
+
+/**
+ * WalkVisitor - Called for an entry below the root
+ * 'path' is the entry's full path (valid only during the call) and
+ * 'depth' is 0 for entries directly in the root. Return one of the
+ * WALK_* values.
+ *
+ * The pre-order visitor sees every entry before a folder's contents.
+ * The post-order visitor sees each folder after its contents, for every
+ * folder the pre-order visitor let the walk enter, including folders
+ * that could not be listed.
+ */
+typedef int (*WalkVisitor)(const char* path, const FsEntry* entry, int depth, void* user);
+
+/**
+ * WalkStats - Counters for one walk
+ */
+typedef struct {
+    uint64_t dirs;           // Folders listed (including the root)
+    uint64_t files;          // Files visited
+    uint64_t bytes;          // Sum of visited file sizes
+    uint64_t errors;         // Folders that could not be listed (skipped)
+    int max_depth;           // Deepest folder level entered (root = 0)
+    uint64_t service_calls;  // Filesystem calls made by the listings
+} WalkStats;
+
+/**
+ * walk_tree(root, pre, post, user, cancel, stats)
+ * Visit every entry below 'root' depth first. 'pre' is required, 'post'
+ * may be NULL. 'cancel' (may be NULL) is polled between entries;
+ * 'stats' (may be NULL) receives the counters.
+ * Returns 0 when the whole tree was visited, 1 if stopped by a visitor
+ * or 'cancel', -1 if 'root' cannot be listed or memory ran out.
+ */
+int walk_tree(const char* root, WalkVisitor pre, WalkVisitor post, void* user,
+              const atomic_int* cancel, WalkStats* stats);
+
+/**
+ * walk_join(dir, name, dest, dest_size)
+ * Build "dir/name" without doubling the separator after "/".
+ * Returns 0 on success, -1 if the result does not fit.
+ */
+int walk_join(const char* dir, const char* name, char* dest, int dest_size);
+
+#endif
@@ -1,125 +1,503 @@
 #include "fs.h"
 #include "utils.h"
+#include "vfs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
-#include <sys/stat.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 /**
  * Filesystem Module Implementation
  * 
  * Provides directory listing and navigation.
- * Works with SD card using standard POSIX operations.
- * Automatically supports both "/" and "sdmc:/" paths via libnx.
+ * All I/O goes through the VFS module: on Switch its native backend talks
+ * to the SD card service directly (one fsFsOpenDirectory, a handful of
+ * fsDirRead calls returning FS_LIST_BATCH entries each, one fsDirClose);
+ * host builds use its POSIX backend.
+ *
+ * Listings are stored structure-of-arrays: names are packed into a single
+ * arena and offsets, lengths, sizes and flags live in parallel columns.
  */
 
-// Keep handle for mounted SD card filesystem so POSIX calls work on Switch
-static FsFileSystem g_sd_fs;
-static int g_sd_mounted = 0;
-
 void fs_init(void)
 {
-    // Try to mount the SD card filesystem so POSIX APIs (opendir/stat/fopen)
-    // operate correctly on Switch. This uses libnx helper to open the sdcard
-    // filesystem and mounts it under the "sdmc" device via fsdev.
-    Result rc = fsOpenSdCardFileSystem(&g_sd_fs);
-    if (R_SUCCEEDED(rc)) {
-        rc = fsdevMountDevice("sdmc", g_sd_fs);
-        if (R_SUCCEEDED(rc)) {
-            g_sd_mounted = 1;
-        } else {
-            // Failed to mount; close fs handle
-            fsFsClose(&g_sd_fs);
-            g_sd_mounted = 0;
-        }
-    }
-    // Even if mount failed, POSIX calls may still operate on some paths.
+    // Uses the SD card session behind "sdmc", or falls back to POSIX calls
+    vfs_init(NULL);
 }
 
 void fs_cleanup(void)
 {
-    // Unmount sdmc if we mounted it
-    if (g_sd_mounted) {
-        fsdevUnmountDevice("sdmc");
-        fsFsClose(&g_sd_fs);
-        g_sd_mounted = 0;
+    vfs_cleanup();
+}
+
+uint64_t fs_now_ns(void)
+{
+#ifdef __SWITCH__
+    return armTicksToNs(armGetSystemTick());
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Resize every per-entry column to 'capacity' slots. Returns -1 on OOM,
+// leaving the directory untouched.
+static int fs_dir_resize(FsDirectory* fs_dir, int capacity)
+{
+    uint32_t* offsets = (uint32_t*)realloc(fs_dir->name_offsets, sizeof(uint32_t) * capacity);
+    if (offsets == NULL) return -1;
+    fs_dir->name_offsets = offsets;
+
+    uint16_t* lengths = (uint16_t*)realloc(fs_dir->name_lengths, sizeof(uint16_t) * capacity);
+    if (lengths == NULL) return -1;
+    fs_dir->name_lengths = lengths;
+
+    uint64_t* sizes = (uint64_t*)realloc(fs_dir->sizes, sizeof(uint64_t) * capacity);
+    if (sizes == NULL) return -1;
+    fs_dir->sizes = sizes;
+
+    uint8_t* flags = (uint8_t*)realloc(fs_dir->flags, sizeof(uint8_t) * capacity);
+    if (flags == NULL) return -1;
+    fs_dir->flags = flags;
+
+    fs_dir->capacity = capacity;
+    return 0;
+}
+
+FsDirectory* fs_dir_create(int capacity)
+{
+    FsDirectory* fs_dir = (FsDirectory*)calloc(1, sizeof(FsDirectory));
+    if (fs_dir == NULL)
+        return NULL;
+
+    if (capacity <= 0)
+        capacity = 32;
+
+    // Assume ~24 byte names for the initial arena; it grows on demand
+    fs_dir->names_capacity = (uint32_t)capacity * 24 + FS_NAME_SLACK;
+    fs_dir->names = (char*)malloc(fs_dir->names_capacity);
+    if (fs_dir->names == NULL || fs_dir_resize(fs_dir, capacity) != 0) {
+        fs_free_directory(fs_dir);
+        return NULL;
     }
+    return fs_dir;
 }
 
-FsDirectory* fs_list_directory(const char* path)
+int fs_dir_reserve(FsDirectory* dir, int capacity)
+{
+    if (dir == NULL)
+        return -1;
+    if (capacity <= dir->capacity)
+        return 0;
+    return fs_dir_resize(dir, capacity);
+}
+
+int fs_dir_append(FsDirectory* fs_dir, const char* name, int is_dir, uint64_t size)
+{
+    if (fs_dir == NULL || name == NULL)
+        return -1;
+
+    // Skip "." and ".." entries
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+        return 0;
+
+    if (fs_dir->count >= fs_dir->capacity) {
+        if (fs_dir_resize(fs_dir, fs_dir->capacity * 2) != 0)
+            return -1;
+    }
+
+    size_t len = strlen(name);
+    if (len > 0xFFFF)
+        len = 0xFFFF;
+
+    // Keep FS_NAME_SLACK spare bytes after the last name for vector scans
+    if (fs_dir->names_used + len + 1 + FS_NAME_SLACK > fs_dir->names_capacity) {
+        uint32_t new_capacity = fs_dir->names_capacity * 2;
+        while (fs_dir->names_used + len + 1 + FS_NAME_SLACK > new_capacity)
+            new_capacity *= 2;
+        char* names = (char*)realloc(fs_dir->names, new_capacity);
+        if (names == NULL)
+            return -1;
+        fs_dir->names = names;
+        fs_dir->names_capacity = new_capacity;
+    }
+
+    int i = fs_dir->count;
+    memcpy(fs_dir->names + fs_dir->names_used, name, len);
+    fs_dir->names[fs_dir->names_used + len] = '\0';
+    fs_dir->name_offsets[i] = fs_dir->names_used;
+    fs_dir->name_lengths[i] = (uint16_t)len;
+    fs_dir->sizes[i] = is_dir ? 0 : size;
+    fs_dir->flags[i] = is_dir ? FS_ENTRY_DIR : 0;
+    fs_dir->names_used += (uint32_t)len + 1;
+    fs_dir->count++;
+    fs_dir->sort_tag = 0;
+    return 0;
+}
+
+int fs_dir_permute(FsDirectory* dir, const uint32_t* order)
+{
+    if (dir == NULL || order == NULL)
+        return -1;
+
+    int n = dir->count;
+    uint32_t* offsets = (uint32_t*)malloc(sizeof(uint32_t) * dir->capacity);
+    uint16_t* lengths = (uint16_t*)malloc(sizeof(uint16_t) * dir->capacity);
+    uint64_t* sizes = (uint64_t*)malloc(sizeof(uint64_t) * dir->capacity);
+    uint8_t* flags = (uint8_t*)malloc(sizeof(uint8_t) * dir->capacity);
+    if (offsets == NULL || lengths == NULL || sizes == NULL || flags == NULL) {
+        free(offsets); free(lengths); free(sizes); free(flags);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint32_t src = order[i];
+        offsets[i] = dir->name_offsets[src];
+        lengths[i] = dir->name_lengths[src];
+        sizes[i] = dir->sizes[src];
+        flags[i] = dir->flags[src];
+    }
+
+    free(dir->name_offsets); dir->name_offsets = offsets;
+    free(dir->name_lengths); dir->name_lengths = lengths;
+    free(dir->sizes); dir->sizes = sizes;
+    free(dir->flags); dir->flags = flags;
+    return 0;
+}
+
+void fs_dir_clear(FsDirectory* dir)
+{
+    if (dir == NULL)
+        return;
+    dir->count = 0;
+    dir->names_used = 0;
+    dir->sort_tag = 0;
+}
+
+int fs_dir_count(const FsDirectory* dir)
+{
+    return dir ? dir->count : 0;
+}
+
+const char* fs_dir_name(const FsDirectory* dir, int index)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return "";
+    return dir->names + dir->name_offsets[index];
+}
+
+int fs_dir_name_length(const FsDirectory* dir, int index)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return 0;
+    return dir->name_lengths[index];
+}
+
+int fs_dir_is_dir(const FsDirectory* dir, int index)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return 0;
+    return (dir->flags[index] & FS_ENTRY_DIR) != 0;
+}
+
+uint64_t fs_dir_size(const FsDirectory* dir, int index)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return 0;
+    return dir->sizes[index];
+}
+
+void fs_dir_set_size(FsDirectory* dir, int index, uint64_t size)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return;
+    dir->sizes[index] = size;
+    dir->flags[index] |= FS_ENTRY_SIZED;
+}
+
+int fs_dir_size_known(const FsDirectory* dir, int index)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return 0;
+    return (dir->flags[index] & (FS_ENTRY_DIR | FS_ENTRY_SIZED)) != FS_ENTRY_DIR;
+}
+
+void fs_dir_set_split(FsDirectory* dir, int index, uint64_t size)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return;
+    dir->sizes[index] = size;
+    dir->flags[index] = FS_ENTRY_SPLIT;
+}
+
+int fs_dir_is_split(const FsDirectory* dir, int index)
+{
+    if (dir == NULL || index < 0 || index >= dir->count)
+        return 0;
+    return (dir->flags[index] & FS_ENTRY_SPLIT) != 0;
+}
+
+int fs_dir_get_entry(const FsDirectory* dir, int index, FsEntry* out)
+{
+    if (dir == NULL || out == NULL || index < 0 || index >= dir->count)
+        return -1;
+
+    out->name = dir->names + dir->name_offsets[index];
+    out->name_len = dir->name_lengths[index];
+    out->is_dir = (dir->flags[index] & FS_ENTRY_DIR) != 0;
+    out->size = dir->sizes[index];
+    return 0;
+}
+
+int fs_dir_find(const FsDirectory* dir, const char* name)
+{
+    if (dir == NULL || name == NULL)
+        return -1;
+
+    size_t len = strlen(name);
+    for (int i = 0; i < dir->count; i++) {
+        if (dir->name_lengths[i] == len &&
+            memcmp(dir->names + dir->name_offsets[i], name, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+uint64_t fs_dir_memory_usage(const FsDirectory* dir)
+{
+    if (dir == NULL)
+        return 0;
+
+    uint64_t per_entry = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+    return sizeof(FsDirectory) + dir->names_capacity + per_entry * (uint64_t)dir->capacity;
+}
+
+// State shared by the listing engines. Entries are appended to 'out';
+// when 'on_batch' is set it is called after every batch and may stop the
+// listing early by returning non-zero.
+typedef struct {
+    const char* path;
+    FsDirectory* out;
+    FsListStats* stats;
+    uint64_t start_ns;
+    int (*on_batch)(void* user);
+    void* user;
+} FsListCtx;
+
+// Record time-to-first-batch and hand the batch to the consumer
+static int fs_list_emit(FsListCtx* ctx)
+{
+    if (ctx->stats->first_batch_ns == 0)
+        ctx->stats->first_batch_ns = fs_now_ns() - ctx->start_ns;
+    return ctx->on_batch ? ctx->on_batch(ctx->user) : 0;
+}
+
+// Batch callback handed to the VFS listing
+static int fs_list_batch(void* user)
+{
+    return fs_list_emit((FsListCtx*)user);
+}
+
+// List 'ctx->path' through the VFS
+static int fs_list_run(FsListCtx* ctx)
+{
+    memset(ctx->stats, 0, sizeof(*ctx->stats));
+    ctx->start_ns = fs_now_ns();
+
+    // Blocking listings get no callback so the backend may presize 'out'
+    int rc = vfs_list(ctx->path, ctx->out, ctx->on_batch ? fs_list_batch : NULL, ctx,
+                      &ctx->stats->service_calls);
+
+    ctx->stats->elapsed_ns = fs_now_ns() - ctx->start_ns;
+    if (ctx->stats->first_batch_ns == 0)
+        ctx->stats->first_batch_ns = ctx->stats->elapsed_ns;
+    return rc;
+}
+
+FsDirectory* fs_list_directory_stats(const char* path, FsListStats* stats)
 {
     if (path == NULL)
         return NULL;
 
-    // Open directory using standard POSIX (libnx handles path resolution)
-    DIR* dir = opendir(path);
-    if (dir == NULL)
+    FsListStats local;
+    FsListCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.path = path;
+    ctx.stats = stats ? stats : &local;
+    ctx.out = fs_dir_create(32);
+    if (ctx.out == NULL)
         return NULL;
 
-    // Allocate directory structure
-    FsDirectory* fs_dir = (FsDirectory*)malloc(sizeof(FsDirectory));
-    if (fs_dir == NULL) {
-        closedir(dir);
+    if (fs_list_run(&ctx) != 0) {
+        fs_free_directory(ctx.out);
         return NULL;
     }
 
-    // Initialize
-    fs_dir->capacity = 32;
-    fs_dir->count = 0;
-    fs_dir->entries = (FsEntry*)malloc(sizeof(FsEntry) * fs_dir->capacity);
+    ctx.stats->entries = (uint64_t)ctx.out->count;
+    return ctx.out;
+}
+
+FsDirectory* fs_list_directory(const char* path)
+{
+    return fs_list_directory_stats(path, NULL);
+}
+
+/**
+ * Progressive listing
+ *
+ * A worker thread runs the listing engine into a private staging
+ * directory. After each batch it moves the staged entries into 'pending'
+ * under the lock; the UI thread drains 'pending' into its own listing with
+ * fs_stream_pump(), so the visible FsDirectory is only ever touched by
+ * the thread that renders it.
+ */
+struct FsListStream {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    char path[FS_MAX_PATH];
+    FsDirectory* staging;        // Worker-private batch buffer
+    FsDirectory* pending;        // Entries not yet pumped (guarded by lock)
+    FsListStats stats;           // Final once state leaves LOADING
+    atomic_int cancel;           // Set by fs_stream_cancel()/fs_stream_close()
+    atomic_int state;            // FS_STREAM_* value
+    int background;              // Worker runs at low priority
+};
+
+// Move every entry of 'src' to the end of 'dst' and empty 'src'
+static int fs_dir_move_all(FsDirectory* dst, FsDirectory* src)
+{
+    int rc = 0;
+    for (int i = 0; i < src->count; i++) {
+        if (fs_dir_append(dst, src->names + src->name_offsets[i],
+                          (src->flags[i] & FS_ENTRY_DIR) != 0, src->sizes[i]) != 0) {
+            rc = -1;
+            break;
+        }
+        dst->flags[dst->count - 1] = src->flags[i];  // Keep split marks
+    }
+    fs_dir_clear(src);
+    return rc;
+}
+
+static int fs_stream_on_batch(void* user)
+{
+    FsListStream* stream = (FsListStream*)user;
+    pthread_mutex_lock(&stream->lock);
+    fs_dir_move_all(stream->pending, stream->staging);
+    pthread_mutex_unlock(&stream->lock);
+    return atomic_load(&stream->cancel);
+}
+
+static void* fs_stream_worker(void* arg)
+{
+    FsListStream* stream = (FsListStream*)arg;
 
-    if (fs_dir->entries == NULL) {
-        free(fs_dir);
-        closedir(dir);
+#ifdef __SWITCH__
+    // Lowest priority available to applications: yields to the UI thread
+    if (stream->background)
+        svcSetThreadPriority(CUR_THREAD_HANDLE, 0x3F);
+#endif
+
+    FsListCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.path = stream->path;
+    ctx.out = stream->staging;
+    ctx.stats = &stream->stats;
+    ctx.on_batch = fs_stream_on_batch;
+    ctx.user = stream;
+
+    int rc = fs_list_run(&ctx);
+    atomic_store(&stream->state, rc == 0 ? FS_STREAM_DONE : FS_STREAM_ERROR);
+    return NULL;
+}
+
+static FsListStream* fs_stream_start(const char* path, int background)
+{
+    if (path == NULL)
+        return NULL;
+
+    FsListStream* stream = (FsListStream*)calloc(1, sizeof(FsListStream));
+    if (stream == NULL)
+        return NULL;
+
+    str_copy(stream->path, path, sizeof(stream->path));
+    stream->staging = fs_dir_create(FS_LIST_BATCH);
+    stream->pending = fs_dir_create(FS_LIST_BATCH);
+    atomic_init(&stream->cancel, 0);
+    atomic_init(&stream->state, FS_STREAM_LOADING);
+    stream->background = background;
+    pthread_mutex_init(&stream->lock, NULL);
+
+    if (stream->staging == NULL || stream->pending == NULL ||
+        pthread_create(&stream->thread, NULL, fs_stream_worker, stream) != 0) {
+        fs_free_directory(stream->staging);
+        fs_free_directory(stream->pending);
+        pthread_mutex_destroy(&stream->lock);
+        free(stream);
         return NULL;
     }
+    return stream;
+}
 
-    // Read directory entries
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip "." and ".." entries
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-            continue;
-
-        // Resize array if needed
-        if (fs_dir->count >= fs_dir->capacity) {
-            fs_dir->capacity *= 2;
-            FsEntry* new_entries = (FsEntry*)realloc(fs_dir->entries,
-                                                      sizeof(FsEntry) * fs_dir->capacity);
-            if (new_entries == NULL) {
-                closedir(dir);
-                return fs_dir;  // Return partial results
-            }
-            fs_dir->entries = new_entries;
-        }
+FsListStream* fs_stream_open(const char* path)
+{
+    return fs_stream_start(path, 0);
+}
 
-        // Copy entry data
-        FsEntry* cur_entry = &fs_dir->entries[fs_dir->count];
-        strncpy(cur_entry->name, entry->d_name, sizeof(cur_entry->name) - 1);
-        cur_entry->name[sizeof(cur_entry->name) - 1] = '\0';
-
-        // Determine if directory
-        cur_entry->is_dir = (entry->d_type == DT_DIR);
-
-        // Get file size
-        cur_entry->size = 0;
-        if (!cur_entry->is_dir) {
-            // Build full path for stat
-            char full_path[512];
-            snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-
-            struct stat file_stat;
-            if (stat(full_path, &file_stat) == 0) {
-                cur_entry->size = file_stat.st_size;
-            }
-        }
+FsListStream* fs_stream_open_background(const char* path)
+{
+    return fs_stream_start(path, 1);
+}
+
+int fs_stream_pump(FsListStream* stream, FsDirectory* dest)
+{
+    if (stream == NULL || dest == NULL)
+        return FS_STREAM_ERROR;
+
+    // Read state first so entries published before completion are drained
+    int state = atomic_load(&stream->state);
+
+    pthread_mutex_lock(&stream->lock);
+    fs_dir_move_all(dest, stream->pending);
+    pthread_mutex_unlock(&stream->lock);
 
-        fs_dir->count++;
+    return state;
+}
+
+void fs_stream_get_stats(FsListStream* stream, FsListStats* out)
+{
+    if (stream == NULL || out == NULL)
+        return;
+
+    if (atomic_load(&stream->state) == FS_STREAM_LOADING) {
+        memset(out, 0, sizeof(*out));
+        return;
     }
+    *out = stream->stats;
+}
 
-    closedir(dir);
-    return fs_dir;
+void fs_stream_cancel(FsListStream* stream)
+{
+    if (stream != NULL)
+        atomic_store(&stream->cancel, 1);
+}
+
+void fs_stream_close(FsListStream* stream)
+{
+    if (stream == NULL)
+        return;
+
+    // The worker notices the flag after its current batch
+    atomic_store(&stream->cancel, 1);
+    pthread_join(stream->thread, NULL);
+
+    fs_free_directory(stream->staging);
+    fs_free_directory(stream->pending);
+    pthread_mutex_destroy(&stream->lock);
+    free(stream);
 }
 
 void fs_free_directory(FsDirectory* dir)
@@ -127,9 +505,11 @@ void fs_free_directory(FsDirectory* dir)
     if (dir == NULL)
         return;
 
-    if (dir->entries != NULL)
-        free(dir->entries);
-
+    free(dir->names);
+    free(dir->name_offsets);
+    free(dir->name_lengths);
+    free(dir->sizes);
+    free(dir->flags);
     free(dir);
 }
 
@@ -143,7 +523,7 @@ void fs_build_path(const char* current_path, const char* entry_name, char* dest)
         return;
     }
 
-    snprintf(dest, 512, "%s/%s", current_path, entry_name);
+    snprintf(dest, FS_MAX_PATH, "%s/%s", current_path, entry_name);
 }
 
 int fs_is_valid_path(const char* path)
@@ -151,12 +531,16 @@ int fs_is_valid_path(const char* path)
     if (path == NULL)
         return 0;
 
-    DIR* dir = opendir(path);
-    if (dir == NULL)
-        return 0;
+    VfsStat st;
+    return vfs_stat(path, &st) == 0 && st.is_dir;
+}
+
+int fs_get_mtime(const char* path, uint64_t* out)
+{
+    if (path == NULL || out == NULL)
+        return -1;
 
-    closedir(dir);
-    return 1;
+    return vfs_get_mtime(path, out);
 }
 
 int fs_is_directory(const FsEntry* entry)
@@ -79,6 +79,54 @@ int input_fileops(void)
     return (buttons & HidNpadButton_X) != 0;
 }
 
+int input_sort(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_Y) != 0;
+}
+
+int input_filter(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_Minus) != 0;
+}
+
+int input_search(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_R) != 0;
+}
+
+int input_largest(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_L) != 0;
+}
+
+int input_jobs(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_ZR) != 0;
+}
+
+int input_undo(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_ZL) != 0;
+}
+
+int input_mark(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_StickR) != 0;
+}
+
+int input_marks(void)
+{
+    u64 buttons = padGetButtonsDown(&g_pad);
+    return (buttons & HidNpadButton_StickL) != 0;
+}
+
 int input_power_pressed(void)
 {
     // Reserved for future use - currently not needed
@@ -10,6 +10,16 @@
 #include "clipboard.h"
 #include "paste.h"
 #include "delete.h"
+#include "dircache.h"
+#include "index.h"
+#include "dirsize.h"
+#include "prefetch.h"
+#include "jobs.h"
+#include "journal.h"
+#include "copy.h"
+#include "hash.h"
+#include "sync.h"
+#include "trash.h"
 #include "../libs/rename/rename.h"  // rename support
 #include "../libs/utils/utils.h"  // path helpers
 #include "../libs/launch/launch.h"  // nro launching
@@ -27,13 +37,231 @@
  *  - libs/utils/utils.c/h: Utility functions
  */
 
+// Clipboard items being moved, by the paste job moving them. They stay
+// on the clipboard until their job has moved them.
+static struct {
+    uint32_t job;
+    FsDirectory* items;
+} g_moving[JOBS_MAX];
+
+// Queue a job and say so; 'name' is the item it works on
+static void main_submit(UIState* ui_state, JobType type, const char* src, const char* dest,
+                        const char* name)
+{
+    char msg[256];
+    if (jobs_submit(type, src, dest) != 0)
+        snprintf(msg, sizeof(msg), "Queued: %s", name);
+    else
+        snprintf(msg, sizeof(msg), "Too many jobs, try again later");
+    ui_show_message(ui_state, msg, 60);
+}
+
+// Queue one job over every path in 'items'
+static void main_submit_batch(UIState* ui_state, JobType type, const FsDirectory* items,
+                              const char* dest)
+{
+    char msg[256];
+    if (jobs_submit_batch(type, items, dest) != 0)
+        snprintf(msg, sizeof(msg), "Queued: %d items", fs_dir_count(items));
+    else
+        snprintf(msg, sizeof(msg), "Too many jobs, try again later");
+    ui_show_message(ui_state, msg, 60);
+}
+
+// Add the marked entries to the clipboard and unmark them, or the entry
+// 'path' (named 'name') when nothing is marked
+static void main_clip(UIState* ui_state, ClipboardOp op, const char* path, const char* name)
+{
+    const char* verb = op == CLIPBOARD_MOVE ? "Marked to move" : "Copied";
+    char msg[256];
+    if (ui_marked_count(ui_state) > 0) {
+        FsDirectory* list = fs_dir_create(ui_marked_count(ui_state));
+        if (list != NULL && ui_get_marked_paths(ui_state, list) > 0 &&
+            clipboard_add_list(list, op) == 0) {
+            snprintf(msg, sizeof(msg), "%s: %d items", verb, fs_dir_count(list));
+            ui_mark_clear(ui_state);
+        } else {
+            snprintf(msg, sizeof(msg), "Cannot add to clipboard");
+        }
+        fs_free_directory(list);
+    } else if (clipboard_add(path, op) == 0) {
+        snprintf(msg, sizeof(msg), "%s: %s", verb, name);
+    } else {
+        snprintf(msg, sizeof(msg), "Cannot add to clipboard");
+    }
+
+    // Items collect until pasted or cleared, so say when there are others
+    int held = clipboard_count(CLIPBOARD_NONE);
+    if (held > 1) {
+        size_t len = strlen(msg);
+        snprintf(msg + len, sizeof(msg) - len, " (%d on clipboard)", held);
+    }
+    ui_show_message(ui_state, msg, 120);
+}
+
+// Remember that job 'job' moves 'items' (the list is taken over)
+static void main_track_moves(uint32_t job, FsDirectory* items)
+{
+    for (int i = 0; i < JOBS_MAX; i++) {
+        if (g_moving[i].job == 0) {
+            g_moving[i].job = job;
+            g_moving[i].items = items;
+            return;
+        }
+    }
+    fs_free_directory(items);  // Not reached: there is a slot per job
+}
+
+// Take what job 'job' moved off the clipboard (they cannot be moved
+// twice): every item if it finished, else only those gone from where
+// they were.
+static void main_settle_moves(uint32_t job, int done)
+{
+    if (job == 0)
+        return;
+    for (int i = 0; i < JOBS_MAX; i++) {
+        if (g_moving[i].job != job)
+            continue;
+
+        FsDirectory* items = g_moving[i].items;
+        FsDirectory* moved = done ? NULL : fs_dir_create(fs_dir_count(items) + 1);
+        uint64_t mtime;
+        for (int j = 0; moved != NULL && j < fs_dir_count(items); j++) {
+            const char* path = fs_dir_name(items, j);
+            if (fs_get_mtime(path, &mtime) != 0)
+                fs_dir_append(moved, path, 0, 0);
+        }
+        clipboard_remove_list(done ? items : moved);
+        fs_free_directory(moved);
+        fs_free_directory(items);
+        g_moving[i].job = 0;
+        g_moving[i].items = NULL;
+        return;
+    }
+}
+
+// Queue one job pasting every clipboard item into 'dest'. Moved items
+// leave the clipboard once the job has moved them; copied ones stay.
+static void main_paste(UIState* ui_state, const char* dest)
+{
+    FsDirectory* copies = fs_dir_create(clipboard_count(CLIPBOARD_COPY) + 1);
+    FsDirectory* moves = fs_dir_create(clipboard_count(CLIPBOARD_MOVE) + 1);
+    char msg[256];
+    if (copies == NULL || moves == NULL || clipboard_get_list(CLIPBOARD_COPY, copies) < 0 ||
+        clipboard_get_list(CLIPBOARD_MOVE, moves) < 0) {
+        snprintf(msg, sizeof(msg), "Paste failed");
+    } else {
+        uint32_t job = jobs_submit_paste(copies, moves, dest);
+        int count = fs_dir_count(copies) + fs_dir_count(moves);
+        if (job == 0)
+            snprintf(msg, sizeof(msg), "Too many jobs, try again later");
+        else if (count == 1)
+            snprintf(msg, sizeof(msg), "Queued: %s", path_get_filename(fs_dir_count(copies) > 0 ?
+                     fs_dir_name(copies, 0) : fs_dir_name(moves, 0)));
+        else
+            snprintf(msg, sizeof(msg), "Queued: %d items", count);
+        if (job != 0 && fs_dir_count(moves) > 0) {
+            main_track_moves(job, moves);
+            moves = NULL;
+        }
+    }
+    ui_show_message(ui_state, msg, 60);
+    fs_free_directory(copies);
+    fs_free_directory(moves);
+}
+
+// Report finished jobs and reload the listing if one of them changed it.
+// Returns 1 if a sync plan is waiting for review in 'offer'.
+static int main_poll_jobs(UIState* ui_state, JobInfo* offer)
+{
+    JobInfo finished[4];
+    int count = jobs_poll_finished(finished, 4);
+    int refresh = 0;
+    int offered = 0;
+    for (int i = 0; i < count; i++) {
+        main_settle_moves(finished[i].id, finished[i].state == JOB_DONE);
+        if (finished[i].type == JOB_COMPARE && finished[i].state == JOB_DONE) {
+            *offer = finished[i];
+            offered = 1;
+            continue;
+        }
+        // Emptying the trash is housekeeping: only failures are worth a word
+        if (finished[i].type != JOB_PURGE || finished[i].state == JOB_FAILED)
+            ui_show_job_result(ui_state, &finished[i]);
+        if (jobs_touches(&finished[i], ui_state->current_path))
+            refresh = 1;
+    }
+
+    /* reload current directory (selection is clamped when done) */
+    if (refresh)
+        ui_refresh_directory(ui_state);
+    return offered;
+}
+
+// Show what syncing 'compare' would do and ask whether to go ahead.
+// Returns 1 if the question is up, 0 if there is nothing to do.
+static int main_offer_sync(UIState* ui_state, const JobInfo* compare)
+{
+    char msg[256];
+    if (sync_plan_kept(compare->src, compare->dest) <= 0) {
+        snprintf(msg, sizeof(msg), "Already in sync: %s", path_get_filename(compare->dest));
+        ui_show_message(ui_state, msg, 120);
+        return 0;
+    }
+    snprintf(msg, sizeof(msg), "Sync %s into %s?\n\n%s", path_get_filename(compare->src),
+             compare->dest, compare->result);
+    ui_show_confirm(ui_state, msg);
+    return 1;
+}
+
+// Purge the deletes that can no longer be undone, in the background
+static void main_purge_trash(void)
+{
+    TrashItem expired[4];
+    int count = trash_expired(expired, 4);
+    for (int i = 0; i < count; i++) {
+        // Left in the trash if the table is full; the next run purges it
+        jobs_submit(JOB_PURGE, expired[i].entry, expired[i].origin);
+    }
+}
+
+// Ask whether to finish the copy 'entry' a previous run left unfinished
+static void main_offer_resume(UIState* ui_state, const JournalEntry* entry)
+{
+    char msg[256];
+    int percent = entry->size > 0 ? (int)(entry->committed * 100 / entry->size) : 0;
+    snprintf(msg, sizeof(msg), "Resume interrupted copy of %s (%d%% done)?",
+             path_get_filename(entry->dest), percent);
+    ui_show_confirm(ui_state, msg);
+}
+
 int main(int argc, char **argv)
 {
     // Initialize all subsystems
     text_init();
     input_init();
     fs_init();
-    clipboard_init();
+    dircache_init(DIRCACHE_DEFAULT_BUDGET);
+    dirsize_init(DIRSIZE_DEFAULT_THREADS);
+    clipboard_init(CLIPBOARD_DEFAULT_FILE);
+    jobs_init(JOBS_DEFAULT_WORKERS);
+    trash_init(TRASH_DEFAULT_DIR);
+
+    // Copies a previous run could not finish are offered one by one
+    static JournalEntry resume[JOURNAL_MAX_ENTRIES];
+    int resume_count = 0;
+    int resume_next = 0;
+    int resume_asking = 0;
+
+    // A compared folder waits for its plan to be accepted
+    static JobInfo sync_offer;
+    int sync_asking = 0;
+    if (journal_init(JOURNAL_DEFAULT_FILE) > 0)
+        resume_count = journal_pending(resume, JOURNAL_MAX_ENTRIES);
+
+    // Refresh the whole-card search index in the background
+    index_init(INDEX_DEFAULT_FILE);
+    index_start_scan("/");
 
     // Initialize UI with starting state
     UIState ui_state;
@@ -48,7 +276,14 @@ int main(int argc, char **argv)
         while(appletMainLoop()) {
             // Wait for user to close app
         }
+        jobs_cleanup();
+        trash_cleanup();
+        journal_cleanup();
         ui_cleanup(&ui_state);
+        prefetch_cleanup();
+        index_cleanup();
+        dirsize_cleanup();
+        dircache_cleanup();
         fs_cleanup();
         text_exit();
         return 1;
@@ -68,16 +303,68 @@ int main(int argc, char **argv)
         // Update input state
         input_update();
 
+        // Jobs keep running whatever the screen shows (their results
+        // wait while a question is up)
+        if (!resume_asking && !sync_asking && main_poll_jobs(&ui_state, &sync_offer)) {
+            sync_asking = main_offer_sync(&ui_state, &sync_offer);
+        }
+        main_purge_trash();
+
+        if (!resume_asking && !sync_asking && !ui_state.popup_active && resume_next < resume_count) {
+            main_offer_resume(&ui_state, &resume[resume_next]);
+            resume_asking = 1;
+        }
+
         // If a popup is visible, let it consume input first
         if (ui_state.popup_active) {
             int code = ui_process_popup_input(&ui_state);
-            (void)code;  // just dismiss on input
+            if (resume_asking && code != 1) {
+                // Yes resumes in the background, no drops the partial file
+                const JournalEntry* entry = &resume[resume_next++];
+                resume_asking = 0;
+                if (code == 3)
+                    main_submit(&ui_state, JOB_RESUME, entry->src, entry->dest,
+                                path_get_filename(entry->dest));
+                else
+                    journal_discard(entry->dest);
+            }
+            if (sync_asking && code != 1) {
+                // Yes carries out the reviewed plan, no drops it
+                sync_asking = 0;
+                if (code == 3)
+                    main_submit(&ui_state, JOB_SYNC, sync_offer.src, sync_offer.dest,
+                                path_get_filename(sync_offer.dest));
+                else
+                    sync_plan_free(sync_plan_take(sync_offer.src, sync_offer.dest));
+            }
             // always render and skip other input handling
             ui_render(&ui_state);
             continue;
         }
 
-        if (ui_state.overlay_active) {
+        if (ui_state.jobs_active) {
+            if (input_down()) {
+                ui_jobs_select_next(&ui_state);
+            }
+
+            if (input_up()) {
+                ui_jobs_select_prev(&ui_state);
+            }
+
+            // A pauses or resumes the selected job, Y cancels it
+            const JobInfo* job = ui_jobs_get_selected(&ui_state);
+            if (input_select() && job != NULL) {
+                jobs_pause(job->id, !job->paused);
+            }
+
+            if (input_sort() && job != NULL) {
+                jobs_cancel(job->id);
+            }
+
+            if (input_back() || input_jobs()) {
+                ui_close_jobs(&ui_state);
+            }
+        } else if (ui_state.overlay_active) {
             // Handle overlay menu input
             if (input_down()) {
                 ui_overlay_select_next(&ui_state);
@@ -92,77 +379,41 @@ int main(int argc, char **argv)
                 int idx = ui_overlay_get_selected(&ui_state);
                 int selected_op = (idx >= 0 && idx < ui_state.overlay_count) ?
                                   ui_state.overlay_codes[idx] : -1;
-                FsEntry* sel_entry = ui_get_selected_entry(&ui_state);
-                
+                FsEntry sel;
+                FsEntry* sel_entry = (ui_get_selected_entry(&ui_state, &sel) == 0) ? &sel : NULL;
+
                 if (sel_entry != NULL && selected_op != -1) {
                     char selected_path[512];
                     ui_get_selected_path(&ui_state, selected_path);
 
                     switch (selected_op) {
-                        case UI_OP_COPY:  // Copy -> set clipboard
-                            clipboard_set(selected_path, CLIPBOARD_COPY);
-                            {
-                                char msg[256];
-                                snprintf(msg, sizeof(msg), "Copied: %s", sel_entry->name);
-                                ui_show_message(&ui_state, msg, 120);
-                            }
+                        case UI_OP_COPY:  // Copy -> add to clipboard
+                            main_clip(&ui_state, CLIPBOARD_COPY, selected_path, sel_entry->name);
                             break;
                         case UI_OP_PASTE:  // Paste into selected directory
                             if (sel_entry != NULL && sel_entry->is_dir) {
-                                if (paste_item(selected_path) == 0) {
-                                    // determine which operation occurred
-                                    const char* clipPath = clipboard_get_path();
-                                    ClipboardOp op = clipboard_get_operation();
-                                    const char* name = path_get_filename(clipPath);
-                                    if (op == CLIPBOARD_COPY) {
-                                        char msg[256];
-                                        snprintf(msg, sizeof(msg), "Pasted: %s", name);
-                                        ui_show_message(&ui_state, msg, 120);
-                                    } else if (op == CLIPBOARD_MOVE) {
-                                        char msg[256];
-                                        snprintf(msg, sizeof(msg), "Moved: %s", name);
-                                        ui_show_message(&ui_state, msg, 120);
-                                    }
-                                } else {
+                                if (!clipboard_has_item()) {
                                     ui_show_message(&ui_state, "Paste failed", 120);
-                                }
-                                /* reload current directory */
-                                FsDirectory* new_dir = fs_list_directory(ui_state.current_path);
-                                if (new_dir != NULL) {
-                                    if (ui_state.current_dir != NULL)
-                                        fs_free_directory(ui_state.current_dir);
-                                    ui_state.current_dir = new_dir;
+                                } else {
+                                    main_paste(&ui_state, selected_path);
                                 }
                             }
                             break;
-                        case UI_OP_MOVE:  // Move -> set clipboard to move
-                            clipboard_set(selected_path, CLIPBOARD_MOVE);
-                            {
-                                char msg[256];
-                                snprintf(msg, sizeof(msg), "Marked to move: %s", sel_entry->name);
-                                ui_show_message(&ui_state, msg, 120);
-                            }
+                        case UI_OP_MOVE:  // Move -> add to clipboard to move
+                            main_clip(&ui_state, CLIPBOARD_MOVE, selected_path, sel_entry->name);
                             break;
                         case UI_OP_DELETE:  // Delete
-                            if (delete_item(selected_path) == 0) {
-                                char msg[256];
-                                snprintf(msg, sizeof(msg), "Deleted: %s", sel_entry->name);
-                                ui_show_message(&ui_state, msg, 120);
-                            } else {
-                                ui_show_message(&ui_state, "Delete failed", 120);
-                            }
-                            /* reload current directory */
-                            {
-                                FsDirectory* new_dir = fs_list_directory(ui_state.current_path);
-                                if (new_dir != NULL) {
-                                    if (ui_state.current_dir != NULL)
-                                        fs_free_directory(ui_state.current_dir);
-                                    ui_state.current_dir = new_dir;
-                                    if (ui_state.selected_index >= ui_state.current_dir->count && ui_state.current_dir->count > 0)
-                                        ui_state.selected_index = ui_state.current_dir->count - 1;
-                                    else if (ui_state.current_dir->count == 0)
-                                        ui_state.selected_index = 0;
+                            if (ui_marked_count(&ui_state) > 0) {
+                                FsDirectory* list = fs_dir_create(ui_marked_count(&ui_state));
+                                if (list != NULL && ui_get_marked_paths(&ui_state, list) > 0) {
+                                    main_submit_batch(&ui_state, JOB_DELETE, list, NULL);
+                                    ui_mark_clear(&ui_state);
+                                } else {
+                                    ui_show_message(&ui_state, "Delete failed", 120);
                                 }
+                                fs_free_directory(list);
+                            } else {
+                                main_submit(&ui_state, JOB_DELETE, selected_path, NULL, sel_entry->name);
                             }
                             break;
                         case UI_OP_RENAME:  // Rename (use software keyboard)
@@ -178,22 +429,10 @@ int main(int argc, char **argv)
                                 swkbdShow(&kbd, result, sizeof(result));
                                 swkbdClose(&kbd);
                                 if (result[0] != '\0') {
-                                    // perform rename
+                                    // queue the rename behind jobs on the same item
                                     char oldpath[512];
                                     ui_get_selected_path(&ui_state, oldpath);
-                                    if (rename_item(oldpath, result) == 0) {
-                                        char msg2[256];
-                                        snprintf(msg2, sizeof(msg2), "Renamed to: %s", result);
-                                        ui_show_message(&ui_state, msg2, 120);
-                                        FsDirectory* new_dir = fs_list_directory(ui_state.current_path);
-                                        if (new_dir != NULL) {
-                                            if (ui_state.current_dir != NULL)
-                                                fs_free_directory(ui_state.current_dir);
-                                            ui_state.current_dir = new_dir;
-                                        }
-                                    } else {
-                                        ui_show_message(&ui_state, "Rename failed", 120);
-                                    }
+                                    main_submit(&ui_state, JOB_RENAME, oldpath, result, sel_entry->name);
                                 }
                             }
                             break;
@@ -208,6 +447,28 @@ int main(int argc, char **argv)
                                 }
                             }
                             break;
+                        case UI_OP_HASH:
+                            if (!sel_entry->is_dir)
+                                main_submit(&ui_state, JOB_HASH, selected_path, NULL, sel_entry->name);
+                            break;
+                        case UI_OP_SYNC:
+                            // Compare first; the plan is shown before anything changes
+                            if (sel_entry->is_dir && clipboard_has_item()) {
+                                char clip_path[512];
+                                char dest[512];
+                                clipboard_get_last(clip_path, sizeof(clip_path));
+                                snprintf(dest, sizeof(dest), "%s/%s", selected_path,
+                                         path_get_filename(clip_path));
+                                main_submit(&ui_state, JOB_COMPARE, clip_path, dest,
+                                            path_get_filename(clip_path));
+                            }
+                            break;
+                        case UI_OP_VERIFY:
+                            // CRC32 catches a bad write as well as SHA would, at a fraction of the cost
+                            copy_set_verify(copy_get_verify() != HASH_NONE ? HASH_NONE : HASH_CRC32);
+                            ui_show_message(&ui_state, copy_get_verify() != HASH_NONE ?
+                                            "Copies are verified (CRC32)" : "Copies are not verified", 120);
+                            break;
                         case UI_OP_INSTALL:
                             if (!sel_entry->is_dir) {
                                 if (install_package(selected_path) == 0) {
@@ -219,6 +480,37 @@ int main(int argc, char **argv)
                                 }
                             }
                             break;
+                        case UI_OP_MARK_ALL:
+                            ui_mark_all(&ui_state);
+                            break;
+                        case UI_OP_MARK_INVERT:
+                            ui_mark_invert(&ui_state);
+                            break;
+                        case UI_OP_MARK_CLEAR:
+                            ui_mark_clear(&ui_state);
+                            break;
+                        case UI_OP_CLIP_CLEAR:
+                            clipboard_clear();
+                            ui_show_message(&ui_state, "Clipboard cleared", 120);
+                            break;
+                        case UI_OP_MARK_PATTERN:
+                            {
+                                SwkbdConfig kbd;
+                                char pattern[SELECT_MAX_PATTERN];
+                                pattern[0] = '\0';
+                                swkbdCreate(&kbd, 0);
+                                swkbdConfigMakePresetDefault(&kbd);
+                                swkbdConfigSetGuideText(&kbd, "Mark matching (e.g. *.nsp)");
+                                swkbdConfigSetOkButtonText(&kbd, "Mark");
+                                Result rc = swkbdShow(&kbd, pattern, sizeof(pattern));
+                                swkbdClose(&kbd);
+                                if (R_SUCCEEDED(rc) && pattern[0] != '\0') {
+                                    char msg[256];
+                                    snprintf(msg, sizeof(msg), "Marked %d", ui_mark_matching(&ui_state, pattern));
+                                    ui_show_message(&ui_state, msg, 120);
+                                }
+                            }
+                            break;
                     }
                 }
                 ui_close_overlay(&ui_state);
@@ -228,6 +520,77 @@ int main(int argc, char **argv)
             if (input_back()) {
                 ui_close_overlay(&ui_state);
             }
+        } else if (ui_filter_is_active(&ui_state)) {
+            // Type-to-filter: the list narrows with every character added
+            if (input_down()) {
+                ui_select_next(&ui_state);
+            }
+
+            if (input_up()) {
+                ui_select_prev(&ui_state);
+            }
+
+            // LEFT/RIGHT pick a character, Y adds it to the query
+            if (input_left()) {
+                ui_filter_cycle_char(&ui_state, -1);
+            }
+
+            if (input_right()) {
+                ui_filter_cycle_char(&ui_state, 1);
+            }
+
+            if (input_sort()) {
+                ui_filter_append(&ui_state);
+            }
+
+            // B deletes a character, or closes the filter once empty
+            if (input_back()) {
+                if (ui_filter_backspace(&ui_state) != 0) {
+                    ui_filter_close(&ui_state);
+                }
+            }
+
+            // Minus types the whole query on the software keyboard
+            if (input_filter()) {
+                SwkbdConfig kbd;
+                char result[FILTER_MAX_QUERY];
+                result[0] = '\0';
+                swkbdCreate(&kbd, 0);
+                swkbdConfigMakePresetDefault(&kbd);
+                swkbdConfigSetInitialText(&kbd, ui_state.filter_query);
+                swkbdConfigSetGuideText(&kbd, "Filter");
+                swkbdConfigSetOkButtonText(&kbd, "Filter");
+                if (R_SUCCEEDED(swkbdShow(&kbd, result, sizeof(result)))) {
+                    ui_filter_set_query(&ui_state, result);
+                }
+                swkbdClose(&kbd);
+            }
+
+            // A opens the selected match like in the full listing
+            if (input_select()) {
+                FsEntry selected;
+                if (ui_get_selected_entry(&ui_state, &selected) == 0) {
+                    if (selected.is_dir) {
+                        ui_enter_directory(&ui_state);
+                    } else {
+                        ui_filter_close(&ui_state);
+                        ui_open_overlay(&ui_state);
+                    }
+                }
+            }
+
+            // Right stick marks the match, left stick opens the marking menu
+            if (input_mark()) {
+                ui_mark_toggle(&ui_state);
+            }
+
+            if (input_marks()) {
+                ui_open_marks(&ui_state);
+            }
+
+            if (input_exit()) {
+                break;
+            }
         } else {
             // Handle normal directory navigation
             if (input_down()) {
@@ -238,11 +601,65 @@ int main(int argc, char **argv)
                 ui_select_prev(&ui_state);
             }
 
+            // LEFT/RIGHT jump to the previous/next initial letter
+            if (input_left()) {
+                ui_jump_initial(&ui_state, -1);
+            }
+
+            if (input_right()) {
+                ui_jump_initial(&ui_state, 1);
+            }
+
+            // Minus opens type-to-filter
+            if (input_filter()) {
+                ui_filter_open(&ui_state);
+            }
+
+            // R searches the whole card by name
+            if (input_search()) {
+                SwkbdConfig kbd;
+                char query[FILTER_MAX_QUERY];
+                query[0] = '\0';
+                swkbdCreate(&kbd, 0);
+                swkbdConfigMakePresetDefault(&kbd);
+                swkbdConfigSetGuideText(&kbd, "Search all files");
+                swkbdConfigSetOkButtonText(&kbd, "Search");
+                Result rc = swkbdShow(&kbd, query, sizeof(query));
+                swkbdClose(&kbd);
+                if (R_SUCCEEDED(rc) && query[0] != '\0') {
+                    int found = ui_show_search(&ui_state, query);
+                    if (found == 0) {
+                        IndexStats stats;
+                        index_get_stats(&stats);
+                        char msg[256];
+                        if (stats.state == INDEX_STATE_SCANNING)
+                            snprintf(msg, sizeof(msg), "No matches yet (indexing, %llu folders so far)",
+                                     (unsigned long long)(stats.dirs_listed + stats.dirs_reused));
+                        else
+                            snprintf(msg, sizeof(msg), "No matches for: %s", query);
+                        ui_show_message(&ui_state, msg, 120);
+                    } else if (found < 0) {
+                        ui_show_message(&ui_state, "Search failed", 120);
+                    }
+                }
+            }
+
+            // L lists the largest files and folders on the card
+            if (input_largest()) {
+                int found = ui_show_largest(&ui_state);
+                if (found == 0) {
+                    ui_show_message(&ui_state, "The file index is not ready yet", 120);
+                } else if (found < 0) {
+                    ui_show_message(&ui_state, "Cannot list largest items", 120);
+                }
+            }
+
             // Handle selection (A button)
             if (input_select()) {
-                FsEntry* selected = ui_get_selected_entry(&ui_state);
-                if (selected != NULL) {
-                    if (selected->is_dir) {
+                FsEntry selected;
+                if (ui_get_selected_entry(&ui_state, &selected) == 0) {
+                    // Search results open straight into their folder
+                    if (selected.is_dir || ui_is_search(&ui_state)) {
                         // A on folder: enter directory
                         ui_enter_directory(&ui_state);
                     } else {
@@ -252,20 +669,60 @@ int main(int argc, char **argv)
                 }
             }
 
-            // Handle back button (go to parent directory)
+            // Handle back button: stop a running listing, else go to parent
             if (input_back()) {
-                // Ignore error if already at root
-                ui_go_back(&ui_state);
+                if (ui_is_loading(&ui_state)) {
+                    ui_cancel_loading(&ui_state);
+                } else {
+                    // Ignore error if already at root
+                    ui_go_back(&ui_state);
+                }
             }
 
             // Handle file ops button (X)
             if (input_fileops()) {
-                FsEntry* selected = ui_get_selected_entry(&ui_state);
-                if (selected != NULL && selected->is_dir) {
+                FsEntry selected;
+                if (ui_get_selected_entry(&ui_state, &selected) == 0 && selected.is_dir) {
                     ui_open_overlay(&ui_state);
                 }
             }
 
+            // Handle sort button (Y): cycle listing order
+            if (input_sort()) {
+                ui_cycle_sort(&ui_state);
+            }
+
+            // ZR shows the background jobs
+            if (input_jobs()) {
+                ui_open_jobs(&ui_state);
+            }
+
+            // Right stick marks the entry, left stick opens the marking menu
+            if (input_mark()) {
+                ui_mark_toggle(&ui_state);
+            }
+
+            if (input_marks()) {
+                ui_open_marks(&ui_state);
+            }
+
+            // Put the last deleted item back while it is still in the trash
+            if (input_undo()) {
+                char origin[FS_MAX_PATH];
+                int restored = trash_restore_last(origin, sizeof(origin));
+                if (restored > 0) {
+                    char msg[256];
+                    if (restored == 1)
+                        snprintf(msg, sizeof(msg), "Restored: %s", path_get_filename(origin));
+                    else
+                        snprintf(msg, sizeof(msg), "Restored %d items to %s", restored, origin);
+                    ui_show_message(&ui_state, msg, 120);
+                    ui_refresh_directory(&ui_state);
+                } else {
+                    ui_show_message(&ui_state, "Nothing to undo", 120);
+                }
+            }
+
             // Handle exit button (return to hbmenu)
             if (input_exit()) {
                 break;
@@ -276,9 +733,18 @@ int main(int argc, char **argv)
         ui_render(&ui_state);
     }
 
-    // Cleanup
-    clipboard_clear();
+    // Cleanup (running jobs are cancelled and waited for)
+    jobs_cleanup();
+    for (int i = 0; i < JOBS_MAX; i++)
+        main_settle_moves(g_moving[i].job, 0);
+    trash_cleanup();
+    journal_cleanup();
+    clipboard_cleanup();
     ui_cleanup(&ui_state);
+    prefetch_cleanup();
+    index_cleanup();
+    dirsize_cleanup();
+    dircache_cleanup();
     fs_cleanup();
     text_exit();
 
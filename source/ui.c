@@ -3,6 +3,16 @@
 #include "utils.h"
 #include "text.h"
 #include "input.h"        // needed for popup input handling
+#include "dircache.h"
+#include "sort.h"
+#include "filter.h"
+#include "index.h"
+#include "dirsize.h"
+#include "prefetch.h"
+#include "copy.h"
+#include "hash.h"
+#include "clipboard.h"
+#include "trash.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -16,14 +26,437 @@
 
 #define MAX_VISIBLE_ENTRIES 20
 
+// Items listed by the "largest items" view
+#define UI_LARGEST_ITEMS 100
+
 // Popup types
 #define POPUP_NONE   0
 #define POPUP_MESSAGE 1
 #define POPUP_RENAME  2
+#define POPUP_CONFIRM 3
 
 // Forward declaration
 static void ui_render_overlay(UIState* ui_state);
 static void ui_render_popup(UIState* ui_state);
+static void ui_render_jobs(UIState* ui_state);
+static void ui_render_job_status(UIState* ui_state);
+static void ui_pump_jobs(UIState* ui_state);
+
+/**
+ * Directory loading
+ *
+ * Listings are produced by a background FsListStream. The new (empty)
+ * FsDirectory becomes current immediately and is filled once per frame
+ * by ui_pump_listing(), so the first rows appear as soon as the first
+ * batch is read and input keeps working while large folders load.
+ *
+ * Folders we navigate away from are parked in the directory cache with
+ * their cursor, so going back to them needs no I/O at all.
+ */
+
+static void ui_clamp_selection(UIState* ui_state);
+static int ui_select_name(UIState* ui_state, const char* name, int from_index);
+static void ui_filter_sync(UIState* ui_state);
+static void ui_request_sizes(UIState* ui_state);
+
+// Select entry 'index', scrolling it into view
+static void ui_select_index(UIState* ui_state, int index)
+{
+    ui_state->selected_index = index;
+    if (index < ui_state->scroll_offset || index >= ui_state->scroll_offset + MAX_VISIBLE_ENTRIES)
+        ui_state->scroll_offset = (index >= MAX_VISIBLE_ENTRIES / 2) ? index - MAX_VISIBLE_ENTRIES / 2 : 0;
+}
+
+// Sort the displayed listing, the marks moving with their entries
+static int ui_sort_marked(UIState* ui_state)
+{
+    FsDirectory* dir = ui_state->current_dir;
+    if (ui_state->marks.marked == 0 || dir->count < 2)
+        return sort_directory(dir, &ui_state->sort);
+
+    uint32_t* order = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)dir->count);
+    if (order == NULL)
+        return -1;
+    int rc = sort_compute_order(dir, &ui_state->sort, order);
+    if (rc == 0 && select_permute(&ui_state->marks, order) != 0)
+        rc = -1;
+    if (rc == 0 && fs_dir_permute(dir, order) != 0) {
+        select_clear(&ui_state->marks);
+        rc = -1;
+    }
+    if (rc == 0)
+        dir->sort_tag = sort_options_tag(&ui_state->sort);
+    free(order);
+    return rc;
+}
+
+// Sort the displayed listing with the current options. keep_entry: 1 to
+// keep the cursor on the same entry, 0 to keep the same row index.
+static void ui_apply_sort(UIState* ui_state, int keep_entry)
+{
+    FsDirectory* dir = ui_state->current_dir;
+    if (dir == NULL || dir->sort_tag == sort_options_tag(&ui_state->sort))
+        return;
+
+    char name[256] = "";
+    FsEntry sel;
+    if (keep_entry && fs_dir_get_entry(dir, ui_state->selected_index, &sel) == 0)
+        str_copy(name, sel.name, sizeof(name));
+
+    if (ui_sort_marked(ui_state) == 0 && name[0] != '\0')
+        ui_select_name(ui_state, name, 0);
+    ui_filter_sync(ui_state);
+}
+
+// Hand the displayed listing to the directory cache (or free it when it
+// is stale or incomplete). Always leaves current_dir NULL.
+static void ui_stash_listing(UIState* ui_state, int stale)
+{
+    int complete = (ui_state->loading == NULL);
+    ui_cancel_loading(ui_state);
+
+    if (ui_state->current_dir == NULL)
+        return;
+
+    // Search results belong to no folder
+    if (ui_state->search_active) {
+        fs_free_directory(ui_state->current_dir);
+        ui_state->current_dir = NULL;
+        ui_state->search_active = 0;
+        return;
+    }
+
+    if (stale || !complete) {
+        fs_free_directory(ui_state->current_dir);
+        ui_state->current_dir = NULL;
+        // A partial listing is not worth caching, its cursor still is
+        if (!stale)
+            dircache_put(ui_state->current_path, NULL,
+                         ui_state->selected_index, ui_state->scroll_offset);
+        return;
+    }
+
+    dircache_put(ui_state->current_path, ui_state->current_dir,
+                 ui_state->selected_index, ui_state->scroll_offset);
+    ui_state->current_dir = NULL;
+}
+
+// Select the entry called 'name' if present, scrolling it into view.
+// Returns 1 when found.
+static int ui_select_name(UIState* ui_state, const char* name, int from_index)
+{
+    int count = fs_dir_count(ui_state->current_dir);
+    int len = str_len(name);
+    for (int i = from_index; i < count; i++) {
+        if (fs_dir_name_length(ui_state->current_dir, i) != len ||
+            strcmp(fs_dir_name(ui_state->current_dir, i), name) != 0)
+            continue;
+
+        ui_select_index(ui_state, i);
+        return 1;
+    }
+    return 0;
+}
+
+// Replace the current listing with a listing of 'path': from the
+// directory cache when possible, otherwise streamed from disk.
+// refresh: 1 to re-read the current folder keeping the cursor,
+//          0 to navigate (cursor restored from the cache or reset).
+static int ui_start_listing(UIState* ui_state, const char* path, int refresh)
+{
+    uint64_t start = fs_now_ns();
+    int sel = refresh ? ui_state->selected_index : 0;
+    int scroll = refresh ? ui_state->scroll_offset : 0;
+    FsListStream* stream = NULL;
+
+    FsDirectory* new_dir = refresh ? NULL : dircache_take(path, &sel, &scroll);
+    if (new_dir == NULL && !refresh)
+        prefetch_take(path, &new_dir, &stream);
+    if (new_dir == NULL) {
+        if (!fs_is_valid_path(path))
+            return -1;
+
+        new_dir = fs_dir_create(FS_LIST_BATCH);
+        if (new_dir == NULL)
+            return -1;
+
+        stream = fs_stream_open(path);
+        if (stream == NULL) {
+            // No worker available: fall back to a blocking listing
+            fs_free_directory(new_dir);
+            new_dir = fs_list_directory(path);
+            if (new_dir == NULL)
+                return -1;
+        }
+    }
+
+    ui_stash_listing(ui_state, refresh);
+
+    str_copy(ui_state->current_path, path, sizeof(ui_state->current_path));
+    ui_state->current_dir = new_dir;
+    ui_state->loading = stream;
+    ui_state->load_start_ns = start;
+    ui_state->load_first_row_ns = 0;
+    ui_state->load_total_ns = stream ? 0 : fs_now_ns() - start;
+    ui_state->selected_index = sel;
+    ui_state->scroll_offset = scroll;
+    ui_state->pending_select[0] = '\0';
+
+    // Folder totals still being computed belong to the old listing
+    ui_state->listing_id++;
+    ui_state->sizes_pending = 0;
+    dirsize_cancel_all();
+
+    // So are the marks
+    select_clear(&ui_state->marks);
+    select_resize(&ui_state->marks, fs_dir_count(new_dir));
+
+    // The filter is tied to one listing: a refresh keeps the query,
+    // navigating closes it
+    filter_free(&ui_state->filter);
+    filter_init(&ui_state->filter);
+    if (!refresh)
+        ui_state->filter_active = 0;
+
+    if (stream == NULL) {
+        ui_apply_sort(ui_state, 0);
+        ui_clamp_selection(ui_state);
+        ui_request_sizes(ui_state);
+    }
+    ui_filter_sync(ui_state);
+    return 0;
+}
+
+// Keep the cursor inside the listing once its final size is known
+static void ui_clamp_selection(UIState* ui_state)
+{
+    int count = fs_dir_count(ui_state->current_dir);
+    if (ui_state->selected_index >= count)
+        ui_state->selected_index = count > 0 ? count - 1 : 0;
+    if (ui_state->scroll_offset > ui_state->selected_index)
+        ui_state->scroll_offset = ui_state->selected_index;
+    if (ui_state->selected_index >= ui_state->scroll_offset + MAX_VISIBLE_ENTRIES)
+        ui_state->scroll_offset = ui_state->selected_index - MAX_VISIBLE_ENTRIES + 1;
+}
+
+// Pull newly listed entries into current_dir; finish the stream when done
+static void ui_pump_listing(UIState* ui_state)
+{
+    if (ui_state->loading == NULL || ui_state->current_dir == NULL)
+        return;
+
+    int before = fs_dir_count(ui_state->current_dir);
+    int state = fs_stream_pump(ui_state->loading, ui_state->current_dir);
+    select_resize(&ui_state->marks, fs_dir_count(ui_state->current_dir));
+
+    // Land on the folder we came back from as soon as it shows up
+    if (ui_state->pending_select[0] != '\0')
+        ui_select_name(ui_state, ui_state->pending_select, before);
+
+    if (state != FS_STREAM_LOADING) {
+        ui_state->load_total_ns = fs_now_ns() - ui_state->load_start_ns;
+        fs_stream_close(ui_state->loading);
+        ui_state->loading = NULL;
+
+        // Entries arrive in directory order; sort once complete, keeping
+        // the cursor on the entry it was moved to while loading
+        ui_apply_sort(ui_state, ui_state->pending_select[0] == '\0');
+        if (ui_state->pending_select[0] != '\0') {
+            ui_select_name(ui_state, ui_state->pending_select, 0);
+            ui_state->pending_select[0] = '\0';
+        }
+        ui_clamp_selection(ui_state);
+        ui_request_sizes(ui_state);
+    }
+
+    if (fs_dir_count(ui_state->current_dir) != before)
+        ui_filter_sync(ui_state);
+}
+
+/**
+ * Folder sizes
+ *
+ * Once a listing is complete every folder in it whose total is not yet
+ * known is queued with the dirsize workers, tagged with listing_id.
+ * Finished totals are polled a few per frame and written into the size
+ * column, so the UI thread never waits for a walk.
+ */
+
+#define UI_SIZES_PER_FRAME 8
+
+static void ui_request_sizes(UIState* ui_state)
+{
+    FsDirectory* dir = ui_state->current_dir;
+    if (dir == NULL || ui_state->search_active)
+        return;
+
+    char path[512];
+    int count = fs_dir_count(dir);
+    for (int i = 0; i < count; i++) {
+        if (fs_dir_size_known(dir, i))
+            continue;
+        fs_build_path(ui_state->current_path, fs_dir_name(dir, i), path);
+        if (dirsize_request(path, ui_state->listing_id) == 0)
+            ui_state->sizes_pending++;
+    }
+}
+
+static void ui_pump_sizes(UIState* ui_state)
+{
+    if (ui_state->sizes_pending == 0 || ui_state->current_dir == NULL)
+        return;
+
+    DirSizeResult results[UI_SIZES_PER_FRAME];
+    int n = dirsize_poll(results, UI_SIZES_PER_FRAME);
+    for (int k = 0; k < n; k++) {
+        if (results[k].cookie != ui_state->listing_id)
+            continue;
+        int i = results[k].failed ? -1 :
+                fs_dir_find(ui_state->current_dir, path_get_filename(results[k].path));
+        if (i >= 0)
+            fs_dir_set_size(ui_state->current_dir, i, results[k].bytes);
+        ui_state->sizes_pending--;
+    }
+
+    // Marked folders now count with their contents
+    if (n > 0 && ui_state->marks.marked > 0)
+        select_recount(&ui_state->marks, ui_state->current_dir);
+
+    // Size order can only be final once every folder total is known
+    if (n > 0 && ui_state->sizes_pending == 0 && ui_state->sort.mode == SORT_SIZE) {
+        ui_state->current_dir->sort_tag = 0;
+        ui_apply_sort(ui_state, 1);
+    }
+}
+
+// Human-readable size, e.g. "512B", "12KB", "3MB", "2GB"
+static void ui_format_size(uint64_t size, char* dest, int dest_size)
+{
+    if (size > 1024ull * 1024 * 1024 * 10)
+        snprintf(dest, dest_size, "%lluGB", (unsigned long long)(size / (1024ull * 1024 * 1024)));
+    else if (size > 1024 * 1024)
+        snprintf(dest, dest_size, "%lluMB", (unsigned long long)(size / (1024 * 1024)));
+    else if (size > 1024)
+        snprintf(dest, dest_size, "%lluKB", (unsigned long long)(size / 1024));
+    else
+        snprintf(dest, dest_size, "%lluB", (unsigned long long)size);
+}
+
+/**
+ * Type-to-filter
+ *
+ * The filter view is a ranked list of entry indices (FilterState.matches)
+ * with its own cursor; selected_index always mirrors the entry under
+ * that cursor so every other operation works unchanged.
+ */
+
+static const char g_filter_charset[] = "abcdefghijklmnopqrstuvwxyz0123456789 ._-()[]";
+
+// Put the filter cursor on 'entry' if it still matches, else the top row
+static void ui_filter_place(UIState* ui_state, int entry)
+{
+    const FilterState* f = &ui_state->filter;
+    int pos = 0;
+    for (int i = 0; i < f->match_count; i++) {
+        if ((int)f->matches[i] == entry) {
+            pos = i;
+            break;
+        }
+    }
+
+    ui_state->filter_pos = pos;
+    if (pos < ui_state->filter_scroll || pos >= ui_state->filter_scroll + MAX_VISIBLE_ENTRIES)
+        ui_state->filter_scroll = (pos >= MAX_VISIBLE_ENTRIES / 2) ? pos - MAX_VISIBLE_ENTRIES / 2 : 0;
+    if (f->match_count > 0)
+        ui_state->selected_index = (int)f->matches[pos];
+}
+
+// Re-filter after the query or the listing changed
+static void ui_filter_sync(UIState* ui_state)
+{
+    if (!ui_state->filter_active || ui_state->current_dir == NULL)
+        return;
+
+    int entry = ui_state->selected_index;
+    if (filter_set_query(&ui_state->filter, ui_state->current_dir, ui_state->filter_query) != 0)
+        return;
+    ui_filter_place(ui_state, entry);
+}
+
+void ui_filter_open(UIState* ui_state)
+{
+    if (ui_state == NULL || ui_state->current_dir == NULL || ui_state->filter_active)
+        return;
+
+    ui_state->filter_active = 1;
+    ui_state->filter_query[0] = '\0';
+    ui_state->filter_pos = 0;
+    ui_state->filter_scroll = 0;
+    filter_free(&ui_state->filter);
+    ui_filter_sync(ui_state);
+}
+
+void ui_filter_close(UIState* ui_state)
+{
+    if (ui_state == NULL || !ui_state->filter_active)
+        return;
+
+    ui_state->filter_active = 0;
+    if (ui_state->filter.match_count > 0)
+        ui_select_index(ui_state, ui_state->selected_index);
+    filter_free(&ui_state->filter);
+}
+
+int ui_filter_is_active(UIState* ui_state)
+{
+    return ui_state != NULL && ui_state->filter_active;
+}
+
+void ui_filter_set_query(UIState* ui_state, const char* query)
+{
+    if (ui_state == NULL || query == NULL || !ui_state->filter_active)
+        return;
+
+    str_copy(ui_state->filter_query, query, sizeof(ui_state->filter_query));
+    ui_filter_sync(ui_state);
+}
+
+void ui_filter_append(UIState* ui_state)
+{
+    if (ui_state == NULL || !ui_state->filter_active)
+        return;
+
+    int len = str_len(ui_state->filter_query);
+    if (len >= FILTER_MAX_QUERY - 1)
+        return;
+
+    ui_state->filter_query[len] = g_filter_charset[ui_state->filter_char];
+    ui_state->filter_query[len + 1] = '\0';
+    ui_filter_sync(ui_state);
+}
+
+int ui_filter_backspace(UIState* ui_state)
+{
+    if (ui_state == NULL || !ui_state->filter_active)
+        return -1;
+
+    int len = str_len(ui_state->filter_query);
+    if (len == 0)
+        return -1;
+
+    ui_state->filter_query[len - 1] = '\0';
+    ui_filter_sync(ui_state);
+    return 0;
+}
+
+void ui_filter_cycle_char(UIState* ui_state, int direction)
+{
+    if (ui_state == NULL)
+        return;
+
+    int n = (int)sizeof(g_filter_charset) - 1;
+    ui_state->filter_char = (ui_state->filter_char + (direction > 0 ? 1 : n - 1)) % n;
+}
 
 void ui_init(UIState* ui_state)
 {
@@ -33,8 +466,30 @@ void ui_init(UIState* ui_state)
     ui_state->selected_index = 0;
     ui_state->scroll_offset = 0;
     ui_state->current_dir = NULL;
+    ui_state->loading = NULL;
+    ui_state->load_start_ns = 0;
+    ui_state->load_first_row_ns = 0;
+    ui_state->load_total_ns = 0;
+    ui_state->pending_select[0] = '\0';
+    ui_state->sort.mode = SORT_NAME;
+    ui_state->sort.dirs_first = 1;
+    ui_state->sort.max_threads = 0;
+    ui_state->filter_active = 0;
+    ui_state->filter_query[0] = '\0';
+    ui_state->filter_char = 0;
+    ui_state->filter_pos = 0;
+    ui_state->filter_scroll = 0;
+    filter_init(&ui_state->filter);
+    select_init(&ui_state->marks);
+    ui_state->search_active = 0;
+    ui_state->search_title[0] = '\0';
+    ui_state->listing_id = 0;
+    ui_state->sizes_pending = 0;
     ui_state->overlay_active = 0;
     ui_state->overlay_selected = 0;
+    ui_state->jobs_active = 0;
+    ui_state->jobs_selected = 0;
+    ui_state->job_count = 0;
 
     // initialize popup state
     ui_state->popup_active = 0;
@@ -46,7 +501,23 @@ void ui_init(UIState* ui_state)
     strcpy(ui_state->current_path, "/");
 
     // Load initial directory
-    ui_state->current_dir = fs_list_directory(ui_state->current_path);
+    ui_start_listing(ui_state, ui_state->current_path, 0);
+}
+
+// Prefetch the folder under the cursor while the browser is idle on it
+static void ui_hint_prefetch(UIState* ui_state)
+{
+    FsEntry entry;
+    if (ui_state->loading != NULL || ui_state->search_active || ui_state->filter_active ||
+        ui_state->overlay_active || ui_state->popup_active || ui_state->jobs_active ||
+        ui_get_selected_entry(ui_state, &entry) != 0 || !entry.is_dir) {
+        prefetch_hint(NULL);
+        return;
+    }
+
+    char path[512];
+    ui_get_selected_path(ui_state, path);
+    prefetch_hint(dircache_has(path) ? NULL : path);
 }
 
 void ui_render(UIState* ui_state)
@@ -54,47 +525,69 @@ void ui_render(UIState* ui_state)
     if (ui_state == NULL || ui_state->current_dir == NULL)
         return;
 
+    ui_pump_listing(ui_state);
+    ui_pump_sizes(ui_state);
+    ui_pump_jobs(ui_state);
+    ui_hint_prefetch(ui_state);
+
     // Clear screen
     text_clear();
 
     // Draw header
-    text_draw(0, 0, "=== FILE BROWSER ===");
-    text_draw(0, 1, ui_state->current_path);
+    char header[80];
+    if (ui_state->loading != NULL) {
+        snprintf(header, sizeof(header), "=== FILE BROWSER ===  Sort: %s  %d loaded...",
+                 sort_mode_name(ui_state->sort.mode), fs_dir_count(ui_state->current_dir));
+    } else {
+        snprintf(header, sizeof(header), "=== FILE BROWSER ===  Sort: %s",
+                 sort_mode_name(ui_state->sort.mode));
+    }
+    text_draw(0, 0, header);
+    if (ui_state->search_active && !ui_state->filter_active) {
+        char line[128];
+        snprintf(line, sizeof(line), "%s  %d results",
+                 ui_state->search_title, fs_dir_count(ui_state->current_dir));
+        text_draw(0, 1, line);
+    } else if (ui_state->filter_active) {
+        char line[128];
+        snprintf(line, sizeof(line), "Filter: %s_   Next: [%c]   %d/%d",
+                 ui_state->filter_query, g_filter_charset[ui_state->filter_char],
+                 ui_state->filter.match_count, fs_dir_count(ui_state->current_dir));
+        text_draw(0, 1, line);
+    } else {
+        text_draw(0, 1, ui_state->current_path);
+    }
 
     // Draw separator
     text_draw(0, 2, "====================");
 
-    // Draw entries
-    int display_start = ui_state->scroll_offset;
-    int display_count = (ui_state->current_dir->count < MAX_VISIBLE_ENTRIES) ?
-                        ui_state->current_dir->count : MAX_VISIBLE_ENTRIES;
+    // Draw entries (the ranked matches while filtering)
+    int entry_count = fs_dir_count(ui_state->current_dir);
+    int display_start = ui_state->filter_active ? ui_state->filter_scroll : ui_state->scroll_offset;
+    int row_count = ui_state->filter_active ? ui_state->filter.match_count : entry_count;
+    int display_count = row_count - display_start;
+    if (display_count > MAX_VISIBLE_ENTRIES)
+        display_count = MAX_VISIBLE_ENTRIES;
 
     for (int i = 0; i < display_count; i++) {
-        int entry_idx = display_start + i;
-        if (entry_idx >= ui_state->current_dir->count)
+        int entry_idx = ui_state->filter_active ?
+                        (int)ui_state->filter.matches[display_start + i] : display_start + i;
+        FsEntry entry;
+        if (fs_dir_get_entry(ui_state->current_dir, entry_idx, &entry) != 0)
             break;
 
-        FsEntry* entry = &ui_state->current_dir->entries[entry_idx];
-
-        // Prepare display string
+        // Prepare display string (marked entries are starred once any are)
         char display[512];
-        if (entry->is_dir) {
-            snprintf(display, sizeof(display), "[%s]", entry->name);
+        char size[32];
+        const char* mark = ui_state->marks.marked == 0 ? "" :
+                           select_is_marked(&ui_state->marks, entry_idx) ? "* " : "  ";
+        ui_format_size(entry.size, size, sizeof(size));
+        if (entry.is_dir && fs_dir_size_known(ui_state->current_dir, entry_idx)) {
+            snprintf(display, sizeof(display), "%s[%s] (%s)", mark, entry.name, size);
+        } else if (entry.is_dir) {
+            snprintf(display, sizeof(display), "%s[%s]", mark, entry.name);
         } else {
-            // Format file size
-            uint64_t size = entry->size;
-            const char* unit = "B";
-            int display_size = size;
-
-            if (size > 1024 * 1024) {
-                display_size = size / (1024 * 1024);
-                unit = "MB";
-            } else if (size > 1024) {
-                display_size = size / 1024;
-                unit = "KB";
-            }
-
-            snprintf(display, sizeof(display), "%s (%d%s)", entry->name, display_size, unit);
+            snprintf(display, sizeof(display), "%s%s (%s)", mark, entry.name, size);
         }
 
         // Highlight selected entry
@@ -106,22 +599,40 @@ void ui_render(UIState* ui_state)
         }
     }
 
+    // Time-to-first-row is measured separately from total listing time
+    if (ui_state->load_first_row_ns == 0 && entry_count > 0)
+        ui_state->load_first_row_ns = fs_now_ns() - ui_state->load_start_ns;
+
     // Draw footer with controls
     int footer_y = 24;
-    if (ui_state->overlay_active) {
+    if (ui_state->jobs_active) {
+        text_draw(0, footer_y, "Jobs: UP/DOWN=Select, A=Pause/Resume, Y=Cancel, B/ZR=Close");
+    } else if (ui_state->overlay_active) {
         text_draw(0, footer_y, "Controls: UP/DOWN=Select, A=Confirm, B=Cancel");
     } else if (ui_state->popup_active && ui_state->popup_type == POPUP_RENAME) {
         text_draw(0, footer_y, "Controls: A=OK B=Cancel U/D=Char L/R=Move");
+    } else if (ui_state->filter_active) {
+        text_draw(0, footer_y, "Filter: L/R=Char, Y=Add, B=Delete, Minus=Keyboard, UP/DOWN=Navigate, A=Select, RS=Mark, LS=Marks");
+    } else if (ui_state->search_active) {
+        text_draw(0, footer_y, "Search: UP/DOWN=Navigate, A=Open, B=Back to folder, Minus=Filter");
+    } else if (ui_state->loading != NULL) {
+        text_draw(0, footer_y, "Controls: UP/DOWN=Navigate, A=Select, B=Stop loading, X=FileOps, Plus=Exit");
     } else {
-        text_draw(0, footer_y, "Controls: UP/DOWN=Navigate, A=Select, B=Back, X=FileOps, Plus=Exit");
+        text_draw(0, footer_y, "Controls: UP/DOWN=Navigate, L/R=Jump, A=Select, B=Back, X=FileOps, Y=Sort, Minus=Filter, R=Search, L=Largest, ZR=Jobs, ZL=Undo, RS=Mark, LS=Marks, Plus=Exit");
     }
 
-    // Draw current selection info
-    if (!ui_state->overlay_active && ui_state->selected_index < ui_state->current_dir->count) {
-        FsEntry* sel = &ui_state->current_dir->entries[ui_state->selected_index];
+    // Draw current selection info, after the marked total if any
+    FsEntry sel;
+    if (!ui_state->overlay_active && ui_get_selected_entry(ui_state, &sel) == 0) {
         char info[512];
-        snprintf(info, sizeof(info), "Selected: %s (%s)",
-                 sel->name, sel->is_dir ? "DIR" : "FILE");
+        int len = 0;
+        if (ui_state->marks.marked > 0) {
+            char total[32];
+            ui_format_size(ui_state->marks.bytes, total, sizeof(total));
+            len = snprintf(info, sizeof(info), "Marked: %d (%s)  ", ui_state->marks.marked, total);
+        }
+        snprintf(info + len, sizeof(info) - len, "Selected: %s (%s)", sel.name, sel.is_dir ? "DIR" :
+                 fs_dir_is_split(ui_state->current_dir, ui_state->selected_index) ? "SPLIT FILE" : "FILE");
         text_draw(0, 25, info);
     }
 
@@ -130,6 +641,13 @@ void ui_render(UIState* ui_state)
         ui_render_overlay(ui_state);
     }
 
+    // Jobs panel, or a summary line while it is closed
+    if (ui_state->jobs_active) {
+        ui_render_jobs(ui_state);
+    } else {
+        ui_render_job_status(ui_state);
+    }
+
     // Draw popup on top if active
     if (ui_state->popup_active) {
         ui_render_popup(ui_state);
@@ -144,7 +662,17 @@ void ui_select_next(UIState* ui_state)
     if (ui_state == NULL || ui_state->current_dir == NULL)
         return;
 
-    if (ui_state->selected_index < ui_state->current_dir->count - 1) {
+    if (ui_state->filter_active) {
+        if (ui_state->filter_pos < ui_state->filter.match_count - 1) {
+            ui_state->filter_pos++;
+            ui_state->selected_index = (int)ui_state->filter.matches[ui_state->filter_pos];
+            if (ui_state->filter_pos >= ui_state->filter_scroll + MAX_VISIBLE_ENTRIES)
+                ui_state->filter_scroll++;
+        }
+        return;
+    }
+
+    if (ui_state->selected_index < fs_dir_count(ui_state->current_dir) - 1) {
         ui_state->selected_index++;
 
         // Adjust scroll if needed
@@ -159,6 +687,16 @@ void ui_select_prev(UIState* ui_state)
     if (ui_state == NULL || ui_state->current_dir == NULL)
         return;
 
+    if (ui_state->filter_active) {
+        if (ui_state->filter_pos > 0) {
+            ui_state->filter_pos--;
+            ui_state->selected_index = (int)ui_state->filter.matches[ui_state->filter_pos];
+            if (ui_state->filter_pos < ui_state->filter_scroll)
+                ui_state->filter_scroll--;
+        }
+        return;
+    }
+
     if (ui_state->selected_index > 0) {
         ui_state->selected_index--;
 
@@ -169,15 +707,16 @@ void ui_select_prev(UIState* ui_state)
     }
 }
 
-FsEntry* ui_get_selected_entry(UIState* ui_state)
+int ui_get_selected_entry(UIState* ui_state, FsEntry* out)
 {
     if (ui_state == NULL || ui_state->current_dir == NULL)
-        return NULL;
+        return -1;
 
-    if (ui_state->selected_index >= ui_state->current_dir->count)
-        return NULL;
+    // Nothing is selected while the filter matches nothing
+    if (ui_state->filter_active && ui_state->filter.match_count == 0)
+        return -1;
 
-    return &ui_state->current_dir->entries[ui_state->selected_index];
+    return fs_dir_get_entry(ui_state->current_dir, ui_state->selected_index, out);
 }
 
 void ui_get_selected_path(UIState* ui_state, char* dest)
@@ -185,13 +724,19 @@ void ui_get_selected_path(UIState* ui_state, char* dest)
     if (ui_state == NULL || dest == NULL)
         return;
 
-    FsEntry* entry = ui_get_selected_entry(ui_state);
-    if (entry == NULL) {
+    FsEntry entry;
+    if (ui_get_selected_entry(ui_state, &entry) != 0) {
         dest[0] = '\0';
         return;
     }
 
-    fs_build_path(ui_state->current_path, entry->name, dest);
+    // Search results are full paths already
+    if (ui_state->search_active) {
+        str_copy(dest, entry.name, 512);
+        return;
+    }
+
+    fs_build_path(ui_state->current_path, entry.name, dest);
 }
 
 int ui_enter_directory(UIState* ui_state)
@@ -199,34 +744,31 @@ int ui_enter_directory(UIState* ui_state)
     if (ui_state == NULL)
         return -1;
 
-    FsEntry* entry = ui_get_selected_entry(ui_state);
-    if (entry == NULL || !entry->is_dir)
+    FsEntry entry;
+    if (ui_get_selected_entry(ui_state, &entry) != 0)
         return -1;
 
     // Build new path
     char new_path[512];
     ui_get_selected_path(ui_state, new_path);
 
-    // Check if valid
-    if (!fs_is_valid_path(new_path))
-        return -1;
-
-    // Load new directory
-    FsDirectory* new_dir = fs_list_directory(new_path);
-    if (new_dir == NULL)
+    // A file found by search: open its folder and select it there
+    if (!entry.is_dir && ui_state->search_active) {
+        char parent[512];
+        if (path_get_parent(new_path, parent) != 0)
+            str_copy(parent, "/", sizeof(parent));  // File in the root
+        if (ui_start_listing(ui_state, parent, 0) != 0)
+            return -1;
+        const char* name = path_get_filename(new_path);
+        if (!ui_select_name(ui_state, name, 0) && ui_state->loading != NULL)
+            str_copy(ui_state->pending_select, name, sizeof(ui_state->pending_select));
+        return 0;
+    }
+    if (!entry.is_dir)
         return -1;
 
-    // Clean up old directory
-    if (ui_state->current_dir != NULL)
-        fs_free_directory(ui_state->current_dir);
-
-    // Update state
-    strcpy(ui_state->current_path, new_path);
-    ui_state->current_dir = new_dir;
-    ui_state->selected_index = 0;
-    ui_state->scroll_offset = 0;
-
-    return 0;
+    // Start listing the new directory (validates the path)
+    return ui_start_listing(ui_state, new_path, 0);
 }
 
 int ui_go_back(UIState* ui_state)
@@ -234,27 +776,222 @@ int ui_go_back(UIState* ui_state)
     if (ui_state == NULL)
         return -1;
 
+    // Leave search results for the folder they were started from
+    if (ui_state->search_active)
+        return ui_start_listing(ui_state, ui_state->current_path, 0);
+
     // Get parent path
     char parent_path[512];
     if (path_get_parent(ui_state->current_path, parent_path) != 0)
         return -1;  // Already at root
 
-    // Load parent directory
-    FsDirectory* parent_dir = fs_list_directory(parent_path);
-    if (parent_dir == NULL)
+    // Remember which child we came from before the path changes
+    char child[256];
+    str_copy(child, path_get_filename(ui_state->current_path), sizeof(child));
+
+    // Start listing the parent directory
+    if (ui_start_listing(ui_state, parent_path, 0) != 0)
         return -1;
 
-    // Clean up current directory
-    if (ui_state->current_dir != NULL)
-        fs_free_directory(ui_state->current_dir);
+    // Return to the entry we came from (now, or once it is streamed in)
+    if (!ui_select_name(ui_state, child, 0) && ui_state->loading != NULL)
+        str_copy(ui_state->pending_select, child, sizeof(ui_state->pending_select));
+    return 0;
+}
+
+int ui_refresh_directory(UIState* ui_state)
+{
+    if (ui_state == NULL)
+        return -1;
+
+    // A file operation may have changed the prefetched folder too
+    prefetch_drop();
+    return ui_start_listing(ui_state, ui_state->current_path, 1);
+}
+
+int ui_is_loading(UIState* ui_state)
+{
+    return ui_state != NULL && ui_state->loading != NULL;
+}
+
+void ui_cancel_loading(UIState* ui_state)
+{
+    if (ui_state == NULL || ui_state->loading == NULL)
+        return;
+
+    // Keep whatever the worker already delivered
+    if (ui_state->current_dir != NULL) {
+        fs_stream_pump(ui_state->loading, ui_state->current_dir);
+        select_resize(&ui_state->marks, fs_dir_count(ui_state->current_dir));
+    }
+    fs_stream_close(ui_state->loading);
+    ui_state->loading = NULL;
+    ui_state->pending_select[0] = '\0';
+    ui_apply_sort(ui_state, 1);
+    ui_clamp_selection(ui_state);
+}
+
+void ui_cycle_sort(UIState* ui_state)
+{
+    if (ui_state == NULL)
+        return;
 
-    // Update state
-    strcpy(ui_state->current_path, parent_path);
-    ui_state->current_dir = parent_dir;
+    ui_state->sort.mode = (SortMode)((ui_state->sort.mode + 1) % SORT_MODE_COUNT);
+
+    // A listing still streaming in is sorted when it completes
+    if (ui_state->loading == NULL)
+        ui_apply_sort(ui_state, 1);
+}
+
+// Show 'results' (full paths) in place of the listing
+static void ui_show_results(UIState* ui_state, FsDirectory* results, const char* title)
+{
+    // Park the folder (and its cursor) we return to with B; repeated
+    // results just replace the previous ones
+    ui_stash_listing(ui_state, 0);
+
+    ui_state->current_dir = results;
+    ui_state->search_active = 1;
+    str_copy(ui_state->search_title, title, sizeof(ui_state->search_title));
     ui_state->selected_index = 0;
     ui_state->scroll_offset = 0;
+    ui_state->pending_select[0] = '\0';
+    ui_state->listing_id++;
+    ui_state->sizes_pending = 0;
+    dirsize_cancel_all();
+    select_clear(&ui_state->marks);
+    select_resize(&ui_state->marks, fs_dir_count(results));
+    ui_state->filter_active = 0;
+    filter_free(&ui_state->filter);
+}
 
-    return 0;
+int ui_show_search(UIState* ui_state, const char* query)
+{
+    if (ui_state == NULL || query == NULL)
+        return -1;
+
+    FsDirectory* results = fs_dir_create(64);
+    if (results == NULL)
+        return -1;
+
+    int found = index_search(query, INDEX_MATCH_SUBSTRING, INDEX_MAX_RESULTS, results);
+    if (found <= 0) {
+        fs_free_directory(results);
+        return found;
+    }
+
+    char title[96];
+    snprintf(title, sizeof(title), "Search: \"%s\"", query);
+    ui_show_results(ui_state, results, title);
+    return found;
+}
+
+int ui_show_largest(UIState* ui_state)
+{
+    if (ui_state == NULL)
+        return -1;
+
+    FsDirectory* results = fs_dir_create(64);
+    if (results == NULL)
+        return -1;
+
+    int found = index_largest(UI_LARGEST_ITEMS, results);
+    if (found <= 0) {
+        fs_free_directory(results);
+        return found;
+    }
+
+    ui_show_results(ui_state, results, "Largest items");
+    return found;
+}
+
+int ui_is_search(UIState* ui_state)
+{
+    return ui_state != NULL && ui_state->search_active;
+}
+
+void ui_jump_initial(UIState* ui_state, int direction)
+{
+    if (ui_state == NULL || ui_state->current_dir == NULL || ui_state->filter_active)
+        return;
+
+    ui_select_index(ui_state, filter_jump_initial(ui_state->current_dir,
+                                                  ui_state->selected_index, direction));
+}
+
+void ui_mark_toggle(UIState* ui_state)
+{
+    FsEntry entry;
+    if (ui_state == NULL || ui_get_selected_entry(ui_state, &entry) != 0)
+        return;
+
+    select_toggle(&ui_state->marks, ui_state->current_dir, ui_state->selected_index);
+    ui_select_next(ui_state);
+}
+
+void ui_mark_all(UIState* ui_state)
+{
+    if (ui_state == NULL || ui_state->current_dir == NULL)
+        return;
+
+    if (!ui_state->filter_active) {
+        select_all(&ui_state->marks, ui_state->current_dir);
+        return;
+    }
+    for (int i = 0; i < ui_state->filter.match_count; i++)
+        select_set(&ui_state->marks, ui_state->current_dir, (int)ui_state->filter.matches[i], 1);
+}
+
+void ui_mark_invert(UIState* ui_state)
+{
+    if (ui_state == NULL || ui_state->current_dir == NULL)
+        return;
+
+    if (!ui_state->filter_active) {
+        select_invert(&ui_state->marks, ui_state->current_dir);
+        return;
+    }
+    for (int i = 0; i < ui_state->filter.match_count; i++)
+        select_toggle(&ui_state->marks, ui_state->current_dir, (int)ui_state->filter.matches[i]);
+}
+
+void ui_mark_clear(UIState* ui_state)
+{
+    if (ui_state != NULL)
+        select_clear(&ui_state->marks);
+}
+
+int ui_mark_matching(UIState* ui_state, const char* pattern)
+{
+    if (ui_state == NULL || ui_state->current_dir == NULL)
+        return 0;
+    return select_match(&ui_state->marks, ui_state->current_dir, pattern);
+}
+
+int ui_marked_count(UIState* ui_state)
+{
+    return ui_state != NULL ? ui_state->marks.marked : 0;
+}
+
+int ui_get_marked_paths(UIState* ui_state, FsDirectory* out)
+{
+    if (ui_state == NULL || ui_state->current_dir == NULL || out == NULL)
+        return -1;
+
+    const FsDirectory* dir = ui_state->current_dir;
+    char path[512];
+    int added = 0;
+    for (int i = select_next(&ui_state->marks, 0); i >= 0; i = select_next(&ui_state->marks, i + 1)) {
+        // Search results are full paths already
+        if (ui_state->search_active)
+            str_copy(path, fs_dir_name(dir, i), sizeof(path));
+        else
+            fs_build_path(ui_state->current_path, fs_dir_name(dir, i), path);
+        if (fs_dir_append(out, path, fs_dir_is_dir(dir, i), fs_dir_size(dir, i)) != 0)
+            return -1;
+        added++;
+    }
+    return added;
 }
 
 void ui_cleanup(UIState* ui_state)
@@ -262,6 +999,11 @@ void ui_cleanup(UIState* ui_state)
     if (ui_state == NULL)
         return;
 
+    ui_cancel_loading(ui_state);
+    filter_free(&ui_state->filter);
+    ui_state->filter_active = 0;
+    select_free(&ui_state->marks);
+
     if (ui_state->current_dir != NULL) {
         fs_free_directory(ui_state->current_dir);
         ui_state->current_dir = NULL;
@@ -301,9 +1043,10 @@ void ui_open_overlay(UIState* ui_state)
     ui_state->overlay_active = 1;
     ui_state->overlay_selected = 0;
     ui_state->overlay_count = 0;
+    str_copy(ui_state->overlay_title, "FILE OPS", sizeof(ui_state->overlay_title));
 
-    FsEntry* sel = ui_get_selected_entry(ui_state);
-    if (sel == NULL)
+    FsEntry sel;
+    if (ui_get_selected_entry(ui_state, &sel) != 0)
         return;
 
     // always include basic operations
@@ -313,23 +1056,78 @@ void ui_open_overlay(UIState* ui_state)
         strncpy(ui_state->overlay_labels[ui_state->overlay_count], basic_labels[i], 31);
         ui_state->overlay_labels[ui_state->overlay_count][31] = '\0';
         ui_state->overlay_codes[ui_state->overlay_count] = basic_codes[i];
+
+        // copy, move and delete work on the marked entries when there are any
+        int code = basic_codes[i];
+        if (ui_state->marks.marked > 0 && (code == UI_OP_COPY || code == UI_OP_MOVE || code == UI_OP_DELETE))
+            snprintf(ui_state->overlay_labels[ui_state->overlay_count], 32, "%s %d marked",
+                     basic_labels[i], ui_state->marks.marked);
+        else if (code == UI_OP_PASTE && clipboard_count(CLIPBOARD_NONE) > 1)
+            snprintf(ui_state->overlay_labels[ui_state->overlay_count], 32, "Paste %d items",
+                     clipboard_count(CLIPBOARD_NONE));
         ui_state->overlay_count++;
     }
 
     // additional options for files
-    if (!sel->is_dir) {
-        if (is_nro_file(sel->name)) {
+    if (!sel.is_dir) {
+        if (is_nro_file(sel.name)) {
             strncpy(ui_state->overlay_labels[ui_state->overlay_count], "Launch", 31);
             ui_state->overlay_labels[ui_state->overlay_count][31] = '\0';
             ui_state->overlay_codes[ui_state->overlay_count] = UI_OP_LAUNCH;
             ui_state->overlay_count++;
         }
-        if (is_installer_file(sel->name)) {
+        if (is_installer_file(sel.name)) {
             strncpy(ui_state->overlay_labels[ui_state->overlay_count], "Install", 31);
             ui_state->overlay_labels[ui_state->overlay_count][31] = '\0';
             ui_state->overlay_codes[ui_state->overlay_count] = UI_OP_INSTALL;
             ui_state->overlay_count++;
         }
+        strncpy(ui_state->overlay_labels[ui_state->overlay_count], "Hash", 31);
+        ui_state->overlay_labels[ui_state->overlay_count][31] = '\0';
+        ui_state->overlay_codes[ui_state->overlay_count] = UI_OP_HASH;
+        ui_state->overlay_count++;
+    }
+
+    // the folder copied last can be synced into the selected one
+    char clip_path[FS_MAX_PATH];
+    if (sel.is_dir && clipboard_get_last(clip_path, sizeof(clip_path)) == CLIPBOARD_COPY) {
+        strncpy(ui_state->overlay_labels[ui_state->overlay_count], "Sync here", 31);
+        ui_state->overlay_labels[ui_state->overlay_count][31] = '\0';
+        ui_state->overlay_codes[ui_state->overlay_count] = UI_OP_SYNC;
+        ui_state->overlay_count++;
+    }
+
+    // copy verification is a setting, toggled from here
+    snprintf(ui_state->overlay_labels[ui_state->overlay_count], 32, "Verify copies: %s",
+             copy_get_verify() != HASH_NONE ? "On" : "Off");
+    ui_state->overlay_codes[ui_state->overlay_count] = UI_OP_VERIFY;
+    ui_state->overlay_count++;
+}
+
+void ui_open_marks(UIState* ui_state)
+{
+    if (ui_state == NULL || ui_state->current_dir == NULL)
+        return;
+
+    ui_state->overlay_active = 1;
+    ui_state->overlay_selected = 0;
+    ui_state->overlay_count = 0;
+    str_copy(ui_state->overlay_title, "MARK", sizeof(ui_state->overlay_title));
+
+    const char* labels[] = {"Mark all", "Invert marks", "Mark matching...", "Clear marks"};
+    int codes[] = {UI_OP_MARK_ALL, UI_OP_MARK_INVERT, UI_OP_MARK_PATTERN, UI_OP_MARK_CLEAR};
+    for (int i = 0; i < 4; i++) {
+        str_copy(ui_state->overlay_labels[i], labels[i], sizeof(ui_state->overlay_labels[i]));
+        ui_state->overlay_codes[i] = codes[i];
+        ui_state->overlay_count++;
+    }
+
+    // the clipboard collects across folders and runs, so it is emptied by hand
+    int held = clipboard_count(CLIPBOARD_NONE);
+    if (held > 0) {
+        snprintf(ui_state->overlay_labels[ui_state->overlay_count], 32, "Clear clipboard (%d)", held);
+        ui_state->overlay_codes[ui_state->overlay_count] = UI_OP_CLIP_CLEAR;
+        ui_state->overlay_count++;
     }
 }
 
@@ -377,7 +1175,7 @@ static void ui_render_overlay(UIState* ui_state)
 
     // Draw semi-transparent background (black box covering middle of screen)
     int overlay_top = 8;
-    int overlay_height = 12;
+    int overlay_height = 13;
     int overlay_left = 15;
 
     // Draw background box using spaces with inverse video
@@ -389,7 +1187,7 @@ static void ui_render_overlay(UIState* ui_state)
     }
 
     // Draw title
-    text_draw_formatted(overlay_left + 8, overlay_top + 1, "i", "FILE OPS");
+    text_draw_formatted(overlay_left + 8, overlay_top + 1, "i", ui_state->overlay_title);
 
     // Draw menu options dynamically
     for (int i = 0; i < ui_state->overlay_count; i++) {
@@ -409,9 +1207,257 @@ static void ui_render_overlay(UIState* ui_state)
 }
 
 
+// Duration as "m:ss", or "h:mm:ss" from an hour
+static void ui_format_duration(uint64_t ns, char* dest, int dest_size)
+{
+    uint64_t secs = ns / 1000000000ull;
+    if (secs >= 3600)
+        snprintf(dest, dest_size, "%llu:%02llu:%02llu", (unsigned long long)(secs / 3600),
+                 (unsigned long long)(secs / 60 % 60), (unsigned long long)(secs % 60));
+    else
+        snprintf(dest, dest_size, "%llu:%02llu", (unsigned long long)(secs / 60),
+                 (unsigned long long)(secs % 60));
+}
+
+static const char* ui_job_verb(JobType type)
+{
+    switch (type) {
+        case JOB_COPY:   return "Copy";
+        case JOB_MOVE:   return "Move";
+        case JOB_DELETE: return "Delete";
+        case JOB_RENAME: return "Rename";
+        case JOB_RESUME: return "Resume";
+        case JOB_HASH:   return "Hash";
+        case JOB_COMPARE: return "Compare";
+        case JOB_SYNC:   return "Sync";
+        case JOB_PURGE:  return "Purge";
+        case JOB_PASTE:  return "Paste";
+    }
+    return "Job";
+}
+
+// Name of the item a job works on (a purged item goes by its old name,
+// a batch by its size), written to 'buf' where it needs formatting
+static const char* ui_job_name(const JobInfo* job, char* buf, int size)
+{
+    if (job->item_count > 1) {
+        snprintf(buf, size, "%d items", job->item_count);
+        return buf;
+    }
+    if (job->type == JOB_PURGE && job->dest[0] != '\0')
+        return path_get_filename(job->dest);
+    return path_get_filename(job->src);
+}
+
+// Refresh the job list, carrying each job's rate samples over by id
+static void ui_pump_jobs(UIState* ui_state)
+{
+    uint32_t old_ids[JOBS_MAX];
+    int old_count = ui_state->job_count;
+    for (int i = 0; i < old_count; i++)
+        old_ids[i] = ui_state->jobs[i].id;
+
+    ui_state->job_count = jobs_list(ui_state->jobs, JOBS_MAX);
+
+    // Both lists are ordered by id and jobs only leave or join at the end,
+    // so a job's old row is never above its new one
+    int j = 0;
+    for (int i = 0; i < ui_state->job_count; i++) {
+        while (j < old_count && old_ids[j] < ui_state->jobs[i].id)
+            j++;
+        if (j < old_count && old_ids[j] == ui_state->jobs[i].id) {
+            if (j != i)
+                ui_state->job_views[i] = ui_state->job_views[j];
+        } else {
+            progress_view_init(&ui_state->job_views[i]);
+        }
+        if (ui_state->jobs[i].state == JOB_RUNNING)
+            progress_view(ui_state->jobs[i].progress, &ui_state->job_views[i]);
+    }
+
+    if (ui_state->jobs_selected >= ui_state->job_count)
+        ui_state->jobs_selected = ui_state->job_count > 0 ? ui_state->job_count - 1 : 0;
+}
+
+// One-line summary of the running jobs, for when the panel is closed
+static void ui_render_job_status(UIState* ui_state)
+{
+    if (ui_state->job_count == 0)
+        return;
+
+    const JobInfo* first = &ui_state->jobs[0];
+    const ProgressView* v = &ui_state->job_views[0];
+    char line[128];
+    char name[32];
+    snprintf(line, sizeof(line), "Jobs: %d  %s %d%% %s%s  ZR=Jobs", ui_state->job_count,
+             ui_job_verb(first->type), v->percent, ui_job_name(first, name, sizeof(name)),
+             first->state == JOB_QUEUED ? " (queued)" : first->paused ? " (paused)" : "");
+    text_draw(0, 26, line);
+}
+
+/** Helper function to render the jobs panel */
+static void ui_render_jobs(UIState* ui_state)
+{
+    int top = 4;
+    int left = 8;
+    int rows = 18;
+    int visible = (rows - 4) / 2;
+    for (int y = top; y < top + rows; y++)
+        text_draw_formatted(left - 2, y, "i", "                                                              ");
+
+    char line[128];
+    snprintf(line, sizeof(line), "JOBS (%d)", ui_state->job_count);
+    text_draw_formatted(left, top + 1, "i", line);
+    if (ui_state->job_count == 0) {
+        text_draw_formatted(left, top + 3, "i", "No jobs running");
+        return;
+    }
+
+    int first = ui_state->jobs_selected >= visible ? ui_state->jobs_selected - visible + 1 : 0;
+    for (int row = 0; row < visible && first + row < ui_state->job_count; row++) {
+        int i = first + row;
+        const JobInfo* job = &ui_state->jobs[i];
+        const ProgressView* v = &ui_state->job_views[i];
+        int y = top + 3 + row * 2;
+
+        const char* state = job->state == JOB_QUEUED ? "queued" :
+                            job->paused ? "paused" :
+                            v->phase == PROGRESS_SCANNING ? "counting" : "";
+        char name[32];
+        snprintf(line, sizeof(line), "%c %-6s %3d%% %-8s %.36s", i == ui_state->jobs_selected ? '>' : ' ',
+                 ui_job_verb(job->type), v->percent, state, ui_job_name(job, name, sizeof(name)));
+        if (i == ui_state->jobs_selected)
+            text_draw_formatted(left, y, "i", line);
+        else
+            text_draw(left, y, line);
+
+        if (job->state != JOB_RUNNING)
+            continue;
+        char done[32];
+        char total[32];
+        char rate[32];
+        char eta[32];
+        ui_format_size(v->done_bytes, done, sizeof(done));
+        ui_format_size(v->total_bytes, total, sizeof(total));
+        ui_format_size((uint64_t)v->bytes_per_sec_avg, rate, sizeof(rate));
+        if (v->eta_ns > 0)
+            ui_format_duration(v->eta_ns, eta, sizeof(eta));
+        else
+            str_copy(eta, "--:--", sizeof(eta));
+        snprintf(line, sizeof(line), "    %s / %s  %llu/%llu files  %s/s  ETA %s", done, total,
+                 (unsigned long long)v->done_files, (unsigned long long)v->total_files, rate, eta);
+        text_draw(left, y + 1, line);
+    }
+}
+
+void ui_open_jobs(UIState* ui_state)
+{
+    if (ui_state == NULL)
+        return;
+    ui_state->jobs_active = 1;
+    ui_state->jobs_selected = 0;
+}
+
+void ui_close_jobs(UIState* ui_state)
+{
+    if (ui_state != NULL)
+        ui_state->jobs_active = 0;
+}
+
+void ui_jobs_select_next(UIState* ui_state)
+{
+    if (ui_state != NULL && ui_state->jobs_selected < ui_state->job_count - 1)
+        ui_state->jobs_selected++;
+}
+
+void ui_jobs_select_prev(UIState* ui_state)
+{
+    if (ui_state != NULL && ui_state->jobs_selected > 0)
+        ui_state->jobs_selected--;
+}
+
+const JobInfo* ui_jobs_get_selected(UIState* ui_state)
+{
+    if (ui_state == NULL || ui_state->jobs_selected >= ui_state->job_count)
+        return NULL;
+    return &ui_state->jobs[ui_state->jobs_selected];
+}
+
+void ui_show_job_result(UIState* ui_state, const JobInfo* info)
+{
+    if (ui_state == NULL || info == NULL)
+        return;
+
+    char batch[32];
+    const char* name = ui_job_name(info, batch, sizeof(batch));
+    char msg[160];
+    if (info->state == JOB_CANCELLED)
+        snprintf(msg, sizeof(msg), "%s cancelled: %s", ui_job_verb(info->type), name);
+    else if (info->state == JOB_FAILED && info->rc == COPY_ERR_NO_SPACE)
+        snprintf(msg, sizeof(msg), "%s failed: not enough free space", ui_job_verb(info->type));
+    else if (info->state == JOB_FAILED && info->rc == COPY_ERR_VERIFY)
+        snprintf(msg, sizeof(msg), "%s failed: copy of %s does not match", ui_job_verb(info->type),
+                 name);
+    else if (info->state == JOB_FAILED)
+        snprintf(msg, sizeof(msg), "%s failed: %s", ui_job_verb(info->type), name);
+    else if (info->type == JOB_RENAME)
+        snprintf(msg, sizeof(msg), "Renamed to: %s", info->dest);
+    else if (info->type == JOB_DELETE && trash_holds(info->src))
+        snprintf(msg, sizeof(msg), "Deleted: %s (ZL to undo)", name);
+    else
+        snprintf(msg, sizeof(msg), "%s: %s", info->type == JOB_COPY || info->type == JOB_PASTE ? "Pasted" :
+                 info->type == JOB_MOVE ? "Moved" : info->type == JOB_RESUME ? "Resumed" :
+                 info->type == JOB_HASH ? "Hashed" : info->type == JOB_COMPARE ? "Compared" :
+                 info->type == JOB_SYNC ? "Synced" : "Deleted", name);
+
+    // Renames and failures before any work have no totals to report
+    if (info->type == JOB_RENAME || info->done_files == 0) {
+        ui_show_message(ui_state, msg, 120);
+        return;
+    }
+
+    char size[32];
+    char rate[32];
+    char took[32];
+    ui_format_size(info->done_bytes, size, sizeof(size));
+    ui_format_duration(info->elapsed_ns, took, sizeof(took));
+    uint64_t per_sec = info->elapsed_ns > 0 ? (uint64_t)(info->done_bytes * 1e9 / info->elapsed_ns) : 0;
+    ui_format_size(per_sec, rate, sizeof(rate));
+
+    char text[512];
+    int len = snprintf(text, sizeof(text), "%s  (%s, %llu files in %s, %s/s)", msg, size,
+                       (unsigned long long)info->done_files, took, rate);
+    if (info->result[0] != '\0' && len < (int)sizeof(text)) {
+        // Digests and sync summaries are worth reading: keep them up until dismissed
+        snprintf(text + len, sizeof(text) - len, "\n\n%s", info->result);
+        ui_show_message(ui_state, text, 0);
+        return;
+    }
+    ui_show_message(ui_state, text, 180);
+}
+
 /**
  * Popup rendering and control helpers
  */
+
+// Draw 'text' from row 'y', one row per line, shifting long lines left so
+// they stay on screen. Returns the row after the last line.
+static int ui_draw_popup_lines(int x, int y, const char* text)
+{
+    const char* line = text;
+    while (line != NULL && y < 27) {
+        const char* end = strchr(line, '\n');
+        int len = end != NULL ? (int)(end - line) : (int)strlen(line);
+        char row[81];
+        if (len > 80)
+            len = 80;
+        memcpy(row, line, len);
+        row[len] = '\0';
+        text_draw(x + len > 80 ? 80 - len : x, y++, row);
+        line = end != NULL ? end + 1 : NULL;
+    }
+    return y;
+}
 static void ui_render_popup(UIState* ui_state)
 {
     if (ui_state == NULL || !ui_state->popup_active)
@@ -426,9 +1472,10 @@ static void ui_render_popup(UIState* ui_state)
     int box_top = 8;
 
     if (ui_state->popup_type == POPUP_MESSAGE) {
-        // center the message vertically
-        int msg_y = box_top + 4;
-        text_draw(box_left + 2, msg_y, ui_state->popup_message);
+        ui_draw_popup_lines(box_left + 2, box_top + 4, ui_state->popup_message);
+    } else if (ui_state->popup_type == POPUP_CONFIRM) {
+        int y = ui_draw_popup_lines(box_left + 2, box_top + 4, ui_state->popup_message);
+        text_draw(box_left + 2, y + 1, "A=Yes  B=No");
     }
 }
 
@@ -443,6 +1490,13 @@ void ui_show_message(UIState* ui_state, const char* msg, int duration)
     ui_state->popup_timer = duration;
 }
 
+void ui_show_confirm(UIState* ui_state, const char* msg)
+{
+    ui_show_message(ui_state, msg, 0);
+    if (ui_state != NULL && msg != NULL)
+        ui_state->popup_type = POPUP_CONFIRM;
+}
+
 
 int ui_process_popup_input(UIState* ui_state)
 {
@@ -469,6 +1523,16 @@ int ui_process_popup_input(UIState* ui_state)
         return 1;
     }
 
+    if (ui_state->popup_type == POPUP_CONFIRM) {
+        int yes = input_select();
+        if (yes || input_back()) {
+            ui_state->popup_active = 0;
+            ui_state->popup_type = POPUP_NONE;
+            return yes ? 3 : 0;
+        }
+        return 1;
+    }
+
     return 0;
 }
 
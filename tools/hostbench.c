@@ -0,0 +1,576 @@
+/**
+ * Host benchmark driver
+ *
+ * Runs the libs/bench benchmarks on a Linux host against synthetic data,
+ * using the POSIX backends of the filesystem modules. Build from the
+ * repository root with:
+ *
+ *   cc -O2 -std=gnu11 -pthread -Iinclude -Ilibs/utils -Ilibs/bench -Ilibs/sort \
+ *      -Ilibs/filter -Ilibs/index -Ilibs/walk -Ilibs/dirsize -Ilibs/prefetch \
+ *      -Ilibs/vfs -Ilibs/copy -Ilibs/delete -Ilibs/dircache -Ilibs/transfer \
+ *      -Ilibs/copysched -Ilibs/progress -Ilibs/journal -Ilibs/hash -Ilibs/sync \
+ *      -Ilibs/trash -Ilibs/move -Ilibs/select -Ilibs/clipboard \
+ *      tools/hostbench.c libs/bench/bench.c source/fs.c libs/utils/utils.c \
+ *      libs/sort/sort.c libs/filter/filter.c libs/index/index.c \
+ *      libs/walk/walk.c libs/dirsize/dirsize.c libs/prefetch/prefetch.c \
+ *      libs/vfs/vfs.c libs/vfs/vfs_native.c libs/vfs/vfs_posix.c \
+ *      libs/vfs/vfs_memory.c libs/vfs/vfs_split.c libs/copy/copy.c \
+ *      libs/delete/delete.c libs/dircache/dircache.c libs/transfer/transfer.c \
+ *      libs/copysched/copysched.c libs/progress/progress.c \
+ *      libs/journal/journal.c libs/hash/hash.c libs/sync/sync.c \
+ *      libs/trash/trash.c libs/move/move.c libs/select/select.c \
+ *      libs/clipboard/clipboard.c \
+ *      -o hostbench
+ *
+ * Usage:
+ *   hostbench listing <dir> [files] [iterations]
+ *   hostbench layout [entries]
+ *   hostbench sort [entries]
+ *   hostbench filter [entries] [query]
+ *   hostbench index <dir> <index file> [query]
+ *   hostbench dirsize <dir> [threads]
+ *   hostbench prefetch <dir> [dwell ms] [folders]
+ *   hostbench fileops <dir> [files] [file size]
+ *   hostbench tree <dir> [depth] [files per level]
+ *   hostbench transfer <dir> [MB]
+ *   hostbench copysched <dir> [files] [file size] [large files] [workers]
+ *   hostbench hash [MB]
+ *   hostbench sync <dir> [files] [file size]
+ *   hostbench delete <dir> [files]
+ *   hostbench move <dir> [files]
+ *   hostbench batch <dir> [files] [entries]
+ *   hostbench clipboard <dir> [items] [folders]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "sort.h"
+#include "index.h"
+#include "dirsize.h"
+#include "vfs.h"
+
+static int run_listing(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s listing <dir> [files] [iterations]\n", argv[0]);
+        return 1;
+    }
+    const char* dir = argv[2];
+    int files = argc > 3 ? atoi(argv[3]) : 3000;
+    int iterations = argc > 4 ? atoi(argv[4]) : 20;
+
+    if (bench_make_tree(dir, files, files / 20) != 0) {
+        fprintf(stderr, "cannot create synthetic tree in %s\n", dir);
+        return 1;
+    }
+
+    BenchListingResult result;
+    if (bench_listing(dir, iterations, &result) != 0) {
+        fprintf(stderr, "cannot list %s\n", dir);
+        return 1;
+    }
+    bench_print_listing(&result);
+
+    FsListStats stream;
+    if (bench_stream(dir, &stream) == 0) {
+        printf("stream: %llu entries, first batch %.3f ms, total %.3f ms\n",
+               (unsigned long long)stream.entries,
+               stream.first_batch_ns / 1e6, stream.elapsed_ns / 1e6);
+    }
+    return 0;
+}
+
+static int run_layout(int argc, char** argv)
+{
+    int entries = argc > 2 ? atoi(argv[2]) : 20000;
+
+    BenchLayoutResult result;
+    if (bench_layout(entries, &result) != 0) {
+        fprintf(stderr, "layout benchmark failed\n");
+        return 1;
+    }
+    bench_print_layout(&result);
+    return 0;
+}
+
+static int run_sort(int argc, char** argv)
+{
+    int entries = argc > 2 ? atoi(argv[2]) : 50000;
+
+    for (int mode = 0; mode < SORT_MODE_COUNT; mode++) {
+        BenchSortResult result;
+        if (bench_sort(entries, mode, &result) != 0) {
+            fprintf(stderr, "sort benchmark failed\n");
+            return 1;
+        }
+        printf("sort %-7s: %d entries, serial %.3f ms, parallel %.3f ms\n",
+               sort_mode_name((SortMode)mode), entries,
+               result.serial_ns / 1e6, result.parallel_ns / 1e6);
+    }
+    return 0;
+}
+
+static int run_filter(int argc, char** argv)
+{
+    int entries = argc > 2 ? atoi(argv[2]) : 50000;
+    const char* query = argc > 3 ? argv[3] : "super game 12";
+
+    BenchFilterResult result;
+    if (bench_filter(entries, query, &result) != 0) {
+        fprintf(stderr, "filter benchmark failed\n");
+        return 1;
+    }
+    printf("filter: %d entries, %d keys, %d matches, %.3f ms/key (worst %.3f ms), naive %.3f ms/key\n",
+           result.entries, result.keystrokes, result.matches,
+           result.total_ns / 1e6 / result.keystrokes, result.worst_ns / 1e6,
+           result.naive_ns / 1e6 / result.keystrokes);
+    return 0;
+}
+
+static int run_index(int argc, char** argv)
+{
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s index <dir> <index file> [query]\n", argv[0]);
+        return 1;
+    }
+    const char* query = argc > 4 ? argv[4] : "rom";
+
+    // Run twice: the second scan starts from the saved index
+    for (int run = 0; run < 2; run++) {
+        index_init(argv[3]);
+        if (index_start_scan(argv[2]) != 0) {
+            fprintf(stderr, "cannot start scan\n");
+            return 1;
+        }
+        IndexStats stats;
+        do {
+            usleep(1000);
+            index_get_stats(&stats);
+        } while (stats.state == INDEX_STATE_SCANNING);
+
+        FsDirectory* results = fs_dir_create(64);
+        uint64_t start = fs_now_ns();
+        int found = index_search(query, INDEX_MATCH_SUBSTRING, INDEX_MAX_RESULTS, results);
+        uint64_t search_ns = fs_now_ns() - start;
+        fs_free_directory(results);
+
+        if (run == 1) {
+            FsDirectory* largest = fs_dir_create(16);
+            start = fs_now_ns();
+            int n = index_largest(10, largest);
+            printf("largest: %d items in %.3f ms, top %s (%llu bytes)\n", n,
+                   (fs_now_ns() - start) / 1e6, n > 0 ? fs_dir_name(largest, 0) : "-",
+                   (unsigned long long)fs_dir_size(largest, 0));
+            fs_free_directory(largest);
+        }
+
+        printf("index %s: %llu entries in %llu dirs (%llu listed, %llu reused), "
+               "%.3f ms scan, %llu byte file, search '%s' %d results %.3f ms\n",
+               run == 0 ? "cold" : "warm",
+               (unsigned long long)stats.entries, (unsigned long long)stats.dirs,
+               (unsigned long long)stats.dirs_listed, (unsigned long long)stats.dirs_reused,
+               stats.elapsed_ns / 1e6, (unsigned long long)stats.file_bytes,
+               query, found, search_ns / 1e6);
+        index_cleanup();
+    }
+    return 0;
+}
+
+static int run_dirsize(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s dirsize <dir> [threads]\n", argv[0]);
+        return 1;
+    }
+    int max_threads = argc > 3 ? atoi(argv[3]) : DIRSIZE_DEFAULT_THREADS;
+
+    for (int threads = 1; threads <= max_threads; threads++) {
+        BenchDirSizeResult result;
+        if (bench_dirsize(argv[2], threads, &result) != 0) {
+            fprintf(stderr, "cannot list %s\n", argv[2]);
+            return 1;
+        }
+        printf("dirsize: %d folders, %d threads, %llu bytes, cold %.3f ms, cached %.3f ms\n",
+               result.folders, result.threads, (unsigned long long)result.bytes,
+               result.cold_ns / 1e6, result.warm_ns / 1e6);
+    }
+    return 0;
+}
+
+static int run_prefetch(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s prefetch <dir> [dwell ms] [folders]\n", argv[0]);
+        return 1;
+    }
+    int dwell_ms = argc > 3 ? atoi(argv[3]) : 250;
+    int folders = argc > 4 ? atoi(argv[4]) : 16;
+
+    BenchPrefetchResult result;
+    if (bench_prefetch(argv[2], dwell_ms, folders, &result) != 0) {
+        fprintf(stderr, "cannot list %s\n", argv[2]);
+        return 1;
+    }
+
+    const PrefetchStats* st = &result.stats;
+    uint64_t taken = st->hits + st->partial_hits;
+    uint64_t lookups = taken + st->misses;
+    printf("prefetch: %d folders, %d entered, dwell %d ms\n",
+           result.folders, result.entered, dwell_ms);
+    printf("prefetch: %llu started, %llu hits, %llu partial, %llu misses (%.0f%% hit rate)\n",
+           (unsigned long long)st->started, (unsigned long long)st->hits,
+           (unsigned long long)st->partial_hits, (unsigned long long)st->misses,
+           lookups ? 100.0 * taken / lookups : 0.0);
+    printf("prefetch: %llu cancelled, %llu unused, %llu wasted entries\n",
+           (unsigned long long)st->cancelled, (unsigned long long)st->wasted,
+           (unsigned long long)st->wasted_entries);
+    if (result.entered > 0) {
+        printf("prefetch: enter %.3f ms/folder with prefetch, %.3f ms/folder without\n",
+               result.enter_ns / 1e6 / result.entered, result.cold_ns / 1e6 / result.entered);
+    }
+    return 0;
+}
+
+static void print_vfs_calls(const char* label, const VfsCounters* c)
+{
+    printf("  %s: %llu opens, %llu closes, %llu reads, %llu writes, %llu dir calls, %llu metadata\n",
+           label, (unsigned long long)c->file_opens, (unsigned long long)c->file_closes,
+           (unsigned long long)c->reads, (unsigned long long)c->writes,
+           (unsigned long long)c->dir_calls, (unsigned long long)c->metadata);
+}
+
+static int run_fileops(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s fileops <dir> [files] [file size]\n", argv[0]);
+        return 1;
+    }
+    int files = argc > 3 ? atoi(argv[3]) : 2000;
+    uint64_t file_size = argc > 4 ? strtoull(argv[4], NULL, 10) : 16384;
+
+    // Same tree on disk, then in memory: the difference is pure I/O cost
+    const VfsBackend* backends[] = {vfs_backend_posix(), vfs_backend_memory()};
+    const char* roots[] = {argv[2], "/hostbench"};
+    for (int i = 0; i < 2; i++) {
+        vfs_init(backends[i]);
+        BenchFileOpsResult result;
+        int rc = bench_fileops(roots[i], files, file_size, &result);
+        vfs_init(NULL);
+        if (rc != 0) {
+            fprintf(stderr, "fileops failed on the %s backend\n", backends[i]->name);
+            return 1;
+        }
+        printf("fileops (%s): %d files, %.1f MB, create %.1f ms, copy %.1f ms (%.1f MB/s), delete %.1f ms\n",
+               result.backend, result.files, result.bytes / 1e6, result.create_ns / 1e6,
+               result.copy_ns / 1e6, result.copy_ns ? result.bytes * 1e3 / result.copy_ns : 0.0,
+               result.delete_ns / 1e6);
+        print_vfs_calls("copy", &result.copy_calls);
+        print_vfs_calls("delete", &result.delete_calls);
+
+        // The per-file libnx code opened a session for the copy, for every
+        // folder and file copied, and for every item of both deleted trees
+        printf("  sessions opened: %llu (per-file sessions would have opened %d)\n",
+               (unsigned long long)(result.copy_calls.session_opens + result.delete_calls.session_opens),
+               (1 + result.dirs + result.files) + 2 * (result.dirs + result.files));
+    }
+    vfs_memory_reset();
+    return 0;
+}
+
+static int run_tree(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s tree <dir> [depth] [files per level]\n", argv[0]);
+        return 1;
+    }
+    int depth = argc > 3 ? atoi(argv[3]) : 150;
+    int files = argc > 4 ? atoi(argv[4]) : 4;
+
+    const VfsBackend* backends[] = {vfs_backend_posix(), vfs_backend_memory()};
+    const char* roots[] = {argv[2], "/hostbench"};
+    for (int i = 0; i < 2; i++) {
+        vfs_init(backends[i]);
+        BenchTreeResult result;
+        int rc = bench_tree(roots[i], depth, files, &result);
+        vfs_init(NULL);
+        if (rc != 0) {
+            fprintf(stderr, "tree failed on the %s backend\n", backends[i]->name);
+            return 1;
+        }
+        printf("tree (%s): depth %d (reached %d), %llu dirs, %llu files, walk %.3f ms (%llu calls), copy %.1f ms, delete %.1f ms\n",
+               backends[i]->name, result.depth, result.max_depth,
+               (unsigned long long)result.dirs, (unsigned long long)result.files,
+               result.walk_ns / 1e6, (unsigned long long)result.walk_calls,
+               result.copy_ns / 1e6, result.delete_ns / 1e6);
+    }
+    vfs_memory_reset();
+    return 0;
+}
+
+static int run_transfer(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s transfer <dir> [MB]\n", argv[0]);
+        return 1;
+    }
+    // Multi-GB by default so the page cache cannot hold every copy
+    uint64_t mb = argc > 3 ? strtoull(argv[3], NULL, 10) : 4096;
+
+    vfs_init(vfs_backend_posix());
+    BenchTransferResult result;
+    int rc = bench_transfer(argv[2], mb << 20, &result);
+    vfs_init(NULL);
+
+    printf("transfer: %.1f MB file, written in %.1f ms\n",
+           result.bytes / 1e6, result.create_ns / 1e6);
+    for (int i = 0; i < result.runs; i++) {
+        const BenchTransferRun* run = &result.run[i];
+        const TransferStats* st = &run->stats;
+        printf("transfer %-11s: %8.1f ms, %7.1f MB/s", run->label, run->elapsed_ns / 1e6,
+               run->elapsed_ns ? result.bytes * 1e3 / run->elapsed_ns : 0.0);
+        if (st->pipelined) {
+            printf(", %llu reads, %llu writes, chunk %u KiB, reader wait %.1f ms, writer wait %.1f ms",
+                   (unsigned long long)st->reads, (unsigned long long)st->writes,
+                   st->chunk_final >> 10, st->reader_wait_ns / 1e6, st->writer_wait_ns / 1e6);
+        }
+        printf("\n");
+    }
+    if (rc != 0) {
+        fprintf(stderr, "transfer failed or produced a different file\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int run_copysched(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s copysched <dir> [files] [file size] [large files] [workers]\n", argv[0]);
+        return 1;
+    }
+    int files = argc > 3 ? atoi(argv[3]) : 20000;
+    uint64_t file_size = argc > 4 ? strtoull(argv[4], NULL, 10) : 4096;
+    int large = argc > 5 ? atoi(argv[5]) : 2;
+    int workers = argc > 6 ? atoi(argv[6]) : COPYSCHED_DEFAULT_WORKERS + 1;
+
+    vfs_init(vfs_backend_posix());
+    BenchCopySchedResult result;
+    int rc = bench_copysched(argv[2], files, file_size, large, workers, &result);
+    vfs_init(NULL);
+
+    printf("copysched: %d small files of %llu bytes, %d large, %.1f MB\n",
+           result.files, (unsigned long long)file_size, result.large_files, result.bytes / 1e6);
+    for (int i = 0; i < result.runs; i++) {
+        const CopySchedStats* st = &result.run[i];
+        printf("copysched %s (%d workers): %8.1f ms, %8.0f files/s, %6.1f MB/s, skeleton %.1f ms, %llu steals\n",
+               st->workers == 1 ? "serial  " : "parallel", st->workers, st->elapsed_ns / 1e6,
+               st->elapsed_ns ? st->files * 1e9 / st->elapsed_ns : 0.0,
+               st->elapsed_ns ? st->bytes * 1e3 / st->elapsed_ns : 0.0,
+               st->skeleton_ns / 1e6, (unsigned long long)st->steals);
+    }
+    if (rc != 0) {
+        fprintf(stderr, "copysched failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int run_hash(int argc, char** argv)
+{
+    uint64_t mb = argc > 2 ? strtoull(argv[2], NULL, 10) : 256;
+
+    BenchHashResult result;
+    if (bench_hash(mb << 20, &result) != 0) {
+        fprintf(stderr, "hash benchmark failed\n");
+        return 1;
+    }
+    for (int a = HASH_CRC32; a < HASH_ALGO_COUNT; a++) {
+        printf("hash %-7s: %llu MB in %8.1f ms, %5.2f GB/s\n", hash_name((HashAlgo)a),
+               (unsigned long long)mb, result.elapsed_ns[a] / 1e6, result.gb_per_sec[a]);
+    }
+    return 0;
+}
+
+static int run_sync(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s sync <dir> [files] [file size]\n", argv[0]);
+        return 1;
+    }
+    int files = argc > 3 ? atoi(argv[3]) : 10000;
+    uint64_t file_size = argc > 4 ? strtoull(argv[4], NULL, 10) : 4096;
+
+    vfs_init(vfs_backend_posix());
+    BenchSyncResult result;
+    int rc = bench_sync(argv[2], files, file_size, &result);
+    vfs_init(NULL);
+
+    printf("sync: %d files of %llu bytes, walk of both trees %.1f ms\n", result.files,
+           (unsigned long long)file_size, result.walk_ns / 1e6);
+    printf("sync unchanged: metadata %.1f ms (%.2fx walk), contents %.1f ms (%llu probed)\n",
+           result.plan_ns / 1e6, result.walk_ns ? (double)result.plan_ns / result.walk_ns : 0.0,
+           result.content_ns / 1e6, (unsigned long long)result.probed);
+    printf("sync edited: %llu new, %llu changed, %llu deleted, executed in %.1f ms\n",
+           (unsigned long long)result.changes[SYNC_NEW],
+           (unsigned long long)result.changes[SYNC_CHANGED],
+           (unsigned long long)result.changes[SYNC_DELETED], result.execute_ns / 1e6);
+    if (rc != 0) {
+        fprintf(stderr, "sync failed or planned the wrong changes\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int run_delete(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s delete <dir> [files]\n", argv[0]);
+        return 1;
+    }
+    int files = argc > 3 ? atoi(argv[3]) : 50000;
+
+    vfs_init(vfs_backend_posix());
+    BenchDeleteResult result;
+    int rc = bench_delete(argv[2], files, &result);
+    vfs_init(NULL);
+
+    printf("delete: %d files, one by one %.1f ms, delete_item %.1f ms\n", result.files,
+           result.legacy_ns / 1e6, result.batched_ns / 1e6);
+    printf("delete to trash: %.3f ms (%.1f ms saved), background purge %.1f ms\n",
+           result.trash_ns / 1e6, (result.legacy_ns - (double)result.trash_ns) / 1e6,
+           result.purge_ns / 1e6);
+    if (rc != 0) {
+        fprintf(stderr, "delete failed or left files behind\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int run_move(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s move <dir> [files]\n", argv[0]);
+        return 1;
+    }
+    int files = argc > 3 ? atoi(argv[3]) : 20000;
+
+    vfs_init(vfs_backend_posix());
+    BenchMoveResult result;
+    int rc = bench_move(argv[2], files, &result);
+    vfs_init(NULL);
+
+    printf("move: %d files, rename %.3f ms, copy and delete %.1f ms\n", result.files,
+           result.rename_ns / 1e6, result.copy_ns / 1e6);
+    printf("move batch: %d folders (one merged) %.3f ms, conflicting batch %s\n",
+           result.folders, result.batch_ns / 1e6,
+           result.conflict_ok ? "moved nothing" : "moved items");
+    if (rc != 0) {
+        fprintf(stderr, "move failed or left files behind\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int run_batch(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s batch <dir> [files] [entries]\n", argv[0]);
+        return 1;
+    }
+    int files = argc > 3 ? atoi(argv[3]) : 2000;
+    int entries = argc > 4 ? atoi(argv[4]) : 100000;
+
+    vfs_init(vfs_backend_posix());
+    BenchBatchResult result;
+    int rc = bench_batch(argv[2], files, entries, &result);
+    vfs_init(NULL);
+
+    printf("select: %d entries, all %.3f ms, invert %.3f ms, match %d in %.3f ms, walk %.3f ms\n",
+           result.entries, result.all_ns / 1e6, result.invert_ns / 1e6, result.matched,
+           result.match_ns / 1e6, result.walk_ns / 1e6);
+    printf("batch: %d files, one at a time %.1f ms, one batch %.1f ms\n", result.files,
+           result.single_ns / 1e6, result.batch_ns / 1e6);
+    if (rc != 0) {
+        fprintf(stderr, "batch failed or left files behind\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int run_clipboard(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s clipboard <dir> [items] [folders]\n", argv[0]);
+        return 1;
+    }
+    int items = argc > 3 ? atoi(argv[3]) : 10000;
+    int folders = argc > 4 ? atoi(argv[4]) : 50;
+
+    vfs_init(vfs_backend_posix());
+    BenchClipboardResult result;
+    int rc = bench_clipboard(argv[2], items, folders, &result);
+    vfs_init(NULL);
+
+    printf("clipboard: %d items in %d folders, add %.1f ms, load %.1f ms, drop moves %.1f ms\n",
+           result.items, result.folders, result.add_ns / 1e6, result.load_ns / 1e6,
+           result.remove_ns / 1e6);
+    printf("clipboard: %llu bytes stored vs %llu as paths (%llu as 512-byte slots), file %llu bytes, "
+           "%llu after dropping moves\n",
+           (unsigned long long)result.name_bytes, (unsigned long long)result.path_bytes,
+           (unsigned long long)result.items * 512, (unsigned long long)result.file_bytes,
+           (unsigned long long)result.compact_bytes);
+    if (rc != 0) {
+        fprintf(stderr, "clipboard lost items (%d found)\n", result.reloaded);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <listing|layout|sort|filter|index|dirsize|prefetch|fileops|tree|transfer|copysched|hash|sync|delete|move|batch|clipboard> ...\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "listing") == 0)
+        return run_listing(argc, argv);
+    if (strcmp(argv[1], "layout") == 0)
+        return run_layout(argc, argv);
+    if (strcmp(argv[1], "sort") == 0)
+        return run_sort(argc, argv);
+    if (strcmp(argv[1], "filter") == 0)
+        return run_filter(argc, argv);
+    if (strcmp(argv[1], "index") == 0)
+        return run_index(argc, argv);
+    if (strcmp(argv[1], "dirsize") == 0)
+        return run_dirsize(argc, argv);
+    if (strcmp(argv[1], "prefetch") == 0)
+        return run_prefetch(argc, argv);
+    if (strcmp(argv[1], "fileops") == 0)
+        return run_fileops(argc, argv);
+    if (strcmp(argv[1], "tree") == 0)
+        return run_tree(argc, argv);
+    if (strcmp(argv[1], "transfer") == 0)
+        return run_transfer(argc, argv);
+    if (strcmp(argv[1], "copysched") == 0)
+        return run_copysched(argc, argv);
+    if (strcmp(argv[1], "hash") == 0)
+        return run_hash(argc, argv);
+    if (strcmp(argv[1], "sync") == 0)
+        return run_sync(argc, argv);
+    if (strcmp(argv[1], "delete") == 0)
+        return run_delete(argc, argv);
+    if (strcmp(argv[1], "move") == 0)
+        return run_move(argc, argv);
+    if (strcmp(argv[1], "batch") == 0)
+        return run_batch(argc, argv);
+    if (strcmp(argv[1], "clipboard") == 0)
+        return run_clipboard(argc, argv);
+
+    fprintf(stderr, "unknown benchmark: %s\n", argv[1]);
+    return 1;
+}